@@ -0,0 +1,109 @@
+#ifndef INCG_AGGREGATOR_H
+#define INCG_AGGREGATOR_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte.h"
+#include "ring_buffer.h"
+#include "thread.h"
+
+/*!
+ * \def AGGREGATOR_SYMBOL_COUNT
+ * \brief The amount of distinct symbols counted; one per byte value.
+ **/
+#define AGGREGATOR_SYMBOL_COUNT 256
+
+/*!
+ * \def AGGREGATOR_MAX_TOP_K
+ * \brief The maximum amount of most frequent symbols reported per window.
+ **/
+#define AGGREGATOR_MAX_TOP_K 16
+
+/*!
+ * \brief Aggregates the symbols read by several consumers over time windows.
+ *
+ * Time is cut into tumbling windows of a fixed length. Every consumer counts
+ * the symbols it reads into a partial aggregate of its own, without taking
+ * a lock or sharing a cache line with the other consumers. Once a window
+ * has closed, the merger thread adds up the partials of all the consumers
+ * and prints the count, the sum and the most frequent symbols of the
+ * window, and of the sliding window made up of the last few tumbling
+ * windows.
+ **/
+typedef struct AggregatorOpaque Aggregator;
+
+/*!
+ * \brief Configuration of an aggregator.
+ **/
+typedef struct {
+    int32_t windowMilliseconds; /*!< The length of a tumbling window */
+    size_t  slidingWindows;     /*!< The amount of tumbling windows a
+                                 *   sliding window spans; 0 or 1 for no
+                                 *   sliding windows
+                                 */
+    size_t topK;                /*!< The amount of most frequent symbols
+                                 *   reported; at most AGGREGATOR_MAX_TOP_K
+                                 */
+} AggregatorConfig;
+
+/*!
+ * \brief Creates an aggregator.
+ * \param maxConsumers The maximum amount of consumers adding symbols.
+ * \param config The windows and the amount of symbols reported.
+ * \param aggregator Output parameter for the aggregator created.
+ * \return The status code.
+ * \warning The aggregator must be freed using `aggregatorFree`.
+ * \sa aggregatorFree
+ **/
+RingBufferStatusCode aggregatorCreate(
+    size_t                  maxConsumers,
+    const AggregatorConfig *config,
+    Aggregator **           aggregator);
+
+/*!
+ * \brief Frees an aggregator.
+ * \param aggregator The aggregator to free.
+ * \return The status code.
+ **/
+RingBufferStatusCode aggregatorFree(Aggregator *aggregator);
+
+/*!
+ * \brief Hands a consumer a partial aggregate of its own.
+ * \param aggregator The aggregator.
+ * \param partialIndex Output parameter for the index of the partial, to be
+ *                     passed to `aggregatorAdd`.
+ * \return The status code; RB_INVALID_ARGUMENT if `maxConsumers` have
+ *         joined already.
+ **/
+RingBufferStatusCode
+aggregatorJoin(Aggregator *aggregator, size_t *partialIndex);
+
+/*!
+ * \brief Counts symbols into the window they arrived in.
+ * \param aggregator The aggregator.
+ * \param partialIndex The index returned by `aggregatorJoin`; must only be
+ *                     used by a single thread.
+ * \param symbols The symbols.
+ * \param count The amount of symbols.
+ **/
+void aggregatorAdd(
+    Aggregator *aggregator,
+    size_t      partialIndex,
+    const byte *symbols,
+    size_t      count);
+
+/*!
+ * \brief Creates the merger thread, which reports every window once it has
+ *        closed.
+ * \param aggregator The aggregator. Must outlive the thread.
+ * \param id The thread ID.
+ * \return The thread created; NULL on failure.
+ *
+ * When shut down, the merger reports the window still open as well, so shut
+ * it down once the consumers have stopped adding symbols.
+ * \warning The return value must be freed using `threadFree` when it is no
+ *          longer needed.
+ * \sa threadFree
+ **/
+Thread *aggregatorMergerCreate(Aggregator *aggregator, int id);
+#endif /* INCG_AGGREGATOR_H */
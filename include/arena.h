@@ -0,0 +1,62 @@
+#ifndef INCG_ARENA_H
+#define INCG_ARENA_H
+#include <stddef.h>
+
+/*!
+ * \brief A preallocated region of memory to carve objects from.
+ *
+ * Allocating bumps a pointer without taking a lock, so that threads don't
+ * contend on the allocator. Objects can't be freed one by one; they are
+ * all freed along with the arena.
+ **/
+typedef struct ArenaOpaque Arena;
+
+/*!
+ * \def ARENA_ALIGNMENT
+ * \brief The alignment of every allocation in bytes.
+ *
+ * A cache line, so that objects of different threads never share one.
+ **/
+#define ARENA_ALIGNMENT 64
+
+/*!
+ * \brief Creates an arena.
+ * \param capacity The amount of bytes the arena can hand out.
+ * \return The arena created on success; otherwise NULL.
+ * \warning The return value must be freed using `arenaFree`.
+ * \sa arenaFree
+ *
+ * The memory is touched up front, so that page faults don't hit the
+ * threads allocating later on.
+ **/
+Arena *arenaCreate(size_t capacity);
+
+/*!
+ * \brief Frees an arena along with all the objects allocated from it.
+ * \param arena The arena to free.
+ **/
+void arenaFree(Arena *arena);
+
+/*!
+ * \brief Returns the amount of arena bytes an allocation takes.
+ * \param size The size of the allocation in bytes.
+ * \return `size` rounded up to ARENA_ALIGNMENT.
+ **/
+size_t arenaFootprint(size_t size);
+
+/*!
+ * \brief Allocates from an arena.
+ * \param arena The arena to allocate from.
+ * \param size The size of the allocation in bytes.
+ * \return The zeroed memory on success; NULL if the arena is exhausted.
+ * \note Thread safe.
+ **/
+void *arenaAllocate(Arena *arena, size_t size);
+
+/*!
+ * \brief Returns the amount of bytes allocated from an arena.
+ * \param arena The arena.
+ * \return The sum of the footprints of all the allocations.
+ **/
+size_t arenaUsed(const Arena *arena);
+#endif /* INCG_ARENA_H */
@@ -0,0 +1,214 @@
+#ifndef INCG_CHANNEL_MANAGER_H
+#define INCG_CHANNEL_MANAGER_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "byte.h"
+#include "ring_buffer.h"
+#include "thread.h"
+
+/*!
+ * \def CHANNEL_MANAGER_STRIPE_COUNT
+ * \brief The amount of mutexes and condition variables that the channels
+ *        share.
+ **/
+#define CHANNEL_MANAGER_STRIPE_COUNT 64
+
+/*!
+ * \brief Many small byte channels carved out of a single arena.
+ *
+ * A ring buffer brings a heap allocation, a mutex and a condition variable
+ * of its own, which adds up with one per connection. The channels of a
+ * channel manager instead consist of a header of a few words, and hold
+ * their bytes in fixed size chunks taken from a pool shared by all the
+ * channels. A channel takes chunks as it grows and gives them back as it
+ * is read, so an idle channel holds no memory at all. A channel never holds
+ * more chunks than its quota allows, so a slow reader can't starve the
+ * other channels of memory.
+ *
+ * The channels share CHANNEL_MANAGER_STRIPE_COUNT mutexes and condition
+ * variables, channel `i` using stripe `i % CHANNEL_MANAGER_STRIPE_COUNT`.
+ **/
+typedef struct ChannelManagerOpaque ChannelManager;
+
+/*!
+ * \brief Identifies a channel of a channel manager.
+ **/
+typedef uint32_t ChannelId;
+
+/*!
+ * \brief Statistics of a channel.
+ **/
+typedef struct {
+    size_t size;       /*!< The amount of bytes unread */
+    size_t chunkCount; /*!< The amount of chunks held */
+    size_t maxChunks;  /*!< The quota of the channel in chunks */
+} ChannelStats;
+
+/*!
+ * \brief Returns the amount of arena bytes a channel manager needs.
+ * \param maxChannels The maximum amount of channels open at once.
+ * \param chunkCount The amount of chunks shared by the channels.
+ * \param chunkSize The size of every chunk in bytes.
+ * \return The amount of bytes to reserve in the arena for the manager.
+ **/
+size_t channelManagerArenaSize(
+    size_t maxChannels,
+    size_t chunkCount,
+    size_t chunkSize);
+
+/*!
+ * \brief Creates a channel manager.
+ * \param arena The arena to carve the manager, its channels and its chunks
+ *              from; must have `channelManagerArenaSize` bytes left.
+ * \param maxChannels The maximum amount of channels open at once.
+ * \param chunkCount The amount of chunks shared by the channels.
+ * \param chunkSize The size of every chunk in bytes.
+ * \param manager Output parameter to write the manager to.
+ * \return The status code.
+ * \warning The manager must be destroyed using `channelManagerDestroy`
+ *          before the arena is freed.
+ * \sa channelManagerDestroy
+ **/
+RingBufferStatusCode channelManagerCreate(
+    Arena *          arena,
+    size_t           maxChannels,
+    size_t           chunkCount,
+    size_t           chunkSize,
+    ChannelManager **manager);
+
+/*!
+ * \brief Destroys the mutexes and condition variables of a channel manager.
+ * \param manager The manager to destroy.
+ * \return The status code.
+ * \note The memory lives in the arena and is freed along with it.
+ **/
+RingBufferStatusCode channelManagerDestroy(ChannelManager *manager);
+
+/*!
+ * \brief Opens a channel.
+ * \param manager The manager.
+ * \param quota The maximum amount of chunk bytes the channel may hold; at
+ *              least one chunk.
+ * \param channel Output parameter for the channel opened.
+ * \return The status code; RB_INVALID_ARGUMENT if `maxChannels` are open
+ *         already.
+ **/
+RingBufferStatusCode channelManagerOpen(
+    ChannelManager *manager,
+    size_t          quota,
+    ChannelId *     channel);
+
+/*!
+ * \brief Closes a channel, dropping the bytes unread.
+ * \param manager The manager.
+ * \param channel The channel to close.
+ * \return The status code.
+ * \note Threads blocked reading from or writing to the channel return
+ *       RB_INVALID_ARGUMENT. No thread may start operating on it anymore.
+ **/
+RingBufferStatusCode
+channelManagerClose(ChannelManager *manager, ChannelId channel);
+
+/*!
+ * \brief Writes as many bytes as the quota and the free chunks allow.
+ * \param manager The manager.
+ * \param channel The channel to write to.
+ * \param source The bytes to write.
+ * \param byteCount The amount of bytes in `source`.
+ * \param bytesWritten Output parameter for the amount of bytes written.
+ * \return The status code.
+ **/
+RingBufferStatusCode channelManagerTryWrite(
+    ChannelManager *manager,
+    ChannelId       channel,
+    const byte *    source,
+    size_t          byteCount,
+    size_t *        bytesWritten);
+
+/*!
+ * \brief Writes bytes, blocking while the channel is at its quota.
+ * \param manager The manager.
+ * \param channel The channel to write to.
+ * \param source The bytes to write.
+ * \param byteCount The amount of bytes in `source`.
+ * \param bytesWritten Output parameter for the amount of bytes written.
+ * \param self The writer thread.
+ * \return The status code; RB_NOMEM if the chunks shared by all the
+ *         channels have run out, RB_THREAD_SHOULD_SHUTDOWN if `self` should
+ *         shut down, RB_INVALID_ARGUMENT if the channel is closed meanwhile.
+ *         Either way `bytesWritten` tells how many of the bytes made it.
+ **/
+RingBufferStatusCode channelManagerWrite(
+    ChannelManager *manager,
+    ChannelId       channel,
+    const byte *    source,
+    size_t          byteCount,
+    size_t *        bytesWritten,
+    Thread *        self);
+
+/*!
+ * \brief Reads the bytes available without blocking.
+ * \param manager The manager.
+ * \param channel The channel to read from.
+ * \param destination The buffer to read into.
+ * \param maxBytes The size of `destination` in bytes.
+ * \param bytesRead Output parameter for the amount of bytes read; 0 if the
+ *                  channel is empty.
+ * \return The status code.
+ **/
+RingBufferStatusCode channelManagerTryRead(
+    ChannelManager *manager,
+    ChannelId       channel,
+    byte *          destination,
+    size_t          maxBytes,
+    size_t *        bytesRead);
+
+/*!
+ * \brief Reads the bytes available, blocking while the channel is empty.
+ * \param manager The manager.
+ * \param channel The channel to read from.
+ * \param destination The buffer to read into.
+ * \param maxBytes The size of `destination` in bytes; at least 1.
+ * \param bytesRead Output parameter for the amount of bytes read.
+ * \param self The reader thread.
+ * \return The status code; RB_THREAD_SHOULD_SHUTDOWN if `self` should shut
+ *         down while the channel is empty, RB_INVALID_ARGUMENT if the
+ *         channel is closed meanwhile.
+ **/
+RingBufferStatusCode channelManagerRead(
+    ChannelManager *manager,
+    ChannelId       channel,
+    byte *          destination,
+    size_t          maxBytes,
+    size_t *        bytesRead,
+    Thread *        self);
+
+/*!
+ * \brief Retrieves the statistics of a channel.
+ * \param manager The manager.
+ * \param channel The channel.
+ * \param stats Output parameter for the statistics.
+ * \return The status code.
+ **/
+RingBufferStatusCode channelManagerStats(
+    ChannelManager *manager,
+    ChannelId       channel,
+    ChannelStats *  stats);
+
+/*!
+ * \brief Returns the amount of chunks that no channel holds.
+ * \param manager The manager.
+ * \return The amount of free chunks.
+ **/
+size_t channelManagerFreeChunks(ChannelManager *manager);
+
+/*!
+ * \brief Wakes all the threads waiting, so that they reexamine their
+ *        shutdown state.
+ * \param manager The manager.
+ * \return The status code.
+ **/
+RingBufferStatusCode channelManagerShutdown(ChannelManager *manager);
+#endif /* INCG_CHANNEL_MANAGER_H */
@@ -4,11 +4,37 @@
 #include <stdint.h>
 
 typedef struct {
-    bool    isOk; /*!< Must be checked before other members are accessed */
-    int32_t producerCount;
-    int32_t consumerCount;
-    int32_t producerSleepTime; /*!< in seconds */
-    int32_t consumerSleepTime; /*!< in seconds */
+    bool        isOk; /*!< Must be checked before other members are accessed */
+    int32_t     producerCount;
+    int32_t     consumerCount;
+    int32_t     producerSleepTime;  /*!< in seconds */
+    int32_t     consumerSleepTime;  /*!< in seconds */
+    const char *spillDirectory;     /*!< NULL if not given */
+    int32_t     spillHighWaterMark; /*!< in bytes; 0 if not given */
+    const char *consumerMode;       /*!< NULL if not given */
+    const char *sinkPath;           /*!< NULL if not given */
+    int32_t     fiberWorkers;       /*!< 0 if not given */
+    int32_t     payloadSize;        /*!< in bytes; 0 if not given */
+    const char *transport;          /*!< NULL if not given */
+    int32_t     drainDeadline;      /*!< in milliseconds; 0 if not given */
+    int32_t     ringBufferSize;     /*!< in bytes; 0 if not given */
+    int32_t     maxRingBufferSize;  /*!< in bytes; 0 if not given */
+    const char *tracePath;          /*!< NULL if not given */
+    const char *fairness;           /*!< NULL if not given */
+    const char *recordPath;         /*!< NULL if not given */
+    const char *replayPath;         /*!< NULL if not given */
+    const char *replaySpeed;        /*!< NULL if not given */
+    int32_t     partitions;         /*!< 0 if not given */
+    int32_t     windowMilliseconds; /*!< 0 if not given */
+    int32_t     slidingWindows;     /*!< 0 if not given */
+    int32_t     topK;               /*!< 0 if not given */
+    int32_t     watchdogStall;      /*!< in milliseconds; 0 if not given */
+    int32_t     p99Limit;           /*!< in microseconds; 0 if not given */
+    int32_t     lingerBatchSize;    /*!< in bytes; 0 if not given */
+    int32_t     lingerMilliseconds; /*!< 0 if not given */
+    const char *ingestPath;         /*!< NULL if not given */
+    int32_t     threadStackSize;    /*!< in bytes; 0 if not given */
+    int32_t     startupThreads;     /*!< 0 if not given */
 } CmdArgs;
 
 /*!
@@ -16,6 +42,29 @@ typedef struct {
  * \param argc The count of command line arguments from main.
  * \param argv The command line arguments from main.
  * \return The result parsed.
+ *
+ * The options `--producerCount`, `--consumerCount`, `--producerSleepTime` and
+ * `--consumerSleepTime` are required, all the others are optional.
  **/
 CmdArgs parseCmdArgs(int argc, char **argv);
+
+typedef struct {
+    bool        isOk; /*!< Must be checked before other members are accessed */
+    const char *name; /*!< Name of the shared memory object */
+    int32_t     sleepTime;      /*!< in seconds */
+    int32_t     id;             /*!< The thread ID to use; optional */
+    int32_t     ringBufferSize; /*!< in bytes; 0 if not given */
+} ShmCmdArgs;
+
+/*!
+ * \brief Parses the command line arguments of the shared memory producer and
+ *        consumer applications.
+ * \param argc The count of command line arguments from main.
+ * \param argv The command line arguments from main.
+ * \return The result parsed.
+ *
+ * The options `--name` and `--sleepTime` are required, `--id` and
+ * `--ringBufferSize` are optional.
+ **/
+ShmCmdArgs parseShmCmdArgs(int argc, char **argv);
 #endif /* INCG_CMD_ARGS_H */
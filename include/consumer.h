@@ -1,6 +1,127 @@
 #ifndef INCG_CONSUMER_H
 #define INCG_CONSUMER_H
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "aggregator.h"
+#include "byte.h"
+#include "fiber_scheduler.h"
+#include "message_pool.h"
+#include "partitioned_ring.h"
+#include "payload.h"
 #include "thread.h"
+#include "watchdog.h"
+#include "workload.h"
+
+/*!
+ * \def CONSUMER_VERIFY_BATCH_SIZE
+ * \brief The maximum amount of frames a verifying consumer reads at once.
+ **/
+#define CONSUMER_VERIFY_BATCH_SIZE 8
+
+/*!
+ * \def CONSUMER_MIN_BATCH_SIZE
+ * \brief The smallest batch limit of an adaptive consumer in bytes.
+ **/
+#define CONSUMER_MIN_BATCH_SIZE 1
+
+/*!
+ * \def CONSUMER_MAX_BATCH_SIZE
+ * \brief The largest batch limit of an adaptive consumer in bytes.
+ **/
+#define CONSUMER_MAX_BATCH_SIZE 4096
+
+/*!
+ * \brief Processes a batch of bytes consumed.
+ * \param span The bytes, pointing into the ring buffer; only valid during
+ *             the call.
+ * \param size The amount of bytes in `span`; at least 1.
+ * \param consumerId The thread ID of the consumer.
+ * \param context The `spanHandlerContext` of the `ConsumerConfig`.
+ * \return true to go on; false to stop the consumer with an error.
+ **/
+typedef bool (*ConsumerSpanHandler)(
+    const byte *span,
+    size_t      size,
+    int         consumerId,
+    void *      context);
+
+/*!
+ * \brief The ways a consumer can consume data.
+ **/
+typedef enum {
+    CONSUMER_MODE_BLOCKING,  /*!< Blocks in `ringBufferRead` */
+    CONSUMER_MODE_EVENT_LOOP, /*!< Waits for the readable eventfd using epoll
+                               *   and drains using `ringBufferTryRead`.
+                               *   Requires `ringBufferEnableNotifications`.
+                               */
+    CONSUMER_MODE_SINK, /*!< Writes the bytes to a file in place, keeping
+                         *   several writes in flight. POSIX only.
+                         */
+    CONSUMER_MODE_VERIFY, /*!< Reads whole frames using
+                           *   `ringBufferReadRecords` and verifies them.
+                           */
+    CONSUMER_MODE_ADAPTIVE, /*!< Hands everything available, up to a batch
+                             *   limit that follows the load, to a span
+                             *   handler at once.
+                             */
+    CONSUMER_MODE_RECORD, /*!< Records the bytes or frames read along with
+                           *   their arrival times using a
+                           *   `WorkloadRecorder`.
+                           */
+    CONSUMER_MODE_AGGREGATE /*!< Counts the bytes read into time windows
+                             *   using an `Aggregator`.
+                             */
+} ConsumerMode;
+
+/*!
+ * \brief Configuration of a consumer.
+ **/
+typedef struct {
+    ConsumerMode     mode;        /*!< How the consumer waits for data */
+    const char *     sinkPath;    /*!< The file that CONSUMER_MODE_SINK
+                                   *   writes to
+                                   */
+    size_t           payloadSize; /*!< The payload size of the frames that
+                                   *   CONSUMER_MODE_VERIFY reads
+                                   */
+    PayloadVerifier *verifier;    /*!< Shared by the CONSUMER_MODE_VERIFY
+                                   *   consumers
+                                   */
+    MessagePool *    pool;        /*!< NULL if the frames are copied through
+                                   *   the ring buffer; otherwise the pool
+                                   *   that the handles read refer to
+                                   */
+    ConsumerSpanHandler spanHandler; /*!< Called by CONSUMER_MODE_ADAPTIVE
+                                      *   for every batch; NULL prints the
+                                      *   bytes
+                                      */
+    void *spanHandlerContext; /*!< Passed to `spanHandler` */
+    WorkloadRecorder *recorder; /*!< Shared by the CONSUMER_MODE_RECORD
+                                 *   consumers; its message size is the
+                                 *   frame size, or 0 for single bytes
+                                 */
+    PartitionedRing *partitions; /*!< NULL to read the frames from the ring
+                                  *   buffer; otherwise the partitioned ring
+                                  *   that CONSUMER_MODE_VERIFY consumers
+                                  *   join and read from
+                                  */
+    Aggregator *aggregator; /*!< Shared by the CONSUMER_MODE_AGGREGATE
+                             *   consumers
+                             */
+    Watchdog *watchdog; /*!< NULL, or the watchdog that CONSUMER_MODE_BLOCKING
+                         *   and CONSUMER_MODE_VERIFY consumers report their
+                         *   progress to
+                         */
+} ConsumerConfig;
+
+/*!
+ * \brief Parses a consumer mode.
+ * \param string The string to parse, e.g. "eventLoop" or "verify".
+ * \param mode Output parameter for the mode parsed.
+ * \return true on success; false if `string` names no consumer mode.
+ **/
+bool consumerModeFromString(const char *string, ConsumerMode *mode);
 
 /*!
  * \brief Creates a consumer thread.
@@ -8,11 +129,34 @@
  * \param sleepTimeSeconds How many seconds the consumer should sleep every
  *                         iteration.
  * \param id The thread ID of the consumer thread to create.
+ * \param config How the consumer consumes data. Must outlive the thread.
  * \return The thread created.
  * \warning The return value must be freed using `threadFree`
  *          when it is no longer needed.
  * \sa threadFree
  **/
-Thread *
-consumerCreate(RingBuffer *ringBuffer, int32_t sleepTimeSeconds, int id);
+Thread *consumerCreate(
+    RingBuffer *          ringBuffer,
+    int32_t               sleepTimeSeconds,
+    int                   id,
+    const ConsumerConfig *config);
+
+/*!
+ * \brief Spawns a consumer fiber.
+ * \param scheduler The scheduler to run the consumer on.
+ * \param ringBuffer A pointer to the ring buffer that the consumer should use.
+ *                   Requires `ringBufferEnableNotifications`.
+ * \param sleepTimeSeconds How many seconds the consumer should sleep every
+ *                         iteration.
+ * \param id The fiber ID.
+ * \return true on success; otherwise false.
+ *
+ * Instead of blocking its worker thread while the ring buffer is empty the
+ * consumer waits for the readable eventfd, letting other fibers run.
+ **/
+bool consumerSpawn(
+    FiberScheduler *scheduler,
+    RingBuffer *    ringBuffer,
+    int32_t         sleepTimeSeconds,
+    int             id);
 #endif /* INCG_CONSUMER_H */
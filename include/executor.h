@@ -0,0 +1,106 @@
+#ifndef INCG_EXECUTOR_H
+#define INCG_EXECUTOR_H
+#include <stddef.h>
+
+#include "byte.h"
+#include "ring_buffer.h"
+
+/*!
+ * \brief Work stealing thread pool.
+ *
+ * Tasks submitted from outside the pool go through a ring buffer, the global
+ * submission queue. Every worker has a deque of its own: it takes tasks
+ * from the global queue in batches, runs the first one and keeps the rest
+ * in its deque, where idle workers steal them from. Tasks submitted by
+ * running tasks go straight into the deque of their worker.
+ **/
+typedef struct ExecutorOpaque Executor;
+
+/*!
+ * \brief The function of a task.
+ * \param payload The task's copy of the payload submitted.
+ **/
+typedef void (*TaskFunction)(void *payload);
+
+/*!
+ * \def EXECUTOR_TASK_PAYLOAD_SIZE
+ * \brief The maximum size of the inline payload of a task in bytes.
+ *
+ * Chosen so that a task fills a cache line on 64 bit systems.
+ **/
+#define EXECUTOR_TASK_PAYLOAD_SIZE 56
+
+/*!
+ * \brief A task descriptor.
+ **/
+typedef struct {
+    TaskFunction function; /*!< The function to run */
+    byte payload[EXECUTOR_TASK_PAYLOAD_SIZE]; /*!< Passed to `function` */
+} ExecutorTask;
+
+/*!
+ * \brief Creates an executor.
+ * \param workerCount The amount of worker threads.
+ * \param queueCapacity The amount of tasks the global submission queue can
+ *                      hold before submitting blocks.
+ * \param executor Output parameter to write the executor to.
+ * \return The status code.
+ * \warning The executor must be freed using `executorFree`.
+ * \sa executorFree
+ **/
+RingBufferStatusCode executorCreate(
+    size_t     workerCount,
+    size_t     queueCapacity,
+    Executor **executor);
+
+/*!
+ * \brief Submits a task.
+ * \param executor The executor to run the task on.
+ * \param function The function to run.
+ * \param payload The payload to copy into the task; may be NULL if
+ *                `payloadSize` is 0.
+ * \param payloadSize The size of `payload`; at most
+ *                    EXECUTOR_TASK_PAYLOAD_SIZE.
+ * \return The status code.
+ *
+ * Blocks while the global submission queue is full, unless called from a
+ * task, which never blocks.
+ **/
+RingBufferStatusCode executorSubmit(
+    Executor *   executor,
+    TaskFunction function,
+    const void * payload,
+    size_t       payloadSize);
+
+/*!
+ * \brief Submits many tasks at once.
+ * \param executor The executor to run the tasks on.
+ * \param tasks The tasks to submit.
+ * \param taskCount The amount of tasks in `tasks`.
+ * \return The status code.
+ *
+ * Cheaper than submitting the tasks one by one, as they are enqueued with
+ * as few ring buffer operations as possible.
+ **/
+RingBufferStatusCode executorSubmitBatch(
+    Executor *          executor,
+    const ExecutorTask *tasks,
+    size_t              taskCount);
+
+/*!
+ * \brief Waits for all the tasks submitted to have run.
+ * \param executor The executor.
+ * \return The status code.
+ * \warning Must not be called from a task.
+ **/
+RingBufferStatusCode executorWaitAll(Executor *executor);
+
+/*!
+ * \brief Shuts down the workers and frees the executor.
+ * \param executor The executor to free.
+ * \return The status code.
+ * \note Tasks that have not started yet are discarded; call
+ *       `executorWaitAll` first to run them.
+ **/
+RingBufferStatusCode executorFree(Executor *executor);
+#endif /* INCG_EXECUTOR_H */
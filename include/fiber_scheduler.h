@@ -0,0 +1,129 @@
+#ifndef INCG_FIBER_SCHEDULER_H
+#define INCG_FIBER_SCHEDULER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ring_buffer.h"
+
+/*!
+ * \brief Cooperative scheduler running many fibers on a few worker threads.
+ *
+ * Fibers are user space tasks with small stacks of their own. A fiber runs
+ * on whichever worker thread picks it up until it yields, waits or returns;
+ * it is never preempted. Fibers that wait don't occupy a worker thread: one
+ * idle worker polls the file descriptors waited for on behalf of all of
+ * them and makes the fibers runnable again once their descriptor becomes
+ * readable.
+ * \note Only available on POSIX systems.
+ **/
+typedef struct FiberSchedulerOpaque FiberScheduler;
+
+/*!
+ * \brief A fiber run by a FiberScheduler.
+ *
+ * Handed to the fiber's function for `fiberYield`, `fiberWait` and the
+ * like; only valid until that function returns.
+ **/
+typedef struct FiberOpaque Fiber;
+
+/*!
+ * \brief The function a fiber runs, like a ThreadFunction.
+ *
+ * Fibers returning anything but EXIT_SUCCESS count as failed, see
+ * `fiberSchedulerFree`.
+ **/
+typedef int (*FiberFunction)(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Fiber *     self);
+
+/*!
+ * \def FIBER_DEFAULT_STACK_SIZE
+ * \brief The stack size of a fiber in bytes if none is given.
+ **/
+#define FIBER_DEFAULT_STACK_SIZE (64 * 1024)
+
+/*!
+ * \brief Creates a fiber scheduler.
+ * \param workerCount The amount of worker threads to run the fibers on.
+ * \param stackSize The stack size of each fiber in bytes; 0 selects
+ *                  FIBER_DEFAULT_STACK_SIZE.
+ * \return The scheduler created on success; otherwise NULL.
+ * \warning The return value must be freed using `fiberSchedulerFree`.
+ * \sa fiberSchedulerFree
+ **/
+FiberScheduler *fiberSchedulerCreate(size_t workerCount, size_t stackSize);
+
+/*!
+ * \brief Spawns a fiber.
+ * \param scheduler The scheduler to run the fiber on.
+ * \param function The function that the fiber will run.
+ * \param ringBuffer The ring buffer.
+ * \param sleepTimeSeconds The sleep time.
+ * \param id The fiber ID.
+ * \return true on success; otherwise false.
+ *
+ * The fiber is freed by the scheduler once its function returned.
+ **/
+bool fiberSpawn(
+    FiberScheduler *scheduler,
+    FiberFunction   function,
+    RingBuffer *    ringBuffer,
+    int32_t         sleepTimeSeconds,
+    int             id);
+
+/*!
+ * \brief Lets the other runnable fibers run before continuing.
+ * \param self The fiber calling.
+ **/
+void fiberYield(Fiber *self);
+
+/*!
+ * \brief Parks the fiber until an eventfd is signalled.
+ * \param self The fiber calling.
+ * \param eventFd The non-blocking eventfd to wait for, e.g. the one returned
+ *                by `ringBufferReadableFd`.
+ *
+ * The scheduler resets the eventfd and wakes all the fibers waiting for it,
+ * in the order they started waiting. Fibers may be woken spuriously, so they
+ * should retry whatever they were waiting for and wait again if need be.
+ * Returns right away once the scheduler is shutting down.
+ **/
+void fiberWait(Fiber *self, int eventFd);
+
+/*!
+ * \brief Parks the fiber for some time without blocking its worker thread.
+ * \param self The fiber calling.
+ * \param seconds The count of seconds to sleep for; 0 just yields.
+ **/
+void fiberSleep(Fiber *self, int32_t seconds);
+
+/*!
+ * \brief Checks whether the fiber should shut down.
+ * \param self The fiber calling.
+ * \return true once `fiberSchedulerShutdown` has been called.
+ **/
+bool fiberShouldShutdown(Fiber *self);
+
+/*!
+ * \brief Requests all the fibers to shut down.
+ * \param scheduler The scheduler.
+ *
+ * Wakes all the fibers waiting, so that they can notice that they should
+ * shut down.
+ **/
+void fiberSchedulerShutdown(FiberScheduler *scheduler);
+
+/*!
+ * \brief Shuts down the scheduler, waits for all its fibers to return and
+ *        frees it.
+ * \param scheduler The scheduler to free.
+ * \param failedFiberCount Output parameter for the count of fibers that
+ *                         returned something other than EXIT_SUCCESS; may
+ *                         be NULL.
+ * \return true on success; otherwise false.
+ **/
+bool fiberSchedulerFree(FiberScheduler *scheduler, size_t *failedFiberCount);
+#endif /* INCG_FIBER_SCHEDULER_H */
@@ -0,0 +1,75 @@
+#ifndef INCG_INGEST_H
+#define INCG_INGEST_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte.h"
+
+/*!
+ * \brief Reader of a file, FIFO or stdin feeding the ring buffer.
+ *
+ * Regular files are mapped into memory and advised to be read
+ * sequentially, so that reading them is a single copy from the page cache
+ * into the destination. Anything else is read using plain reads right into
+ * the destination, which is meant to be space reserved in the ring buffer;
+ * there is no intermediate buffer either way.
+ * \note Only available on POSIX systems.
+ * \note Not thread safe; every thread should use its own source.
+ **/
+typedef struct IngestSourceOpaque IngestSource;
+
+/*!
+ * \brief Opens a source.
+ * \param path The file or FIFO to read; "-" for stdin.
+ * \return The source opened on success; otherwise NULL.
+ * \warning The return value must be freed using `ingestSourceFree`.
+ * \sa ingestSourceFree
+ **/
+IngestSource *ingestSourceOpen(const char *path);
+
+/*!
+ * \brief Unmaps and closes a source.
+ * \param source The source to free.
+ * \return true on success; otherwise false.
+ * \note stdin is left open.
+ **/
+bool ingestSourceFree(IngestSource *source);
+
+/*!
+ * \brief Checks whether the source is a mapped regular file.
+ * \param source The source.
+ * \return true if mapped; false if read using reads.
+ **/
+bool ingestSourceIsMapped(const IngestSource *source);
+
+/*!
+ * \brief Waits for bytes to read.
+ * \param source The source.
+ * \param timeoutMilliseconds The longest to wait for.
+ * \param isReady Output parameter; true if `ingestSourceRead` won't block.
+ * \return true on success; otherwise false.
+ *
+ * Lets the reader look at its shutdown state while a pipe is idle, rather
+ * than blocking in a read.
+ **/
+bool ingestSourceWait(
+    IngestSource *source,
+    int32_t       timeoutMilliseconds,
+    bool *        isReady);
+
+/*!
+ * \brief Reads the next bytes.
+ * \param source The source.
+ * \param destination The buffer to read into.
+ * \param maxBytes The size of `destination` in bytes; at least 1.
+ * \param bytesRead Output parameter for the amount of bytes read; 0 once the
+ *                  end has been reached.
+ * \return true on success; otherwise false.
+ **/
+bool ingestSourceRead(
+    IngestSource *source,
+    byte *        destination,
+    size_t        maxBytes,
+    size_t *      bytesRead);
+#endif /* INCG_INGEST_H */
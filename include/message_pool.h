@@ -0,0 +1,94 @@
+#ifndef INCG_MESSAGE_POOL_H
+#define INCG_MESSAGE_POOL_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "ring_buffer.h"
+
+/*!
+ * \brief Fixed size message buffers that are passed by handle.
+ *
+ * Every owner (a producer) has buffers of its own in a local cache that
+ * only it takes from, so acquiring a buffer takes no lock. Instead of the
+ * bytes only the handle of a buffer goes through the ring buffer. Whoever
+ * is done with the buffer (a consumer) recycles it to its owner through a
+ * lock-free queue, which the owner refills its cache from once the cache
+ * runs dry. Thus a buffer is never freed by any thread but the one that
+ * allocated it, and no allocator is involved after startup.
+ **/
+typedef struct MessagePoolOpaque MessagePool;
+
+/*!
+ * \brief Identifies a buffer of a message pool.
+ **/
+typedef uint32_t MessageHandle;
+
+/*!
+ * \brief Returns the amount of arena bytes a message pool needs.
+ * \param ownerCount The amount of owners.
+ * \param buffersPerOwner The amount of buffers of every owner.
+ * \param bufferSize The size of every buffer in bytes.
+ * \return The amount of bytes to reserve in the arena for the pool.
+ **/
+size_t messagePoolArenaSize(
+    size_t ownerCount,
+    size_t buffersPerOwner,
+    size_t bufferSize);
+
+/*!
+ * \brief Creates a message pool.
+ * \param arena The arena to carve the pool and its buffers from; must have
+ *              `messagePoolArenaSize` bytes left.
+ * \param ownerCount The amount of owners; their indices are 0 to
+ *                   `ownerCount` - 1.
+ * \param buffersPerOwner The amount of buffers of every owner.
+ * \param bufferSize The size of every buffer in bytes.
+ * \param pool Output parameter to write the pool to.
+ * \return The status code.
+ * \note The pool lives in the arena and is freed along with it.
+ **/
+RingBufferStatusCode messagePoolCreate(
+    Arena *       arena,
+    size_t        ownerCount,
+    size_t        buffersPerOwner,
+    size_t        bufferSize,
+    MessagePool **pool);
+
+/*!
+ * \brief Returns the arena that a message pool lives in.
+ * \param pool The pool.
+ * \return The arena given to `messagePoolCreate`.
+ **/
+Arena *messagePoolArena(MessagePool *pool);
+
+/*!
+ * \brief Takes a buffer from the local cache of an owner.
+ * \param pool The pool.
+ * \param ownerIndex The owner; must be the calling thread.
+ * \param handle Output parameter for the handle of the buffer.
+ * \return true on success; false if all the buffers of the owner are in
+ *         use.
+ **/
+bool messagePoolAcquire(
+    MessagePool *  pool,
+    size_t         ownerIndex,
+    MessageHandle *handle);
+
+/*!
+ * \brief Returns the memory of a buffer.
+ * \param pool The pool.
+ * \param handle The handle of the buffer.
+ * \return The buffer, aligned to ARENA_ALIGNMENT.
+ **/
+void *messagePoolData(MessagePool *pool, MessageHandle handle);
+
+/*!
+ * \brief Hands a buffer back to its owner.
+ * \param pool The pool.
+ * \param handle The handle of the buffer, which must not be used after.
+ * \note Lock-free; may be called by any thread.
+ **/
+void messagePoolRecycle(MessagePool *pool, MessageHandle handle);
+#endif /* INCG_MESSAGE_POOL_H */
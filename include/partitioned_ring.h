@@ -0,0 +1,151 @@
+#ifndef INCG_PARTITIONED_RING_H
+#define INCG_PARTITIONED_RING_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte.h"
+#include "ring_buffer.h"
+#include "thread.h"
+
+/*!
+ * \brief A set of ring buffers, one per partition, that keyed records are
+ *        routed to.
+ *
+ * Writers hash the key of a record to its partition, so that all the
+ * records of a key end up in the same ring buffer. Every partition is owned
+ * by exactly one of the consumers that have joined, so the records of a key
+ * are read, and processed, in the order they were written, no matter how
+ * many consumers there are.
+ *
+ * Whenever a consumer joins or leaves, the partitions are spread over the
+ * consumers anew. A partition only moves to its new owner once the previous
+ * owner has come back for its next batch, and thereby finished processing
+ * the records it read from the partition before.
+ **/
+typedef struct PartitionedRingOpaque PartitionedRing;
+
+/*!
+ * \brief Creates a partitioned ring.
+ * \param partitionCount The amount of partitions; at least 1.
+ * \param partitionSize The size of the ring buffer of every partition in
+ *                      bytes.
+ * \param maxConsumers The maximum amount of consumers joined at once.
+ * \param partitionedRing Output parameter for the partitioned ring created.
+ * \return The status code.
+ * \warning The partitioned ring must be freed using `partitionedRingFree`.
+ * \sa partitionedRingFree
+ **/
+RingBufferStatusCode partitionedRingCreate(
+    size_t            partitionCount,
+    size_t            partitionSize,
+    size_t            maxConsumers,
+    PartitionedRing **partitionedRing);
+
+/*!
+ * \brief Frees a partitioned ring.
+ * \param partitionedRing The partitioned ring to free.
+ * \return The status code.
+ **/
+RingBufferStatusCode partitionedRingFree(PartitionedRing *partitionedRing);
+
+/*!
+ * \brief Returns the partition of a key.
+ * \param partitionedRing The partitioned ring.
+ * \param key The key.
+ * \return The index of the partition.
+ **/
+size_t partitionedRingPartitionOf(
+    const PartitionedRing *partitionedRing,
+    uint64_t               key);
+
+/*!
+ * \brief Writes a record to the partition of its key, blocking while the
+ *        partition is full.
+ * \param partitionedRing The partitioned ring.
+ * \param key The key of the record.
+ * \param source The record.
+ * \param byteCount The size of the record in bytes.
+ * \param threadId The thread ID of the writer.
+ * \param self The writer thread.
+ * \return The status code; see `ringBufferWriteRecord`.
+ **/
+RingBufferStatusCode partitionedRingWrite(
+    PartitionedRing *partitionedRing,
+    uint64_t         key,
+    const byte *     source,
+    size_t           byteCount,
+    int              threadId,
+    Thread *         self);
+
+/*!
+ * \brief Adds a consumer, taking over its share of the partitions.
+ * \param partitionedRing The partitioned ring.
+ * \param consumerIndex Output parameter for the index of the consumer, to be
+ *                      passed to `partitionedRingRead`.
+ * \return The status code; RB_INVALID_ARGUMENT if `maxConsumers` have
+ *         joined already.
+ **/
+RingBufferStatusCode partitionedRingJoin(
+    PartitionedRing *partitionedRing,
+    size_t *         consumerIndex);
+
+/*!
+ * \brief Removes a consumer, handing its partitions to the others.
+ * \param partitionedRing The partitioned ring.
+ * \param consumerIndex The index returned by `partitionedRingJoin`.
+ * \return The status code.
+ * \note The consumer must have finished processing what it read.
+ **/
+RingBufferStatusCode partitionedRingLeave(
+    PartitionedRing *partitionedRing,
+    size_t           consumerIndex);
+
+/*!
+ * \brief Reads whole records of a single partition, blocking until one of
+ *        the partitions of the consumer has any.
+ * \param partitionedRing The partitioned ring.
+ * \param consumerIndex The index returned by `partitionedRingJoin`.
+ * \param destination The buffer to read into; must hold `maxRecords`
+ *                    records.
+ * \param recordSize The size of every record in bytes.
+ * \param maxRecords The maximum amount of records to read.
+ * \param recordsRead Output parameter for the amount of records read.
+ * \param threadId The thread ID of the consumer.
+ * \param self The consumer thread.
+ * \return The status code; RB_THREAD_SHOULD_SHUTDOWN once `self` should
+ *         shut down and none of its partitions has records.
+ *
+ * Calling this function again tells the partitioned ring that the records
+ * read before have been processed.
+ **/
+RingBufferStatusCode partitionedRingRead(
+    PartitionedRing *partitionedRing,
+    size_t           consumerIndex,
+    byte *           destination,
+    size_t           recordSize,
+    size_t           maxRecords,
+    size_t *         recordsRead,
+    int              threadId,
+    Thread *         self);
+
+/*!
+ * \brief Waits until all the partitions have been read.
+ * \param partitionedRing The partitioned ring.
+ * \param timeoutMilliseconds The maximum time to wait for.
+ * \param remaining Output parameter for the amount of bytes still unread.
+ * \return The status code; RB_TIMED_OUT if bytes remain after the timeout.
+ * \sa ringBufferWaitDrained
+ **/
+RingBufferStatusCode partitionedRingWaitDrained(
+    PartitionedRing *partitionedRing,
+    int32_t          timeoutMilliseconds,
+    size_t *         remaining);
+
+/*!
+ * \brief Wakes all the threads waiting, so that they reexamine their
+ *        shutdown state.
+ * \param partitionedRing The partitioned ring.
+ * \return The status code.
+ **/
+RingBufferStatusCode partitionedRingShutdown(PartitionedRing *partitionedRing);
+#endif /* INCG_PARTITIONED_RING_H */
@@ -0,0 +1,145 @@
+#ifndef INCG_PAYLOAD_H
+#define INCG_PAYLOAD_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte.h"
+
+/*!
+ * \def PAYLOAD_FRAME_MAGIC
+ * \brief Marks the start of every frame ("RBPF" in little endian).
+ **/
+#define PAYLOAD_FRAME_MAGIC 0x46504252u
+
+/*!
+ * \def PAYLOAD_MAX_SIZE
+ * \brief The maximum payload size of a frame in bytes.
+ **/
+#define PAYLOAD_MAX_SIZE (16 * 1024 * 1024)
+
+/*!
+ * \brief The header in front of every payload written in frames.
+ *
+ * A frame is the header immediately followed by `length` bytes of payload.
+ * Every producer numbers its frames starting at 0, so that consumers can
+ * detect frames that were lost, duplicated or reordered.
+ **/
+typedef struct {
+    uint32_t magic;      /*!< PAYLOAD_FRAME_MAGIC */
+    uint32_t producerId; /*!< The thread ID of the producer */
+    uint64_t sequence;   /*!< The producer's frame number */
+    uint32_t length;     /*!< The size of the payload in bytes */
+    uint32_t crc;        /*!< CRC32C of the payload */
+} PayloadFrameHeader;
+
+/*!
+ * \brief Fills a buffer with the alphabet, just like the producers write it
+ *        byte by byte.
+ * \param destination The buffer to fill.
+ * \param size The size of `destination` in bytes.
+ * \param streamOffset The offset of `destination` into the endless stream
+ *                     of alphabets, so that consecutive calls continue where
+ *                     the previous one stopped.
+ * \param upperCase true for upper case letters.
+ *
+ * Uses AVX2 or SSE2 if the CPU supports it.
+ **/
+void payloadFill(
+    byte *   destination,
+    size_t   size,
+    uint64_t streamOffset,
+    bool     upperCase);
+
+/*!
+ * \brief Computes the CRC32C (Castagnoli) checksum of a buffer.
+ * \param crc The CRC of the bytes before `data`; 0 to start.
+ * \param data The bytes.
+ * \param size The amount of bytes.
+ * \return The CRC including `data`.
+ *
+ * Uses the SSE 4.2 crc32 instruction if the CPU supports it.
+ **/
+uint32_t payloadCrc32c(uint32_t crc, const byte *data, size_t size);
+
+/*!
+ * \brief Returns the names of the kernels selected for the CPU.
+ * \return E.g. "fill: avx2, crc32c: sse4.2".
+ **/
+const char *payloadKernelNames(void);
+
+/*!
+ * \brief Builds a frame.
+ * \param frame The buffer to build the frame in; must hold
+ *              `sizeof(PayloadFrameHeader) + payloadSize` bytes.
+ * \param payloadSize The size of the payload in bytes.
+ * \param producerId The thread ID of the producer.
+ * \param sequence The producer's frame number.
+ **/
+void payloadBuildFrame(
+    byte *   frame,
+    size_t   payloadSize,
+    int      producerId,
+    uint64_t sequence);
+
+/*!
+ * \brief Per producer counters of a consumer verifying frames.
+ **/
+typedef struct PayloadVerifierOpaque PayloadVerifier;
+
+/*!
+ * \brief Creates a verifier.
+ * \param producerCount The amount of producers; their IDs must be 1 to
+ *                      `producerCount`.
+ * \param consumerCount The amount of consumers verifying.
+ * \return The verifier created on success; otherwise NULL.
+ * \warning The return value must be freed using `payloadVerifierFree`.
+ **/
+PayloadVerifier *
+payloadVerifierCreate(size_t producerCount, size_t consumerCount);
+
+/*!
+ * \brief Frees a verifier.
+ * \param verifier The verifier to free.
+ **/
+void payloadVerifierFree(PayloadVerifier *verifier);
+
+/*!
+ * \brief Reserves the counters of a consumer.
+ * \param verifier The verifier.
+ * \param consumerIndex Output parameter for the index of the consumer.
+ * \return true on success; false if all `consumerCount` are taken.
+ **/
+bool payloadVerifierAttach(PayloadVerifier *verifier, size_t *consumerIndex);
+
+/*!
+ * \brief Verifies frames.
+ * \param verifier The verifier.
+ * \param consumerIndex The index returned by `payloadVerifierAttach`.
+ * \param frames The frames, one after the other.
+ * \param frameSize The size of every frame, including its header.
+ * \param frameCount The amount of frames.
+ * \param consumerId The thread ID of the consumer, for the reports.
+ * \return true if all the frames are intact and in order; otherwise false.
+ *
+ * Every consumer has counters of its own, so that consumers never contend.
+ * Problems that a consumer can tell on its own (corruption and frames of a
+ * producer going backwards) are reported to stderr right away. Gaps and
+ * duplicates spanning consumers are reported by `payloadVerifierReport`.
+ **/
+bool payloadVerifierCheck(
+    PayloadVerifier *verifier,
+    size_t           consumerIndex,
+    const byte *     frames,
+    size_t           frameSize,
+    size_t           frameCount,
+    int              consumerId);
+
+/*!
+ * \brief Merges the counters of all the consumers and reports the result.
+ * \param verifier The verifier.
+ * \return true if no frame was lost, duplicated, reordered or corrupted.
+ * \warning Must only be called once the consumers have stopped.
+ **/
+bool payloadVerifierReport(PayloadVerifier *verifier);
+#endif /* INCG_PAYLOAD_H */
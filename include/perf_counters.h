@@ -0,0 +1,73 @@
+#ifndef INCG_PERF_COUNTERS_H
+#define INCG_PERF_COUNTERS_H
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * \brief The hardware and software counters that can be measured.
+ **/
+typedef enum {
+    PERF_COUNTER_CYCLES,           /*!< CPU cycles */
+    PERF_COUNTER_INSTRUCTIONS,     /*!< Instructions retired */
+    PERF_COUNTER_CACHE_MISSES,     /*!< Last level cache misses */
+    PERF_COUNTER_BRANCH_MISSES,    /*!< Mispredicted branches */
+    PERF_COUNTER_CONTEXT_SWITCHES, /*!< Context switches */
+    PERF_COUNTER_COUNT             /*!< The amount of counters */
+} PerfCounter;
+
+/*!
+ * \brief A set of counters read using `perf_event_open`.
+ *
+ * The counters count the thread that created them along with all the
+ * threads it creates afterwards, so that a measured region may span threads.
+ * Counters that the CPU, the kernel or `perf_event_paranoid` don't permit
+ * are left out; on systems other than Linux all of them are.
+ **/
+typedef struct PerfCountersOpaque PerfCounters;
+
+/*!
+ * \brief Opens the counters.
+ * \return The counters, stopped and at zero, on success; otherwise NULL.
+ * \warning The return value must be freed using `perfCountersFree`.
+ * \note Must be called before the threads to count are created.
+ **/
+PerfCounters *perfCountersCreate(void);
+
+/*!
+ * \brief Closes the counters.
+ * \param counters The counters to free.
+ **/
+void perfCountersFree(PerfCounters *counters);
+
+/*!
+ * \brief Resets the counters to zero and starts counting.
+ * \param counters The counters.
+ **/
+void perfCountersStart(PerfCounters *counters);
+
+/*!
+ * \brief Stops counting.
+ * \param counters The counters.
+ **/
+void perfCountersStop(PerfCounters *counters);
+
+/*!
+ * \brief Reads a counter.
+ * \param counters The counters.
+ * \param counter The counter to read.
+ * \param value Output parameter for the value, scaled up if the kernel had
+ *              to multiplex the counters.
+ * \return true on success; false if the counter is not available.
+ **/
+bool perfCountersRead(
+    PerfCounters *counters,
+    PerfCounter   counter,
+    uint64_t *    value);
+
+/*!
+ * \brief Returns the name of a counter.
+ * \param counter The counter.
+ * \return E.g. "cycles".
+ **/
+const char *perfCounterName(PerfCounter counter);
+#endif /* INCG_PERF_COUNTERS_H */
@@ -1,6 +1,60 @@
 #ifndef INCG_PRODUCER_H
 #define INCG_PRODUCER_H
+#include "fiber_scheduler.h"
+#include "message_pool.h"
+#include "partitioned_ring.h"
 #include "thread.h"
+#include "watchdog.h"
+#include "workload.h"
+
+/*!
+ * \brief Configuration of a producer.
+ **/
+typedef struct {
+    size_t payloadSize; /*!< 0 to write single bytes; otherwise the payload
+                         *   size of the frames to write, see payload.h
+                         */
+    MessagePool *pool;  /*!< NULL to copy the frames into the ring buffer;
+                         *   otherwise the pool to build them in, passing
+                         *   their handles. The owner index of a producer
+                         *   is its thread ID - 1.
+                         */
+    uint64_t *writeCounts; /*!< NULL, or where every producer counts the
+                            *   bytes or frames it wrote, at its thread
+                            *   ID - 1
+                            */
+    const WorkloadReplay *replay; /*!< NULL, or the recorded workload that
+                                   *   every producer re-emits at its
+                                   *   recorded timing instead; its
+                                   *   message size must match
+                                   *   `payloadSize`
+                                   */
+    uint32_t replaySpeed; /*!< How many times faster than recorded to
+                           *   replay; 0 for as fast as possible
+                           */
+    PartitionedRing *partitions; /*!< NULL to write the frames to the ring
+                                  *   buffer; otherwise the partitioned ring
+                                  *   to write them to, keyed by the
+                                  *   producer's thread ID
+                                  */
+    Watchdog *watchdog; /*!< NULL, or the watchdog that byte and copied
+                         *   frame producers report their progress to
+                         */
+    size_t lingerBatchSize; /*!< 0 or 1 to write every byte right away;
+                             *   otherwise the amount of bytes that byte
+                             *   producers collect before writing them at
+                             *   once; at most the ring buffer's size
+                             */
+    int32_t lingerMilliseconds; /*!< The longest a byte collected waits for
+                                 *   the batch to fill up
+                                 */
+    const char *const *ingestPaths; /*!< NULL to write letters; otherwise
+                                     *   the file, FIFO or "-" for stdin
+                                     *   that every producer streams into
+                                     *   the ring buffer instead, at its
+                                     *   thread ID - 1
+                                     */
+} ProducerConfig;
 
 /*!
  * \brief Creates a producer thread.
@@ -9,12 +63,34 @@
  * \param sleepTimeSeconds The amount of seconds the producer should sleep
  *                         every iteration.
  * \param id The thread ID.
+ * \param config What the producer writes. Must outlive the thread.
  * \return The thread created.
  * \warning The return value must be freed using `threadFree` when it is no
  *          longer needed.
  * \sa threadFree
  **/
-Thread *
-producerCreate(RingBuffer *ringBuffer, int32_t sleepTimeSeconds, int id);
+Thread *producerCreate(
+    RingBuffer *          ringBuffer,
+    int32_t               sleepTimeSeconds,
+    int                   id,
+    const ProducerConfig *config);
 
+/*!
+ * \brief Spawns a producer fiber.
+ * \param scheduler The scheduler to run the producer on.
+ * \param ringBuffer A pointer to the ring buffer that the producer should write
+ *                   to. Requires `ringBufferEnableNotifications`.
+ * \param sleepTimeSeconds The amount of seconds the producer should sleep
+ *                         every iteration.
+ * \param id The fiber ID.
+ * \return true on success; otherwise false.
+ *
+ * Instead of blocking its worker thread while the ring buffer is full the
+ * producer waits for the writable eventfd, letting other fibers run.
+ **/
+bool producerSpawn(
+    FiberScheduler *scheduler,
+    RingBuffer *    ringBuffer,
+    int32_t         sleepTimeSeconds,
+    int             id);
 #endif /* INCG_PRODUCER_H */
@@ -0,0 +1,187 @@
+#ifndef INCG_REQUEST_CHANNEL_H
+#define INCG_REQUEST_CHANNEL_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte.h"
+#include "ring_buffer.h"
+#include "thread.h"
+
+/*!
+ * \brief A request/reply channel between requesters and responders.
+ *
+ * The requests travel through a ring buffer shared by all the requesters.
+ * Every requester has a reply slot of its own, which the responder writes
+ * the reply to directly, so replies never queue behind the replies of other
+ * requesters. A requester has at most one request underway; it learns about
+ * the reply by polling its ticket or by blocking on it.
+ **/
+typedef struct RequestChannelOpaque RequestChannel;
+
+/*!
+ * \brief Identifies a request, so that its reply finds its way back.
+ **/
+typedef struct {
+    uint32_t requester; /*!< The index of the requester */
+    uint32_t sequence;  /*!< The requester's request number */
+} RequestTicket;
+
+/*!
+ * \brief A request received by a responder.
+ **/
+typedef struct {
+    RequestTicket ticket; /*!< To be passed to `requestChannelReply` */
+    const byte *  data;   /*!< The request; points into the buffer passed to
+                           *   `requestChannelReceive`
+                           */
+    size_t size;          /*!< The size of `data` in bytes */
+} RequestChannelRequest;
+
+/*!
+ * \brief Creates a request/reply channel.
+ * \param ringBufferSize The size of the ring buffer carrying the requests;
+ *                       must hold at least one request.
+ * \param maxRequesters The maximum amount of requesters attached at once.
+ * \param maxRequestSize The maximum size of a request in bytes.
+ * \param maxReplySize The maximum size of a reply in bytes.
+ * \param channel Output parameter for the channel created.
+ * \return The status code.
+ * \warning The channel must be freed using `requestChannelFree`.
+ * \sa requestChannelFree
+ **/
+RingBufferStatusCode requestChannelCreate(
+    size_t           ringBufferSize,
+    size_t           maxRequesters,
+    size_t           maxRequestSize,
+    size_t           maxReplySize,
+    RequestChannel **channel);
+
+/*!
+ * \brief Frees a request/reply channel.
+ * \param channel The channel to free.
+ * \return The status code.
+ **/
+RingBufferStatusCode requestChannelFree(RequestChannel *channel);
+
+/*!
+ * \brief Takes a reply slot.
+ * \param channel The channel.
+ * \param requester Output parameter for the index of the requester.
+ * \return The status code; RB_INVALID_ARGUMENT if all the slots are taken.
+ **/
+RingBufferStatusCode
+requestChannelAttach(RequestChannel *channel, uint32_t *requester);
+
+/*!
+ * \brief Gives back a reply slot.
+ * \param channel The channel.
+ * \param requester The index returned by `requestChannelAttach`.
+ * \return The status code.
+ * \note The requester must not have a request underway.
+ **/
+RingBufferStatusCode
+requestChannelDetach(RequestChannel *channel, uint32_t requester);
+
+/*!
+ * \brief Submits a request, blocking while the ring buffer is full.
+ * \param channel The channel.
+ * \param requester The index returned by `requestChannelAttach`.
+ * \param request The request.
+ * \param size The size of `request` in bytes.
+ * \param ticket Output parameter for the ticket of the request.
+ * \param threadId The thread ID of the requester.
+ * \param self The requester thread.
+ * \return The status code; RB_INVALID_ARGUMENT if the request is too large
+ *         or the previous request of the requester hasn't been answered.
+ **/
+RingBufferStatusCode requestChannelSubmit(
+    RequestChannel *channel,
+    uint32_t        requester,
+    const byte *    request,
+    size_t          size,
+    RequestTicket * ticket,
+    int             threadId,
+    Thread *        self);
+
+/*!
+ * \brief Checks whether a request has been answered, without blocking.
+ * \param channel The channel.
+ * \param ticket The ticket of the request.
+ * \param reply The buffer to copy the reply to; must hold `maxReplySize`
+ *              bytes.
+ * \param replySize Output parameter for the size of the reply.
+ * \param isDone Output parameter; true if the reply has been copied.
+ * \return The status code.
+ **/
+RingBufferStatusCode requestChannelPoll(
+    RequestChannel *     channel,
+    const RequestTicket *ticket,
+    byte *               reply,
+    size_t *             replySize,
+    bool *               isDone);
+
+/*!
+ * \brief Waits until a request has been answered.
+ * \param channel The channel.
+ * \param ticket The ticket of the request.
+ * \param reply The buffer to copy the reply to; must hold `maxReplySize`
+ *              bytes.
+ * \param replySize Output parameter for the size of the reply.
+ * \param self The requester thread.
+ * \return The status code; RB_THREAD_SHOULD_SHUTDOWN if `self` should shut
+ *         down before the reply arrived.
+ **/
+RingBufferStatusCode requestChannelWait(
+    RequestChannel *     channel,
+    const RequestTicket *ticket,
+    byte *               reply,
+    size_t *             replySize,
+    Thread *             self);
+
+/*!
+ * \brief Returns the size of the buffer a responder receives requests into.
+ * \param channel The channel.
+ * \return The size in bytes.
+ **/
+size_t requestChannelBufferSize(const RequestChannel *channel);
+
+/*!
+ * \brief Receives a request, blocking until there is one.
+ * \param channel The channel.
+ * \param buffer The buffer to receive into; must hold
+ *               `requestChannelBufferSize` bytes.
+ * \param request Output parameter for the request received.
+ * \param threadId The thread ID of the responder.
+ * \param self The responder thread.
+ * \return The status code; see `ringBufferReadRecords`.
+ **/
+RingBufferStatusCode requestChannelReceive(
+    RequestChannel *       channel,
+    byte *                 buffer,
+    RequestChannelRequest *request,
+    int                    threadId,
+    Thread *               self);
+
+/*!
+ * \brief Answers a request.
+ * \param channel The channel.
+ * \param ticket The ticket of the request.
+ * \param reply The reply.
+ * \param size The size of `reply` in bytes.
+ * \return The status code; RB_INVALID_ARGUMENT if the reply is too large.
+ **/
+RingBufferStatusCode requestChannelReply(
+    RequestChannel *     channel,
+    const RequestTicket *ticket,
+    const byte *         reply,
+    size_t               size);
+
+/*!
+ * \brief Wakes all the threads waiting, so that they reexamine their
+ *        shutdown state.
+ * \param channel The channel.
+ * \return The status code.
+ **/
+RingBufferStatusCode requestChannelShutdown(RequestChannel *channel);
+#endif /* INCG_REQUEST_CHANNEL_H */
@@ -1,6 +1,7 @@
 #ifndef INCG_INCG_RING_BUFFER_H
 #define INCG_INCG_RING_BUFFER_H
 #include <stddef.h>
+#include <stdint.h>
 
 #include "byte.h"
 #include "thread.h"
@@ -20,7 +21,13 @@ typedef enum {
     RB_FAILURE_TO_WAIT_ON_CONDVAR,
     RB_FAILURE_TO_SIGNAL_CONDVAR,
     RB_THREAD_SHOULD_SHUTDOWN,
-    RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE
+    RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE,
+    RB_INVALID_ARGUMENT,
+    RB_FAILURE_TO_SPILL,
+    RB_FAILURE_TO_MAP_SHARED_MEMORY,
+    RB_FAILURE_TO_NOTIFY,
+    RB_UNSUPPORTED,
+    RB_TIMED_OUT
 } RingBufferStatusCode;
 
 /*!
@@ -66,6 +73,28 @@ RingBufferStatusCode ringBufferCreate(
  **/
 RingBufferStatusCode ringBufferFree(RingBuffer *ringBuffer);
 
+/*!
+ * \brief Enables the on-disk overflow tier of a ring buffer.
+ * \param ringBuffer The ring buffer.
+ * \param directory The (already existing) directory to write the segment
+ *                  files to.
+ * \param highWaterMark The fill level of the in-memory ring at which writes
+ *                      start going to disk. Must be in [1, byteCount].
+ * \return The status code.
+ *
+ * Once the in-memory ring holds `highWaterMark` bytes writers no longer block,
+ * but append to sequential segment files in `directory` instead. Readers
+ * read those back in FIFO order once the in-memory ring has been drained.
+ * The writer filling a batch of spilled bytes writes it to disk without
+ * holding the ring buffer's lock. Segment files are deleted after they have
+ * been consumed.
+ * \warning Must be called before any thread operates on the ring buffer.
+ **/
+RingBufferStatusCode ringBufferEnableSpill(
+    RingBuffer *ringBuffer,
+    const char *directory,
+    size_t      highWaterMark);
+
 /*!
  * \brief Writes to the ring buffer.
  * \param ringBuffer The ring buffer to write to.
@@ -94,6 +123,439 @@ RingBufferStatusCode ringBufferRead(
     int         threadId,
     Thread *    self);
 
+/*!
+ * \brief Makes writers wait for space in the order they arrived in.
+ * \param ringBuffer The ring buffer.
+ * \return The status code.
+ *
+ * Normally every waiting writer is woken once space is freed and whichever
+ * wins the race for the mutex writes, so that under saturation some writers
+ * may starve. Once fair, writers that have to wait queue up instead and
+ * only the first in line is woken, so that every writer gets its turn.
+ * Non-blocking writes don't overtake writers waiting in line either.
+ * \warning Must be called before any thread operates on the ring buffer.
+ **/
+RingBufferStatusCode ringBufferEnableFairness(RingBuffer *ringBuffer);
+
+/*!
+ * \brief Enables readiness notification through eventfds.
+ * \param ringBuffer The ring buffer.
+ * \return The status code; RB_UNSUPPORTED if not running on Linux.
+ *
+ * Creates two non-blocking eventfds that can be multiplexed with other file
+ * descriptors using epoll, poll or select.
+ * The readable one is signaled whenever the ring buffer goes from empty to
+ * non-empty, the writable one whenever it goes from full to not full. As only
+ * transitions are signaled, a burst of writes causes a single wakeup.
+ * Users should read the eventfd to reset it and then drain the ring buffer
+ * using `ringBufferTryRead` until it returns no more bytes; a write racing
+ * with that is guaranteed to signal the eventfd again.
+ * Both eventfds are also signaled by `ringBufferShutdown`.
+ * \warning Must be called before any thread operates on the ring buffer.
+ * \sa ringBufferReadableFd
+ * \sa ringBufferWritableFd
+ **/
+RingBufferStatusCode ringBufferEnableNotifications(RingBuffer *ringBuffer);
+
+/*!
+ * \brief Returns the eventfd signaled when the ring buffer becomes readable.
+ * \param ringBuffer The ring buffer.
+ * \return The file descriptor or -1 if notifications are not enabled.
+ * \note The file descriptor is owned by the ring buffer.
+ **/
+int ringBufferReadableFd(RingBuffer *ringBuffer);
+
+/*!
+ * \brief Returns the eventfd signaled when the ring buffer becomes writable.
+ * \param ringBuffer The ring buffer.
+ * \return The file descriptor or -1 if notifications are not enabled.
+ * \note The file descriptor is owned by the ring buffer.
+ **/
+int ringBufferWritableFd(RingBuffer *ringBuffer);
+
+/*!
+ * \brief Waits on several ring buffers at once.
+ *
+ * The selector registers with every ring buffer added, so that the ring
+ * buffers wake it whenever they become readable or writable, the same
+ * transitions that signal the eventfds of `ringBufferEnableNotifications`.
+ * A single thread can thus serve many ring buffers without polling them.
+ **/
+typedef struct RingBufferSelectorOpaque RingBufferSelector;
+
+/*!
+ * \brief The readiness a selector waits for.
+ **/
+typedef enum {
+    RB_SELECT_READABLE = 0x1, /*!< Bytes can be read */
+    RB_SELECT_WRITABLE = 0x2  /*!< Bytes can be written */
+} RingBufferSelectEvent;
+
+/*!
+ * \brief A ring buffer found ready by `ringBufferSelect`.
+ **/
+typedef struct {
+    RingBuffer *ringBuffer; /*!< The ring buffer */
+    unsigned    events;     /*!< The `RingBufferSelectEvent`s ready */
+} RingBufferReady;
+
+/*!
+ * \brief Creates a selector.
+ * \param maxRingBuffers The maximum amount of ring buffers added at once.
+ * \param selector Output parameter for the selector created.
+ * \return The status code.
+ * \warning The selector must be freed using `ringBufferSelectorFree`.
+ * \sa ringBufferSelectorFree
+ **/
+RingBufferStatusCode ringBufferSelectorCreate(
+    size_t               maxRingBuffers,
+    RingBufferSelector **selector);
+
+/*!
+ * \brief Frees a selector, removing it from all its ring buffers.
+ * \param selector The selector to free.
+ * \return The status code.
+ **/
+RingBufferStatusCode ringBufferSelectorFree(RingBufferSelector *selector);
+
+/*!
+ * \brief Adds a ring buffer to a selector.
+ * \param selector The selector.
+ * \param ringBuffer The ring buffer; must outlive its membership.
+ * \param events The `RingBufferSelectEvent`s to wait for.
+ * \return The status code; RB_INVALID_ARGUMENT if the ring buffer has been
+ *         added already or `maxRingBuffers` have been added.
+ **/
+RingBufferStatusCode ringBufferSelectorAdd(
+    RingBufferSelector *selector,
+    RingBuffer *        ringBuffer,
+    unsigned            events);
+
+/*!
+ * \brief Removes a ring buffer from a selector.
+ * \param selector The selector.
+ * \param ringBuffer The ring buffer.
+ * \return The status code; RB_INVALID_ARGUMENT if it hasn't been added.
+ **/
+RingBufferStatusCode ringBufferSelectorRemove(
+    RingBufferSelector *selector,
+    RingBuffer *        ringBuffer);
+
+/*!
+ * \brief Blocks until any of the ring buffers of a selector is ready.
+ * \param selector The selector.
+ * \param ready The buffer to report the ring buffers ready in.
+ * \param maxReady The size of `ready` in elements; at least 1.
+ * \param readyCount Output parameter for the amount of ring buffers ready.
+ * \param self The selecting thread.
+ * \return The status code; RB_THREAD_SHOULD_SHUTDOWN if `self` should shut
+ *         down while none is ready.
+ * \note A selector must only be used by one thread at a time; adding and
+ *       removing ring buffers included.
+ *
+ * Readiness is a snapshot: another thread may read or write before the
+ * caller does, so use the non-blocking operations on the ring buffers
+ * reported. A thread asked to shut down notices once `ringBufferShutdown`
+ * is called on one of the ring buffers, which wakes the selector.
+ **/
+RingBufferStatusCode ringBufferSelect(
+    RingBufferSelector *selector,
+    RingBufferReady *   ready,
+    size_t              maxReady,
+    size_t *            readyCount,
+    Thread *            self);
+
+/*!
+ * \brief Writes as many bytes as currently fit without blocking.
+ * \param ringBuffer The ring buffer to write to.
+ * \param source The bytes to write.
+ * \param byteCount The amount of bytes in `source`.
+ * \param bytesWritten Output parameter for the amount of bytes written.
+ * \param threadId The thread ID of the thread that wants to write.
+ * \return The status code.
+ **/
+RingBufferStatusCode ringBufferTryWrite(
+    RingBuffer *ringBuffer,
+    const byte *source,
+    size_t      byteCount,
+    size_t *    bytesWritten,
+    int         threadId);
+
+/*!
+ * \brief Reads the bytes currently available without blocking.
+ * \param ringBuffer The ring buffer to read from.
+ * \param destination The buffer to read into.
+ * \param maxCount The maximum amount of bytes to read.
+ * \param bytesRead Output parameter for the amount of bytes read; 0 if the
+ *                  ring buffer is empty.
+ * \param threadId The thread ID of the thread trying to read.
+ * \return The status code.
+ **/
+RingBufferStatusCode ringBufferTryRead(
+    RingBuffer *ringBuffer,
+    byte *      destination,
+    size_t      maxCount,
+    size_t *    bytesRead,
+    int         threadId);
+
+/*!
+ * \brief Writes a record as a whole, blocking until it fits.
+ * \param ringBuffer The ring buffer to write to.
+ * \param source The bytes of the record.
+ * \param byteCount The size of the record; at most the ring buffer's size.
+ * \param threadId The thread ID of the thread that wants to write.
+ * \param self Pointer to the thread that wants to write; may be NULL for
+ *             threads not created using `threadCreate`, which then wait
+ *             until space becomes free regardless of any shutdown.
+ * \return The status code.
+ *
+ * Records written concurrently never interleave, so readers can take them
+ * apart again using `ringBufferTryReadRecords`. Not supported once
+ * spilling has been enabled.
+ **/
+RingBufferStatusCode ringBufferWriteRecord(
+    RingBuffer *ringBuffer,
+    const byte *source,
+    size_t      byteCount,
+    int         threadId,
+    Thread *    self);
+
+/*!
+ * \brief Reads whole records, blocking until at least one is available.
+ * \param ringBuffer The ring buffer to read from.
+ * \param destination The buffer to read into; must hold `maxRecords`
+ *                    records.
+ * \param recordSize The size of every record in bytes.
+ * \param maxRecords The maximum amount of records to read.
+ * \param recordsRead Output parameter for the amount of records read.
+ * \param threadId The thread ID of the thread trying to read.
+ * \param self Pointer to the thread trying to read.
+ * \return The status code.
+ * \note All the writers must write records of `recordSize` bytes using
+ *       `ringBufferWriteRecord`.
+ **/
+RingBufferStatusCode ringBufferReadRecords(
+    RingBuffer *ringBuffer,
+    byte *      destination,
+    size_t      recordSize,
+    size_t      maxRecords,
+    size_t *    recordsRead,
+    int         threadId,
+    Thread *    self);
+
+/*!
+ * \brief Reads whole records without blocking.
+ * \param ringBuffer The ring buffer to read from.
+ * \param destination The buffer to read into; must hold `maxRecords`
+ *                    records.
+ * \param recordSize The size of every record in bytes.
+ * \param maxRecords The maximum amount of records to read.
+ * \param recordsRead Output parameter for the amount of records read; 0 if
+ *                    there is no whole record available.
+ * \param threadId The thread ID of the thread trying to read.
+ * \return The status code.
+ * \note All the writers must write records of `recordSize` bytes using
+ *       `ringBufferWriteRecord`.
+ **/
+RingBufferStatusCode ringBufferTryReadRecords(
+    RingBuffer *ringBuffer,
+    byte *      destination,
+    size_t      recordSize,
+    size_t      maxRecords,
+    size_t *    recordsRead,
+    int         threadId);
+
+/*!
+ * \brief Bytes acquired for reading in place.
+ **/
+typedef struct {
+    const byte *data;     /*!< The bytes, pointing into the ring buffer */
+    size_t      size;     /*!< The amount of bytes; 0 if none acquired */
+    uint64_t    position; /*!< Stream offset of the first byte; i.e. the
+                           *   count of bytes read from the ring buffer
+                           *   before it
+                           */
+    uint64_t sequence; /*!< Identifies the reservation to the ring buffer */
+    size_t   backlog;  /*!< The amount of bytes left to read after the
+                        *   reservation was taken; only a hint, as other
+                        *   threads may change it right away
+                        */
+} RingBufferReadReservation;
+
+/*!
+ * \brief Acquires bytes for reading them in place, without copying.
+ * \param ringBuffer The ring buffer to read from.
+ * \param maxCount The maximum amount of bytes to acquire.
+ * \param reservation Output parameter for the bytes acquired.
+ * \param threadId The thread ID of the thread trying to read.
+ * \param self Pointer to the thread trying to read.
+ * \return The status code.
+ *
+ * Blocks until at least one byte is available. The bytes acquired are
+ * contiguous, so fewer than available may be returned at the end of the
+ * storage. They stay valid and are not written over until released using
+ * `ringBufferReleaseRead`. Reservations may be released in any order, but
+ * the space of a reservation only becomes free once all the older ones have
+ * been released as well.
+ * \sa ringBufferReleaseRead
+ **/
+RingBufferStatusCode ringBufferAcquireRead(
+    RingBuffer *               ringBuffer,
+    size_t                     maxCount,
+    RingBufferReadReservation *reservation,
+    int                        threadId,
+    Thread *                   self);
+
+/*!
+ * \brief Like `ringBufferAcquireRead`, but doesn't block.
+ * \param ringBuffer The ring buffer to read from.
+ * \param maxCount The maximum amount of bytes to acquire.
+ * \param reservation Output parameter for the bytes acquired; its size is 0
+ *                    if nothing could be acquired.
+ * \param threadId The thread ID of the thread trying to read.
+ * \return The status code.
+ **/
+RingBufferStatusCode ringBufferTryAcquireRead(
+    RingBuffer *               ringBuffer,
+    size_t                     maxCount,
+    RingBufferReadReservation *reservation,
+    int                        threadId);
+
+/*!
+ * \brief Releases bytes acquired using `ringBufferAcquireRead`.
+ * \param ringBuffer The ring buffer.
+ * \param reservation The reservation to release.
+ * \param threadId The thread ID of the thread releasing.
+ * \return The status code.
+ **/
+RingBufferStatusCode ringBufferReleaseRead(
+    RingBuffer *                     ringBuffer,
+    const RingBufferReadReservation *reservation,
+    int                              threadId);
+
+/*!
+ * \brief Space reserved for writing in place.
+ **/
+typedef struct {
+    byte * data; /*!< The space, pointing into the ring buffer */
+    size_t size; /*!< The amount of bytes that may be written */
+} RingBufferWriteReservation;
+
+/*!
+ * \brief Reserves space for writing bytes in place, e.g. by reading them
+ *        from a file right into it.
+ * \param ringBuffer The ring buffer to write to.
+ * \param maxCount The maximum amount of bytes to reserve.
+ * \param reservation Output parameter for the space reserved.
+ * \param threadId The thread ID of the thread that wants to write.
+ * \param self Pointer to the thread that wants to write; may be NULL to
+ *             wait for space regardless of any shutdown.
+ * \return The status code; RB_UNSUPPORTED once spilling has been enabled.
+ *
+ * Blocks until at least one byte is free. The space reserved is contiguous,
+ * so less than is free may be returned at the end of the storage. Only one
+ * reservation is handed out at a time, and no other writer writes until it
+ * has been committed using `ringBufferCommitWrite`, so commit quickly.
+ * \sa ringBufferCommitWrite
+ **/
+RingBufferStatusCode ringBufferAcquireWrite(
+    RingBuffer *                ringBuffer,
+    size_t                      maxCount,
+    RingBufferWriteReservation *reservation,
+    int                         threadId,
+    Thread *                    self);
+
+/*!
+ * \brief Makes bytes written into a reservation readable.
+ * \param ringBuffer The ring buffer.
+ * \param reservation The reservation returned by `ringBufferAcquireWrite`.
+ * \param byteCount The amount of bytes written to the start of the
+ *                  reservation; 0 to give it up.
+ * \param threadId The thread ID of the thread committing.
+ * \return The status code.
+ * \note The rest of the space reserved is given back.
+ **/
+RingBufferStatusCode ringBufferCommitWrite(
+    RingBuffer *                      ringBuffer,
+    const RingBufferWriteReservation *reservation,
+    size_t                            byteCount,
+    int                               threadId);
+
+/*!
+ * \brief Returns the storage of the ring buffer.
+ * \param ringBuffer The ring buffer.
+ * \param data Output parameter for the start of the storage.
+ * \param size Output parameter for the size of the storage in bytes.
+ *
+ * Reservations always point into the storage, which allows registering it
+ * with the kernel once, e.g. as an io_uring fixed buffer.
+ * \warning The storage is replaced by `ringBufferResize`.
+ **/
+void ringBufferStorage(RingBuffer *ringBuffer, const byte **data, size_t *size);
+
+/*!
+ * \brief Changes the size of the ring buffer while it is in use.
+ * \param ringBuffer The ring buffer.
+ * \param byteCount The new size in bytes.
+ * \param self The thread resizing; NULL to wait regardless of shutdown.
+ * \return The status code.
+ *
+ * The bytes not yet read are copied in order into new storage, which then
+ * replaces the old one while holding the mutex, so that no byte is lost or
+ * reordered. Readers and writers may keep running meanwhile.
+ *
+ * When shrinking, writers are held back until the readers have made the
+ * bytes fit. Either way the resize waits for all the read reservations to be
+ * released and the write reservation to be committed, as they point into the
+ * old storage.
+ * \warning The storage returned by `ringBufferStorage` becomes invalid.
+ *          Don't shrink below the largest record written using
+ *          `ringBufferWriteRecord`.
+ **/
+RingBufferStatusCode
+ringBufferResize(RingBuffer *ringBuffer, size_t byteCount, Thread *self);
+
+/*!
+ * \brief Statistics for deciding on the size of a ring buffer and for
+ *        telling whether it is moving.
+ **/
+typedef struct {
+    size_t   size;         /*!< The size in bytes */
+    size_t   count;        /*!< Bytes not yet read, including spilled ones */
+    uint64_t fullWaits;    /*!< Times writers had to wait for space */
+    uint64_t emptyWaits;   /*!< Times readers had to wait for bytes */
+    uint64_t readTotal;    /*!< Bytes ever read; the tail position */
+    uint64_t writtenTotal; /*!< Bytes ever written; the head position */
+} RingBufferStats;
+
+/*!
+ * \brief Takes a snapshot of the statistics of a ring buffer.
+ * \param ringBuffer The ring buffer.
+ * \param stats Output parameter for the statistics.
+ * \return The status code.
+ *
+ * The wait counters only ever grow; compare two snapshots to learn about
+ * the time in between. Non-blocking operations never wait.
+ **/
+RingBufferStatusCode
+ringBufferStats(RingBuffer *ringBuffer, RingBufferStats *stats);
+
+/*!
+ * \brief Waits until all the bytes written have been read and released.
+ * \param ringBuffer The ring buffer.
+ * \param timeoutMilliseconds The maximum time to wait for.
+ * \param remaining Output parameter for the amount of bytes still unread,
+ *                  including the ones spilled to disk.
+ * \return The status code; RB_TIMED_OUT if bytes remain after the timeout.
+ *
+ * Meant for draining the ring buffer during shutdown once all the writers
+ * have stopped; while writers are running it may never return early.
+ **/
+RingBufferStatusCode ringBufferWaitDrained(
+    RingBuffer *ringBuffer,
+    int32_t     timeoutMilliseconds,
+    size_t *    remaining);
+
 /*!
  * \brief Function used by the main thread to shut down the ring buffer.
  * \param ringBuffer The ring buffer to shut down.
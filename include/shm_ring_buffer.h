@@ -0,0 +1,111 @@
+#ifndef INCG_SHM_RING_BUFFER_H
+#define INCG_SHM_RING_BUFFER_H
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "byte.h"
+#include "ring_buffer.h"
+
+/*!
+ * \brief A ring buffer living in a named POSIX shared memory object.
+ *
+ * The ring buffer can be attached to by name from other processes, so that
+ * producers and consumers may live in different processes. It is
+ * synchronized using a robust, process shared mutex and a process shared
+ * condition variable. If a process dies while holding the mutex the next
+ * process to lock it marks the mutex as consistent again and carries on.
+ * \note Only available on POSIX systems.
+ **/
+typedef struct ShmRingBufferOpaque ShmRingBuffer;
+
+/*!
+ * \brief Creates a shared memory ring buffer.
+ * \param name The name of the shared memory object, e.g. "/my_ring".
+ * \param byteCount The size of the ring buffer in bytes.
+ * \param ringBuffer Output parameter to write the ring buffer to.
+ * \return The status code.
+ * \warning The ring buffer must be freed using `shmRingBufferDetach`.
+ *          The shared memory object is removed when its creator detaches.
+ * \sa shmRingBufferDetach
+ **/
+RingBufferStatusCode shmRingBufferCreate(
+    const char *    name,
+    size_t          byteCount,
+    ShmRingBuffer **ringBuffer);
+
+/*!
+ * \brief Attaches to a shared memory ring buffer created by another process.
+ * \param name The name of the shared memory object.
+ * \param ringBuffer Output parameter to write the ring buffer to.
+ * \return The status code.
+ * \warning The ring buffer must be freed using `shmRingBufferDetach`.
+ * \sa shmRingBufferDetach
+ **/
+RingBufferStatusCode
+shmRingBufferAttach(const char *name, ShmRingBuffer **ringBuffer);
+
+/*!
+ * \brief Attaches to a shared memory ring buffer, creating it if it doesn't
+ *        exist yet.
+ *
+ * If another process created it first, attaching is retried with a backoff
+ * until that process has finished initializing it.
+ * \param name The name of the shared memory object.
+ * \param byteCount The size of the ring buffer in bytes if it is created.
+ * \param ringBuffer Output parameter to write the ring buffer to.
+ * \return The status code.
+ * \warning The ring buffer must be freed using `shmRingBufferDetach`.
+ * \sa shmRingBufferDetach
+ **/
+RingBufferStatusCode shmRingBufferOpen(
+    const char *    name,
+    size_t          byteCount,
+    ShmRingBuffer **ringBuffer);
+
+/*!
+ * \brief Detaches from a shared memory ring buffer.
+ * \param ringBuffer The ring buffer to detach from.
+ * \return The status code.
+ *
+ * Unmaps the ring buffer from this process. If this process created the
+ * ring buffer its name is removed as well; processes still attached can
+ * keep using it.
+ **/
+RingBufferStatusCode shmRingBufferDetach(ShmRingBuffer *ringBuffer);
+
+/*!
+ * \brief Writes to the shared memory ring buffer.
+ * \param ringBuffer The ring buffer to write to.
+ * \param toWrite The byte to write.
+ * \param threadId The ID of the writer.
+ * \return The status code.
+ *
+ * Returns RB_THREAD_SHOULD_SHUTDOWN once `shmRingBufferShutdown` has been
+ * called on `ringBuffer`, even if there is space to write to.
+ **/
+RingBufferStatusCode
+shmRingBufferWrite(ShmRingBuffer *ringBuffer, byte toWrite, int threadId);
+
+/*!
+ * \brief Reads from the shared memory ring buffer.
+ * \param ringBuffer The ring buffer to read from.
+ * \param byteRead Output parameter for the byte read.
+ * \param threadId The ID of the reader.
+ * \return The status code.
+ *
+ * Returns RB_THREAD_SHOULD_SHUTDOWN once `shmRingBufferShutdown` has been
+ * called on `ringBuffer`, even if there are bytes left to read.
+ **/
+RingBufferStatusCode
+shmRingBufferRead(ShmRingBuffer *ringBuffer, byte *byteRead, int threadId);
+
+/*!
+ * \brief Shuts down this process's use of the shared memory ring buffer.
+ * \param ringBuffer The ring buffer to shut down.
+ * \return The status code.
+ *
+ * Wakes the threads of this process waiting on the ring buffer and has them
+ * return RB_THREAD_SHOULD_SHUTDOWN. Other processes are not affected.
+ **/
+RingBufferStatusCode shmRingBufferShutdown(ShmRingBuffer *ringBuffer);
+#endif /* INCG_SHM_RING_BUFFER_H */
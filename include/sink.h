@@ -0,0 +1,96 @@
+#ifndef INCG_SINK_H
+#define INCG_SINK_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte.h"
+
+/*!
+ * \brief Asynchronous writer to a file or pipe.
+ *
+ * Uses io_uring where available, keeping up to `sinkQueueDepth` writes in
+ * flight. Writes from within the fixed buffer given on creation are issued
+ * as fixed buffer writes, so the kernel doesn't have to map the pages for
+ * every write.
+ * Otherwise the writes submitted are gathered and written using a single
+ * writev once a completion is waited for.
+ * \note Only available on POSIX systems.
+ * \note Not thread safe; every thread should use its own sink.
+ **/
+typedef struct SinkOpaque Sink;
+
+/*!
+ * \brief Creates a sink.
+ * \param path The file or FIFO to write to. Files are created if needed, but
+ *             not truncated.
+ * \param queueDepth The maximum amount of writes in flight.
+ * \param fixedBuffer The memory that most writes will come from; may be NULL.
+ * \param fixedBufferSize The size of `fixedBuffer` in bytes.
+ * \return The sink created on success; otherwise NULL.
+ * \warning The return value must be freed using `sinkFree`.
+ * \sa sinkFree
+ **/
+Sink *sinkCreate(
+    const char *path,
+    unsigned    queueDepth,
+    const byte *fixedBuffer,
+    size_t      fixedBufferSize);
+
+/*!
+ * \brief Waits for all the writes in flight and frees the sink.
+ * \param sink The sink to free.
+ * \return true on success; false if a write or closing the file failed.
+ **/
+bool sinkFree(Sink *sink);
+
+/*!
+ * \brief Checks whether the sink uses io_uring.
+ * \param sink The sink.
+ * \return true if io_uring is used; false if writev is used.
+ **/
+bool sinkUsesIoUring(const Sink *sink);
+
+/*!
+ * \brief Returns the maximum amount of writes that may be in flight.
+ * \param sink The sink.
+ * \return The queue depth; 1 for io_uring writes to pipes, as their order
+ *         would not be preserved otherwise.
+ * \note That only keeps the writes of this sink in order; the writes of
+ *       several sinks to the same pipe interleave in any order.
+ **/
+unsigned sinkQueueDepth(const Sink *sink);
+
+/*!
+ * \brief Returns the amount of writes submitted but not yet completed.
+ * \param sink The sink.
+ * \return The amount of writes in flight.
+ **/
+unsigned sinkInFlight(const Sink *sink);
+
+/*!
+ * \brief Submits a write.
+ * \param sink The sink to write to.
+ * \param data The bytes to write. Must stay valid until the write completes.
+ * \param size The amount of bytes to write.
+ * \param position The file offset to write to; ignored for pipes.
+ * \param tag Returned by `sinkWaitCompletion` once the write completed.
+ * \return true on success; otherwise false.
+ * \warning Must only be called if `sinkInFlight` < `sinkQueueDepth`.
+ **/
+bool sinkSubmit(
+    Sink *      sink,
+    const byte *data,
+    size_t      size,
+    uint64_t    position,
+    uint64_t    tag);
+
+/*!
+ * \brief Waits for a write to complete.
+ * \param sink The sink.
+ * \param tag Output parameter for the tag of the write that completed.
+ * \return true on success; false if the write failed or nothing was in
+ *         flight.
+ **/
+bool sinkWaitCompletion(Sink *sink, uint64_t *tag);
+#endif /* INCG_SINK_H */
@@ -8,4 +8,10 @@
  **/
 void sleepThread(int32_t seconds);
 
+/*!
+ * \brief Sleep the current thread for less than a second.
+ * \param milliseconds The count of milliseconds to sleep for.
+ **/
+void sleepThreadMilliseconds(int32_t milliseconds);
+
 #endif /* INCG_SLEEP_H */
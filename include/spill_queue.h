@@ -0,0 +1,94 @@
+#ifndef INCG_SPILL_QUEUE_H
+#define INCG_SPILL_QUEUE_H
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "byte.h"
+
+/*!
+ * \brief A FIFO queue of bytes that is stored in sequential segment files on
+ *        disk.
+ *
+ * Bytes pushed are collected in an in-memory batch. Full batches are sealed
+ * and appended to the current segment file by `spillQueueFlush`, so that
+ * pushing never waits for the disk. Segment files are deleted as soon as
+ * they have been read completely.
+ * \note Pushing, popping and reading the size must be synchronized by the
+ *       user. `spillQueueFlush` may run concurrently with all of them.
+ **/
+typedef struct SpillQueueOpaque SpillQueue;
+
+/*!
+ * \brief Creates a spill queue.
+ * \param directory The (already existing) directory to store the segment
+ *                  files in.
+ * \param batchSize The amount of bytes to collect in memory before they are
+ *                  written to disk in one go.
+ * \param segmentSize The amount of bytes after which a new segment file is
+ *                    started.
+ * \return The spill queue created on success; otherwise NULL.
+ * \warning The return value must be freed using `spillQueueFree`.
+ * \sa spillQueueFree
+ **/
+SpillQueue *
+spillQueueCreate(const char *directory, size_t batchSize, size_t segmentSize);
+
+/*!
+ * \brief Frees a spill queue, deleting all of its segment files.
+ * \param spillQueue The spill queue to free.
+ * \return true on success; otherwise false.
+ **/
+bool spillQueueFree(SpillQueue *spillQueue);
+
+/*!
+ * \brief Appends a byte to the end of the spill queue.
+ * \param spillQueue The spill queue to append to.
+ * \param toPush The byte to append.
+ * \return true on success; false if no new batch could be allocated.
+ * \note Only seals the batch once it is full; `spillQueueFlush` writes it.
+ **/
+bool spillQueuePush(SpillQueue *spillQueue, byte toPush);
+
+/*!
+ * \brief Writes the sealed batches to disk.
+ * \param spillQueue The spill queue.
+ * \param bytesFlushed Output parameter for the amount of bytes written.
+ * \return true on success; false if writing to disk failed, in which case
+ *         the batch is kept in memory.
+ *
+ * Meant to be called without holding the lock that synchronizes pushing and
+ * popping, which is what keeps them from waiting for the disk. Concurrent
+ * calls write one after the other.
+ **/
+bool spillQueueFlush(SpillQueue *spillQueue, size_t *bytesFlushed);
+
+/*!
+ * \brief Removes bytes from the front of the spill queue.
+ * \param spillQueue The spill queue to remove from.
+ * \param destination The buffer to write the bytes removed to.
+ * \param maxCount The maximum amount of bytes to remove.
+ * \param popped Output parameter for the amount of bytes actually removed.
+ * \return true on success; false if reading from disk failed.
+ **/
+bool spillQueuePop(
+    SpillQueue *spillQueue,
+    byte *      destination,
+    size_t      maxCount,
+    size_t *    popped);
+
+/*!
+ * \brief Returns the amount of bytes in the spill queue.
+ * \param spillQueue The spill queue.
+ * \return The amount of bytes in the spill queue.
+ **/
+size_t spillQueueSize(const SpillQueue *spillQueue);
+
+/*!
+ * \brief Returns the amount of bytes that can be popped right now.
+ * \param spillQueue The spill queue.
+ * \return The amount of bytes in the spill queue, unless a batch is being
+ *         written to disk; then only the bytes on disk already, as the batch
+ *         comes next.
+ **/
+size_t spillQueueAvailable(SpillQueue *spillQueue);
+#endif /* INCG_SPILL_QUEUE_H */
@@ -0,0 +1,40 @@
+#ifndef INCG_SUPERVISOR_H
+#define INCG_SUPERVISOR_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "thread.h"
+
+/*!
+ * \brief Configuration of a supervisor.
+ **/
+typedef struct {
+    size_t  minSize;              /*!< Never shrink below; in bytes */
+    size_t  maxSize;              /*!< Never grow beyond; in bytes */
+    int32_t intervalMilliseconds; /*!< The time between two decisions */
+} SupervisorConfig;
+
+/*!
+ * \brief Creates a supervisor thread, which sizes a ring buffer to its load.
+ * \param ringBuffer The ring buffer to resize.
+ * \param id The thread ID.
+ * \param config The bounds and the interval. Must outlive the thread.
+ * \return The thread created; NULL on failure.
+ *
+ * Every interval the supervisor compares the waits of the ring buffer's
+ * writers and readers, see `ringBufferStats`. If writers had to wait for
+ * space, it doubles the size, so that bursts are absorbed rather than
+ * stalling the producers. If only readers had to wait, the ring buffer ran
+ * mostly empty and it halves the size, giving back the memory. The size is
+ * changed using `ringBufferResize`, so the producers and consumers keep
+ * running.
+ * \warning The return value must be freed using `threadFree` when it is no
+ *          longer needed. Shut it down before the producers, as a shrink
+ *          may wait for the consumers.
+ * \sa threadFree
+ **/
+Thread *supervisorCreate(
+    RingBuffer *            ringBuffer,
+    int                     id,
+    const SupervisorConfig *config);
+#endif /* INCG_SUPERVISOR_H */
@@ -1,8 +1,11 @@
 #ifndef INCG_THREAD_H
 #define INCG_THREAD_H
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "arena.h"
+
 typedef struct RingBufferOpaque RingBuffer;
 
 typedef struct ThreadOpaque Thread;
@@ -26,6 +29,115 @@ Thread *threadCreate(
     int32_t        sleepTimeSeconds,
     int            id);
 
+/*!
+ * \brief Creates a thread that carries a user supplied context.
+ * \param function The function that the thread will run.
+ * \param ringBuffer The ring buffer.
+ * \param sleepTimeSeconds The sleep time.
+ * \param id The thread ID.
+ * \param context The context, which the thread function can retrieve using
+ *                `threadContext`. Must outlive the thread.
+ * \sa threadContext
+ **/
+Thread *threadCreateWithContext(
+    ThreadFunction function,
+    RingBuffer *   ringBuffer,
+    int32_t        sleepTimeSeconds,
+    int            id,
+    void *         context);
+
+/*!
+ * \brief Creates a thread whose bookkeeping is allocated from an arena.
+ * \param function The function that the thread will run.
+ * \param ringBuffer The ring buffer.
+ * \param sleepTimeSeconds The sleep time.
+ * \param id The thread ID.
+ * \param context The context; may be NULL. Must outlive the thread.
+ * \param arena The arena to allocate from, which must have
+ *              `threadArenaSize` bytes left; NULL to use malloc.
+ * \warning The arena must outlive the thread; `threadFree` leaves the
+ *          memory to the arena.
+ **/
+Thread *threadCreateInArena(
+    ThreadFunction function,
+    RingBuffer *   ringBuffer,
+    int32_t        sleepTimeSeconds,
+    int            id,
+    void *         context,
+    Arena *        arena);
+
+/*!
+ * \brief Creates a thread of a batch created by `threadCreateParallel`.
+ * \param index The index of the thread in the batch.
+ * \param context The context given to `threadCreateParallel`.
+ * \return The thread created; NULL on failure.
+ **/
+typedef Thread *(*ThreadFactory)(size_t index, void *context);
+
+/*!
+ * \brief Creates a batch of threads using several threads at once.
+ * \param factory Creates every thread; called concurrently.
+ * \param context Passed to `factory`.
+ * \param count The amount of threads to create.
+ * \param creatorCount The amount of threads creating them, including the
+ *                     calling one; 0 or 1 to create them one after another.
+ * \param threads Output parameter for the threads, `count` many; NULL where
+ *                creating failed.
+ * \return true if all the threads were created; otherwise false.
+ **/
+bool threadCreateParallel(
+    ThreadFactory factory,
+    void *        context,
+    size_t        count,
+    size_t        creatorCount,
+    Thread **     threads);
+
+/*!
+ * \brief Sets the stack size of the threads created from now on.
+ * \param byteCount The stack size in bytes; 0 for the system's default.
+ * \return true on success; false if `byteCount` is below the system's
+ *         minimum.
+ **/
+bool threadSetStackSize(size_t byteCount);
+
+/*!
+ * \brief Holds the threads created from now on at a start barrier.
+ *
+ * The threads are set up as usual, but only run their function once
+ * `threadReleaseStart` is called, so that early threads don't get ahead of
+ * the ones created after them.
+ * \sa threadReleaseStart
+ **/
+void threadHoldStart(void);
+
+/*!
+ * \brief Waits until threads have reached the start barrier.
+ * \param threadCount The amount of threads created since `threadHoldStart`
+ *                    to wait for.
+ **/
+void threadWaitStartReady(size_t threadCount);
+
+/*!
+ * \brief Releases all the threads held at the start barrier at once and
+ *        stops holding new ones.
+ * \note Does nothing if no threads are being held.
+ **/
+void threadReleaseStart(void);
+
+/*!
+ * \brief Returns the amount of arena bytes a thread needs.
+ * \return The amount of bytes `threadCreateInArena` allocates.
+ **/
+size_t threadArenaSize(void);
+
+/*!
+ * \brief Returns the context of a thread.
+ * \param thread The thread.
+ * \return The context given to `threadCreateWithContext`; NULL for threads
+ *         created using `threadCreate`.
+ **/
+void *threadContext(Thread *thread);
+
 /*!
  * \brief Frees the given thread.
  * \param thread The thread to free.
@@ -0,0 +1,65 @@
+#ifndef INCG_TRACE_H
+#define INCG_TRACE_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/*!
+ * \brief The events recorded while tracing.
+ *
+ * Events ending in BEGIN and END enclose a span of time on a thread.
+ **/
+typedef enum {
+    TRACE_WRITE_BEGIN,          /*!< A write to the ring buffer started */
+    TRACE_WRITE_END,            /*!< The write returned */
+    TRACE_READ_BEGIN,           /*!< A read from the ring buffer started */
+    TRACE_READ_END,             /*!< The read returned */
+    TRACE_WAIT_FOR_SPACE_BEGIN, /*!< A writer went to sleep, as it was full */
+    TRACE_WAIT_FOR_SPACE_END,   /*!< The writer woke up */
+    TRACE_WAIT_FOR_DATA_BEGIN,  /*!< A reader went to sleep, as it was empty */
+    TRACE_WAIT_FOR_DATA_END,    /*!< The reader woke up */
+    TRACE_BROADCAST,            /*!< The waiters were woken */
+    TRACE_SHUTDOWN,             /*!< The ring buffer was shut down */
+    TRACE_EVENT_COUNT           /*!< The amount of events */
+} TraceEvent;
+
+/*!
+ * \brief Starts tracing.
+ * \param eventsPerThread The amount of events every thread can record;
+ *                        once its buffer is full, further events of the
+ *                        thread are dropped and counted.
+ * \return true on success; otherwise false.
+ *
+ * Every thread records into a buffer of its own, allocated on its first
+ * event, so that recording takes no lock. Events carry the time stamp
+ * counter of the CPU where there is one, which takes a few cycles to read.
+ * \note Call before the threads to trace are created.
+ **/
+bool traceEnable(size_t eventsPerThread);
+
+/*!
+ * \brief Records an event of the calling thread.
+ * \param event The event.
+ * \param threadId The thread ID to attribute the event to; 0 for threads
+ *                 without one, like the main thread.
+ *
+ * Does nothing unless tracing is enabled.
+ **/
+void traceRecord(TraceEvent event, int threadId);
+
+/*!
+ * \brief Writes all the events recorded as Chrome trace event JSON.
+ * \param path The file to write to.
+ * \return true on success; otherwise false.
+ *
+ * The file can be opened using chrome://tracing or https://ui.perfetto.dev,
+ * showing every thread ID as a track of its own.
+ * \warning The threads traced must have exited.
+ **/
+bool traceWriteChromeJson(const char *path);
+
+/*!
+ * \brief Stops tracing and frees all the events recorded.
+ * \warning The threads traced must have exited.
+ **/
+void traceDisable(void);
+#endif /* INCG_TRACE_H */
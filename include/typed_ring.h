@@ -0,0 +1,260 @@
+#ifndef INCG_TYPED_RING_H
+#define INCG_TYPED_RING_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "ring_buffer.h"
+#include "thread.h"
+
+/*!
+ * \def DEFINE_RING
+ * \brief Defines a ring buffer specialized for an element type and a fixed
+ *        capacity.
+ * \param name The name of the ring type; also prefixes its functions.
+ * \param type The element type, e.g. a struct, which is copied in and out.
+ * \param capacity The amount of elements; must be a power of two.
+ *
+ * Unlike `RingBuffer`, whose elements are bytes and whose size is only known
+ * at runtime, the capacity and the index mask are compile time constants, so
+ * that wrapping an index takes a single AND rather than a compare and
+ * branch, and elements of any type are moved without framing. The storage is
+ * part of the ring, so that rings can live on the stack, in static storage
+ * or inside other structs.
+ *
+ * Defines `name` along with these functions, which return
+ * `RingBufferStatusCode`s just like the `RingBuffer` functions:
+ * - `name##Init(name *ring)` / `name##Destroy(name *ring)`
+ * - `name##Write(name *ring, const type *element, Thread *self)` and
+ *   `name##Read(name *ring, type *element, Thread *self)`, which block while
+ *   the ring is full or empty respectively. Once `self` should shut down
+ *   they return RB_THREAD_SHOULD_SHUTDOWN; if `self` is NULL they wait
+ *   regardless of any shutdown.
+ * - `name##TryWrite(name *ring, const type *elements, size_t count,
+ *   size_t *written)` and `name##TryRead(name *ring, type *elements,
+ *   size_t maxCount, size_t *read)`, which move as many elements as
+ *   possible without blocking.
+ * - `name##Shutdown(name *ring)`, which wakes all the threads waiting, so
+ *   that they reexamine their shutdown state.
+ *
+ * Waiters are only woken if there are any, and one at a time for single
+ * elements, rather than broadcasting on every operation.
+ * \note Use at file scope; the functions are `static inline`.
+ **/
+#define DEFINE_RING(name, type, capacity)                                     \
+    /* Fails to compile unless `capacity` is a power of two. */               \
+    typedef char name##CapacityMustBeAPowerOfTwo                              \
+        [((capacity) > 0 && ((capacity) & ((capacity) - 1)) == 0) ? 1 : -1];  \
+                                                                              \
+    enum { name##Capacity = (capacity), name##Mask = (capacity) - 1 };        \
+                                                                              \
+    typedef struct {                                                          \
+        pthread_mutex_t mutex;          /*!< Protects all of the below */     \
+        pthread_cond_t  notEmpty;       /*!< Readers wait on this one */      \
+        pthread_cond_t  notFull;        /*!< Writers wait on this one */      \
+        size_t          readersWaiting; /*!< Readers waiting on notEmpty */   \
+        size_t          writersWaiting; /*!< Writers waiting on notFull */    \
+        size_t          readCount;      /*!< Elements read ever */            \
+        size_t          writeCount;     /*!< Elements written ever */         \
+        type            elements[capacity]; /*!< The storage */               \
+    } name;                                                                   \
+                                                                              \
+    static inline RingBufferStatusCode name##Init(name *ring)                 \
+    {                                                                         \
+        if (pthread_mutex_init(&ring->mutex, NULL) != 0) {                    \
+            return RB_FAILURE_TO_INIT_MUTEX;                                  \
+        }                                                                     \
+                                                                              \
+        if (pthread_cond_init(&ring->notEmpty, NULL) != 0) {                  \
+            pthread_mutex_destroy(&ring->mutex);                              \
+            return RB_FAILURE_TO_INIT_CONDVAR;                                \
+        }                                                                     \
+                                                                              \
+        if (pthread_cond_init(&ring->notFull, NULL) != 0) {                   \
+            pthread_cond_destroy(&ring->notEmpty);                            \
+            pthread_mutex_destroy(&ring->mutex);                              \
+            return RB_FAILURE_TO_INIT_CONDVAR;                                \
+        }                                                                     \
+                                                                              \
+        ring->readersWaiting = 0;                                             \
+        ring->writersWaiting = 0;                                             \
+        ring->readCount      = 0;                                             \
+        ring->writeCount     = 0;                                             \
+        return RB_OK;                                                         \
+    }                                                                         \
+                                                                              \
+    static inline RingBufferStatusCode name##Destroy(name *ring)              \
+    {                                                                         \
+        const bool couldDestroyNotEmpty                                       \
+            = pthread_cond_destroy(&ring->notEmpty) == 0;                     \
+        const bool couldDestroyNotFull                                        \
+            = pthread_cond_destroy(&ring->notFull) == 0;                      \
+                                                                              \
+        if (pthread_mutex_destroy(&ring->mutex) != 0) {                       \
+            return RB_FAILURE_TO_DESTROY_MUTEX;                               \
+        }                                                                     \
+                                                                              \
+        return couldDestroyNotEmpty && couldDestroyNotFull                    \
+                   ? RB_OK                                                    \
+                   : RB_FAILURE_TO_DESTROY_CONDVAR;                           \
+    }                                                                         \
+                                                                              \
+    /* Waits on `condition`; the mutex is held on entry and on success. */    \
+    static inline RingBufferStatusCode name##Wait(                            \
+        name *ring, pthread_cond_t *condition, size_t *waiting, Thread *self) \
+    {                                                                         \
+        if (self != NULL) {                                                   \
+            bool shouldShutdown;                                              \
+                                                                              \
+            if (!threadShouldShutdown(self, &shouldShutdown)) {               \
+                pthread_mutex_unlock(&ring->mutex);                           \
+                return RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;                \
+            }                                                                 \
+                                                                              \
+            if (shouldShutdown) {                                             \
+                if (pthread_mutex_unlock(&ring->mutex) != 0) {                \
+                    return RB_FAILURE_TO_UNLOCK_MUTEX;                        \
+                }                                                             \
+                                                                              \
+                return RB_THREAD_SHOULD_SHUTDOWN;                             \
+            }                                                                 \
+        }                                                                     \
+                                                                              \
+        ++*waiting;                                                           \
+        const int error = pthread_cond_wait(condition, &ring->mutex);         \
+        --*waiting;                                                           \
+                                                                              \
+        if (error != 0) {                                                     \
+            pthread_mutex_unlock(&ring->mutex);                               \
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;                             \
+        }                                                                     \
+                                                                              \
+        return RB_OK;                                                         \
+    }                                                                         \
+                                                                              \
+    /* Unlocks the mutex and wakes `count` waiters if there are any. */       \
+    static inline RingBufferStatusCode name##UnlockAndWake(                   \
+        name *ring, pthread_cond_t *condition, size_t waiting, size_t count)  \
+    {                                                                         \
+        if (pthread_mutex_unlock(&ring->mutex) != 0) {                        \
+            return RB_FAILURE_TO_UNLOCK_MUTEX;                                \
+        }                                                                     \
+                                                                              \
+        if (waiting == 0 || count == 0) {                                     \
+            return RB_OK;                                                     \
+        }                                                                     \
+                                                                              \
+        const int error = count == 1 ? pthread_cond_signal(condition)         \
+                                     : pthread_cond_broadcast(condition);     \
+        return error == 0 ? RB_OK : RB_FAILURE_TO_SIGNAL_CONDVAR;             \
+    }                                                                         \
+                                                                              \
+    static inline RingBufferStatusCode name##Write(                           \
+        name *ring, const type *element, Thread *self)                        \
+    {                                                                         \
+        if (pthread_mutex_lock(&ring->mutex) != 0) {                          \
+            return RB_FAILURE_TO_LOCK_MUTEX;                                  \
+        }                                                                     \
+                                                                              \
+        while (ring->writeCount - ring->readCount == (capacity)) {            \
+            const RingBufferStatusCode statusCode = name##Wait(               \
+                ring, &ring->notFull, &ring->writersWaiting, self);           \
+                                                                              \
+            if (RB_FAILURE(statusCode)) {                                     \
+                return statusCode;                                            \
+            }                                                                 \
+        }                                                                     \
+                                                                              \
+        ring->elements[ring->writeCount++ & name##Mask] = *element;           \
+        return name##UnlockAndWake(                                           \
+            ring, &ring->notEmpty, ring->readersWaiting, 1);                  \
+    }                                                                         \
+                                                                              \
+    static inline RingBufferStatusCode name##Read(                            \
+        name *ring, type *element, Thread *self)                              \
+    {                                                                         \
+        if (pthread_mutex_lock(&ring->mutex) != 0) {                          \
+            return RB_FAILURE_TO_LOCK_MUTEX;                                  \
+        }                                                                     \
+                                                                              \
+        while (ring->writeCount == ring->readCount) {                         \
+            const RingBufferStatusCode statusCode = name##Wait(               \
+                ring, &ring->notEmpty, &ring->readersWaiting, self);          \
+                                                                              \
+            if (RB_FAILURE(statusCode)) {                                     \
+                return statusCode;                                            \
+            }                                                                 \
+        }                                                                     \
+                                                                              \
+        *element = ring->elements[ring->readCount++ & name##Mask];            \
+        return name##UnlockAndWake(                                           \
+            ring, &ring->notFull, ring->writersWaiting, 1);                   \
+    }                                                                         \
+                                                                              \
+    static inline RingBufferStatusCode name##TryWrite(                        \
+        name *ring, const type *elements, size_t count, size_t *written)      \
+    {                                                                         \
+        if (pthread_mutex_lock(&ring->mutex) != 0) {                          \
+            return RB_FAILURE_TO_LOCK_MUTEX;                                  \
+        }                                                                     \
+                                                                              \
+        const size_t space                                                    \
+            = (capacity) - (ring->writeCount - ring->readCount);              \
+        const size_t n     = count < space ? count : space;                   \
+        const size_t start = ring->writeCount & name##Mask;                   \
+        const size_t first = n < (capacity) - start ? n : (capacity) - start; \
+                                                                              \
+        /* At most two copies: up to the end of the storage and from its */   \
+        /* start. */                                                          \
+        memcpy(&ring->elements[start], elements, first * sizeof(type));       \
+        memcpy(ring->elements, elements + first, (n - first) * sizeof(type)); \
+        ring->writeCount += n;                                                \
+        *written = n;                                                         \
+        return name##UnlockAndWake(                                           \
+            ring, &ring->notEmpty, ring->readersWaiting, n);                  \
+    }                                                                         \
+                                                                              \
+    static inline RingBufferStatusCode name##TryRead(                         \
+        name *ring, type *elements, size_t maxCount, size_t *read)            \
+    {                                                                         \
+        if (pthread_mutex_lock(&ring->mutex) != 0) {                          \
+            return RB_FAILURE_TO_LOCK_MUTEX;                                  \
+        }                                                                     \
+                                                                              \
+        const size_t available = ring->writeCount - ring->readCount;          \
+        const size_t n     = maxCount < available ? maxCount : available;     \
+        const size_t start = ring->readCount & name##Mask;                    \
+        const size_t first = n < (capacity) - start ? n : (capacity) - start; \
+                                                                              \
+        memcpy(elements, &ring->elements[start], first * sizeof(type));       \
+        memcpy(elements + first, ring->elements, (n - first) * sizeof(type)); \
+        ring->readCount += n;                                                 \
+        *read = n;                                                            \
+        return name##UnlockAndWake(                                           \
+            ring, &ring->notFull, ring->writersWaiting, n);                   \
+    }                                                                         \
+                                                                              \
+    static inline RingBufferStatusCode name##Shutdown(name *ring)             \
+    {                                                                         \
+        /* Taking the mutex makes sure that no waiter is between checking */  \
+        /* its shutdown state and going to sleep. */                          \
+        if (pthread_mutex_lock(&ring->mutex) != 0) {                          \
+            return RB_FAILURE_TO_LOCK_MUTEX;                                  \
+        }                                                                     \
+                                                                              \
+        const bool couldWake                                                  \
+            = pthread_cond_broadcast(&ring->notEmpty) == 0                    \
+              && pthread_cond_broadcast(&ring->notFull) == 0;                 \
+                                                                              \
+        if (pthread_mutex_unlock(&ring->mutex) != 0) {                        \
+            return RB_FAILURE_TO_UNLOCK_MUTEX;                                \
+        }                                                                     \
+                                                                              \
+        return couldWake ? RB_OK : RB_FAILURE_TO_SIGNAL_CONDVAR;              \
+    }                                                                         \
+                                                                              \
+    /* Swallows the semicolon after DEFINE_RING(...). */                      \
+    struct name##SemicolonSwallower
+#endif /* INCG_TYPED_RING_H */
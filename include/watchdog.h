@@ -0,0 +1,121 @@
+#ifndef INCG_WATCHDOG_H
+#define INCG_WATCHDOG_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ring_buffer.h"
+#include "thread.h"
+
+/*!
+ * \brief Detects producers and consumers of a ring buffer that stopped
+ *        making progress.
+ *
+ * Every producer and consumer joins the watchdog, gets a slot of its own and
+ * beats into it whenever it completes an operation on the ring buffer. It
+ * marks the slot as waiting before it blocks on the ring buffer, which is
+ * fine for as long as the ring buffer itself keeps moving.
+ *
+ * Every interval the watchdog thread looks at the slots and at a snapshot
+ * of the ring buffer and reports
+ *  - threads that haven't beaten for the stall time while not waiting, or
+ *    consumers waiting for that long while there are bytes to read,
+ *  - the ring buffer being full without a byte being read for the stall
+ *    time, along with the consumers not making progress, and
+ *  - producers whose 99th percentile write latency during the interval
+ *    exceeds the limit, the latency being the time from marking the slot
+ *    as waiting to the next beat.
+ * Every alarm is reported once when it is raised and once when it clears,
+ * along with the state of the ring buffer.
+ **/
+typedef struct WatchdogOpaque Watchdog;
+
+/*!
+ * \brief The role of a thread watched.
+ **/
+typedef enum {
+    WATCHDOG_ROLE_PRODUCER, /*!< Writes to the ring buffer */
+    WATCHDOG_ROLE_CONSUMER  /*!< Reads from the ring buffer */
+} WatchdogRole;
+
+/*!
+ * \brief Configuration of a watchdog.
+ **/
+typedef struct {
+    int32_t  stallMilliseconds;    /*!< No progress for this long is a
+                                    *   stall
+                                    */
+    int32_t  intervalMilliseconds; /*!< The time between two checks */
+    uint64_t p99LimitMicroseconds; /*!< The write latency producers must
+                                    *   keep their 99th percentile below;
+                                    *   0 for no limit
+                                    */
+} WatchdogConfig;
+
+/*!
+ * \brief Creates a watchdog.
+ * \param ringBuffer The ring buffer watched. Must outlive the watchdog.
+ * \param maxThreads The maximum amount of threads joining.
+ * \param config The thresholds and the interval.
+ * \param watchdog Output parameter for the watchdog created.
+ * \return The status code.
+ * \warning The watchdog must be freed using `watchdogFree`.
+ * \sa watchdogFree
+ **/
+RingBufferStatusCode watchdogCreate(
+    RingBuffer *          ringBuffer,
+    size_t                maxThreads,
+    const WatchdogConfig *config,
+    Watchdog **           watchdog);
+
+/*!
+ * \brief Frees a watchdog.
+ * \param watchdog The watchdog to free.
+ * \return The status code.
+ **/
+RingBufferStatusCode watchdogFree(Watchdog *watchdog);
+
+/*!
+ * \brief Hands a thread a slot of its own.
+ * \param watchdog The watchdog; NULL to do nothing.
+ * \param role What the thread does with the ring buffer.
+ * \param threadId The thread ID reported.
+ * \param slot Output parameter for the slot, to be passed to
+ *             `watchdogWaiting` and `watchdogBeat`.
+ * \return The status code; RB_INVALID_ARGUMENT if `maxThreads` have joined
+ *         already.
+ **/
+RingBufferStatusCode watchdogJoin(
+    Watchdog *   watchdog,
+    WatchdogRole role,
+    int          threadId,
+    size_t *     slot);
+
+/*!
+ * \brief Marks a thread as about to block on the ring buffer.
+ * \param watchdog The watchdog; NULL to do nothing.
+ * \param slot The slot returned by `watchdogJoin`; must only be used by a
+ *             single thread.
+ **/
+void watchdogWaiting(Watchdog *watchdog, size_t slot);
+
+/*!
+ * \brief Records that a thread completed an operation on the ring buffer.
+ * \param watchdog The watchdog; NULL to do nothing.
+ * \param slot The slot returned by `watchdogJoin`.
+ *
+ * Ends the wait marked by `watchdogWaiting`, if any.
+ **/
+void watchdogBeat(Watchdog *watchdog, size_t slot);
+
+/*!
+ * \brief Creates the watchdog thread.
+ * \param watchdog The watchdog. Must outlive the thread.
+ * \param id The thread ID.
+ * \return The thread created; NULL on failure.
+ * \warning The return value must be freed using `threadFree` when it is no
+ *          longer needed. Shut it down before the producers and consumers,
+ *          as stopping them looks like a stall.
+ * \sa threadFree
+ **/
+Thread *watchdogThreadCreate(Watchdog *watchdog, int id);
+#endif /* INCG_WATCHDOG_H */
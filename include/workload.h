@@ -0,0 +1,142 @@
+#ifndef INCG_WORKLOAD_H
+#define INCG_WORKLOAD_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte.h"
+
+/*!
+ * \def WORKLOAD_MAGIC
+ * \brief Marks the start of every workload file ("RBWL" in little endian).
+ **/
+#define WORKLOAD_MAGIC 0x4c574252u
+
+/*!
+ * \def WORKLOAD_VERSION
+ * \brief The version of the workload file format.
+ **/
+#define WORKLOAD_VERSION 1u
+
+/*!
+ * \def WORKLOAD_HEADER_SIZE
+ * \brief The size of the header of a workload file in bytes.
+ **/
+#define WORKLOAD_HEADER_SIZE 12
+
+/*!
+ * \brief Captures a stream of messages along with their timing to a file.
+ *
+ * The file starts with a header of three little endian 32 bit words: the
+ * magic, the version and the message size, which is 0 for a stream of
+ * single bytes. Every message follows as the nanoseconds since the previous
+ * message, LEB128 encoded, and the message itself, so that a byte consumed
+ * every few milliseconds takes 5 bytes of the file.
+ * \note Thread safe; the messages of all the threads appending are recorded
+ *       in the order they are appended.
+ **/
+typedef struct WorkloadRecorderOpaque WorkloadRecorder;
+
+/*!
+ * \brief Creates a recorder.
+ * \param path The file to record to; truncated if it exists.
+ * \param messageSize The size of every message in bytes; 0 for single bytes.
+ * \return The recorder created on success; otherwise NULL.
+ * \warning The return value must be freed using `workloadRecorderFree`.
+ * \sa workloadRecorderFree
+ **/
+WorkloadRecorder *workloadRecorderCreate(const char *path, size_t messageSize);
+
+/*!
+ * \brief Records a message that has just arrived.
+ * \param recorder The recorder.
+ * \param message The message; `messageSize` bytes, or a single byte.
+ * \return true on success; false if writing to the file failed.
+ **/
+bool workloadRecorderAppend(WorkloadRecorder *recorder, const byte *message);
+
+/*!
+ * \brief Writes out what is buffered and frees the recorder.
+ * \param recorder The recorder to free.
+ * \param messageCount Output parameter for the amount of messages recorded;
+ *                     may be NULL.
+ * \return true on success; false if writing to or closing the file failed.
+ **/
+bool workloadRecorderFree(WorkloadRecorder *recorder, uint64_t *messageCount);
+
+/*!
+ * \brief A recorded workload, mapped into memory.
+ *
+ * Read only once opened, so any amount of threads may replay it at once,
+ * each using a cursor of its own.
+ **/
+typedef struct WorkloadReplayOpaque WorkloadReplay;
+
+/*!
+ * \brief A position within a recorded workload.
+ **/
+typedef struct {
+    size_t   position; /*!< The offset of the next message into the file */
+    uint64_t offsetNanoseconds; /*!< When the last message arrived,
+                                 *   relative to the first one
+                                 */
+} WorkloadCursor;
+
+/*!
+ * \brief Opens a recorded workload.
+ * \param path The file that a `WorkloadRecorder` wrote.
+ * \return The workload on success; NULL if the file can't be mapped or
+ *         isn't a workload file.
+ * \warning The return value must be freed using `workloadReplayFree`.
+ * \sa workloadReplayFree
+ **/
+WorkloadReplay *workloadReplayOpen(const char *path);
+
+/*!
+ * \brief Unmaps a recorded workload.
+ * \param replay The workload to free.
+ **/
+void workloadReplayFree(WorkloadReplay *replay);
+
+/*!
+ * \brief Returns the size of the messages of a recorded workload.
+ * \param replay The workload.
+ * \return The size in bytes; 0 for single bytes.
+ **/
+size_t workloadReplayMessageSize(const WorkloadReplay *replay);
+
+/*!
+ * \brief Positions a cursor at the first message.
+ * \param cursor The cursor.
+ **/
+void workloadCursorRewind(WorkloadCursor *cursor);
+
+/*!
+ * \brief Fetches the next message.
+ * \param replay The workload.
+ * \param cursor The cursor; advanced past the message.
+ * \param message Output parameter for the message, pointing into the
+ *                mapping; `workloadReplayMessageSize` bytes or a single byte.
+ * \return true on success; false at the end of the workload, or if the file
+ *         was cut short.
+ *
+ * `cursor->offsetNanoseconds` is when the message is due.
+ **/
+bool workloadReplayNext(
+    const WorkloadReplay *replay,
+    WorkloadCursor *      cursor,
+    const byte **         message);
+
+/*!
+ * \brief Reads the monotonic clock.
+ * \return The current time in nanoseconds.
+ **/
+uint64_t workloadNanoseconds(void);
+
+/*!
+ * \brief Sleeps until a point in time.
+ * \param deadlineNanoseconds The time to wake up at, as returned by
+ *                            `workloadNanoseconds`.
+ **/
+void workloadSleepUntil(uint64_t deadlineNanoseconds);
+#endif /* INCG_WORKLOAD_H */
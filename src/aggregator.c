@@ -0,0 +1,526 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aggregator.h"
+#include "arena.h"
+#include "sleep_thread.h"
+
+/*!
+ * \def AGGREGATOR_PARTIALS_PER_CONSUMER
+ * \brief The amount of windows a consumer can count into before the merger
+ *        has reported the oldest of them.
+ **/
+#define AGGREGATOR_PARTIALS_PER_CONSUMER 4
+
+/*!
+ * \def AGGREGATOR_POLL_MILLISECONDS
+ * \brief The longest the merger sleeps before reexamining its shutdown
+ *        state.
+ **/
+#define AGGREGATOR_POLL_MILLISECONDS 100
+
+/*!
+ * \def AGGREGATOR_NO_WINDOW
+ * \brief Marks a partial that hasn't counted any window yet.
+ **/
+#define AGGREGATOR_NO_WINDOW UINT64_MAX
+
+/*!
+ * \brief The aggregate of a window.
+ *
+ * The members of a partial are atomic, as the merger reads them while its
+ * consumer may already reuse the partial for a later window.
+ **/
+typedef struct {
+    uint64_t window; /*!< The window counted; AGGREGATOR_NO_WINDOW if none */
+    uint64_t sum;    /*!< The sum of the symbols */
+    uint64_t counts[AGGREGATOR_SYMBOL_COUNT]; /*!< Indexed by symbol */
+} AggregatorWindow;
+
+/*!
+ * \brief The partials of a consumer.
+ *
+ * Allocated on cache lines of their own and only written by the consumer.
+ **/
+typedef struct {
+    uint64_t countingWindow; /*!< Atomic; the window being counted into;
+                              *   AGGREGATOR_NO_WINDOW if none
+                              */
+    AggregatorWindow partials[AGGREGATOR_PARTIALS_PER_CONSUMER];
+} AggregatorConsumer;
+
+/*!
+ * \brief Aggregator implementation type.
+ **/
+typedef struct {
+    AggregatorConfig     config;            /*!< The windows */
+    uint64_t             startMilliseconds; /*!< When window 0 began */
+    Arena *              arena;             /*!< Holds `consumers` */
+    AggregatorConsumer **consumers;         /*!< One per consumer joined */
+    size_t               maxConsumers;      /*!< The size of `consumers` */
+    size_t               consumerCount;     /*!< Atomic; consumers joined */
+    AggregatorWindow *   history;           /*!< The last windows reported,
+                                             *   making up the sliding
+                                             *   window; only touched by the
+                                             *   merger
+                                             */
+    size_t historySize;                     /*!< The size of `history` */
+} AggregatorImpl;
+
+static AggregatorImpl *impl(Aggregator *aggregator)
+{
+    return (AggregatorImpl *) aggregator;
+}
+
+static Aggregator *opaque(AggregatorImpl *aggregator)
+{
+    return (Aggregator *) aggregator;
+}
+
+/*!
+ * \brief Returns the monotonic time in milliseconds.
+ **/
+static uint64_t nowMilliseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000u + (uint64_t) now.tv_nsec / 1000000u;
+}
+
+/*!
+ * \brief Returns the window that is open at the moment.
+ * \param a The aggregator.
+ * \return The index of the window.
+ **/
+static uint64_t currentWindow(const AggregatorImpl *a)
+{
+    return (nowMilliseconds() - a->startMilliseconds)
+           / (uint64_t) a->config.windowMilliseconds;
+}
+
+RingBufferStatusCode aggregatorCreate(
+    size_t                  maxConsumers,
+    const AggregatorConfig *config,
+    Aggregator **           aggregator)
+{
+    if (maxConsumers == 0 || config->windowMilliseconds <= 0
+        || config->topK > AGGREGATOR_MAX_TOP_K || aggregator == NULL) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    RingBufferStatusCode statusCode = RB_NOMEM;
+    AggregatorImpl *     a          = calloc(1, sizeof(AggregatorImpl));
+
+    if (a == NULL) {
+        return RB_NOMEM;
+    }
+
+    a->config            = *config;
+    a->maxConsumers      = maxConsumers;
+    a->historySize       = config->slidingWindows > 1 ? config->slidingWindows
+                                                      : 1;
+    a->consumers         = calloc(maxConsumers, sizeof(AggregatorConsumer *));
+    a->history           = calloc(a->historySize, sizeof(AggregatorWindow));
+    a->arena             = arenaCreate(
+        maxConsumers * arenaFootprint(sizeof(AggregatorConsumer)));
+    a->startMilliseconds = nowMilliseconds();
+
+    if (a->consumers == NULL || a->history == NULL || a->arena == NULL) {
+        goto error;
+    }
+
+    for (size_t i = 0; i < a->historySize; ++i) {
+        a->history[i].window = AGGREGATOR_NO_WINDOW;
+    }
+
+    *aggregator = opaque(a);
+    return RB_OK;
+
+error:
+    arenaFree(a->arena);
+    free(a->history);
+    free(a->consumers);
+    free(a);
+    return statusCode;
+}
+
+RingBufferStatusCode aggregatorFree(Aggregator *aggregator)
+{
+    AggregatorImpl *a = impl(aggregator);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (a == NULL) {
+        return RB_OK;
+    }
+
+    arenaFree(a->arena);
+    free(a->history);
+    free(a->consumers);
+    free(a);
+    return RB_OK;
+}
+
+RingBufferStatusCode
+aggregatorJoin(Aggregator *aggregator, size_t *partialIndex)
+{
+    AggregatorImpl *a = impl(aggregator);
+    const size_t    index
+        = __atomic_fetch_add(&a->consumerCount, 1, __ATOMIC_ACQ_REL);
+
+    if (index >= a->maxConsumers) {
+        __atomic_fetch_sub(&a->consumerCount, 1, __ATOMIC_ACQ_REL);
+        return RB_INVALID_ARGUMENT;
+    }
+
+    AggregatorConsumer *consumer
+        = arenaAllocate(a->arena, sizeof(AggregatorConsumer));
+
+    consumer->countingWindow = AGGREGATOR_NO_WINDOW;
+
+    for (size_t i = 0; i < AGGREGATOR_PARTIALS_PER_CONSUMER; ++i) {
+        consumer->partials[i].window = AGGREGATOR_NO_WINDOW;
+    }
+
+    // Published along with the partials it points to.
+    __atomic_store_n(&a->consumers[index], consumer, __ATOMIC_RELEASE);
+    *partialIndex = index;
+    return RB_OK;
+}
+
+void aggregatorAdd(
+    Aggregator *aggregator,
+    size_t      partialIndex,
+    const byte *symbols,
+    size_t      count)
+{
+    AggregatorImpl *    a        = impl(aggregator);
+    AggregatorConsumer *consumer = a->consumers[partialIndex];
+
+    // Announce the window, then make sure it is still open. A merger that
+    // finds another window announced after its window closed knows that
+    // every later count goes to a later window.
+    uint64_t window = currentWindow(a);
+
+    for (;;) {
+        __atomic_store_n(&consumer->countingWindow, window, __ATOMIC_SEQ_CST);
+
+        const uint64_t stillOpen = currentWindow(a);
+
+        if (stillOpen == window) {
+            break;
+        }
+
+        window = stillOpen;
+    }
+
+    AggregatorWindow *partial
+        = &consumer->partials[window % AGGREGATOR_PARTIALS_PER_CONSUMER];
+
+    if (__atomic_load_n(&partial->window, __ATOMIC_RELAXED) != window) {
+        // Invalidate the partial before clearing it, so that a merger still
+        // reading it notices.
+        __atomic_store_n(
+            &partial->window, AGGREGATOR_NO_WINDOW, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&partial->sum, 0, __ATOMIC_RELAXED);
+
+        for (size_t i = 0; i < AGGREGATOR_SYMBOL_COUNT; ++i) {
+            __atomic_store_n(&partial->counts[i], 0, __ATOMIC_RELAXED);
+        }
+
+        __atomic_store_n(&partial->window, window, __ATOMIC_RELAXED);
+    }
+
+    // Only this consumer writes the partial, so no read-modify-write is
+    // needed.
+    uint64_t sum = __atomic_load_n(&partial->sum, __ATOMIC_RELAXED);
+
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t *counter = &partial->counts[symbols[i]];
+        __atomic_store_n(
+            counter,
+            __atomic_load_n(counter, __ATOMIC_RELAXED) + 1,
+            __ATOMIC_RELAXED);
+        sum += symbols[i];
+    }
+
+    __atomic_store_n(&partial->sum, sum, __ATOMIC_RELAXED);
+    __atomic_store_n(
+        &consumer->countingWindow, AGGREGATOR_NO_WINDOW, __ATOMIC_RELEASE);
+}
+
+/*!
+ * \brief Adds the partials of all the consumers of a closed window.
+ * \param a The aggregator.
+ * \param window The index of the window; must have closed.
+ * \param merged Output parameter for the aggregate of the window.
+ * \return The amount of partials that were overwritten before they could be
+ *         merged.
+ **/
+static size_t
+mergeWindow(AggregatorImpl *a, uint64_t window, AggregatorWindow *merged)
+{
+    const size_t consumerCount
+        = __atomic_load_n(&a->consumerCount, __ATOMIC_ACQUIRE);
+    size_t lostCount = 0;
+
+    memset(merged, 0, sizeof(*merged));
+    merged->window = window;
+
+    for (size_t c = 0; c < consumerCount && c < a->maxConsumers; ++c) {
+        const AggregatorConsumer *consumer
+            = __atomic_load_n(&a->consumers[c], __ATOMIC_ACQUIRE);
+
+        // Still joining; it hasn't counted anything yet.
+        if (consumer == NULL) {
+            continue;
+        }
+
+        // A count into the window that started before it closed is yet to
+        // be finished. There is at most one, as the next count goes to a
+        // later window, so a consumer busy counting those is never waited
+        // for. It takes microseconds, but the consumer may be preempted, so
+        // don't spin.
+        while (__atomic_load_n(&consumer->countingWindow, __ATOMIC_SEQ_CST)
+               == window) {
+            sleepThreadMilliseconds(1);
+        }
+
+        const AggregatorWindow *partial
+            = &consumer->partials[window % AGGREGATOR_PARTIALS_PER_CONSUMER];
+        AggregatorWindow copy;
+
+        if (__atomic_load_n(&partial->window, __ATOMIC_ACQUIRE) != window) {
+            continue;
+        }
+
+        copy.sum = __atomic_load_n(&partial->sum, __ATOMIC_RELAXED);
+
+        for (size_t i = 0; i < AGGREGATOR_SYMBOL_COUNT; ++i) {
+            copy.counts[i]
+                = __atomic_load_n(&partial->counts[i], __ATOMIC_RELAXED);
+        }
+
+        // The consumer has moved on to a window that reuses the partial.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&partial->window, __ATOMIC_RELAXED) != window) {
+            ++lostCount;
+            continue;
+        }
+
+        merged->sum += copy.sum;
+
+        for (size_t i = 0; i < AGGREGATOR_SYMBOL_COUNT; ++i) {
+            merged->counts[i] += copy.counts[i];
+        }
+    }
+
+    return lostCount;
+}
+
+/*!
+ * \brief Prints the aggregate of a window.
+ * \param id The thread ID of the merger.
+ * \param kind "window" or "sliding window".
+ * \param firstMilliseconds When the window began, relative to the start.
+ * \param lastMilliseconds When the window ended, relative to the start.
+ * \param aggregate The aggregate.
+ * \param topK The amount of most frequent symbols to print.
+ **/
+static void printWindow(
+    int                     id,
+    const char *            kind,
+    uint64_t                firstMilliseconds,
+    uint64_t                lastMilliseconds,
+    const AggregatorWindow *aggregate,
+    size_t                  topK)
+{
+    size_t   top[AGGREGATOR_MAX_TOP_K];
+    size_t   topCount = 0;
+    uint64_t count    = 0;
+
+    // Keep the most frequent symbols sorted by descending count.
+    for (size_t symbol = 0; symbol < AGGREGATOR_SYMBOL_COUNT; ++symbol) {
+        const uint64_t symbolCount = aggregate->counts[symbol];
+        count += symbolCount;
+
+        if (symbolCount == 0) {
+            continue;
+        }
+
+        size_t position = topCount < topK ? topCount++ : topK;
+
+        while (position > 0
+               && aggregate->counts[top[position - 1]] < symbolCount) {
+            if (position < topK) {
+                top[position] = top[position - 1];
+            }
+
+            --position;
+        }
+
+        if (position < topK) {
+            top[position] = symbol;
+        }
+    }
+
+    printf(
+        "Aggregator (tid: %d) %s [%llu ms, %llu ms): %llu symbols, sum %llu",
+        id,
+        kind,
+        (unsigned long long) firstMilliseconds,
+        (unsigned long long) lastMilliseconds,
+        (unsigned long long) count,
+        (unsigned long long) aggregate->sum);
+
+    for (size_t i = 0; i < topCount; ++i) {
+        const char *separator = i == 0 ? ", top: " : ", ";
+
+        if (isprint((int) top[i])) {
+            printf("%s'%c' ", separator, (int) top[i]);
+        }
+        else {
+            printf("%s0x%02zx ", separator, top[i]);
+        }
+
+        printf("%llu", (unsigned long long) aggregate->counts[top[i]]);
+    }
+
+    printf(".\n");
+}
+
+/*!
+ * \brief Merges and reports a closed window, and the sliding window ending
+ *        with it.
+ * \param a The aggregator.
+ * \param window The index of the window; must have closed.
+ * \param id The thread ID of the merger.
+ **/
+static void closeWindow(AggregatorImpl *a, uint64_t window, int id)
+{
+    const uint64_t    length = (uint64_t) a->config.windowMilliseconds;
+    AggregatorWindow *merged = &a->history[window % a->historySize];
+    const size_t      lostCount = mergeWindow(a, window, merged);
+
+    if (lostCount != 0) {
+        fprintf(
+            stderr,
+            "Aggregator (tid: %d) reported window %llu too late; %zu "
+            "partials were lost.\n",
+            id,
+            (unsigned long long) window,
+            lostCount);
+    }
+
+    printWindow(
+        id,
+        "window",
+        window * length,
+        (window + 1) * length,
+        merged,
+        a->config.topK);
+
+    if (a->historySize == 1) {
+        return;
+    }
+
+    AggregatorWindow sliding;
+    uint64_t         first = window;
+    memset(&sliding, 0, sizeof(sliding));
+
+    for (size_t h = 0; h < a->historySize; ++h) {
+        const AggregatorWindow *past = &a->history[h];
+
+        // Windows before the first one haven't happened.
+        if (past->window == AGGREGATOR_NO_WINDOW) {
+            continue;
+        }
+
+        first = past->window < first ? past->window : first;
+        sliding.sum += past->sum;
+
+        for (size_t i = 0; i < AGGREGATOR_SYMBOL_COUNT; ++i) {
+            sliding.counts[i] += past->counts[i];
+        }
+    }
+
+    printWindow(
+        id,
+        "sliding window",
+        first * length,
+        (window + 1) * length,
+        &sliding,
+        a->config.topK);
+}
+
+/*!
+ * \brief The thread function for the merger thread.
+ * \param ringBuffer Unused.
+ * \param sleepTimeSeconds Unused; the windows are part of the config.
+ * \param id The thread ID.
+ * \param self A pointer to the thread itself; its context is the
+ *             aggregator.
+ **/
+static int mergerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+
+    AggregatorImpl *a          = threadContext(self);
+    uint64_t        nextWindow = 0;
+    bool            shouldShutdown;
+
+    for (;;) {
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            return EXIT_FAILURE;
+        }
+
+        const uint64_t window = currentWindow(a);
+
+        // Once the consumers have stopped the open window is complete too.
+        while (nextWindow < window
+               || (shouldShutdown && nextWindow == window)) {
+            closeWindow(a, nextWindow, id);
+            ++nextWindow;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        const uint64_t closesAt
+            = a->startMilliseconds
+              + (window + 1) * (uint64_t) a->config.windowMilliseconds;
+        const uint64_t now = nowMilliseconds();
+        const uint64_t sleepMilliseconds
+            = closesAt <= now ? 0 : closesAt - now;
+
+        sleepThreadMilliseconds(
+            sleepMilliseconds < AGGREGATOR_POLL_MILLISECONDS
+                ? (int32_t) sleepMilliseconds
+                : AGGREGATOR_POLL_MILLISECONDS);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+Thread *aggregatorMergerCreate(Aggregator *aggregator, int id)
+{
+    return threadCreateWithContext(
+        &mergerThreadFunction,
+        /* ringBuffer */ NULL,
+        /* sleepTimeSeconds */ 0,
+        id,
+        impl(aggregator));
+}
@@ -0,0 +1,104 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "byte.h"
+
+/*!
+ * \brief Arena implementation type.
+ **/
+typedef struct {
+    byte * allocation; /*!< What malloc returned */
+    byte * begin;      /*!< `allocation` aligned to ARENA_ALIGNMENT */
+    size_t capacity;   /*!< The amount of bytes starting at `begin` */
+    size_t used;       /*!< Atomic; the amount of bytes handed out */
+} ArenaImpl;
+
+static ArenaImpl *impl(Arena *arena)
+{
+    return (ArenaImpl *) arena;
+}
+
+static const ArenaImpl *constImpl(const Arena *arena)
+{
+    return (const ArenaImpl *) arena;
+}
+
+static Arena *opaque(ArenaImpl *arena)
+{
+    return (Arena *) arena;
+}
+
+Arena *arenaCreate(size_t capacity)
+{
+    ArenaImpl *a = malloc(sizeof(ArenaImpl));
+
+    if (a == NULL) {
+        return NULL;
+    }
+
+    a->capacity   = arenaFootprint(capacity);
+    a->used       = 0;
+    a->allocation = malloc(a->capacity + ARENA_ALIGNMENT - 1);
+
+    if (a->allocation == NULL) {
+        free(a);
+        return NULL;
+    }
+
+    const uintptr_t address = (uintptr_t) a->allocation;
+    a->begin                = a->allocation
+                 + (ARENA_ALIGNMENT - address % ARENA_ALIGNMENT)
+                       % ARENA_ALIGNMENT;
+
+    // Fault the pages in now rather than on the message path.
+    memset(a->begin, 0, a->capacity);
+    return opaque(a);
+}
+
+void arenaFree(Arena *arena)
+{
+    ArenaImpl *a = impl(arena);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (a == NULL) {
+        return;
+    }
+
+    free(a->allocation);
+    free(a);
+}
+
+size_t arenaFootprint(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+void *arenaAllocate(Arena *arena, size_t size)
+{
+    ArenaImpl *  a         = impl(arena);
+    const size_t footprint = arenaFootprint(size);
+    size_t       used      = __atomic_load_n(&a->used, __ATOMIC_RELAXED);
+
+    // Bump unless that would overshoot; the memory is zeroed already.
+    do {
+        if (footprint > a->capacity - used) {
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(
+        &a->used,
+        &used,
+        used + footprint,
+        /* weak */ true,
+        __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED));
+
+    return a->begin + used;
+}
+
+size_t arenaUsed(const Arena *arena)
+{
+    return __atomic_load_n(&constImpl(arena)->used, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,739 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "channel_manager.h"
+
+/*!
+ * \def CHANNEL_NO_CHUNK
+ * \brief Ends a list of chunks; also marks a channel holding no chunks.
+ **/
+#define CHANNEL_NO_CHUNK UINT32_MAX
+
+/*!
+ * \def CHANNEL_NO_CHANNEL
+ * \brief Ends the list of closed channels.
+ **/
+#define CHANNEL_NO_CHANNEL UINT32_MAX
+
+/*!
+ * \brief The header of a channel.
+ *
+ * The chunks of a channel are linked from `head` to `tail` through the
+ * links of the chunk pool. Protected by the stripe of the channel.
+ **/
+typedef struct {
+    uint32_t head;        /*!< The chunk read from; the next closed channel
+                           *   while closed
+                           */
+    uint32_t tail;        /*!< The chunk written to */
+    uint32_t readOffset;  /*!< The offset into `head` to read from */
+    uint32_t writeOffset; /*!< The offset into `tail` to write to */
+    uint32_t size;        /*!< The amount of bytes unread */
+    uint32_t chunkCount;  /*!< The amount of chunks held */
+    uint32_t maxChunks;   /*!< The quota in chunks; 0 while closed */
+    uint32_t generation;  /*!< Bumped on every close */
+} Channel;
+
+/*!
+ * \brief A mutex and a condition variable shared by several channels.
+ *
+ * Allocated on cache lines of their own.
+ **/
+typedef struct {
+    pthread_mutex_t mutex;   /*!< Protects the channels of the stripe */
+    pthread_cond_t  changed; /*!< Broadcast whenever a channel of the stripe
+                              *   was read from or written to
+                              */
+    size_t waiters;          /*!< The threads waiting on `changed` */
+} ChannelStripe;
+
+/*!
+ * \brief Channel manager implementation type.
+ **/
+typedef struct {
+    size_t          maxChannels; /*!< The size of `channels` */
+    size_t          chunkCount;  /*!< The amount of chunks */
+    size_t          chunkSize;   /*!< The size of every chunk in bytes */
+    Channel *       channels;    /*!< Indexed by channel ID */
+    byte *          chunks;      /*!< All the chunks, back to back */
+    uint32_t *      nextChunk;   /*!< Links of the chunk lists */
+    ChannelStripe * stripes[CHANNEL_MANAGER_STRIPE_COUNT]; /*!< The locks */
+    pthread_mutex_t freeMutex;      /*!< Protects the below */
+    uint32_t        freeChunk;      /*!< The first chunk no channel holds */
+    size_t          freeChunkCount; /*!< Atomic; the length of that list */
+    uint32_t        freeChannel;    /*!< The first closed channel */
+} ChannelManagerImpl;
+
+static ChannelManagerImpl *impl(ChannelManager *manager)
+{
+    return (ChannelManagerImpl *) manager;
+}
+
+static ChannelManager *opaque(ChannelManagerImpl *manager)
+{
+    return (ChannelManager *) manager;
+}
+
+static ChannelStripe *stripeOf(ChannelManagerImpl *m, ChannelId channel)
+{
+    return m->stripes[channel % CHANNEL_MANAGER_STRIPE_COUNT];
+}
+
+static byte *chunkData(ChannelManagerImpl *m, uint32_t chunk)
+{
+    return m->chunks + (size_t) chunk * m->chunkSize;
+}
+
+/*!
+ * \brief Takes a chunk from the pool.
+ * \param m The manager.
+ * \return The chunk; CHANNEL_NO_CHUNK if the pool is empty.
+ **/
+static uint32_t takeChunk(ChannelManagerImpl *m)
+{
+    if (pthread_mutex_lock(&m->freeMutex) != 0) {
+        return CHANNEL_NO_CHUNK;
+    }
+
+    const uint32_t chunk = m->freeChunk;
+
+    if (chunk != CHANNEL_NO_CHUNK) {
+        m->freeChunk = m->nextChunk[chunk];
+        __atomic_sub_fetch(&m->freeChunkCount, 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&m->freeMutex);
+    return chunk;
+}
+
+/*!
+ * \brief Gives a list of chunks back to the pool.
+ * \param m The manager.
+ * \param first The first chunk of the list; CHANNEL_NO_CHUNK if it's empty.
+ * \param last The last chunk of the list.
+ * \param count The length of the list.
+ **/
+static void
+giveChunks(ChannelManagerImpl *m, uint32_t first, uint32_t last, size_t count)
+{
+    if (first == CHANNEL_NO_CHUNK || pthread_mutex_lock(&m->freeMutex) != 0) {
+        return;
+    }
+
+    m->nextChunk[last] = m->freeChunk;
+    m->freeChunk       = first;
+    __atomic_add_fetch(&m->freeChunkCount, count, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&m->freeMutex);
+}
+
+/*!
+ * \brief Writes as many bytes as the quota and the pool allow.
+ * \param m The manager.
+ * \param c The channel; its stripe must be locked.
+ * \param source The bytes to write.
+ * \param byteCount The amount of bytes in `source`.
+ * \param isPoolEmpty Output parameter; true if the pool ran out of chunks.
+ * \return The amount of bytes written.
+ **/
+static size_t writeLocked(
+    ChannelManagerImpl *m,
+    Channel *           c,
+    const byte *        source,
+    size_t              byteCount,
+    bool *              isPoolEmpty)
+{
+    size_t written = 0;
+    *isPoolEmpty   = false;
+
+    while (written < byteCount) {
+        if (c->tail == CHANNEL_NO_CHUNK || c->writeOffset == m->chunkSize) {
+            if (c->chunkCount == c->maxChunks) {
+                break;
+            }
+
+            const uint32_t chunk = takeChunk(m);
+
+            if (chunk == CHANNEL_NO_CHUNK) {
+                *isPoolEmpty = true;
+                break;
+            }
+
+            m->nextChunk[chunk] = CHANNEL_NO_CHUNK;
+
+            if (c->tail == CHANNEL_NO_CHUNK) {
+                c->head       = chunk;
+                c->readOffset = 0;
+            }
+            else {
+                m->nextChunk[c->tail] = chunk;
+            }
+
+            c->tail        = chunk;
+            c->writeOffset = 0;
+            ++c->chunkCount;
+        }
+
+        const size_t room  = m->chunkSize - c->writeOffset;
+        const size_t count = byteCount - written < room ? byteCount - written
+                                                        : room;
+        memcpy(chunkData(m, c->tail) + c->writeOffset, source + written, count);
+        c->writeOffset += (uint32_t) count;
+        c->size += (uint32_t) count;
+        written += count;
+    }
+
+    return written;
+}
+
+/*!
+ * \brief Reads the bytes available, giving back the chunks emptied.
+ * \param m The manager.
+ * \param c The channel; its stripe must be locked.
+ * \param destination The buffer to read into.
+ * \param maxBytes The size of `destination` in bytes.
+ * \return The amount of bytes read.
+ **/
+static size_t readLocked(
+    ChannelManagerImpl *m,
+    Channel *           c,
+    byte *              destination,
+    size_t              maxBytes)
+{
+    uint32_t emptiedFirst = CHANNEL_NO_CHUNK;
+    uint32_t emptiedLast  = CHANNEL_NO_CHUNK;
+    size_t   emptiedCount = 0;
+    size_t   read         = 0;
+
+    while (read < maxBytes && c->size != 0) {
+        const size_t end       = c->head == c->tail ? c->writeOffset
+                                                    : m->chunkSize;
+        const size_t available = end - c->readOffset;
+        const size_t count     = maxBytes - read < available ? maxBytes - read
+                                                             : available;
+        memcpy(
+            destination + read, chunkData(m, c->head) + c->readOffset, count);
+        c->readOffset += (uint32_t) count;
+        c->size -= (uint32_t) count;
+        read += count;
+
+        // An empty channel holds no chunks at all.
+        if (c->readOffset == end && (c->size == 0 || end == m->chunkSize)) {
+            const uint32_t emptied = c->head;
+            c->head                = m->nextChunk[emptied];
+            c->readOffset          = 0;
+            --c->chunkCount;
+
+            if (emptiedLast == CHANNEL_NO_CHUNK) {
+                emptiedFirst = emptied;
+            }
+            else {
+                m->nextChunk[emptiedLast] = emptied;
+            }
+
+            emptiedLast = emptied;
+            ++emptiedCount;
+
+            if (c->size == 0) {
+                c->head        = CHANNEL_NO_CHUNK;
+                c->tail        = CHANNEL_NO_CHUNK;
+                c->writeOffset = 0;
+            }
+        }
+    }
+
+    // Give them back at once, taking the pool's mutex only once.
+    giveChunks(m, emptiedFirst, emptiedLast, emptiedCount);
+    return read;
+}
+
+/*!
+ * \brief Locks the stripe of a channel and checks that the channel is open.
+ * \param m The manager.
+ * \param channel The channel.
+ * \param stripe Output parameter for the stripe locked.
+ * \return The status code; the stripe is only locked on success.
+ **/
+static RingBufferStatusCode
+lockChannel(ChannelManagerImpl *m, ChannelId channel, ChannelStripe **stripe)
+{
+    if (channel >= m->maxChannels) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    *stripe = stripeOf(m, channel);
+
+    if (pthread_mutex_lock(&(*stripe)->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    if (m->channels[channel].maxChunks == 0) {
+        pthread_mutex_unlock(&(*stripe)->mutex);
+        return RB_INVALID_ARGUMENT;
+    }
+
+    return RB_OK;
+}
+
+/*!
+ * \brief Wakes the threads waiting on a stripe, if any, and unlocks it.
+ * \param stripe The stripe; must be locked.
+ * \param hasChanged Whether a channel of the stripe was read or written.
+ * \param statusCode The status code to return on success.
+ * \return The status code.
+ **/
+static RingBufferStatusCode unlockChannel(
+    ChannelStripe *      stripe,
+    bool                 hasChanged,
+    RingBufferStatusCode statusCode)
+{
+    if (hasChanged && stripe->waiters != 0
+        && pthread_cond_broadcast(&stripe->changed) != 0) {
+        statusCode = RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    if (pthread_mutex_unlock(&stripe->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return statusCode;
+}
+
+/*!
+ * \brief Waits for a channel of a stripe to be read, written or closed.
+ * \param stripe The stripe; must be locked.
+ * \param c The channel waited for.
+ * \param generation The generation of `c` when the wait began.
+ * \param self The waiting thread.
+ * \return The status code; RB_THREAD_SHOULD_SHUTDOWN if `self` should shut
+ *         down, RB_INVALID_ARGUMENT if `c` has been closed meanwhile.
+ **/
+static RingBufferStatusCode waitChanged(
+    ChannelStripe *stripe,
+    const Channel *c,
+    uint32_t       generation,
+    Thread *       self)
+{
+    bool shouldShutdown;
+
+    if (!threadShouldShutdown(self, &shouldShutdown)) {
+        return RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+    }
+
+    if (shouldShutdown) {
+        return RB_THREAD_SHOULD_SHUTDOWN;
+    }
+
+    ++stripe->waiters;
+    const int error = pthread_cond_wait(&stripe->changed, &stripe->mutex);
+    --stripe->waiters;
+
+    if (error != 0) {
+        return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+    }
+
+    // Even if it has been opened again, it's somebody else's channel now.
+    return c->generation == generation ? RB_OK : RB_INVALID_ARGUMENT;
+}
+
+size_t channelManagerArenaSize(
+    size_t maxChannels,
+    size_t chunkCount,
+    size_t chunkSize)
+{
+    return arenaFootprint(sizeof(ChannelManagerImpl))
+           + arenaFootprint(maxChannels * sizeof(Channel))
+           + arenaFootprint(chunkCount * sizeof(uint32_t))
+           + CHANNEL_MANAGER_STRIPE_COUNT
+                 * arenaFootprint(sizeof(ChannelStripe))
+           + arenaFootprint(chunkCount * chunkSize);
+}
+
+RingBufferStatusCode channelManagerCreate(
+    Arena *          arena,
+    size_t           maxChannels,
+    size_t           chunkCount,
+    size_t           chunkSize,
+    ChannelManager **manager)
+{
+    if (maxChannels == 0 || maxChannels >= CHANNEL_NO_CHANNEL
+        || chunkCount == 0 || chunkCount >= CHANNEL_NO_CHUNK
+        || chunkSize == 0 || chunkSize > UINT32_MAX || manager == NULL) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    ChannelManagerImpl *m = arenaAllocate(arena, sizeof(ChannelManagerImpl));
+
+    if (m == NULL) {
+        return RB_NOMEM;
+    }
+
+    m->maxChannels = maxChannels;
+    m->chunkCount  = chunkCount;
+    m->chunkSize   = chunkSize;
+    m->channels    = arenaAllocate(arena, maxChannels * sizeof(Channel));
+    m->nextChunk   = arenaAllocate(arena, chunkCount * sizeof(uint32_t));
+
+    if (m->channels == NULL || m->nextChunk == NULL) {
+        return RB_NOMEM;
+    }
+
+    for (size_t s = 0; s < CHANNEL_MANAGER_STRIPE_COUNT; ++s) {
+        m->stripes[s] = arenaAllocate(arena, sizeof(ChannelStripe));
+
+        if (m->stripes[s] == NULL) {
+            return RB_NOMEM;
+        }
+    }
+
+    // Last, so that the headers stay close together.
+    m->chunks = arenaAllocate(arena, chunkCount * chunkSize);
+
+    if (m->chunks == NULL) {
+        return RB_NOMEM;
+    }
+
+    // Hand out the lowest channels and chunks first.
+    for (size_t c = 0; c < maxChannels; ++c) {
+        m->channels[c].head = c + 1 == maxChannels ? CHANNEL_NO_CHANNEL
+                                                   : (uint32_t) (c + 1);
+    }
+
+    for (size_t c = 0; c < chunkCount; ++c) {
+        m->nextChunk[c] = c + 1 == chunkCount ? CHANNEL_NO_CHUNK
+                                              : (uint32_t) (c + 1);
+    }
+
+    m->freeChannel    = 0;
+    m->freeChunk      = 0;
+    m->freeChunkCount = chunkCount;
+
+    RingBufferStatusCode statusCode = RB_FAILURE_TO_INIT_MUTEX;
+    size_t               s          = 0;
+
+    if (pthread_mutex_init(&m->freeMutex, NULL) != 0) {
+        return RB_FAILURE_TO_INIT_MUTEX;
+    }
+
+    for (; s < CHANNEL_MANAGER_STRIPE_COUNT; ++s) {
+        if (pthread_mutex_init(&m->stripes[s]->mutex, NULL) != 0) {
+            statusCode = RB_FAILURE_TO_INIT_MUTEX;
+            goto error;
+        }
+
+        if (pthread_cond_init(&m->stripes[s]->changed, NULL) != 0) {
+            pthread_mutex_destroy(&m->stripes[s]->mutex);
+            statusCode = RB_FAILURE_TO_INIT_CONDVAR;
+            goto error;
+        }
+    }
+
+    *manager = opaque(m);
+    return RB_OK;
+
+error:
+    while (s-- > 0) {
+        pthread_cond_destroy(&m->stripes[s]->changed);
+        pthread_mutex_destroy(&m->stripes[s]->mutex);
+    }
+
+    pthread_mutex_destroy(&m->freeMutex);
+    return statusCode;
+}
+
+RingBufferStatusCode channelManagerDestroy(ChannelManager *manager)
+{
+    ChannelManagerImpl *m = impl(manager);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (m == NULL) {
+        return RB_OK;
+    }
+
+    RingBufferStatusCode statusCode = RB_OK;
+
+    for (size_t s = 0; s < CHANNEL_MANAGER_STRIPE_COUNT; ++s) {
+        if (pthread_cond_destroy(&m->stripes[s]->changed) != 0) {
+            statusCode = RB_FAILURE_TO_DESTROY_CONDVAR;
+        }
+
+        if (pthread_mutex_destroy(&m->stripes[s]->mutex) != 0) {
+            statusCode = RB_FAILURE_TO_DESTROY_MUTEX;
+        }
+    }
+
+    if (pthread_mutex_destroy(&m->freeMutex) != 0) {
+        statusCode = RB_FAILURE_TO_DESTROY_MUTEX;
+    }
+
+    return statusCode;
+}
+
+RingBufferStatusCode channelManagerOpen(
+    ChannelManager *manager,
+    size_t          quota,
+    ChannelId *     channel)
+{
+    ChannelManagerImpl *m         = impl(manager);
+    const size_t        maxChunks = quota / m->chunkSize;
+
+    if (maxChunks == 0 || maxChunks > UINT32_MAX / m->chunkSize) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    if (pthread_mutex_lock(&m->freeMutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    const uint32_t id = m->freeChannel;
+
+    if (id != CHANNEL_NO_CHANNEL) {
+        m->freeChannel = m->channels[id].head;
+    }
+
+    if (pthread_mutex_unlock(&m->freeMutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    if (id == CHANNEL_NO_CHANNEL) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    ChannelStripe *stripe = stripeOf(m, id);
+
+    if (pthread_mutex_lock(&stripe->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    Channel *c     = &m->channels[id];
+    c->head        = CHANNEL_NO_CHUNK;
+    c->tail        = CHANNEL_NO_CHUNK;
+    c->readOffset  = 0;
+    c->writeOffset = 0;
+    c->size        = 0;
+    c->chunkCount  = 0;
+    c->maxChunks   = (uint32_t) maxChunks;
+
+    if (pthread_mutex_unlock(&stripe->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    *channel = id;
+    return RB_OK;
+}
+
+RingBufferStatusCode
+channelManagerClose(ChannelManager *manager, ChannelId channel)
+{
+    ChannelManagerImpl * m = impl(manager);
+    ChannelStripe *      stripe;
+    RingBufferStatusCode statusCode = lockChannel(m, channel, &stripe);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    Channel *c = &m->channels[channel];
+    giveChunks(m, c->head, c->tail, c->chunkCount);
+    c->maxChunks = 0;
+    ++c->generation;
+
+    // Don't leave the threads blocked on the channel waiting forever.
+    statusCode = unlockChannel(stripe, true, RB_OK);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    if (pthread_mutex_lock(&m->freeMutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    c->head        = m->freeChannel;
+    m->freeChannel = channel;
+
+    if (pthread_mutex_unlock(&m->freeMutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode channelManagerTryWrite(
+    ChannelManager *manager,
+    ChannelId       channel,
+    const byte *    source,
+    size_t          byteCount,
+    size_t *        bytesWritten)
+{
+    ChannelManagerImpl * m = impl(manager);
+    ChannelStripe *      stripe;
+    RingBufferStatusCode statusCode = lockChannel(m, channel, &stripe);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    bool isPoolEmpty;
+    *bytesWritten = writeLocked(
+        m, &m->channels[channel], source, byteCount, &isPoolEmpty);
+    return unlockChannel(stripe, *bytesWritten != 0, RB_OK);
+}
+
+RingBufferStatusCode channelManagerWrite(
+    ChannelManager *manager,
+    ChannelId       channel,
+    const byte *    source,
+    size_t          byteCount,
+    size_t *        bytesWritten,
+    Thread *        self)
+{
+    ChannelManagerImpl * m = impl(manager);
+    ChannelStripe *      stripe;
+    RingBufferStatusCode statusCode = lockChannel(m, channel, &stripe);
+    *bytesWritten                   = 0;
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    Channel *      c          = &m->channels[channel];
+    const uint32_t generation = c->generation;
+    size_t         written    = 0;
+
+    for (;;) {
+        bool         isPoolEmpty;
+        const size_t count = writeLocked(
+            m, c, source + written, byteCount - written, &isPoolEmpty);
+        written += count;
+
+        // Let the readers in before waiting for them.
+        if (count != 0 && stripe->waiters != 0
+            && pthread_cond_broadcast(&stripe->changed) != 0) {
+            statusCode = RB_FAILURE_TO_SIGNAL_CONDVAR;
+            break;
+        }
+
+        if (written == byteCount) {
+            break;
+        }
+
+        // Waiting wouldn't help if other channels hold all the chunks.
+        if (isPoolEmpty) {
+            statusCode = RB_NOMEM;
+            break;
+        }
+
+        statusCode = waitChanged(stripe, c, generation, self);
+
+        if (RB_FAILURE(statusCode)) {
+            break;
+        }
+    }
+
+    *bytesWritten = written;
+    return unlockChannel(stripe, false, statusCode);
+}
+
+RingBufferStatusCode channelManagerTryRead(
+    ChannelManager *manager,
+    ChannelId       channel,
+    byte *          destination,
+    size_t          maxBytes,
+    size_t *        bytesRead)
+{
+    ChannelManagerImpl * m = impl(manager);
+    ChannelStripe *      stripe;
+    RingBufferStatusCode statusCode = lockChannel(m, channel, &stripe);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    *bytesRead
+        = readLocked(m, &m->channels[channel], destination, maxBytes);
+    return unlockChannel(stripe, *bytesRead != 0, RB_OK);
+}
+
+RingBufferStatusCode channelManagerRead(
+    ChannelManager *manager,
+    ChannelId       channel,
+    byte *          destination,
+    size_t          maxBytes,
+    size_t *        bytesRead,
+    Thread *        self)
+{
+    ChannelManagerImpl * m = impl(manager);
+    ChannelStripe *      stripe;
+    RingBufferStatusCode statusCode = lockChannel(m, channel, &stripe);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    Channel *      c          = &m->channels[channel];
+    const uint32_t generation = c->generation;
+    *bytesRead                = 0;
+
+    while (c->size == 0 && RB_SUCCESS(statusCode)) {
+        statusCode = waitChanged(stripe, c, generation, self);
+    }
+
+    if (RB_SUCCESS(statusCode)) {
+        *bytesRead = readLocked(m, c, destination, maxBytes);
+    }
+
+    return unlockChannel(stripe, *bytesRead != 0, statusCode);
+}
+
+RingBufferStatusCode channelManagerStats(
+    ChannelManager *manager,
+    ChannelId       channel,
+    ChannelStats *  stats)
+{
+    ChannelManagerImpl * m = impl(manager);
+    ChannelStripe *      stripe;
+    RingBufferStatusCode statusCode = lockChannel(m, channel, &stripe);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    const Channel *c  = &m->channels[channel];
+    stats->size       = c->size;
+    stats->chunkCount = c->chunkCount;
+    stats->maxChunks  = c->maxChunks;
+    return unlockChannel(stripe, false, RB_OK);
+}
+
+size_t channelManagerFreeChunks(ChannelManager *manager)
+{
+    return __atomic_load_n(&impl(manager)->freeChunkCount, __ATOMIC_RELAXED);
+}
+
+RingBufferStatusCode channelManagerShutdown(ChannelManager *manager)
+{
+    ChannelManagerImpl *m = impl(manager);
+
+    for (size_t s = 0; s < CHANNEL_MANAGER_STRIPE_COUNT; ++s) {
+        ChannelStripe *stripe = m->stripes[s];
+
+        if (pthread_mutex_lock(&stripe->mutex) != 0) {
+            return RB_FAILURE_TO_LOCK_MUTEX;
+        }
+
+        const int error = pthread_cond_broadcast(&stripe->changed);
+
+        if (pthread_mutex_unlock(&stripe->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        if (error != 0) {
+            return RB_FAILURE_TO_SIGNAL_CONDVAR;
+        }
+    }
+
+    return RB_OK;
+}
@@ -74,8 +74,124 @@ static void printUsage(const char *programName)
         stderr,
         "usage: %s --producerCount <prodCount> --consumerCount <consCount> "
         "--producerSleepTime <prodSleepTimeSeconds> --consumerSleepTime "
-        "<consSleepTimeSeconds>\n\n",
+        "<consSleepTimeSeconds> [options]\n\n",
         programName);
+    fprintf(stderr, "Options:\n");
+    fprintf(
+        stderr,
+        "  --spillDirectory <dir>          Spill to segment files in <dir>\n"
+        "                                  once the ring buffer is full.\n");
+    fprintf(
+        stderr,
+        "  --spillHighWaterMark <bytes>    Fill level at which to start\n"
+        "                                  spilling (default: ring size).\n");
+    fprintf(
+        stderr,
+        "  --consumerMode <mode>           blocking (default), eventLoop,\n"
+        "                                  sink, verify, adaptive, record\n"
+        "                                  or aggregate.\n");
+    fprintf(
+        stderr,
+        "  --sinkPath <file>               The file or FIFO that sink\n"
+        "                                  consumers write to; a FIFO\n"
+        "                                  takes a single consumer.\n");
+    fprintf(
+        stderr,
+        "  --fiberWorkers <count>          Run the producers and consumers as\n"
+        "                                  fibers on <count> threads.\n");
+    fprintf(
+        stderr,
+        "  --payloadSize <bytes>           Write frames with <bytes> of\n"
+        "                                  payload instead of single bytes.\n");
+    fprintf(
+        stderr,
+        "  --transport <transport>         copy (default) frames into the\n"
+        "                                  ring buffer or pool them.\n");
+    fprintf(
+        stderr,
+        "  --drainDeadline <ms>            On shutdown, let the consumers\n"
+        "                                  read what's left for up to <ms>.\n");
+    fprintf(
+        stderr,
+        "  --ringBufferSize <bytes>        The initial size of the ring\n"
+        "                                  buffer.\n");
+    fprintf(
+        stderr,
+        "  --maxRingBufferSize <bytes>     Resize the ring buffer to its load\n"
+        "                                  while running, up to <bytes>.\n");
+    fprintf(
+        stderr,
+        "  --tracePath <file>              Trace the ring buffer operations\n"
+        "                                  into a Chrome trace event file.\n");
+    fprintf(
+        stderr,
+        "  --fairness <fairness>           none (default) or fifo, to have\n"
+        "                                  waiting producers take turns.\n");
+    fprintf(
+        stderr,
+        "  --recordPath <file>             The file that record consumers\n"
+        "                                  record the workload to.\n");
+    fprintf(
+        stderr,
+        "  --replayPath <file>             Have every producer replay the\n"
+        "                                  workload recorded to <file>.\n");
+    fprintf(
+        stderr,
+        "  --replaySpeed <speed>           Replay <speed> times as fast as\n"
+        "                                  recorded (default: 1) or max.\n");
+    fprintf(
+        stderr,
+        "  --partitions <count>            Route the frames of every\n"
+        "                                  producer to one of <count>\n"
+        "                                  partitions, each read by a single\n"
+        "                                  consumer.\n");
+    fprintf(
+        stderr,
+        "  --windowMilliseconds <ms>       The length of the windows that\n"
+        "                                  aggregate consumers count into\n"
+        "                                  (default: 1000).\n");
+    fprintf(
+        stderr,
+        "  --slidingWindows <count>        Also report the sliding window\n"
+        "                                  over the last <count> windows.\n");
+    fprintf(
+        stderr,
+        "  --topK <count>                  The amount of most frequent bytes\n"
+        "                                  reported per window\n"
+        "                                  (default: 3).\n");
+    fprintf(
+        stderr,
+        "  --watchdogStall <ms>            Report threads and a full ring\n"
+        "                                  buffer making no progress for\n"
+        "                                  <ms>.\n");
+    fprintf(
+        stderr,
+        "  --p99Limit <us>                 Also report producers whose p99\n"
+        "                                  write latency reaches <us>.\n");
+    fprintf(
+        stderr,
+        "  --lingerBatchSize <bytes>       Have the producers collect <bytes>\n"
+        "                                  and write them at once.\n");
+    fprintf(
+        stderr,
+        "  --lingerMilliseconds <ms>       The longest a byte collected waits\n"
+        "                                  to be written (default: 5).\n");
+    fprintf(
+        stderr,
+        "  --ingestPath <files>            Have the producers stream the\n"
+        "                                  comma separated files or FIFOs,\n"
+        "                                  one each, into the ring buffer;\n"
+        "                                  - for stdin.\n");
+    fprintf(
+        stderr,
+        "  --threadStackSize <bytes>       The stack size of every thread\n"
+        "                                  (default: the system's).\n");
+    fprintf(
+        stderr,
+        "  --startupThreads <count>        Create the producers and\n"
+        "                                  consumers using <count> threads\n"
+        "                                  (default: 1).\n");
+    fprintf(stderr, "\n");
     fprintf(stderr, "Example:\n");
     fprintf(
         stderr,
@@ -84,53 +200,166 @@ static void printUsage(const char *programName)
         programName);
 }
 
+// Macro to parse a number; does a goto error on failure.
+#define TRY_PARSE(what, requiredBit)                    \
+    do {                                                \
+        if (!matched && strcmp("--" #what, arg) == 0) { \
+            matched = true;                             \
+            if (!parseNumber(value, &retVal.what)) {    \
+                goto error;                             \
+            }                                           \
+            requiredSeen |= (requiredBit);              \
+        }                                               \
+    } while (false)
+
+// Macro to take a string as is.
+#define TRY_PARSE_STRING(what, requiredBit)             \
+    do {                                                \
+        if (!matched && strcmp("--" #what, arg) == 0) { \
+            matched     = true;                         \
+            retVal.what = value;                        \
+            requiredSeen |= (requiredBit);              \
+        }                                               \
+    } while (false)
+
 CmdArgs parseCmdArgs(int argc, char **argv)
 {
-    CmdArgs retVal = {false, 0, 0, 0, 0};
-
-    const int expectedArgc = 9; /* 8 arguments plus the program name */
-
-    if (argc != expectedArgc) {
-        fprintf(
-            stderr,
-            "\nInvalid count of command line arguments.\nExpected: %d\nActual  "
-            ": "
-            "%d\n\n",
-            expectedArgc - 1,
-            argc - 1);
+    CmdArgs retVal = {false};
+
+    // Bit set of the required options that have been encountered.
+    unsigned       requiredSeen = 0;
+    const unsigned allRequired  = 0xF;
+
+    for (int index = 1; index < argc; index += 2) {
+        const char *const arg       = argv[index];
+        const int         nextIndex = index + 1;
+        bool              matched   = false;
+
+        // Every option is followed by its value.
+        if (!isValidIndex(argc, nextIndex)) {
+            fprintf(stderr, "\nMissing value for option: %s\n\n", arg);
+            goto error;
+        }
+
+        const char *const value = argv[nextIndex];
+
+        // Parse the arguments.
+        TRY_PARSE(producerCount, 0x1u);
+        TRY_PARSE(consumerCount, 0x2u);
+        TRY_PARSE(producerSleepTime, 0x4u);
+        TRY_PARSE(consumerSleepTime, 0x8u);
+        TRY_PARSE_STRING(spillDirectory, 0x0u);
+        TRY_PARSE(spillHighWaterMark, 0x0u);
+        TRY_PARSE_STRING(consumerMode, 0x0u);
+        TRY_PARSE_STRING(sinkPath, 0x0u);
+        TRY_PARSE(fiberWorkers, 0x0u);
+        TRY_PARSE(payloadSize, 0x0u);
+        TRY_PARSE_STRING(transport, 0x0u);
+        TRY_PARSE(drainDeadline, 0x0u);
+        TRY_PARSE(ringBufferSize, 0x0u);
+        TRY_PARSE(maxRingBufferSize, 0x0u);
+        TRY_PARSE_STRING(tracePath, 0x0u);
+        TRY_PARSE_STRING(fairness, 0x0u);
+        TRY_PARSE_STRING(recordPath, 0x0u);
+        TRY_PARSE_STRING(replayPath, 0x0u);
+        TRY_PARSE_STRING(replaySpeed, 0x0u);
+        TRY_PARSE(partitions, 0x0u);
+        TRY_PARSE(windowMilliseconds, 0x0u);
+        TRY_PARSE(slidingWindows, 0x0u);
+        TRY_PARSE(topK, 0x0u);
+        TRY_PARSE(watchdogStall, 0x0u);
+        TRY_PARSE(p99Limit, 0x0u);
+        TRY_PARSE(lingerBatchSize, 0x0u);
+        TRY_PARSE(lingerMilliseconds, 0x0u);
+        TRY_PARSE_STRING(ingestPath, 0x0u);
+        TRY_PARSE(threadStackSize, 0x0u);
+        TRY_PARSE(startupThreads, 0x0u);
+
+        if (!matched) {
+            fprintf(stderr, "\nUnknown option: %s\n\n", arg);
+            goto error;
+        }
+    }
+
+    if (requiredSeen != allRequired) {
+        fprintf(stderr, "\nA required option is missing.\n\n");
         goto error;
     }
 
-    for (int index = 1; index < argc; ++index) {
+    retVal.isOk = true;
+    return retVal;
+
+error:
+    printUsage(argv[0]);
+    return (CmdArgs){false};
+}
+
+/*!
+ * \brief Prints usage instructions for the shared memory applications.
+ * \param programName Should be argv[0].
+ **/
+static void printShmUsage(const char *programName)
+{
+    fprintf(stderr, "%s: Invalid command line parameters\n\n", programName);
+    fprintf(
+        stderr,
+        "usage: %s --name <shmName> --sleepTime <sleepTimeSeconds> "
+        "[--id <threadId>] [--ringBufferSize <bytes>]\n\n",
+        programName);
+    fprintf(
+        stderr,
+        "The ring buffer is created with the size given if it doesn't exist "
+        "yet,\notherwise it is attached to.\n\n");
+    fprintf(stderr, "Example:\n");
+    fprintf(
+        stderr, "  %s --name /ring --sleepTime 1 --id 1\n\n", programName);
+}
+
+ShmCmdArgs parseShmCmdArgs(int argc, char **argv)
+{
+    ShmCmdArgs retVal = {false, NULL, 0, 1, 0};
+
+    // Bit set of the required options that have been encountered.
+    unsigned       requiredSeen = 0;
+    const unsigned allRequired  = 0x3;
+
+    for (int index = 1; index < argc; index += 2) {
         const char *const arg       = argv[index];
         const int         nextIndex = index + 1;
+        bool              matched   = false;
 
-// Macro to parse a number; does a goto error on failure.
-#define TRY_PARSE(what)                                            \
-    do {                                                           \
-        if (strcmp("--" #what, arg) == 0) {                        \
-            if (isValidIndex(argc, nextIndex)) {                   \
-                if (!parseNumber(argv[nextIndex], &retVal.what)) { \
-                    goto error;                                    \
-                }                                                  \
-            }                                                      \
-            else {                                                 \
-                goto error;                                        \
-            }                                                      \
-        }                                                          \
-    } while (false)
+        // Every option is followed by its value.
+        if (!isValidIndex(argc, nextIndex)) {
+            fprintf(stderr, "\nMissing value for option: %s\n\n", arg);
+            goto error;
+        }
+
+        const char *const value = argv[nextIndex];
 
         // Parse the arguments.
-        TRY_PARSE(producerCount);
-        TRY_PARSE(consumerCount);
-        TRY_PARSE(producerSleepTime);
-        TRY_PARSE(consumerSleepTime);
+        TRY_PARSE_STRING(name, 0x1u);
+        TRY_PARSE(sleepTime, 0x2u);
+        TRY_PARSE(id, 0x0u);
+        TRY_PARSE(ringBufferSize, 0x0u);
+
+        if (!matched) {
+            fprintf(stderr, "\nUnknown option: %s\n\n", arg);
+            goto error;
+        }
+    }
+
+    if (requiredSeen != allRequired) {
+        fprintf(stderr, "\nA required option is missing.\n\n");
+        goto error;
     }
 
     retVal.isOk = true;
     return retVal;
 
 error:
-    printUsage(argv[0]);
-    return (CmdArgs){false, 0, 0, 0, 0};
+    printShmUsage(argv[0]);
+    return (ShmCmdArgs){false, NULL, 0, 0, 0};
 }
+
+#undef TRY_PARSE_STRING
+#undef TRY_PARSE
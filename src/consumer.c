@@ -1,17 +1,41 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
 
 #include "byte.h"
 #include "consumer.h"
 #include "ring_buffer.h"
+#ifndef _WIN32
+#include "sink.h"
+#endif
 #include "sleep_thread.h"
 
+/*!
+ * \def CONSUMER_SINK_QUEUE_DEPTH
+ * \brief The maximum amount of writes a sink consumer keeps in flight.
+ **/
+#define CONSUMER_SINK_QUEUE_DEPTH 8
+
+/*!
+ * \def CONSUMER_SINK_MAX_WRITE_SIZE
+ * \brief The maximum amount of bytes a sink consumer writes at once.
+ **/
+#define CONSUMER_SINK_MAX_WRITE_SIZE (64 * 1024)
+
 /*!
  * \brief The thread function for the consumer threads.
  * \param ringBuffer The ring buffer to use.
  * \param sleepTimeSeconds The seconds to sleep for every iteration.
  * \param id The thread ID.
- * \param self A pointer to the thread itself.
+ * \param self A pointer to the thread itself; its context is the
+ *             `ConsumerConfig`.
  **/
 static int consumerThreadFunction(
     RingBuffer *ringBuffer,
@@ -19,6 +43,14 @@ static int consumerThreadFunction(
     int         id,
     Thread *    self)
 {
+    const ConsumerConfig *config = threadContext(self);
+    size_t                slot;
+
+    if (RB_FAILURE(watchdogJoin(
+            config->watchdog, WATCHDOG_ROLE_CONSUMER, id, &slot))) {
+        return EXIT_FAILURE;
+    }
+
     for (;;) {
         bool       shouldShutdown;
         const bool ok = threadShouldShutdown(self, &shouldShutdown);
@@ -33,7 +65,8 @@ static int consumerThreadFunction(
             break;
         }
 
-        byte                       byteJustRead;
+        byte byteJustRead;
+        watchdogWaiting(config->watchdog, slot);
         const RingBufferStatusCode statusCode
             = ringBufferRead(ringBuffer, &byteJustRead, id, self);
 
@@ -47,6 +80,7 @@ static int consumerThreadFunction(
             return EXIT_FAILURE;
         }
 
+        watchdogBeat(config->watchdog, slot);
         printf("Consumer (tid: %d) just read %c.\n", id, byteJustRead);
 
         sleepThread(sleepTimeSeconds);
@@ -55,8 +89,862 @@ static int consumerThreadFunction(
     return EXIT_SUCCESS;
 }
 
-Thread *consumerCreate(RingBuffer *ringBuffer, int32_t sleepTimeSeconds, int id)
+/*!
+ * \brief The span handler of adaptive consumers if none is given.
+ * \param span The bytes.
+ * \param size The amount of bytes.
+ * \param consumerId The thread ID of the consumer.
+ * \param context Unused.
+ * \return Always true.
+ **/
+static bool printSpan(
+    const byte *span,
+    size_t      size,
+    int         consumerId,
+    void *      context)
+{
+    (void) context;
+
+    for (size_t i = 0; i < size; ++i) {
+        printf("Consumer (tid: %d) just read %c.\n", consumerId, span[i]);
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Adapts the batch limit of an adaptive consumer to the load.
+ * \param limit The current batch limit.
+ * \param reservation The batch just taken.
+ * \return The new batch limit.
+ **/
+static size_t
+adaptBatchLimit(size_t limit, const RingBufferReadReservation *reservation)
+{
+    // Bytes were left behind -> there is a backlog, so take more at once to
+    // catch up with fewer ring buffer operations.
+    if (reservation->backlog != 0) {
+        return limit * 2 <= CONSUMER_MAX_BATCH_SIZE ? limit * 2
+                                                     : CONSUMER_MAX_BATCH_SIZE;
+    }
+
+    // The ring buffer runs near-empty -> take less, so that no consumer
+    // sits on a large batch while the others idle.
+    if (reservation->size * 2 <= limit) {
+        return limit / 2 >= CONSUMER_MIN_BATCH_SIZE ? limit / 2
+                                                    : CONSUMER_MIN_BATCH_SIZE;
+    }
+
+    return limit;
+}
+
+/*!
+ * \brief The thread function for the adaptive consumer threads.
+ * \param ringBuffer The ring buffer to use.
+ * \param sleepTimeSeconds The seconds to sleep for every batch.
+ * \param id The thread ID.
+ * \param self A pointer to the thread itself; its context is the
+ *             `ConsumerConfig`.
+ *
+ * Acquires everything available up to the batch limit in place and hands it
+ * to the span handler as a whole, so that the mutex, the shutdown state and
+ * the sleep are paid once per batch rather than once per byte.
+ **/
+static int adaptiveConsumerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    const ConsumerConfig *    config = threadContext(self);
+    const ConsumerSpanHandler handler
+        = config->spanHandler == NULL ? &printSpan : config->spanHandler;
+    size_t batchLimit = CONSUMER_MIN_BATCH_SIZE;
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            return EXIT_FAILURE;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        RingBufferReadReservation  reservation;
+        const RingBufferStatusCode statusCode = ringBufferAcquireRead(
+            ringBuffer, batchLimit, &reservation, id, self);
+
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            break;
+        }
+
+        if (RB_FAILURE(statusCode)) {
+            return EXIT_FAILURE;
+        }
+
+        const bool handled = handler(
+            reservation.data,
+            reservation.size,
+            id,
+            config->spanHandlerContext);
+
+        if (RB_FAILURE(ringBufferReleaseRead(ringBuffer, &reservation, id))
+            || !handled) {
+            return EXIT_FAILURE;
+        }
+
+        printf(
+            "Consumer (tid: %d) drained %zu bytes (batch limit: %zu).\n",
+            id,
+            reservation.size,
+            batchLimit);
+
+        batchLimit = adaptBatchLimit(batchLimit, &reservation);
+        sleepThread(sleepTimeSeconds);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief The thread function for the event loop consumer threads.
+ * \param ringBuffer The ring buffer to use.
+ * \param sleepTimeSeconds The seconds to sleep for every wakeup.
+ * \param id The thread ID.
+ * \param self A pointer to the thread itself.
+ *
+ * Waits for the readable eventfd of the ring buffer using epoll, so that it
+ * could just as well wait for sockets or timers, and drains everything that
+ * is available on every wakeup.
+ **/
+static int eventLoopConsumerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
 {
-    return threadCreate(
-        &consumerThreadFunction, ringBuffer, sleepTimeSeconds, id);
-}
\ No newline at end of file
+#ifdef __linux__
+    const int readableFd = ringBufferReadableFd(ringBuffer);
+
+    if (readableFd == -1) {
+        return EXIT_FAILURE;
+    }
+
+    const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (epollFd == -1) {
+        return EXIT_FAILURE;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events  = EPOLLIN;
+    event.data.fd = readableFd;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, readableFd, &event) != 0) {
+        close(epollFd);
+        return EXIT_FAILURE;
+    }
+
+    int exitStatus = EXIT_SUCCESS;
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            // Another event loop sharing the eventfd may have reset the
+            // wakeup of ringBufferShutdown -> pass it on.
+            const uint64_t one = 1;
+            (void) write(readableFd, &one, sizeof(one));
+            break;
+        }
+
+        struct epoll_event readyEvent;
+        const int readyCount = epoll_wait(epollFd, &readyEvent, 1, -1);
+
+        if (readyCount == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        // Reset the eventfd *before* draining, so that writes racing with
+        // the drain signal it again. EAGAIN just means that another consumer
+        // reset it already.
+        uint64_t counter;
+        (void) read(readableFd, &counter, sizeof(counter));
+
+        // Drain everything available.
+        for (;;) {
+            byte                       batch[64];
+            size_t                     bytesRead;
+            const RingBufferStatusCode statusCode = ringBufferTryRead(
+                ringBuffer, batch, sizeof(batch), &bytesRead, id);
+
+            if (RB_FAILURE(statusCode)) {
+                close(epollFd);
+                return EXIT_FAILURE;
+            }
+
+            if (bytesRead == 0) {
+                break;
+            }
+
+            for (size_t i = 0; i < bytesRead; ++i) {
+                printf("Consumer (tid: %d) just read %c.\n", id, batch[i]);
+            }
+        }
+
+        sleepThread(sleepTimeSeconds);
+    }
+
+    close(epollFd);
+    return exitStatus;
+#else
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    (void) self;
+    return EXIT_FAILURE;
+#endif
+}
+
+/*!
+ * \brief The thread function for the sink consumer threads.
+ * \param ringBuffer The ring buffer to use.
+ * \param sleepTimeSeconds The seconds to sleep for every completed write.
+ * \param id The thread ID.
+ * \param self A pointer to the thread itself; its context is the
+ *             `ConsumerConfig`.
+ *
+ * Acquires bytes in place and submits them to a sink at their stream offset,
+ * so that the file ends up holding the stream in order even with several
+ * sink consumers; a FIFO only does with a single one. Up to
+ * `CONSUMER_SINK_QUEUE_DEPTH` writes are kept in flight; a reservation is
+ * released once its write has completed.
+ **/
+static int sinkConsumerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+#ifndef _WIN32
+    const ConsumerConfig *config = threadContext(self);
+    const byte *          storage;
+    size_t                storageSize;
+    ringBufferStorage(ringBuffer, &storage, &storageSize);
+
+    Sink *sink = sinkCreate(
+        config->sinkPath, CONSUMER_SINK_QUEUE_DEPTH, storage, storageSize);
+
+    if (sink == NULL) {
+        fprintf(stderr, "Consumer (tid: %d) could not open the sink.\n", id);
+        return EXIT_FAILURE;
+    }
+
+    // The reservations in flight, indexed by the tag of their write.
+    RingBufferReadReservation reservations[CONSUMER_SINK_QUEUE_DEPTH];
+    uint64_t                  freeTags[CONSUMER_SINK_QUEUE_DEPTH];
+    size_t                    freeTagCount = 0;
+
+    for (uint64_t tag = 0; tag < sinkQueueDepth(sink); ++tag) {
+        freeTags[freeTagCount++] = tag;
+    }
+
+    int  exitStatus     = EXIT_SUCCESS;
+    bool shouldShutdown = false;
+
+    while (!shouldShutdown) {
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        // Fill the queue. Only block if nothing is in flight, as a write
+        // completing lets us release space for the producers.
+        while (!shouldShutdown && freeTagCount != 0) {
+            RingBufferReadReservation reservation;
+            const RingBufferStatusCode statusCode
+                = sinkInFlight(sink) == 0
+                      ? ringBufferAcquireRead(
+                          ringBuffer,
+                          CONSUMER_SINK_MAX_WRITE_SIZE,
+                          &reservation,
+                          id,
+                          self)
+                      : ringBufferTryAcquireRead(
+                          ringBuffer,
+                          CONSUMER_SINK_MAX_WRITE_SIZE,
+                          &reservation,
+                          id);
+
+            if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+                shouldShutdown = true;
+                break;
+            }
+
+            if (RB_FAILURE(statusCode)) {
+                exitStatus     = EXIT_FAILURE;
+                shouldShutdown = true;
+                break;
+            }
+
+            if (reservation.size == 0) {
+                break;
+            }
+
+            const uint64_t tag = freeTags[--freeTagCount];
+            reservations[tag]  = reservation;
+
+            if (!sinkSubmit(
+                    sink,
+                    reservation.data,
+                    reservation.size,
+                    reservation.position,
+                    tag)) {
+                ringBufferReleaseRead(ringBuffer, &reservation, id);
+                freeTags[freeTagCount++] = tag;
+                exitStatus               = EXIT_FAILURE;
+                shouldShutdown           = true;
+                break;
+            }
+        }
+
+        // Retire one write per iteration; the rest are retired below when
+        // shutting down.
+        if (sinkInFlight(sink) == 0 || shouldShutdown) {
+            continue;
+        }
+
+        uint64_t tag;
+
+        if (!sinkWaitCompletion(sink, &tag)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        printf(
+            "Consumer (tid: %d) just wrote %zu bytes at offset %llu.\n",
+            id,
+            reservations[tag].size,
+            (unsigned long long) reservations[tag].position);
+
+        if (RB_FAILURE(
+                ringBufferReleaseRead(ringBuffer, &reservations[tag], id))) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        freeTags[freeTagCount++] = tag;
+        sleepThread(sleepTimeSeconds);
+    }
+
+    // Don't leave writes behind that point into the ring buffer.
+    while (sinkInFlight(sink) != 0) {
+        uint64_t tag;
+
+        if (!sinkWaitCompletion(sink, &tag)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        ringBufferReleaseRead(ringBuffer, &reservations[tag], id);
+    }
+
+    if (!sinkFree(sink)) {
+        exitStatus = EXIT_FAILURE;
+    }
+
+    return exitStatus;
+#else
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    (void) self;
+    return EXIT_FAILURE;
+#endif
+}
+
+/*!
+ * \brief The thread function for the verifying consumer threads.
+ * \param ringBuffer The ring buffer to use.
+ * \param sleepTimeSeconds The seconds to sleep for every batch of frames.
+ * \param id The thread ID.
+ * \param self A pointer to the thread itself; its context is the
+ *             `ConsumerConfig`.
+ *
+ * With a message pool the ring buffer carries handles; the frames are
+ * verified in place and their buffers recycled to the producers.
+ * With a partitioned ring the consumer joins it for as long as it runs and
+ * only reads the partitions it owns.
+ **/
+static int verifyingConsumerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    const ConsumerConfig *config = threadContext(self);
+    size_t                consumerIndex;
+
+    if (!payloadVerifierAttach(config->verifier, &consumerIndex)) {
+        return EXIT_FAILURE;
+    }
+
+    const size_t frameSize = sizeof(PayloadFrameHeader) + config->payloadSize;
+    const size_t recordSize
+        = config->pool == NULL ? frameSize : sizeof(MessageHandle);
+    byte *records = malloc(recordSize * CONSUMER_VERIFY_BATCH_SIZE);
+
+    if (records == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    size_t partitionConsumerIndex = 0;
+
+    if (config->partitions != NULL
+        && RB_FAILURE(partitionedRingJoin(
+            config->partitions, &partitionConsumerIndex))) {
+        free(records);
+        return EXIT_FAILURE;
+    }
+
+    size_t slot;
+
+    if (RB_FAILURE(watchdogJoin(
+            config->watchdog, WATCHDOG_ROLE_CONSUMER, id, &slot))) {
+        // Don't keep the partitions from the others.
+        if (config->partitions != NULL) {
+            (void) partitionedRingLeave(
+                config->partitions, partitionConsumerIndex);
+        }
+
+        free(records);
+        return EXIT_FAILURE;
+    }
+
+    int exitStatus = EXIT_SUCCESS;
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        size_t frameCount;
+        watchdogWaiting(config->watchdog, slot);
+        const RingBufferStatusCode statusCode
+            = config->partitions == NULL
+                  ? ringBufferReadRecords(
+                      ringBuffer,
+                      records,
+                      recordSize,
+                      CONSUMER_VERIFY_BATCH_SIZE,
+                      &frameCount,
+                      id,
+                      self)
+                  : partitionedRingRead(
+                      config->partitions,
+                      partitionConsumerIndex,
+                      records,
+                      recordSize,
+                      CONSUMER_VERIFY_BATCH_SIZE,
+                      &frameCount,
+                      id,
+                      self);
+
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            break;
+        }
+
+        if (RB_FAILURE(statusCode)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        watchdogBeat(config->watchdog, slot);
+
+        // Problems are reported by the verifier; keep on consuming so that
+        // the producers don't stall.
+        if (config->pool == NULL) {
+            (void) payloadVerifierCheck(
+                config->verifier,
+                consumerIndex,
+                records,
+                frameSize,
+                frameCount,
+                id);
+        }
+        else {
+            const MessageHandle *handles = (const MessageHandle *) records;
+
+            for (size_t i = 0; i < frameCount; ++i) {
+                (void) payloadVerifierCheck(
+                    config->verifier,
+                    consumerIndex,
+                    messagePoolData(config->pool, handles[i]),
+                    frameSize,
+                    1,
+                    id);
+                messagePoolRecycle(config->pool, handles[i]);
+            }
+        }
+
+        printf(
+            "Consumer (tid: %d) just verified %zu frames.\n", id, frameCount);
+
+        sleepThread(sleepTimeSeconds);
+    }
+
+    // Hand the partitions to the consumers still running.
+    if (config->partitions != NULL
+        && RB_FAILURE(partitionedRingLeave(
+            config->partitions, partitionConsumerIndex))) {
+        exitStatus = EXIT_FAILURE;
+    }
+
+    free(records);
+    return exitStatus;
+}
+
+/*!
+ * \brief The thread function for the recording consumer threads.
+ * \param ringBuffer The ring buffer to use.
+ * \param sleepTimeSeconds The seconds to sleep for every batch read.
+ * \param id The thread ID.
+ * \param self A pointer to the thread itself; its context is the
+ *             `ConsumerConfig`.
+ *
+ * Reads single bytes or, if frames are written, whole frames, so that every
+ * message is recorded as it arrived.
+ **/
+static int recordingConsumerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    const ConsumerConfig *config    = threadContext(self);
+    const size_t          frameSize = config->payloadSize == 0
+                                          ? 0
+                                          : sizeof(PayloadFrameHeader)
+                                                + config->payloadSize;
+    byte *records = malloc(
+        frameSize == 0 ? 1 : frameSize * CONSUMER_VERIFY_BATCH_SIZE);
+
+    if (records == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    int exitStatus = EXIT_SUCCESS;
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        size_t               messageCount = 1;
+        RingBufferStatusCode statusCode;
+
+        if (frameSize == 0) {
+            statusCode = ringBufferRead(ringBuffer, records, id, self);
+        }
+        else {
+            statusCode = ringBufferReadRecords(
+                ringBuffer,
+                records,
+                frameSize,
+                CONSUMER_VERIFY_BATCH_SIZE,
+                &messageCount,
+                id,
+                self);
+        }
+
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            break;
+        }
+
+        if (RB_FAILURE(statusCode)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        size_t recorded = 0;
+
+        while (recorded < messageCount
+               && workloadRecorderAppend(
+                   config->recorder, records + recorded * frameSize)) {
+            ++recorded;
+        }
+
+        if (recorded < messageCount) {
+            fprintf(stderr, "Consumer (tid: %d) could not record.\n", id);
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        printf(
+            "Consumer (tid: %d) just recorded %zu messages.\n",
+            id,
+            messageCount);
+
+        sleepThread(sleepTimeSeconds);
+    }
+
+    free(records);
+    return exitStatus;
+}
+
+/*!
+ * \brief The thread function for the aggregating consumer threads.
+ * \param ringBuffer The ring buffer to use.
+ * \param sleepTimeSeconds The seconds to sleep for every batch read.
+ * \param id The thread ID.
+ * \param self A pointer to the thread itself; its context is the
+ *             `ConsumerConfig`.
+ *
+ * Counts the bytes into a partial aggregate of its own, which the merger
+ * thread of the aggregator reports.
+ **/
+static int aggregatingConsumerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    const ConsumerConfig *config = threadContext(self);
+    size_t                partialIndex;
+
+    if (RB_FAILURE(aggregatorJoin(config->aggregator, &partialIndex))) {
+        return EXIT_FAILURE;
+    }
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            return EXIT_FAILURE;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        byte                       batch[64];
+        size_t                     bytesRead;
+        const RingBufferStatusCode statusCode = ringBufferReadRecords(
+            ringBuffer, batch, 1, sizeof(batch), &bytesRead, id, self);
+
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            break;
+        }
+
+        if (RB_FAILURE(statusCode)) {
+            return EXIT_FAILURE;
+        }
+
+        aggregatorAdd(config->aggregator, partialIndex, batch, bytesRead);
+
+        sleepThread(sleepTimeSeconds);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief The fiber function for the consumers.
+ * \param ringBuffer The ring buffer to use.
+ * \param sleepTimeSeconds The seconds to sleep for every iteration.
+ * \param id The fiber ID.
+ * \param self A pointer to the fiber itself.
+ **/
+static int consumerFiberFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Fiber *     self)
+{
+#ifndef _WIN32
+    const int readableFd = ringBufferReadableFd(ringBuffer);
+
+    if (readableFd == -1) {
+        return EXIT_FAILURE;
+    }
+
+    while (!fiberShouldShutdown(self)) {
+        byte                       batch[64];
+        size_t                     bytesRead;
+        const RingBufferStatusCode statusCode = ringBufferTryRead(
+            ringBuffer, batch, sizeof(batch), &bytesRead, id);
+
+        if (RB_FAILURE(statusCode)) {
+            return EXIT_FAILURE;
+        }
+
+        // The ring buffer is empty -> let the others run until it isn't.
+        if (bytesRead == 0) {
+            fiberWait(self, readableFd);
+            continue;
+        }
+
+        for (size_t i = 0; i < bytesRead; ++i) {
+            printf("Consumer (tid: %d) just read %c.\n", id, batch[i]);
+        }
+
+        fiberSleep(self, sleepTimeSeconds);
+    }
+
+    return EXIT_SUCCESS;
+#else
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    (void) self;
+    return EXIT_FAILURE;
+#endif
+}
+
+bool consumerModeFromString(const char *string, ConsumerMode *mode)
+{
+    if (strcmp(string, "blocking") == 0) {
+        *mode = CONSUMER_MODE_BLOCKING;
+        return true;
+    }
+
+    if (strcmp(string, "eventLoop") == 0) {
+        *mode = CONSUMER_MODE_EVENT_LOOP;
+        return true;
+    }
+
+    if (strcmp(string, "sink") == 0) {
+        *mode = CONSUMER_MODE_SINK;
+        return true;
+    }
+
+    if (strcmp(string, "verify") == 0) {
+        *mode = CONSUMER_MODE_VERIFY;
+        return true;
+    }
+
+    if (strcmp(string, "adaptive") == 0) {
+        *mode = CONSUMER_MODE_ADAPTIVE;
+        return true;
+    }
+
+    if (strcmp(string, "record") == 0) {
+        *mode = CONSUMER_MODE_RECORD;
+        return true;
+    }
+
+    if (strcmp(string, "aggregate") == 0) {
+        *mode = CONSUMER_MODE_AGGREGATE;
+        return true;
+    }
+
+    return false;
+}
+
+Thread *consumerCreate(
+    RingBuffer *          ringBuffer,
+    int32_t               sleepTimeSeconds,
+    int                   id,
+    const ConsumerConfig *config)
+{
+    switch (config->mode) {
+    case CONSUMER_MODE_BLOCKING:
+        return threadCreateWithContext(
+            &consumerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config);
+    case CONSUMER_MODE_EVENT_LOOP:
+        return threadCreate(
+            &eventLoopConsumerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id);
+    case CONSUMER_MODE_SINK:
+        return threadCreateWithContext(
+            &sinkConsumerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config);
+    case CONSUMER_MODE_VERIFY:
+        return threadCreateInArena(
+            &verifyingConsumerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config,
+            config->pool == NULL ? NULL : messagePoolArena(config->pool));
+    case CONSUMER_MODE_ADAPTIVE:
+        return threadCreateWithContext(
+            &adaptiveConsumerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config);
+    case CONSUMER_MODE_RECORD:
+        return threadCreateWithContext(
+            &recordingConsumerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config);
+    case CONSUMER_MODE_AGGREGATE:
+        return threadCreateWithContext(
+            &aggregatingConsumerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config);
+    default:
+        break;
+    }
+
+    return NULL;
+}
+
+bool consumerSpawn(
+    FiberScheduler *scheduler,
+    RingBuffer *    ringBuffer,
+    int32_t         sleepTimeSeconds,
+    int             id)
+{
+#ifndef _WIN32
+    return fiberSpawn(
+        scheduler, &consumerFiberFunction, ringBuffer, sleepTimeSeconds, id);
+#else
+    (void) scheduler;
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    return false;
+#endif
+}
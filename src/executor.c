@@ -0,0 +1,695 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "executor.h"
+#include "thread.h"
+
+/*!
+ * \def EXECUTOR_DEQUE_INITIAL_CAPACITY
+ * \brief The amount of tasks a worker's deque can hold before it grows.
+ **/
+#define EXECUTOR_DEQUE_INITIAL_CAPACITY 64
+
+/*!
+ * \def EXECUTOR_QUEUE_BATCH_SIZE
+ * \brief The maximum amount of tasks a worker takes from the global
+ *        submission queue at once.
+ **/
+#define EXECUTOR_QUEUE_BATCH_SIZE 16
+
+/*!
+ * \brief Double ended queue of tasks.
+ *
+ * The owning worker pushes and pops at the bottom, others steal from the
+ * top, so that the owner works on what is hot in its cache while thieves
+ * take the oldest tasks.
+ **/
+typedef struct {
+    pthread_mutex_t mutex;    /*!< Protects all of the below */
+    ExecutorTask *  tasks;    /*!< Circular array of `capacity` tasks */
+    size_t          capacity; /*!< Always a power of two */
+    size_t          top;      /*!< Index of the oldest task */
+    size_t          bottom;   /*!< Index one past the newest task */
+} ExecutorDeque;
+
+typedef struct ExecutorImpl ExecutorImpl;
+
+/*!
+ * \brief A worker thread of an executor.
+ **/
+typedef struct {
+    ExecutorImpl *executor; /*!< The executor owning the worker */
+    Thread *      thread;   /*!< The worker thread */
+    size_t        index;    /*!< Index in the executor's workers */
+    ExecutorDeque deque;    /*!< The worker's own tasks */
+} ExecutorWorker;
+
+/*!
+ * \brief Executor implementation type.
+ **/
+struct ExecutorImpl {
+    RingBuffer *    queue;            /*!< The global submission queue */
+    ExecutorWorker *workers;          /*!< The workers */
+    size_t          workerCount;      /*!< The amount of workers */
+    pthread_key_t   currentWorker;    /*!< The worker of the calling thread */
+    pthread_mutex_t mutex;            /*!< For the condition variables */
+    pthread_cond_t  workAvailable;    /*!< Wakes idle workers */
+    pthread_cond_t  allDone;          /*!< Wakes `executorWaitAll` */
+    size_t          generation;       /*!< Atomic; bumped on every queueing */
+    size_t          outstandingTasks; /*!< Atomic; tasks not yet finished */
+    size_t          idleWorkers;      /*!< Atomic; workers waiting */
+};
+
+static ExecutorImpl *impl(Executor *executor)
+{
+    return (ExecutorImpl *) executor;
+}
+
+static Executor *opaque(ExecutorImpl *executor)
+{
+    return (Executor *) executor;
+}
+
+static bool dequeInit(ExecutorDeque *deque)
+{
+    deque->tasks
+        = malloc(EXECUTOR_DEQUE_INITIAL_CAPACITY * sizeof(ExecutorTask));
+
+    if (deque->tasks == NULL) {
+        return false;
+    }
+
+    if (pthread_mutex_init(&deque->mutex, NULL) != 0) {
+        free(deque->tasks);
+        return false;
+    }
+
+    deque->capacity = EXECUTOR_DEQUE_INITIAL_CAPACITY;
+    deque->top      = 0;
+    deque->bottom   = 0;
+    return true;
+}
+
+static void dequeDestroy(ExecutorDeque *deque)
+{
+    pthread_mutex_destroy(&deque->mutex);
+    free(deque->tasks);
+}
+
+/*!
+ * \brief Pushes tasks to the bottom of a deque.
+ * \param deque The deque.
+ * \param tasks The tasks to push; the last one is popped first.
+ * \param taskCount The amount of tasks.
+ * \return true on success; false if the deque could not grow.
+ **/
+static bool
+dequePush(ExecutorDeque *deque, const ExecutorTask *tasks, size_t taskCount)
+{
+    pthread_mutex_lock(&deque->mutex);
+
+    const size_t size     = deque->bottom - deque->top;
+    size_t       capacity = deque->capacity;
+
+    while (capacity - size < taskCount) {
+        capacity *= 2;
+    }
+
+    if (capacity != deque->capacity) {
+        ExecutorTask *grown = malloc(capacity * sizeof(ExecutorTask));
+
+        if (grown == NULL) {
+            pthread_mutex_unlock(&deque->mutex);
+            return false;
+        }
+
+        for (size_t i = 0; i < size; ++i) {
+            grown[i]
+                = deque->tasks[(deque->top + i) & (deque->capacity - 1)];
+        }
+
+        free(deque->tasks);
+        deque->tasks    = grown;
+        deque->capacity = capacity;
+        deque->top      = 0;
+        deque->bottom   = size;
+    }
+
+    for (size_t i = 0; i < taskCount; ++i) {
+        deque->tasks[deque->bottom & (deque->capacity - 1)] = tasks[i];
+        ++deque->bottom;
+    }
+
+    pthread_mutex_unlock(&deque->mutex);
+    return true;
+}
+
+/*!
+ * \brief Pops the newest task of a deque.
+ * \param deque The deque.
+ * \param task Output parameter for the task.
+ * \return true if a task was popped; false if the deque is empty.
+ **/
+static bool dequePop(ExecutorDeque *deque, ExecutorTask *task)
+{
+    pthread_mutex_lock(&deque->mutex);
+
+    const bool isEmpty = deque->top == deque->bottom;
+
+    if (!isEmpty) {
+        --deque->bottom;
+        *task = deque->tasks[deque->bottom & (deque->capacity - 1)];
+    }
+
+    pthread_mutex_unlock(&deque->mutex);
+    return !isEmpty;
+}
+
+/*!
+ * \brief Steals the oldest task of a deque.
+ * \param deque The deque.
+ * \param task Output parameter for the task.
+ * \param isBusy Output parameter; set to true if the deque was locked by
+ *               someone else, so that it might hold tasks after all.
+ * \return true if a task was stolen; false if the deque is empty or busy.
+ **/
+static bool dequeSteal(ExecutorDeque *deque, ExecutorTask *task, bool *isBusy)
+{
+    // Don't queue up behind the owner; there are other deques to try.
+    if (pthread_mutex_trylock(&deque->mutex) != 0) {
+        *isBusy = true;
+        return false;
+    }
+
+    const bool isEmpty = deque->top == deque->bottom;
+
+    if (!isEmpty) {
+        *task = deque->tasks[deque->top & (deque->capacity - 1)];
+        ++deque->top;
+    }
+
+    pthread_mutex_unlock(&deque->mutex);
+    return !isEmpty;
+}
+
+/*!
+ * \brief Steals a task from any of the other workers.
+ * \param e The executor.
+ * \param thief The worker trying to steal.
+ * \param task Output parameter for the task.
+ * \param isBusy Output parameter; set to true if a deque was skipped as
+ *               someone else had it locked.
+ * \return true if a task was stolen; otherwise false.
+ **/
+static bool steal(
+    ExecutorImpl *        e,
+    const ExecutorWorker *thief,
+    ExecutorTask *        task,
+    bool *                isBusy)
+{
+    for (size_t i = 1; i < e->workerCount; ++i) {
+        ExecutorWorker *victim
+            = &e->workers[(thief->index + i) % e->workerCount];
+
+        if (dequeSteal(&victim->deque, task, isBusy)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * \brief Wakes idle workers after tasks have been queued.
+ * \param e The executor.
+ * \param taskCount The amount of tasks queued.
+ **/
+static void wakeIdleWorkers(ExecutorImpl *e, size_t taskCount)
+{
+    __atomic_add_fetch(&e->generation, 1, __ATOMIC_SEQ_CST);
+
+    // Pairs with the idle workers incrementing `idleWorkers` before they
+    // check `generation`: either they see the new generation or we see them.
+    if (__atomic_load_n(&e->idleWorkers, __ATOMIC_SEQ_CST) == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&e->mutex);
+
+    if (taskCount == 1) {
+        pthread_cond_signal(&e->workAvailable);
+    }
+    else {
+        pthread_cond_broadcast(&e->workAvailable);
+    }
+
+    pthread_mutex_unlock(&e->mutex);
+}
+
+/*!
+ * \brief Accounts for tasks about to be queued.
+ * \param e The executor.
+ * \param taskCount The amount of tasks.
+ **/
+static void countQueued(ExecutorImpl *e, size_t taskCount)
+{
+    __atomic_add_fetch(&e->outstandingTasks, taskCount, __ATOMIC_SEQ_CST);
+}
+
+/*!
+ * \brief Takes back the accounting of tasks that could not be queued.
+ * \param e The executor.
+ * \param taskCount The amount of tasks.
+ **/
+static void uncountQueued(ExecutorImpl *e, size_t taskCount)
+{
+    if (__atomic_sub_fetch(&e->outstandingTasks, taskCount, __ATOMIC_SEQ_CST)
+        == 0) {
+        pthread_mutex_lock(&e->mutex);
+        pthread_cond_broadcast(&e->allDone);
+        pthread_mutex_unlock(&e->mutex);
+    }
+}
+
+/*!
+ * \brief Runs a task taken from a deque or the global submission queue.
+ * \param e The executor.
+ * \param task The task.
+ **/
+static void runTask(ExecutorImpl *e, ExecutorTask *task)
+{
+    task->function(task->payload);
+
+    if (__atomic_sub_fetch(&e->outstandingTasks, 1, __ATOMIC_SEQ_CST) == 0) {
+        pthread_mutex_lock(&e->mutex);
+        pthread_cond_broadcast(&e->allDone);
+        pthread_mutex_unlock(&e->mutex);
+    }
+}
+
+/*!
+ * \brief Waits for tasks to be queued.
+ * \param e The executor.
+ * \param self The worker thread.
+ * \param generation The generation seen before looking for tasks last.
+ * \return true if there might be tasks; false if the worker should shut
+ *         down.
+ *
+ * Sleeps until tasks have been queued since, rather than until there are
+ * tasks anywhere: the tasks not started yet may be out of reach, e.g. in a
+ * submission not completed yet, and waiting for those would be spinning.
+ **/
+static bool waitForTasks(ExecutorImpl *e, Thread *self, size_t generation)
+{
+    bool shouldShutdown = false;
+
+    pthread_mutex_lock(&e->mutex);
+    __atomic_add_fetch(&e->idleWorkers, 1, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&e->generation, __ATOMIC_SEQ_CST) == generation) {
+        if (!threadShouldShutdown(self, &shouldShutdown) || shouldShutdown) {
+            shouldShutdown = true;
+            break;
+        }
+
+        pthread_cond_wait(&e->workAvailable, &e->mutex);
+    }
+
+    __atomic_sub_fetch(&e->idleWorkers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&e->mutex);
+    return !shouldShutdown;
+}
+
+/*!
+ * \brief The thread function of the workers.
+ * \param queue The global submission queue.
+ * \param sleepTimeSeconds Unused.
+ * \param id The thread ID.
+ * \param self The thread itself; its context is the `ExecutorWorker`.
+ **/
+static int workerThreadFunction(
+    RingBuffer *queue,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) sleepTimeSeconds;
+
+    ExecutorWorker *worker = threadContext(self);
+    ExecutorImpl *  e      = worker->executor;
+
+    if (pthread_setspecific(e->currentWorker, worker) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            return EXIT_FAILURE;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        // Taken before looking, so that tasks queued while looking keep us
+        // from going to sleep.
+        const size_t generation
+            = __atomic_load_n(&e->generation, __ATOMIC_SEQ_CST);
+        ExecutorTask task;
+        bool         isBusy = false;
+
+        // Our own tasks first, then the others', then new ones.
+        if (dequePop(&worker->deque, &task)
+            || steal(e, worker, &task, &isBusy)) {
+            runTask(e, &task);
+            continue;
+        }
+
+        ExecutorTask               batch[EXECUTOR_QUEUE_BATCH_SIZE];
+        size_t                     taken;
+        const RingBufferStatusCode statusCode = ringBufferTryReadRecords(
+            queue,
+            (byte *) batch,
+            sizeof(ExecutorTask),
+            EXECUTOR_QUEUE_BATCH_SIZE,
+            &taken,
+            id);
+
+        if (RB_FAILURE(statusCode)) {
+            return EXIT_FAILURE;
+        }
+
+        if (taken == 0) {
+            // A deque skipped may still hold tasks; only look again while
+            // someone is holding it, which doesn't take long.
+            if (!isBusy && !waitForTasks(e, self, generation)) {
+                break;
+            }
+
+            continue;
+        }
+
+        // Keep all but the first one where the others can steal them; in
+        // reverse so that we still run them in the order submitted.
+        for (size_t i = 1, j = taken - 1; i < j; ++i, --j) {
+            const ExecutorTask swapped = batch[i];
+            batch[i]                   = batch[j];
+            batch[j]                   = swapped;
+        }
+
+        if (taken > 1) {
+            if (dequePush(&worker->deque, &batch[1], taken - 1)) {
+                wakeIdleWorkers(e, taken - 1);
+            }
+            else {
+                // Out of memory -> run them right away instead.
+                for (size_t i = taken - 1; i > 0; --i) {
+                    runTask(e, &batch[i]);
+                }
+            }
+        }
+
+        runTask(e, &batch[0]);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Shuts down and joins the first workers.
+ * \param e The executor.
+ * \param workerCount The amount of workers started.
+ * \return The status code.
+ **/
+static RingBufferStatusCode stopWorkers(ExecutorImpl *e, size_t workerCount)
+{
+    RingBufferStatusCode statusCode = RB_OK;
+
+    for (size_t i = 0; i < workerCount; ++i) {
+        if (!threadRequestShutdown(e->workers[i].thread)) {
+            statusCode = RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+        }
+    }
+
+    // Wake the idle workers so that they notice.
+    pthread_mutex_lock(&e->mutex);
+    pthread_cond_broadcast(&e->workAvailable);
+    pthread_mutex_unlock(&e->mutex);
+
+    for (size_t i = 0; i < workerCount; ++i) {
+        int exitStatus;
+
+        if (!threadFree(e->workers[i].thread, &exitStatus)
+            || exitStatus != EXIT_SUCCESS) {
+            statusCode = RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+        }
+    }
+
+    return statusCode;
+}
+
+RingBufferStatusCode executorCreate(
+    size_t     workerCount,
+    size_t     queueCapacity,
+    Executor **executor)
+{
+    if (workerCount == 0 || queueCapacity == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    ExecutorImpl *e = calloc(1, sizeof(ExecutorImpl));
+
+    if (e == NULL) {
+        return RB_NOMEM;
+    }
+
+    e->workers = calloc(workerCount, sizeof(ExecutorWorker));
+
+    if (e->workers == NULL) {
+        free(e);
+        return RB_NOMEM;
+    }
+
+    RingBufferStatusCode statusCode
+        = ringBufferCreate(queueCapacity * sizeof(ExecutorTask), &e->queue);
+
+    if (RB_FAILURE(statusCode)) {
+        goto errorFreeWorkers;
+    }
+
+    if (pthread_key_create(&e->currentWorker, NULL) != 0) {
+        statusCode = RB_NOMEM;
+        goto errorFreeQueue;
+    }
+
+    if (pthread_mutex_init(&e->mutex, NULL) != 0) {
+        statusCode = RB_FAILURE_TO_INIT_MUTEX;
+        goto errorDeleteKey;
+    }
+
+    if (pthread_cond_init(&e->workAvailable, NULL) != 0) {
+        statusCode = RB_FAILURE_TO_INIT_CONDVAR;
+        goto errorDestroyMutex;
+    }
+
+    if (pthread_cond_init(&e->allDone, NULL) != 0) {
+        statusCode = RB_FAILURE_TO_INIT_CONDVAR;
+        goto errorDestroyWorkAvailable;
+    }
+
+    // Set up all of the workers before starting any, as every worker steals
+    // from all the others right away.
+    for (; e->workerCount < workerCount; ++e->workerCount) {
+        ExecutorWorker *worker = &e->workers[e->workerCount];
+        worker->executor       = e;
+        worker->index          = e->workerCount;
+
+        if (!dequeInit(&worker->deque)) {
+            statusCode = RB_NOMEM;
+            goto errorDestroyDeques;
+        }
+    }
+
+    for (size_t i = 0; i < workerCount; ++i) {
+        e->workers[i].thread = threadCreateWithContext(
+            &workerThreadFunction,
+            e->queue,
+            /* sleepTimeSeconds */ 0,
+            (int) i + 1,
+            &e->workers[i]);
+
+        if (e->workers[i].thread == NULL) {
+            stopWorkers(e, i);
+            statusCode = RB_NOMEM;
+            goto errorDestroyDeques;
+        }
+    }
+
+    *executor = opaque(e);
+    return RB_OK;
+
+errorDestroyDeques:
+    for (size_t i = 0; i < e->workerCount; ++i) {
+        dequeDestroy(&e->workers[i].deque);
+    }
+
+    pthread_cond_destroy(&e->allDone);
+errorDestroyWorkAvailable:
+    pthread_cond_destroy(&e->workAvailable);
+errorDestroyMutex:
+    pthread_mutex_destroy(&e->mutex);
+errorDeleteKey:
+    pthread_key_delete(e->currentWorker);
+errorFreeQueue:
+    ringBufferFree(e->queue);
+errorFreeWorkers:
+    free(e->workers);
+    free(e);
+    return statusCode;
+}
+
+/*!
+ * \brief Queues tasks.
+ * \param e The executor.
+ * \param tasks The tasks.
+ * \param taskCount The amount of tasks.
+ * \return The status code.
+ **/
+static RingBufferStatusCode
+submitTasks(ExecutorImpl *e, const ExecutorTask *tasks, size_t taskCount)
+{
+    ExecutorWorker *worker = pthread_getspecific(e->currentWorker);
+
+    // Tasks submitted by tasks stay with their worker.
+    if (worker != NULL) {
+        countQueued(e, taskCount);
+
+        if (!dequePush(&worker->deque, tasks, taskCount)) {
+            uncountQueued(e, taskCount);
+            return RB_NOMEM;
+        }
+
+        wakeIdleWorkers(e, taskCount);
+        return RB_OK;
+    }
+
+    // Everything else goes through the global submission queue, in chunks
+    // that fit.
+    const byte * queueStorage;
+    size_t       queueSize;
+    ringBufferStorage(e->queue, &queueStorage, &queueSize);
+    const size_t chunkSize = queueSize / sizeof(ExecutorTask);
+
+    while (taskCount != 0) {
+        const size_t count = taskCount < chunkSize ? taskCount : chunkSize;
+
+        countQueued(e, count);
+
+        const RingBufferStatusCode statusCode = ringBufferWriteRecord(
+            e->queue,
+            (const byte *) tasks,
+            count * sizeof(ExecutorTask),
+            /* threadId */ 0,
+            /* self */ NULL);
+
+        if (RB_FAILURE(statusCode)) {
+            uncountQueued(e, count);
+            return statusCode;
+        }
+
+        wakeIdleWorkers(e, count);
+        tasks += count;
+        taskCount -= count;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode executorSubmit(
+    Executor *   executor,
+    TaskFunction function,
+    const void * payload,
+    size_t       payloadSize)
+{
+    if (function == NULL || payloadSize > EXECUTOR_TASK_PAYLOAD_SIZE
+        || (payload == NULL && payloadSize != 0)) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    ExecutorTask task;
+    task.function = function;
+    memcpy(task.payload, payload, payloadSize);
+
+    return submitTasks(impl(executor), &task, 1);
+}
+
+RingBufferStatusCode executorSubmitBatch(
+    Executor *          executor,
+    const ExecutorTask *tasks,
+    size_t              taskCount)
+{
+    for (size_t i = 0; i < taskCount; ++i) {
+        if (tasks[i].function == NULL) {
+            return RB_INVALID_ARGUMENT;
+        }
+    }
+
+    return submitTasks(impl(executor), tasks, taskCount);
+}
+
+RingBufferStatusCode executorWaitAll(Executor *executor)
+{
+    ExecutorImpl *e = impl(executor);
+
+    if (pthread_mutex_lock(&e->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    while (__atomic_load_n(&e->outstandingTasks, __ATOMIC_SEQ_CST) != 0) {
+        if (pthread_cond_wait(&e->allDone, &e->mutex) != 0) {
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    if (pthread_mutex_unlock(&e->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode executorFree(Executor *executor)
+{
+    ExecutorImpl *e = impl(executor);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (e == NULL) {
+        return RB_OK;
+    }
+
+    RingBufferStatusCode statusCode = stopWorkers(e, e->workerCount);
+
+    for (size_t i = 0; i < e->workerCount; ++i) {
+        dequeDestroy(&e->workers[i].deque);
+    }
+
+    pthread_cond_destroy(&e->allDone);
+    pthread_cond_destroy(&e->workAvailable);
+    pthread_mutex_destroy(&e->mutex);
+    pthread_key_delete(e->currentWorker);
+
+    const RingBufferStatusCode freeStatusCode = ringBufferFree(e->queue);
+
+    if (RB_FAILURE(freeStatusCode)) {
+        statusCode = freeStatusCode;
+    }
+
+    free(e->workers);
+    free(e);
+    return statusCode;
+}
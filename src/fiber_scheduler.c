@@ -0,0 +1,639 @@
+#define _XOPEN_SOURCE 700
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "byte.h"
+#include "fiber_scheduler.h"
+
+/*!
+ * \brief The states of a fiber as seen by the worker that ran it last.
+ **/
+typedef enum {
+    FIBER_RUNNABLE, /*!< Yielded; to be run again */
+    FIBER_PARKED,   /*!< Waits for an eventfd or a point in time */
+    FIBER_FINISHED  /*!< Its function returned */
+} FiberState;
+
+typedef struct FiberSchedulerImpl FiberSchedulerImpl;
+typedef struct FiberImpl          FiberImpl;
+
+/*!
+ * \brief Fiber implementation type.
+ **/
+struct FiberImpl {
+    ucontext_t          context;          /*!< The saved registers */
+    byte *              stack;            /*!< The fiber's own stack */
+    FiberFunction       function;         /*!< The function to run */
+    RingBuffer *        ringBuffer;       /*!< Argument to `function` */
+    int32_t             sleepTimeSeconds; /*!< Argument to `function` */
+    int                 id;               /*!< Argument to `function` */
+    int                 exitStatus;       /*!< What `function` returned */
+    FiberState          state;            /*!< Set before switching away */
+    int                 waitFd;           /*!< The eventfd waited for or -1 */
+    uint64_t            wakeTime;         /*!< Milliseconds; 0 if none */
+    FiberSchedulerImpl *scheduler;        /*!< The scheduler owning this */
+    ucontext_t *        workerContext;    /*!< The worker running this */
+    FiberImpl *         previous;         /*!< Intrusive list link */
+    FiberImpl *         next;             /*!< Intrusive list link */
+};
+
+/*!
+ * \brief Intrusive FIFO list of fibers.
+ **/
+typedef struct {
+    FiberImpl *head;
+    FiberImpl *tail;
+} FiberList;
+
+/*!
+ * \brief Fiber scheduler implementation type.
+ **/
+struct FiberSchedulerImpl {
+    pthread_mutex_t mutex;             /*!< Protects all of the below */
+    pthread_cond_t  conditionVariable; /*!< Signalled when there is work */
+    pthread_t *     workers;           /*!< The worker threads */
+    size_t          workerCount;       /*!< The amount of worker threads */
+    size_t          stackSize;         /*!< Stack size of new fibers */
+    FiberList       runQueue;          /*!< Fibers ready to run */
+    FiberList       parked;            /*!< Fibers waiting */
+    size_t          liveFibers;        /*!< Fibers that haven't returned */
+    size_t          failedFibers;      /*!< Fibers that returned a failure */
+    bool            shuttingDown;      /*!< Read without the mutex too */
+    bool            isPolling;         /*!< Whether a worker polls */
+    bool            isWakePending;     /*!< Whether the poller was woken */
+    int             wakePipe[2];       /*!< Interrupts the poller */
+    struct pollfd * pollFds;           /*!< What the poller polls */
+    size_t          pollFdCount;       /*!< Entries used in `pollFds` */
+    size_t          pollFdCapacity;    /*!< Entries allocated in `pollFds` */
+    uint64_t        pollWakeTime;      /*!< When the poll times out; or 0 */
+};
+
+static FiberSchedulerImpl *impl(FiberScheduler *scheduler)
+{
+    return (FiberSchedulerImpl *) scheduler;
+}
+
+static FiberScheduler *opaque(FiberSchedulerImpl *scheduler)
+{
+    return (FiberScheduler *) scheduler;
+}
+
+static FiberImpl *fiberImpl(Fiber *fiber)
+{
+    return (FiberImpl *) fiber;
+}
+
+static Fiber *fiberOpaque(FiberImpl *fiber)
+{
+    return (Fiber *) fiber;
+}
+
+/*!
+ * \brief Returns the time of the monotonic clock in milliseconds.
+ **/
+static uint64_t nowMilliseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000u + (uint64_t) now.tv_nsec / 1000000u;
+}
+
+static void listPushBack(FiberList *list, FiberImpl *fiber)
+{
+    fiber->previous = list->tail;
+    fiber->next     = NULL;
+
+    if (list->tail == NULL) {
+        list->head = fiber;
+    }
+    else {
+        list->tail->next = fiber;
+    }
+
+    list->tail = fiber;
+}
+
+static void listRemove(FiberList *list, FiberImpl *fiber)
+{
+    if (fiber->previous == NULL) {
+        list->head = fiber->next;
+    }
+    else {
+        fiber->previous->next = fiber->next;
+    }
+
+    if (fiber->next == NULL) {
+        list->tail = fiber->previous;
+    }
+    else {
+        fiber->next->previous = fiber->previous;
+    }
+}
+
+static FiberImpl *listPopFront(FiberList *list)
+{
+    FiberImpl *fiber = list->head;
+
+    if (fiber != NULL) {
+        listRemove(list, fiber);
+    }
+
+    return fiber;
+}
+
+/*!
+ * \brief Interrupts the poll of the poller, if there is one.
+ * \param s The scheduler; its mutex must be locked.
+ **/
+static void wakePoller(FiberSchedulerImpl *s)
+{
+    if (s->isPolling && !s->isWakePending) {
+        const byte one = 1;
+        s->isWakePending = true;
+        (void) write(s->wakePipe[1], &one, sizeof(one));
+    }
+}
+
+/*!
+ * \brief Makes a fiber runnable.
+ * \param s The scheduler; its mutex must be locked.
+ * \param fiber The fiber.
+ **/
+static void makeRunnable(FiberSchedulerImpl *s, FiberImpl *fiber)
+{
+    listPushBack(&s->runQueue, fiber);
+    pthread_cond_signal(&s->conditionVariable);
+
+    // A single worker might be the one polling.
+    wakePoller(s);
+}
+
+/*!
+ * \brief Entry point of every fiber.
+ * \param high The upper 32 bits of the fiber's address.
+ * \param low The lower 32 bits of the fiber's address.
+ *
+ * makecontext only passes int arguments, hence the split pointer.
+ **/
+static void fiberTrampoline(unsigned high, unsigned low)
+{
+    FiberImpl *fiber
+        = (FiberImpl *) (((uintptr_t) high << 16 << 16) | (uintptr_t) low);
+
+    fiber->exitStatus = fiber->function(
+        fiber->ringBuffer,
+        fiber->sleepTimeSeconds,
+        fiber->id,
+        fiberOpaque(fiber));
+    fiber->state = FIBER_FINISHED;
+
+    // Never returns; the worker frees the stack we're running on.
+    setcontext(fiber->workerContext);
+}
+
+/*!
+ * \brief Switches from a fiber back to the worker running it.
+ * \param fiber The fiber; its state tells the worker what to do with it.
+ **/
+static void switchToWorker(FiberImpl *fiber)
+{
+    swapcontext(&fiber->context, fiber->workerContext);
+}
+
+/*!
+ * \brief Takes back a fiber that switched back to its worker.
+ * \param s The scheduler; its mutex must be locked.
+ * \param fiber The fiber.
+ *
+ * This must happen on the worker's stack, as no other worker may resume the
+ * fiber before its context has been saved.
+ **/
+static void retireFromWorker(FiberSchedulerImpl *s, FiberImpl *fiber)
+{
+    switch (fiber->state) {
+    case FIBER_RUNNABLE:
+        listPushBack(&s->runQueue, fiber);
+        break;
+    case FIBER_PARKED:
+        if (s->shuttingDown) {
+            listPushBack(&s->runQueue, fiber);
+            break;
+        }
+
+        listPushBack(&s->parked, fiber);
+
+        if (!s->isPolling) {
+            // Have an idle worker take up polling.
+            pthread_cond_signal(&s->conditionVariable);
+            break;
+        }
+
+        // Have the poller include the new fiber if it doesn't already.
+        bool isPolled = fiber->waitFd == -1;
+
+        for (size_t i = 1; i < s->pollFdCount && !isPolled; ++i) {
+            isPolled = s->pollFds[i].fd == fiber->waitFd;
+        }
+
+        if (!isPolled
+            || (fiber->wakeTime != 0
+                && (s->pollWakeTime == 0
+                    || fiber->wakeTime < s->pollWakeTime))) {
+            wakePoller(s);
+        }
+
+        break;
+    case FIBER_FINISHED:
+        if (fiber->exitStatus != EXIT_SUCCESS) {
+            ++s->failedFibers;
+        }
+
+        free(fiber->stack);
+        free(fiber);
+        --s->liveFibers;
+
+        if (s->liveFibers == 0) {
+            pthread_cond_broadcast(&s->conditionVariable);
+        }
+
+        break;
+    }
+}
+
+/*!
+ * \brief Polls the eventfds the parked fibers wait for and wakes them.
+ * \param s The scheduler; its mutex must be locked. It is unlocked while
+ *          polling.
+ **/
+static void pollParked(FiberSchedulerImpl *s)
+{
+    // Gather the distinct eventfds and the earliest wake time; the wake pipe
+    // goes first.
+    s->pollFds[0].fd      = s->wakePipe[0];
+    s->pollFds[0].events  = POLLIN;
+    s->pollFds[0].revents = 0;
+    s->pollFdCount        = 1;
+    s->pollWakeTime       = 0;
+
+    for (FiberImpl *f = s->parked.head; f != NULL; f = f->next) {
+        if (f->wakeTime != 0
+            && (s->pollWakeTime == 0 || f->wakeTime < s->pollWakeTime)) {
+            s->pollWakeTime = f->wakeTime;
+        }
+
+        if (f->waitFd == -1) {
+            continue;
+        }
+
+        bool isKnown = false;
+
+        for (size_t i = 1; i < s->pollFdCount && !isKnown; ++i) {
+            isKnown = s->pollFds[i].fd == f->waitFd;
+        }
+
+        if (isKnown) {
+            continue;
+        }
+
+        if (s->pollFdCount == s->pollFdCapacity) {
+            struct pollfd *pollFds = realloc(
+                s->pollFds, 2 * s->pollFdCapacity * sizeof(struct pollfd));
+
+            // Carry on with what we've got; the others are polled later.
+            if (pollFds == NULL) {
+                break;
+            }
+
+            s->pollFds = pollFds;
+            s->pollFdCapacity *= 2;
+        }
+
+        s->pollFds[s->pollFdCount].fd      = f->waitFd;
+        s->pollFds[s->pollFdCount].events  = POLLIN;
+        s->pollFds[s->pollFdCount].revents = 0;
+        ++s->pollFdCount;
+    }
+
+    int timeout = -1;
+
+    if (s->pollWakeTime != 0) {
+        const uint64_t now = nowMilliseconds();
+        timeout = s->pollWakeTime <= now ? 0 : (int) (s->pollWakeTime - now);
+    }
+
+    s->isPolling     = true;
+    s->isWakePending = false;
+    pthread_mutex_unlock(&s->mutex);
+
+    const int readyCount = poll(s->pollFds, (nfds_t) s->pollFdCount, timeout);
+
+    pthread_mutex_lock(&s->mutex);
+    s->isPolling = false;
+
+    if (readyCount > 0) {
+        if ((s->pollFds[0].revents & POLLIN) != 0) {
+            byte drain[64];
+            (void) read(s->wakePipe[0], drain, sizeof(drain));
+        }
+
+        for (size_t i = 1; i < s->pollFdCount; ++i) {
+            if ((s->pollFds[i].revents & POLLIN) == 0) {
+                continue;
+            }
+
+            // Reset the eventfd and wake everyone waiting for it; waking
+            // just one could strand the others if it doesn't use up all of
+            // what became available, e.g. a producer writing a single byte.
+            uint64_t counter;
+            (void) read(s->pollFds[i].fd, &counter, sizeof(counter));
+
+            for (FiberImpl *f = s->parked.head; f != NULL;) {
+                FiberImpl *next = f->next;
+
+                if (f->waitFd == s->pollFds[i].fd) {
+                    listRemove(&s->parked, f);
+                    makeRunnable(s, f);
+                }
+
+                f = next;
+            }
+        }
+    }
+
+    const uint64_t now = nowMilliseconds();
+
+    for (FiberImpl *f = s->parked.head; f != NULL;) {
+        FiberImpl *next = f->next;
+
+        if (f->wakeTime != 0 && f->wakeTime <= now) {
+            listRemove(&s->parked, f);
+            makeRunnable(s, f);
+        }
+
+        f = next;
+    }
+
+    // Let the others see whether someone has to take over polling.
+    pthread_cond_broadcast(&s->conditionVariable);
+}
+
+/*!
+ * \brief The routine of the worker threads.
+ * \param argument The scheduler.
+ * \return NULL.
+ **/
+static void *workerRoutine(void *argument)
+{
+    FiberSchedulerImpl *s = argument;
+    ucontext_t          workerContext;
+
+    pthread_mutex_lock(&s->mutex);
+
+    for (;;) {
+        FiberImpl *fiber = listPopFront(&s->runQueue);
+
+        if (fiber != NULL) {
+            pthread_mutex_unlock(&s->mutex);
+
+            fiber->state         = FIBER_RUNNABLE;
+            fiber->workerContext = &workerContext;
+            swapcontext(&workerContext, &fiber->context);
+
+            pthread_mutex_lock(&s->mutex);
+            retireFromWorker(s, fiber);
+            continue;
+        }
+
+        if (s->shuttingDown && s->liveFibers == 0) {
+            break;
+        }
+
+        if (s->parked.head != NULL && !s->isPolling) {
+            pollParked(s);
+            continue;
+        }
+
+        pthread_cond_wait(&s->conditionVariable, &s->mutex);
+    }
+
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+FiberScheduler *fiberSchedulerCreate(size_t workerCount, size_t stackSize)
+{
+    if (workerCount == 0) {
+        return NULL;
+    }
+
+    FiberSchedulerImpl *s = calloc(1, sizeof(FiberSchedulerImpl));
+
+    if (s == NULL) {
+        return NULL;
+    }
+
+    s->stackSize      = stackSize == 0 ? FIBER_DEFAULT_STACK_SIZE : stackSize;
+    s->pollFdCapacity = 8;
+    s->pollFds        = malloc(s->pollFdCapacity * sizeof(struct pollfd));
+    s->workers        = calloc(workerCount, sizeof(pthread_t));
+
+    if (s->pollFds == NULL || s->workers == NULL) {
+        goto errorFree;
+    }
+
+    if (pipe(s->wakePipe) != 0) {
+        goto errorFree;
+    }
+
+    // Interrupting the poller must never block.
+    fcntl(s->wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(s->wakePipe[1], F_SETFL, O_NONBLOCK);
+
+    if (pthread_mutex_init(&s->mutex, NULL) != 0) {
+        goto errorClosePipe;
+    }
+
+    if (pthread_cond_init(&s->conditionVariable, NULL) != 0) {
+        pthread_mutex_destroy(&s->mutex);
+        goto errorClosePipe;
+    }
+
+    for (; s->workerCount < workerCount; ++s->workerCount) {
+        if (pthread_create(
+                &s->workers[s->workerCount], NULL, &workerRoutine, s)
+            != 0) {
+            fiberSchedulerFree(opaque(s), NULL);
+            return NULL;
+        }
+    }
+
+    return opaque(s);
+
+errorClosePipe:
+    close(s->wakePipe[0]);
+    close(s->wakePipe[1]);
+errorFree:
+    free(s->workers);
+    free(s->pollFds);
+    free(s);
+    return NULL;
+}
+
+bool fiberSpawn(
+    FiberScheduler *scheduler,
+    FiberFunction   function,
+    RingBuffer *    ringBuffer,
+    int32_t         sleepTimeSeconds,
+    int             id)
+{
+    FiberSchedulerImpl *s     = impl(scheduler);
+    FiberImpl *         fiber = calloc(1, sizeof(FiberImpl));
+
+    if (fiber == NULL) {
+        return false;
+    }
+
+    fiber->stack = malloc(s->stackSize);
+
+    if (fiber->stack == NULL || getcontext(&fiber->context) != 0) {
+        free(fiber->stack);
+        free(fiber);
+        return false;
+    }
+
+    fiber->function         = function;
+    fiber->ringBuffer       = ringBuffer;
+    fiber->sleepTimeSeconds = sleepTimeSeconds;
+    fiber->id               = id;
+    fiber->waitFd           = -1;
+    fiber->scheduler        = s;
+
+    fiber->context.uc_stack.ss_sp   = fiber->stack;
+    fiber->context.uc_stack.ss_size = s->stackSize;
+    fiber->context.uc_link          = NULL;
+
+    const uintptr_t address = (uintptr_t) fiber;
+    makecontext(
+        &fiber->context,
+        (void (*)(void)) fiberTrampoline,
+        2,
+        (unsigned) (address >> 16 >> 16),
+        (unsigned) (address & 0xFFFFFFFFu));
+
+    pthread_mutex_lock(&s->mutex);
+    ++s->liveFibers;
+    makeRunnable(s, fiber);
+    pthread_mutex_unlock(&s->mutex);
+    return true;
+}
+
+void fiberYield(Fiber *self)
+{
+    FiberImpl *fiber = fiberImpl(self);
+    fiber->state     = FIBER_RUNNABLE;
+    switchToWorker(fiber);
+}
+
+void fiberWait(Fiber *self, int eventFd)
+{
+    FiberImpl *fiber = fiberImpl(self);
+
+    if (fiberShouldShutdown(self)) {
+        return;
+    }
+
+    fiber->state    = FIBER_PARKED;
+    fiber->waitFd   = eventFd;
+    fiber->wakeTime = 0;
+    switchToWorker(fiber);
+    fiber->waitFd = -1;
+}
+
+void fiberSleep(Fiber *self, int32_t seconds)
+{
+    FiberImpl *fiber = fiberImpl(self);
+
+    if (seconds <= 0) {
+        fiberYield(self);
+        return;
+    }
+
+    if (fiberShouldShutdown(self)) {
+        return;
+    }
+
+    fiber->state    = FIBER_PARKED;
+    fiber->waitFd   = -1;
+    fiber->wakeTime = nowMilliseconds() + (uint64_t) seconds * 1000u;
+    switchToWorker(fiber);
+    fiber->wakeTime = 0;
+}
+
+bool fiberShouldShutdown(Fiber *self)
+{
+    return __atomic_load_n(
+        &fiberImpl(self)->scheduler->shuttingDown, __ATOMIC_ACQUIRE);
+}
+
+void fiberSchedulerShutdown(FiberScheduler *scheduler)
+{
+    FiberSchedulerImpl *s = impl(scheduler);
+
+    pthread_mutex_lock(&s->mutex);
+    __atomic_store_n(&s->shuttingDown, true, __ATOMIC_RELEASE);
+
+    FiberImpl *fiber;
+
+    while ((fiber = listPopFront(&s->parked)) != NULL) {
+        listPushBack(&s->runQueue, fiber);
+    }
+
+    pthread_cond_broadcast(&s->conditionVariable);
+    wakePoller(s);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+bool fiberSchedulerFree(FiberScheduler *scheduler, size_t *failedFiberCount)
+{
+    FiberSchedulerImpl *s = impl(scheduler);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (s == NULL) {
+        return true;
+    }
+
+    fiberSchedulerShutdown(scheduler);
+
+    bool success = true;
+
+    for (size_t i = 0; i < s->workerCount; ++i) {
+        if (pthread_join(s->workers[i], NULL) != 0) {
+            success = false;
+        }
+    }
+
+    if (failedFiberCount != NULL) {
+        *failedFiberCount = s->failedFibers;
+    }
+
+    if (s->failedFibers != 0) {
+        success = false;
+    }
+
+    pthread_cond_destroy(&s->conditionVariable);
+    pthread_mutex_destroy(&s->mutex);
+    close(s->wakePipe[0]);
+    close(s->wakePipe[1]);
+    free(s->workers);
+    free(s->pollFds);
+    free(s);
+    return success;
+}
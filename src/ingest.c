@@ -0,0 +1,209 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ingest.h"
+
+/*!
+ * \brief Ingest source implementation type.
+ **/
+typedef struct {
+    int         fd;          /*!< The file read */
+    bool        isStdin;     /*!< Whether `fd` is stdin, left open */
+    bool        isMapped;    /*!< Whether `mapping` is used */
+    const byte *mapping;     /*!< mmap: The file's bytes; NULL if empty */
+    size_t      mappingSize; /*!< mmap: Size of `mapping` in bytes */
+    size_t      position;    /*!< mmap: The offset of the next byte */
+} IngestSourceImpl;
+
+static IngestSourceImpl *impl(IngestSource *source)
+{
+    return (IngestSourceImpl *) source;
+}
+
+static const IngestSourceImpl *constImpl(const IngestSource *source)
+{
+    return (const IngestSourceImpl *) source;
+}
+
+static IngestSource *opaque(IngestSourceImpl *source)
+{
+    return (IngestSource *) source;
+}
+
+/*!
+ * \brief Maps a regular file for reading it front to back.
+ * \param source The source, whose `fd` is the file.
+ * \param size The size of the file in bytes.
+ * \return true on success; otherwise false.
+ **/
+static bool mapFile(IngestSourceImpl *source, size_t size)
+{
+    source->isMapped    = true;
+    source->mapping     = NULL;
+    source->mappingSize = size;
+    source->position    = 0;
+
+    // Empty files can't be mapped, but there's nothing to read anyway.
+    if (size == 0) {
+        return true;
+    }
+
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, source->fd, 0);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    // Read ahead aggressively and drop the pages behind; only a hint.
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    source->mapping = mapping;
+    return true;
+}
+
+IngestSource *ingestSourceOpen(const char *path)
+{
+    IngestSourceImpl *source = calloc(1, sizeof(IngestSourceImpl));
+
+    if (source == NULL) {
+        return NULL;
+    }
+
+    // Opening a FIFO blocks until there is a writer, which would keep the
+    // reader from ever looking at its shutdown state; wait using poll
+    // instead.
+    source->isStdin = strcmp(path, "-") == 0;
+    source->fd      = source->isStdin ? STDIN_FILENO
+                                      : open(path, O_RDONLY | O_NONBLOCK);
+
+    if (source->fd == -1) {
+        goto error;
+    }
+
+    const int flags = fcntl(source->fd, F_GETFL);
+
+    if (!source->isStdin
+        && (flags == -1
+            || fcntl(source->fd, F_SETFL, flags & ~O_NONBLOCK) == -1)) {
+        goto error;
+    }
+
+    struct stat status;
+
+    if (fstat(source->fd, &status) != 0) {
+        goto error;
+    }
+
+    // Redirected stdin may well be a regular file, too.
+    if (S_ISREG(status.st_mode) && !mapFile(source, (size_t) status.st_size)) {
+        goto error;
+    }
+
+    return opaque(source);
+
+error:
+    if (source->fd != -1 && !source->isStdin) {
+        close(source->fd);
+    }
+
+    free(source);
+    return NULL;
+}
+
+bool ingestSourceFree(IngestSource *source)
+{
+    IngestSourceImpl *s = impl(source);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (s == NULL) {
+        return true;
+    }
+
+    bool success = true;
+
+    if (s->mapping != NULL
+        && munmap((void *) s->mapping, s->mappingSize) != 0) {
+        success = false;
+    }
+
+    if (!s->isStdin && close(s->fd) != 0) {
+        success = false;
+    }
+
+    free(s);
+    return success;
+}
+
+bool ingestSourceIsMapped(const IngestSource *source)
+{
+    return constImpl(source)->isMapped;
+}
+
+bool ingestSourceWait(
+    IngestSource *source,
+    int32_t       timeoutMilliseconds,
+    bool *        isReady)
+{
+    IngestSourceImpl *s = impl(source);
+
+    // The bytes of a mapped file are always there.
+    if (s->isMapped) {
+        *isReady = true;
+        return true;
+    }
+
+    struct pollfd pfd = {s->fd, POLLIN, 0};
+    const int     ready = poll(&pfd, 1, (int) timeoutMilliseconds);
+
+    if (ready == -1 && errno != EINTR) {
+        return false;
+    }
+
+    // The end of a pipe counts as ready, as reading it returns at once.
+    *isReady = ready > 0;
+    return true;
+}
+
+bool ingestSourceRead(
+    IngestSource *source,
+    byte *        destination,
+    size_t        maxBytes,
+    size_t *      bytesRead)
+{
+    IngestSourceImpl *s = impl(source);
+
+    if (s->isMapped) {
+        const size_t left  = s->mappingSize - s->position;
+        const size_t count = maxBytes < left ? maxBytes : left;
+
+        memcpy(destination, s->mapping + s->position, count);
+        s->position += count;
+        *bytesRead = count;
+        return true;
+    }
+
+    for (;;) {
+        const ssize_t count = read(s->fd, destination, maxBytes);
+
+        if (count == -1 && errno == EINTR) {
+            continue;
+        }
+
+        if (count == -1) {
+            return false;
+        }
+
+        *bytesRead = (size_t) count;
+        return true;
+    }
+}
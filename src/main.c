@@ -1,12 +1,68 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/stat.h>
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "aggregator.h"
+#include "arena.h"
 #include "cmd_args.h"
 #include "consumer.h"
+#include "partitioned_ring.h"
+#include "payload.h"
 #include "producer.h"
 #include "ring_buffer.h"
 #include "sleep_thread.h"
+#include "supervisor.h"
+#include "trace.h"
+#include "watchdog.h"
+#include "workload.h"
+
+/*!
+ * \def SUPERVISOR_INTERVAL_MILLISECONDS
+ * \brief The time between two sizing decisions of the supervisor.
+ **/
+#define SUPERVISOR_INTERVAL_MILLISECONDS 100
+
+/*!
+ * \def TRACE_EVENTS_PER_THREAD
+ * \brief The amount of events every thread can trace.
+ **/
+#define TRACE_EVENTS_PER_THREAD ((size_t) 1 << 20)
+
+/*!
+ * \def AGGREGATOR_DEFAULT_WINDOW_MILLISECONDS
+ * \brief The length of the aggregation windows if none is given.
+ **/
+#define AGGREGATOR_DEFAULT_WINDOW_MILLISECONDS 1000
+
+/*!
+ * \def AGGREGATOR_DEFAULT_TOP_K
+ * \brief The amount of most frequent bytes reported if none is given.
+ **/
+#define AGGREGATOR_DEFAULT_TOP_K 3
+
+/*!
+ * \def WATCHDOG_CHECKS_PER_STALL
+ * \brief How often the watchdog checks on the threads within the stall
+ *        time.
+ **/
+#define WATCHDOG_CHECKS_PER_STALL 4
+
+/*!
+ * \def PRODUCER_DEFAULT_LINGER_MILLISECONDS
+ * \brief The longest a byte collected by a producer waits to be written if
+ *        no linger time is given.
+ **/
+#define PRODUCER_DEFAULT_LINGER_MILLISECONDS 5
 
 /*!
  * \brief Function to free threads (producers or consumers).
@@ -33,6 +89,11 @@ static bool freeThreads(
     bool success = true;
 
     for (int32_t i = 0; i < elementCount; ++i) {
+        // Creating it may have failed.
+        if (threads[i] == NULL) {
+            continue;
+        }
+
         int        threadExitStatus;
         const bool couldFree = threadFree(threads[i], &threadExitStatus);
 
@@ -57,22 +118,394 @@ static bool freeThreads(
     return success;
 }
 
+#ifdef _WIN32
 /*!
  * \brief Global variable that will hold the last signal emitted.
- *        Should only ever be 0 (the default value) or SIGINT
- *        which is the only signal for which the signal handler
+ *        Should only ever be 0 (the default value), SIGINT or SIGTERM
+ *        which are the only signals for which the signal handler
  *        shall be registered.
  **/
 volatile sig_atomic_t gSignalStatus = 0;
 
 /*!
  * \brief The signal handler for this application.
- * \param signal The signal that was emitted (should be SIGINT).
+ * \param signal The signal that was emitted (should be SIGINT or SIGTERM).
  **/
 static void signalHandler(int signal)
 {
     gSignalStatus = signal;
 }
+#endif
+
+/*!
+ * \brief Wakes all the threads waiting on the ring buffer and the
+ *        partitions, so that they reexamine their shutdown state.
+ * \param ringBuffer The ring buffer.
+ * \param partitions The partitioned ring; may be NULL.
+ * \return The status code.
+ **/
+static RingBufferStatusCode
+shutdownRings(RingBuffer *ringBuffer, PartitionedRing *partitions)
+{
+    const RingBufferStatusCode statusCode = ringBufferShutdown(ringBuffer);
+
+    if (RB_FAILURE(statusCode) || partitions == NULL) {
+        return statusCode;
+    }
+
+    return partitionedRingShutdown(partitions);
+}
+
+/*!
+ * \brief Prepares waiting for SIGINT and SIGTERM.
+ * \return true on success; otherwise false.
+ * \note Must be called before any thread is created. The threads inherit the
+ *       signal mask, so that the signals stay pending until
+ *       `waitForShutdownSignal` takes them, rather than interrupting
+ *       whichever thread they happen to be delivered to.
+ **/
+static bool prepareShutdownSignals(void)
+{
+#ifndef _WIN32
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    return pthread_sigmask(SIG_BLOCK, &signals, NULL) == 0;
+#else
+    return signal(SIGINT, &signalHandler) != SIG_ERR
+           && signal(SIGTERM, &signalHandler) != SIG_ERR;
+#endif
+}
+
+/*!
+ * \brief Blocks until SIGINT or SIGTERM is emitted.
+ * \return The signal emitted.
+ *
+ * Returns as soon as the signal arrives rather than polling for it.
+ **/
+static int waitForShutdownSignal(void)
+{
+#ifndef _WIN32
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+
+    for (;;) {
+        siginfo_t  info;
+        const int signal = sigwaitinfo(&signals, &info);
+
+        // Interrupted by a signal not waited for -> wait again.
+        if (signal != -1) {
+            return signal;
+        }
+    }
+#else
+    while (gSignalStatus == 0) {
+        sleepThread(/* seconds */ 1);
+    }
+
+    return gSignalStatus;
+#endif
+}
+
+/*!
+ * \brief Lets another SIGINT or SIGTERM end the process right away.
+ * \return true on success; otherwise false.
+ *
+ * For once shutting down has begun, so that a second signal doesn't have to
+ * wait for the drain.
+ **/
+static bool forceShutdownOnSignal(void)
+{
+#ifndef _WIN32
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+
+    // Only the main thread unblocks them, so that they are delivered to it
+    // and take their default action of terminating the process.
+    return pthread_sigmask(SIG_UNBLOCK, &signals, NULL) == 0;
+#else
+    return signal(SIGINT, SIG_DFL) != SIG_ERR
+           && signal(SIGTERM, SIG_DFL) != SIG_ERR;
+#endif
+}
+
+/*!
+ * \brief What the producers and consumers are created from.
+ **/
+typedef struct {
+    RingBuffer *          ringBuffer;       /*!< The ring buffer */
+    int32_t               sleepTimeSeconds; /*!< Sleep time */
+    int                   firstId;          /*!< The thread ID of index 0 */
+    const ProducerConfig *producerConfig;   /*!< For the producers */
+    const ConsumerConfig *consumerConfig;   /*!< For the consumers */
+} StartupContext;
+
+/*!
+ * \brief Creates a producer; a `ThreadFactory`.
+ * \param index The index of the producer.
+ * \param context The `StartupContext`.
+ * \return The producer created; NULL on failure.
+ **/
+static Thread *producerFactory(size_t index, void *context)
+{
+    const StartupContext *startup = context;
+
+    return producerCreate(
+        startup->ringBuffer,
+        startup->sleepTimeSeconds,
+        startup->firstId + (int) index,
+        startup->producerConfig);
+}
+
+/*!
+ * \brief Creates a consumer; a `ThreadFactory`.
+ * \param index The index of the consumer.
+ * \param context The `StartupContext`.
+ * \return The consumer created; NULL on failure.
+ **/
+static Thread *consumerFactory(size_t index, void *context)
+{
+    const StartupContext *startup = context;
+
+    return consumerCreate(
+        startup->ringBuffer,
+        startup->sleepTimeSeconds,
+        startup->firstId + (int) index,
+        startup->consumerConfig);
+}
+
+/*!
+ * \brief Returns the time passed since a point in time.
+ * \param start The point in time, read from CLOCK_MONOTONIC.
+ * \return The time passed in milliseconds.
+ **/
+static double millisecondsSince(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) * 1e3
+           + (double) (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/*!
+ * \brief Requests threads to shut down.
+ * \param threads The threads.
+ * \param elementCount The size of `threads` in elements.
+ * \return true if all the requests succeeded; otherwise false.
+ **/
+static bool requestShutdown(Thread **threads, int32_t elementCount)
+{
+    // If the pointer is null -> do nothing (that's okay)
+    if (threads == NULL) {
+        return true;
+    }
+
+    bool success = true;
+
+    for (int32_t i = 0; i < elementCount; ++i) {
+        // Creating it may have failed.
+        if (threads[i] != NULL) {
+            success &= threadRequestShutdown(threads[i]);
+        }
+    }
+
+    return success;
+}
+
+/*!
+ * \brief Prints how evenly the producers got to write.
+ * \param writeCounts The writes of every producer.
+ * \param producerCount The amount of producers.
+ *
+ * Jain's fairness index is 1 if all the producers wrote equally often and
+ * falls to 1 / `producerCount` if a single one wrote everything.
+ **/
+static void
+printProducerFairness(const uint64_t *writeCounts, int32_t producerCount)
+{
+    double   sum        = 0.0;
+    double   sumSquares = 0.0;
+    uint64_t minimum    = UINT64_MAX;
+    uint64_t maximum    = 0;
+
+    for (int32_t prod = 0; prod < producerCount; ++prod) {
+        const double writes = (double) writeCounts[prod];
+
+        sum += writes;
+        sumSquares += writes * writes;
+        minimum = writeCounts[prod] < minimum ? writeCounts[prod] : minimum;
+        maximum = writeCounts[prod] > maximum ? writeCounts[prod] : maximum;
+        printf(
+            "Producer (tid: %d) wrote %llu times.\n",
+            (int) prod + 1,
+            (unsigned long long) writeCounts[prod]);
+    }
+
+    if (sumSquares == 0.0) {
+        return;
+    }
+
+    printf(
+        "Producer fairness: Jain's index %.3f, max/min writes ",
+        sum * sum / ((double) producerCount * sumSquares));
+
+    if (minimum == 0) {
+        printf("infinite.\n");
+    }
+    else {
+        printf("%.2f.\n", (double) maximum / (double) minimum);
+    }
+}
+
+/*!
+ * \brief Counts the entries of a comma separated list.
+ * \param list The list.
+ * \return The amount of entries; 1 plus the amount of commas.
+ **/
+static int32_t countListEntries(const char *list)
+{
+    int32_t count = 1;
+
+    for (const char *c = list; *c != '\0'; ++c) {
+        count += *c == ',';
+    }
+
+    return count;
+}
+
+/*!
+ * \brief Splits a comma separated list into its entries.
+ * \param list The list.
+ * \return The entries, in a single allocation along with their characters;
+ *         NULL on failure.
+ * \warning The return value must be freed using `free`.
+ **/
+static const char **splitList(const char *list)
+{
+    const size_t count  = (size_t) countListEntries(list);
+    const size_t length = strlen(list);
+
+    // The characters follow the pointers, which keeps them aligned.
+    const char **entries = malloc(count * sizeof(const char *) + length + 1);
+
+    if (entries == NULL) {
+        return NULL;
+    }
+
+    char *characters = (char *) (entries + count);
+    memcpy(characters, list, length + 1);
+
+    for (size_t i = 0; i < count; ++i) {
+        entries[i] = characters;
+        characters += strcspn(characters, ",");
+        *characters++ = '\0';
+    }
+
+    return entries;
+}
+
+/*!
+ * \brief Writes the trace recorded, if any, and stops tracing.
+ * \param path The file to write to; NULL if not tracing.
+ * \return true on success; otherwise false.
+ * \warning The threads traced must have exited.
+ **/
+static bool finishTrace(const char *path)
+{
+    if (path == NULL) {
+        return true;
+    }
+
+    const bool couldWrite = traceWriteChromeJson(path);
+    traceDisable();
+
+    if (!couldWrite) {
+        fprintf(stderr, "Could not write the trace to %s\n", path);
+        return false;
+    }
+
+    printf("Wrote the trace to %s\n", path);
+    return true;
+}
+
+/*!
+ * \brief Runs the producers and consumers as fibers until SIGINT is emitted.
+ * \param commandLineArguments The command line arguments parsed.
+ * \param ringBuffer The ring buffer; must have notifications enabled.
+ * \return EXIT_SUCCESS on success; otherwise EXIT_FAILURE.
+ **/
+static int
+runFibers(const CmdArgs *commandLineArguments, RingBuffer *ringBuffer)
+{
+#ifndef _WIN32
+    FiberScheduler *scheduler = fiberSchedulerCreate(
+        (size_t) commandLineArguments->fiberWorkers, /* stackSize */ 0);
+
+    if (scheduler == NULL) {
+        fprintf(stderr, "Could not create the fiber scheduler.\n");
+        return EXIT_FAILURE;
+    }
+
+    int programExitStatus = EXIT_SUCCESS;
+    int fiberId           = 1;
+
+    for (int32_t prod = 0; prod < commandLineArguments->producerCount;
+         ++prod) {
+        if (!producerSpawn(
+                scheduler,
+                ringBuffer,
+                commandLineArguments->producerSleepTime,
+                fiberId)) {
+            programExitStatus = EXIT_FAILURE;
+            goto shutdown;
+        }
+
+        ++fiberId;
+    }
+
+    for (int32_t cons = 0; cons < commandLineArguments->consumerCount;
+         ++cons) {
+        if (!consumerSpawn(
+                scheduler,
+                ringBuffer,
+                commandLineArguments->consumerSleepTime,
+                fiberId)) {
+            programExitStatus = EXIT_FAILURE;
+            goto shutdown;
+        }
+
+        ++fiberId;
+    }
+
+    // Have the main thread wait for SIGINT or SIGTERM to be emitted.
+    waitForShutdownSignal();
+
+    printf("Shutdown of fibers was requested.\n");
+
+shutdown:;
+    size_t failedFiberCount = 0;
+
+    if (!fiberSchedulerFree(scheduler, &failedFiberCount)) {
+        fprintf(
+            stderr,
+            "Could not shut down the fibers; %zu failed.\n",
+            failedFiberCount);
+        programExitStatus = EXIT_FAILURE;
+    }
+
+    return programExitStatus;
+#else
+    (void) commandLineArguments;
+    (void) ringBuffer;
+    fprintf(stderr, "Fibers are not supported on this platform.\n");
+    return EXIT_FAILURE;
+#endif
+}
 
 /*!
  * \brief The entry point of this application.
@@ -82,8 +515,12 @@ static void signalHandler(int signal)
  **/
 int main(int argc, char **argv)
 {
-    // Install the signal handler for SIGINT (e.g., when CTRL + C is pressed)
-    signal(SIGINT, &signalHandler);
+    // Take SIGINT (e.g., when CTRL + C is pressed) and SIGTERM (e.g., from a
+    // service manager) on the main thread only.
+    if (!prepareShutdownSignals()) {
+        fprintf(stderr, "Could not prepare the shutdown signals.\n");
+        return EXIT_FAILURE;
+    }
 
     const CmdArgs commandLineArguments = parseCmdArgs(argc, argv);
 
@@ -91,10 +528,386 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    ConsumerConfig consumerConfig = {CONSUMER_MODE_BLOCKING,
+                                     commandLineArguments.sinkPath,
+                                     (size_t) commandLineArguments.payloadSize,
+                                     NULL,
+                                     NULL,
+                                     NULL,
+                                     NULL,
+                                     NULL,
+                                     NULL,
+                                     NULL,
+                                     NULL};
+    ProducerConfig producerConfig = {(size_t) commandLineArguments.payloadSize,
+                                     NULL,
+                                     NULL,
+                                     NULL,
+                                     1,
+                                     NULL,
+                                     NULL,
+                                     0,
+                                     0,
+                                     NULL};
+    const bool useFairness = commandLineArguments.fairness != NULL
+                             && strcmp(commandLineArguments.fairness, "fifo")
+                                    == 0;
+
+    if (commandLineArguments.fairness != NULL && !useFairness
+        && strcmp(commandLineArguments.fairness, "none") != 0) {
+        fprintf(
+            stderr, "Unknown fairness: %s\n", commandLineArguments.fairness);
+        return EXIT_FAILURE;
+    }
+    const bool usePool = commandLineArguments.transport != NULL
+                         && strcmp(commandLineArguments.transport, "pool") == 0;
+
+    if (commandLineArguments.transport != NULL && !usePool
+        && strcmp(commandLineArguments.transport, "copy") != 0) {
+        fprintf(
+            stderr, "Unknown transport: %s\n", commandLineArguments.transport);
+        return EXIT_FAILURE;
+    }
+
+    if (commandLineArguments.consumerMode != NULL
+        && !consumerModeFromString(
+            commandLineArguments.consumerMode, &consumerConfig.mode)) {
+        fprintf(
+            stderr,
+            "Unknown consumer mode: %s\n",
+            commandLineArguments.consumerMode);
+        return EXIT_FAILURE;
+    }
+
+    if (commandLineArguments.fiberWorkers > 0
+        && consumerConfig.mode != CONSUMER_MODE_BLOCKING) {
+        fprintf(stderr, "--fiberWorkers requires the blocking consumer mode\n");
+        return EXIT_FAILURE;
+    }
+
+    // Replay at the recorded timing unless told otherwise.
+    if (commandLineArguments.replaySpeed != NULL
+        && strcmp(commandLineArguments.replaySpeed, "max") == 0) {
+        producerConfig.replaySpeed = 0;
+    }
+    else if (commandLineArguments.replaySpeed != NULL) {
+        char *              end;
+        const unsigned long replaySpeed
+            = strtoul(commandLineArguments.replaySpeed, &end, 10);
+
+        if (replaySpeed == 0 || replaySpeed > UINT32_MAX || *end != '\0') {
+            fprintf(
+                stderr, "--replaySpeed must be a positive number or max\n");
+            return EXIT_FAILURE;
+        }
+
+        producerConfig.replaySpeed = (uint32_t) replaySpeed;
+    }
+
+    if (commandLineArguments.replayPath != NULL
+        && (commandLineArguments.fiberWorkers > 0 || usePool)) {
+        fprintf(
+            stderr,
+            "--replayPath can't be combined with --fiberWorkers or the pool "
+            "transport\n");
+        return EXIT_FAILURE;
+    }
+
+    if (consumerConfig.mode == CONSUMER_MODE_RECORD
+        && commandLineArguments.recordPath == NULL) {
+        fprintf(stderr, "The record consumer mode requires --recordPath\n");
+        return EXIT_FAILURE;
+    }
+
+    if (commandLineArguments.topK > AGGREGATOR_MAX_TOP_K) {
+        fprintf(stderr, "--topK must be at most %d\n", AGGREGATOR_MAX_TOP_K);
+        return EXIT_FAILURE;
+    }
+
+    if (commandLineArguments.lingerMilliseconds != 0
+        && commandLineArguments.lingerBatchSize <= 1) {
+        fprintf(stderr, "--lingerMilliseconds requires --lingerBatchSize\n");
+        return EXIT_FAILURE;
+    }
+
+    producerConfig.lingerBatchSize
+        = (size_t) commandLineArguments.lingerBatchSize;
+    producerConfig.lingerMilliseconds
+        = commandLineArguments.lingerMilliseconds == 0
+              ? PRODUCER_DEFAULT_LINGER_MILLISECONDS
+              : commandLineArguments.lingerMilliseconds;
+
+    // Batches are written as records, which the spilling ring buffer and
+    // the fibers don't take.
+    if (commandLineArguments.lingerBatchSize > 1
+        && (commandLineArguments.payloadSize != 0
+            || commandLineArguments.replayPath != NULL
+            || commandLineArguments.spillDirectory != NULL
+            || commandLineArguments.fiberWorkers > 0)) {
+        fprintf(
+            stderr,
+            "--lingerBatchSize can't be combined with --payloadSize, "
+            "--replayPath, --spillDirectory or --fiberWorkers\n");
+        return EXIT_FAILURE;
+    }
+
+    if (commandLineArguments.startupThreads < 0) {
+        fprintf(stderr, "--startupThreads must not be negative\n");
+        return EXIT_FAILURE;
+    }
+
+    // Every thread created from here on gets the stack size.
+    if (commandLineArguments.threadStackSize < 0
+        || !threadSetStackSize(
+            (size_t) commandLineArguments.threadStackSize)) {
+        fprintf(
+            stderr,
+            "--threadStackSize is below the minimum stack size of the "
+            "system\n");
+        return EXIT_FAILURE;
+    }
+
+    if (commandLineArguments.ingestPath != NULL
+        && countListEntries(commandLineArguments.ingestPath)
+               != commandLineArguments.producerCount) {
+        fprintf(stderr, "--ingestPath needs a path for every producer\n");
+        return EXIT_FAILURE;
+    }
+
+    // Ingesting producers write whatever the input holds into space they
+    // reserve, which the spilling ring buffer doesn't hand out.
+    if (commandLineArguments.ingestPath != NULL
+        && (commandLineArguments.payloadSize != 0
+            || commandLineArguments.replayPath != NULL
+            || commandLineArguments.lingerBatchSize > 1
+            || commandLineArguments.spillDirectory != NULL
+            || commandLineArguments.fiberWorkers > 0
+            || commandLineArguments.watchdogStall != 0)) {
+        fprintf(
+            stderr,
+            "--ingestPath can't be combined with --payloadSize, "
+            "--replayPath, --lingerBatchSize, --spillDirectory, "
+            "--fiberWorkers or --watchdogStall\n");
+        return EXIT_FAILURE;
+    }
+
+    if (commandLineArguments.p99Limit != 0
+        && commandLineArguments.watchdogStall == 0) {
+        fprintf(stderr, "--p99Limit requires --watchdogStall\n");
+        return EXIT_FAILURE;
+    }
+
+    // Only the blocking and verifying consumers and the producers copying
+    // into the ring buffer report their progress.
+    if (commandLineArguments.watchdogStall != 0
+        && ((consumerConfig.mode != CONSUMER_MODE_BLOCKING
+             && consumerConfig.mode != CONSUMER_MODE_VERIFY)
+            || usePool || commandLineArguments.fiberWorkers > 0
+            || commandLineArguments.partitions != 0
+            || commandLineArguments.replayPath != NULL)) {
+        fprintf(
+            stderr,
+            "--watchdogStall requires the blocking or verify consumer mode and "
+            "can't be combined with the pool transport, --fiberWorkers, "
+            "--partitions or --replayPath\n");
+        return EXIT_FAILURE;
+    }
+
+    // The threads make no progress while they sleep between operations.
+    if (commandLineArguments.watchdogStall != 0
+        && (commandLineArguments.watchdogStall
+                <= commandLineArguments.producerSleepTime * 1000
+            || commandLineArguments.watchdogStall
+                   <= commandLineArguments.consumerSleepTime * 1000)) {
+        fprintf(
+            stderr,
+            "--watchdogStall must exceed the producer and consumer sleep "
+            "times\n");
+        return EXIT_FAILURE;
+    }
+
+    if (commandLineArguments.payloadSize < 0
+        || commandLineArguments.payloadSize > PAYLOAD_MAX_SIZE) {
+        fprintf(
+            stderr, "--payloadSize must be at most %d\n", PAYLOAD_MAX_SIZE);
+        return EXIT_FAILURE;
+    }
+
+    // Frames are only understood by consumers that either verify them or
+    // pass them on as they are.
+    if (consumerConfig.mode == CONSUMER_MODE_VERIFY
+        && producerConfig.payloadSize == 0) {
+        fprintf(stderr, "The verify consumer mode requires --payloadSize\n");
+        return EXIT_FAILURE;
+    }
+
+    if (producerConfig.payloadSize != 0
+        && ((consumerConfig.mode != CONSUMER_MODE_VERIFY
+             && consumerConfig.mode != CONSUMER_MODE_SINK
+             && consumerConfig.mode != CONSUMER_MODE_RECORD)
+            || commandLineArguments.spillDirectory != NULL)) {
+        fprintf(
+            stderr,
+            "--payloadSize requires the verify, sink or record consumer mode "
+            "and can't be combined with --spillDirectory\n");
+        return EXIT_FAILURE;
+    }
+
+    if (usePool && consumerConfig.mode != CONSUMER_MODE_VERIFY) {
+        fprintf(
+            stderr, "The pool transport requires the verify consumer mode\n");
+        return EXIT_FAILURE;
+    }
+
+    // The pool is sized for the frames a ring buffer of 16 handles holds.
+    if (usePool
+        && (commandLineArguments.ringBufferSize != 0
+            || commandLineArguments.maxRingBufferSize != 0)) {
+        fprintf(
+            stderr,
+            "The pool transport can't be combined with --ringBufferSize or "
+            "--maxRingBufferSize\n");
+        return EXIT_FAILURE;
+    }
+
+    // Only the verifying consumers read keyed frames.
+    if (commandLineArguments.partitions != 0
+        && (consumerConfig.mode != CONSUMER_MODE_VERIFY || usePool
+            || useFairness || commandLineArguments.spillDirectory != NULL
+            || commandLineArguments.maxRingBufferSize != 0
+            || commandLineArguments.replayPath != NULL)) {
+        fprintf(
+            stderr,
+            "--partitions requires the verify consumer mode and can't be "
+            "combined with the pool transport, --fairness fifo, "
+            "--spillDirectory, --maxRingBufferSize or --replayPath\n");
+        return EXIT_FAILURE;
+    }
+
+    if (commandLineArguments.maxRingBufferSize != 0
+        && commandLineArguments.fiberWorkers > 0) {
+        fprintf(
+            stderr,
+            "--maxRingBufferSize can't be combined with --fiberWorkers\n");
+        return EXIT_FAILURE;
+    }
+
+    // The fibers are stopped without draining the ring buffer.
+    if (commandLineArguments.drainDeadline > 0
+        && commandLineArguments.fiberWorkers > 0) {
+        fprintf(
+            stderr, "--drainDeadline can't be combined with --fiberWorkers\n");
+        return EXIT_FAILURE;
+    }
+
+    if (consumerConfig.mode == CONSUMER_MODE_SINK) {
+        if (consumerConfig.sinkPath == NULL) {
+            fprintf(stderr, "The sink consumer mode requires --sinkPath\n");
+            return EXIT_FAILURE;
+        }
+
+        // The sinks register the ring buffer's storage as their fixed
+        // buffer once, and resizing the ring buffer replaces the storage.
+        if (commandLineArguments.maxRingBufferSize != 0) {
+            fprintf(
+                stderr,
+                "The sink consumer mode can't be combined with "
+                "--maxRingBufferSize\n");
+            return EXIT_FAILURE;
+        }
+
+        // The sink consumers write at their stream offsets into the file, so
+        // start out with an empty one. FIFOs are left alone.
+        struct stat sinkStatus;
+        const bool  sinkExists
+            = stat(consumerConfig.sinkPath, &sinkStatus) == 0;
+
+        // FIFOs have no offsets, so the writes of several sink consumers
+        // would interleave in any order.
+        if (sinkExists && S_ISFIFO(sinkStatus.st_mode)
+            && commandLineArguments.consumerCount > 1) {
+            fprintf(
+                stderr,
+                "The sink consumer mode takes a single consumer when "
+                "--sinkPath is a FIFO\n");
+            return EXIT_FAILURE;
+        }
+
+        if (!sinkExists || S_ISREG(sinkStatus.st_mode)) {
+            FILE *sinkFile = fopen(consumerConfig.sinkPath, "wb");
+
+            if (sinkFile == NULL) {
+                fprintf(
+                    stderr,
+                    "Could not create %s\n",
+                    consumerConfig.sinkPath);
+                return EXIT_FAILURE;
+            }
+
+            fclose(sinkFile);
+        }
+    }
+
+    // Leave room for a few frames, so that producers and consumers overlap.
+    const size_t ringFrameCount = 16;
+    const size_t frameSize
+        = sizeof(PayloadFrameHeader) + producerConfig.payloadSize;
+    const size_t defaultRingBufferSize
+        = producerConfig.payloadSize == 0
+              ? 10
+              : ringFrameCount
+                    * (usePool ? sizeof(MessageHandle) : frameSize);
+    const size_t ringBufferSize
+        = commandLineArguments.ringBufferSize == 0
+              ? defaultRingBufferSize
+              : (size_t) commandLineArguments.ringBufferSize;
+    const SupervisorConfig supervisorConfig
+        = {ringBufferSize,
+           (size_t) commandLineArguments.maxRingBufferSize,
+           SUPERVISOR_INTERVAL_MILLISECONDS};
+
+    // Frames are written as records, which have to fit as a whole. Pooled
+    // frames stay in the pool, only their handles pass the ring buffer.
+    if (producerConfig.payloadSize != 0 && !usePool
+        && ringBufferSize < frameSize) {
+        fprintf(stderr, "--ringBufferSize must be at least %zu\n", frameSize);
+        return EXIT_FAILURE;
+    }
+
+    // So do the batches of lingering producers.
+    if (producerConfig.lingerBatchSize > ringBufferSize) {
+        fprintf(
+            stderr,
+            "--lingerBatchSize must be at most the ring buffer size (%zu)\n",
+            ringBufferSize);
+        return EXIT_FAILURE;
+    }
+
+    if (supervisorConfig.maxSize != 0
+        && supervisorConfig.maxSize < supervisorConfig.minSize) {
+        fprintf(
+            stderr,
+            "--maxRingBufferSize must be at least the ring buffer size\n");
+        return EXIT_FAILURE;
+    }
+
+    // Record every ring buffer operation from here on.
+    if (commandLineArguments.tracePath != NULL
+        && !traceEnable(TRACE_EVENTS_PER_THREAD)) {
+        fprintf(stderr, "Could not enable tracing.\n");
+        return EXIT_FAILURE;
+    }
+
+    Thread *             supervisor     = NULL;
+    Thread *             merger         = NULL;
+    Thread *             watchdogThread = NULL;
     Thread **            producers      = NULL;
     Thread **            consumers      = NULL;
+    Arena *              arena          = NULL;
+    WorkloadReplay *     replay         = NULL;
+    PartitionedRing *    partitions     = NULL;
+    Watchdog *           watchdog       = NULL;
     RingBuffer *         ringBuffer     = NULL;
-    const size_t         ringBufferSize = 10;
     RingBufferStatusCode statusCode
         = ringBufferCreate(ringBufferSize, &ringBuffer);
 
@@ -102,23 +915,225 @@ int main(int argc, char **argv)
         goto error;
     }
 
-    producers = calloc(commandLineArguments.producerCount, sizeof(Thread *));
+    if (useFairness) {
+        statusCode = ringBufferEnableFairness(ringBuffer);
 
-    if (producers == NULL) {
-        goto error;
+        if (RB_FAILURE(statusCode)) {
+            goto error;
+        }
     }
 
-    int threadId = 1;
+    // Have the ring buffer spill to disk rather than block the producers.
+    if (commandLineArguments.spillDirectory != NULL) {
+        const size_t highWaterMark
+            = commandLineArguments.spillHighWaterMark == 0
+                  ? ringBufferSize
+                  : (size_t) commandLineArguments.spillHighWaterMark;
 
-    for (int32_t prod = 0; prod < commandLineArguments.producerCount; ++prod) {
-        producers[prod] = producerCreate(
-            ringBuffer, commandLineArguments.producerSleepTime, threadId);
+        statusCode = ringBufferEnableSpill(
+            ringBuffer, commandLineArguments.spillDirectory, highWaterMark);
 
-        if (producers[prod] == NULL) {
+        if (RB_FAILURE(statusCode)) {
             goto error;
         }
+    }
 
-        ++threadId;
+    // Event loop consumers and fibers wait for the ring buffer's eventfds.
+    if (consumerConfig.mode == CONSUMER_MODE_EVENT_LOOP
+        || commandLineArguments.fiberWorkers > 0) {
+        statusCode = ringBufferEnableNotifications(ringBuffer);
+
+        if (RB_FAILURE(statusCode)) {
+            goto error;
+        }
+    }
+
+    // Run many logical producers and consumers on a few threads.
+    if (commandLineArguments.fiberWorkers > 0) {
+        int programExitStatus = runFibers(&commandLineArguments, ringBuffer);
+
+        if (!finishTrace(commandLineArguments.tracePath)) {
+            programExitStatus = EXIT_FAILURE;
+        }
+
+        statusCode = ringBufferFree(ringBuffer);
+
+        if (RB_FAILURE(statusCode)) {
+            fprintf(
+                stderr,
+                "Could not free ring buffer: %s\n",
+                ringBufferStatusCodeToString(statusCode));
+            return EXIT_FAILURE;
+        }
+
+        return programExitStatus;
+    }
+
+    if (consumerConfig.mode == CONSUMER_MODE_VERIFY) {
+        printf("Payload kernels: %s\n", payloadKernelNames());
+        consumerConfig.verifier = payloadVerifierCreate(
+            (size_t) commandLineArguments.producerCount,
+            (size_t) commandLineArguments.consumerCount);
+
+        if (consumerConfig.verifier == NULL) {
+            statusCode = RB_NOMEM;
+            goto error;
+        }
+    }
+
+    // The producers replay frames as they were recorded, so the recording
+    // has to be of the same frame size.
+    if (commandLineArguments.replayPath != NULL) {
+        replay = workloadReplayOpen(commandLineArguments.replayPath);
+
+        if (replay == NULL) {
+            fprintf(
+                stderr,
+                "Could not open %s for replaying.\n",
+                commandLineArguments.replayPath);
+            statusCode = RB_INVALID_ARGUMENT;
+            goto error;
+        }
+
+        if (workloadReplayMessageSize(replay)
+            != (producerConfig.payloadSize == 0 ? 0 : frameSize)) {
+            fprintf(
+                stderr,
+                "%s was recorded with another --payloadSize.\n",
+                commandLineArguments.replayPath);
+            statusCode = RB_INVALID_ARGUMENT;
+            goto error;
+        }
+
+        producerConfig.replay = replay;
+    }
+
+    if (consumerConfig.mode == CONSUMER_MODE_RECORD) {
+        consumerConfig.recorder = workloadRecorderCreate(
+            commandLineArguments.recordPath,
+            producerConfig.payloadSize == 0 ? 0 : frameSize);
+
+        if (consumerConfig.recorder == NULL) {
+            fprintf(
+                stderr,
+                "Could not create %s\n",
+                commandLineArguments.recordPath);
+            statusCode = RB_INVALID_ARGUMENT;
+            goto error;
+        }
+    }
+
+    if (consumerConfig.mode == CONSUMER_MODE_AGGREGATE) {
+        const AggregatorConfig aggregatorConfig
+            = {commandLineArguments.windowMilliseconds == 0
+                   ? AGGREGATOR_DEFAULT_WINDOW_MILLISECONDS
+                   : commandLineArguments.windowMilliseconds,
+               (size_t) commandLineArguments.slidingWindows,
+               commandLineArguments.topK == 0
+                   ? AGGREGATOR_DEFAULT_TOP_K
+                   : (size_t) commandLineArguments.topK};
+
+        statusCode = aggregatorCreate(
+            (size_t) commandLineArguments.consumerCount,
+            &aggregatorConfig,
+            &consumerConfig.aggregator);
+
+        if (RB_FAILURE(statusCode)) {
+            goto error;
+        }
+    }
+
+    // Every partition gets a ring buffer of its own, of the size given.
+    if (commandLineArguments.partitions != 0) {
+        statusCode = partitionedRingCreate(
+            (size_t) commandLineArguments.partitions,
+            ringBufferSize,
+            (size_t) commandLineArguments.consumerCount,
+            &partitions);
+
+        if (RB_FAILURE(statusCode)) {
+            goto error;
+        }
+
+        producerConfig.partitions = partitions;
+        consumerConfig.partitions = partitions;
+    }
+
+    // Preallocate the buffers along with the threads. A producer can't have
+    // more frames underway than the ring buffer and all the consumers hold,
+    // plus the one it is building.
+    if (usePool) {
+        const size_t ownerCount = (size_t) commandLineArguments.producerCount;
+        const size_t buffersPerOwner
+            = ringFrameCount
+              + (size_t) commandLineArguments.consumerCount
+                    * CONSUMER_VERIFY_BATCH_SIZE
+              + 1;
+        const size_t threadCount
+            = (size_t) commandLineArguments.producerCount
+              + (size_t) commandLineArguments.consumerCount;
+
+        arena = arenaCreate(
+            messagePoolArenaSize(ownerCount, buffersPerOwner, frameSize)
+            + threadCount * threadArenaSize());
+
+        if (arena == NULL) {
+            statusCode = RB_NOMEM;
+            goto error;
+        }
+
+        statusCode = messagePoolCreate(
+            arena,
+            ownerCount,
+            buffersPerOwner,
+            frameSize,
+            &producerConfig.pool);
+
+        if (RB_FAILURE(statusCode)) {
+            goto error;
+        }
+
+        consumerConfig.pool = producerConfig.pool;
+    }
+
+    // The producers and consumers join the watchdog as they start.
+    if (commandLineArguments.watchdogStall != 0) {
+        const int32_t interval
+            = commandLineArguments.watchdogStall / WATCHDOG_CHECKS_PER_STALL;
+        const WatchdogConfig watchdogConfig
+            = {commandLineArguments.watchdogStall,
+               interval == 0 ? 1 : interval,
+               (uint64_t) commandLineArguments.p99Limit};
+
+        statusCode = watchdogCreate(
+            ringBuffer,
+            (size_t) commandLineArguments.producerCount
+                + (size_t) commandLineArguments.consumerCount,
+            &watchdogConfig,
+            &watchdog);
+
+        if (RB_FAILURE(statusCode)) {
+            goto error;
+        }
+
+        producerConfig.watchdog = watchdog;
+        consumerConfig.watchdog = watchdog;
+    }
+
+    producers = calloc(commandLineArguments.producerCount, sizeof(Thread *));
+    producerConfig.writeCounts
+        = calloc(commandLineArguments.producerCount, sizeof(uint64_t));
+
+    if (producers == NULL || producerConfig.writeCounts == NULL) {
+        goto error;
+    }
+
+    if (commandLineArguments.ingestPath != NULL) {
+        producerConfig.ingestPaths = splitList(commandLineArguments.ingestPath);
+
+        if (producerConfig.ingestPaths == NULL) {
+            goto error;
+        }
     }
 
     consumers = calloc(commandLineArguments.consumerCount, sizeof(Thread *));
@@ -127,41 +1142,130 @@ int main(int argc, char **argv)
         goto error;
     }
 
-    for (int32_t cons = 0; cons < commandLineArguments.consumerCount; ++cons) {
-        consumers[cons] = consumerCreate(
-            ringBuffer, commandLineArguments.consumerSleepTime, threadId);
+    // Hold the producers and consumers at the start barrier until all of
+    // them exist, so that the first ones don't get a head start.
+    const StartupContext producerStartup
+        = {ringBuffer,
+           commandLineArguments.producerSleepTime,
+           1,
+           &producerConfig,
+           NULL};
+    const StartupContext consumerStartup
+        = {ringBuffer,
+           commandLineArguments.consumerSleepTime,
+           1 + commandLineArguments.producerCount,
+           NULL,
+           &consumerConfig};
+    const size_t startupThreads
+        = commandLineArguments.startupThreads == 0
+              ? 1
+              : (size_t) commandLineArguments.startupThreads;
+    struct timespec startupStart;
+    clock_gettime(CLOCK_MONOTONIC, &startupStart);
+    threadHoldStart();
+
+    if (!threadCreateParallel(
+            &producerFactory,
+            (void *) &producerStartup,
+            (size_t) commandLineArguments.producerCount,
+            startupThreads,
+            producers)
+        || !threadCreateParallel(
+            &consumerFactory,
+            (void *) &consumerStartup,
+            (size_t) commandLineArguments.consumerCount,
+            startupThreads,
+            consumers)) {
+        goto error;
+    }
+
+    threadWaitStartReady(
+        (size_t) commandLineArguments.producerCount
+        + (size_t) commandLineArguments.consumerCount);
+    const double readyAfter = millisecondsSince(&startupStart);
+    threadReleaseStart();
 
-        if (consumers[cons] == NULL) {
+    printf(
+        "Started %d producers and %d consumers in %.3f ms using %zu "
+        "threads.\n",
+        (int) commandLineArguments.producerCount,
+        (int) commandLineArguments.consumerCount,
+        readyAfter,
+        startupThreads);
+
+    int threadId = 1 + commandLineArguments.producerCount
+                   + commandLineArguments.consumerCount;
+
+    // Report the windows as they close.
+    if (consumerConfig.aggregator != NULL) {
+        merger = aggregatorMergerCreate(consumerConfig.aggregator, threadId);
+
+        if (merger == NULL) {
             goto error;
         }
 
         ++threadId;
     }
 
-    // Have the main thread wait for SIGINT to be emitted.
-    while (gSignalStatus != SIGINT) {
-        sleepThread(/* seconds */ 1);
+    // Start sizing the ring buffer to the load once it is under load.
+    if (supervisorConfig.maxSize != 0) {
+        supervisor = supervisorCreate(ringBuffer, threadId, &supervisorConfig);
+
+        if (supervisor == NULL) {
+            goto error;
+        }
+
+        ++threadId;
+    }
+
+    if (watchdog != NULL) {
+        watchdogThread = watchdogThreadCreate(watchdog, threadId);
+
+        if (watchdogThread == NULL) {
+            goto error;
+        }
+
+        ++threadId;
     }
 
+    // Have the main thread wait for SIGINT or SIGTERM to be emitted.
+    const int shutdownSignal = waitForShutdownSignal();
+
+    struct timespec shutdownStart;
+    clock_gettime(CLOCK_MONOTONIC, &shutdownStart);
+
     // When the user has pressed CTRL + C -> shutdown the threads.
-    printf("Shutdown of threads was requested.\n");
+    printf("Shutdown of threads was requested (signal %d).\n", shutdownSignal);
+
+    if (forceShutdownOnSignal()) {
+        printf("Send it again to exit without waiting.\n");
+    }
 
-    bool couldShutdownThreads = true;
+    // Stopping the producers and consumers would look like a stall.
+    int watchdogExitStatus;
 
-    // Request the producers to shut down.
-    for (int32_t prod = 0; prod < commandLineArguments.producerCount; ++prod) {
-        couldShutdownThreads = threadRequestShutdown(producers[prod]);
+    if (watchdogThread != NULL
+        && (!threadRequestShutdown(watchdogThread)
+            || !threadFree(watchdogThread, &watchdogExitStatus)
+            || watchdogExitStatus != EXIT_SUCCESS)) {
+        watchdogThread = NULL;
+        fprintf(stderr, "The watchdog failed.\n");
+        goto error;
     }
 
-    // Request the consumers to shut down.
-    for (int32_t cons = 0; cons < commandLineArguments.consumerCount; ++cons) {
-        couldShutdownThreads = threadRequestShutdown(consumers[cons]);
+    watchdogThread = NULL;
+
+    // Stop the producers first, so that nothing is written while the
+    // consumers drain the ring buffer. The supervisor goes along with them,
+    // as it may be waiting for the consumers to make room.
+    bool couldShutdownThreads
+        = requestShutdown(producers, commandLineArguments.producerCount);
+
+    if (supervisor != NULL) {
+        couldShutdownThreads &= threadRequestShutdown(supervisor);
     }
 
-    // Tell the ring buffer to shut down.
-    // This will wake all threads sleeping on the ring buffer's condition
-    // variable and tell them to shut down.
-    statusCode = ringBufferShutdown(ringBuffer);
+    statusCode = shutdownRings(ringBuffer, partitions);
 
     if (RB_FAILURE(statusCode)) {
         goto error;
@@ -172,6 +1276,67 @@ int main(int argc, char **argv)
     }
 
     int programExitStatus = EXIT_SUCCESS;
+    int supervisorExitStatus;
+
+    if (supervisor != NULL
+        && (!threadFree(supervisor, &supervisorExitStatus)
+            || supervisorExitStatus != EXIT_SUCCESS)) {
+        fprintf(stderr, "The supervisor failed.\n");
+        programExitStatus = EXIT_FAILURE;
+    }
+
+    supervisor = NULL;
+
+    const bool couldFreeProducers = freeThreads(
+        producers,
+        commandLineArguments.producerCount,
+        "Producer exited with",
+        "Could not free producer thread");
+    producers = NULL;
+
+    if (!couldFreeProducers) {
+        programExitStatus = EXIT_FAILURE;
+    }
+
+    printProducerFairness(
+        producerConfig.writeCounts, commandLineArguments.producerCount);
+
+    const double producersStoppedAfter = millisecondsSince(&shutdownStart);
+
+    // Give the consumers until the deadline to read what was accepted.
+    size_t remaining = 0;
+    statusCode
+        = partitions == NULL
+              ? ringBufferWaitDrained(
+                  ringBuffer, commandLineArguments.drainDeadline, &remaining)
+              : partitionedRingWaitDrained(
+                  partitions, commandLineArguments.drainDeadline, &remaining);
+
+    if (statusCode == RB_TIMED_OUT) {
+        fprintf(stderr, "Abandoning %zu unread bytes.\n", remaining);
+
+        // Only a deadline given promises not to lose anything.
+        if (commandLineArguments.drainDeadline > 0) {
+            programExitStatus = EXIT_FAILURE;
+        }
+    }
+    else if (RB_FAILURE(statusCode)) {
+        goto error;
+    }
+
+    const double drainedAfter = millisecondsSince(&shutdownStart);
+
+    couldShutdownThreads
+        = requestShutdown(consumers, commandLineArguments.consumerCount);
+    statusCode = shutdownRings(ringBuffer, partitions);
+
+    if (RB_FAILURE(statusCode)) {
+        goto error;
+    }
+
+    if (!couldShutdownThreads) {
+        goto error;
+    }
 
     if (!freeThreads(
             consumers,
@@ -181,11 +1346,76 @@ int main(int argc, char **argv)
         programExitStatus = EXIT_FAILURE;
     }
 
-    if (!freeThreads(
-            producers,
-            commandLineArguments.producerCount,
-            "Producer exited with",
-            "Could not free producer thread")) {
+    consumers = NULL;
+
+    const double consumersStoppedAfter = millisecondsSince(&shutdownStart);
+
+    // The consumers have stopped counting, so the window still open is
+    // complete as well.
+    int mergerExitStatus;
+
+    if (merger != NULL
+        && (!threadRequestShutdown(merger)
+            || !threadFree(merger, &mergerExitStatus)
+            || mergerExitStatus != EXIT_SUCCESS)) {
+        fprintf(stderr, "The aggregator failed.\n");
+        programExitStatus = EXIT_FAILURE;
+    }
+
+    merger = NULL;
+
+    printf(
+        "Shutdown took %.3f ms: producers stopped after %.3f ms, drained "
+        "after %.3f ms, consumers stopped after %.3f ms.\n",
+        millisecondsSince(&shutdownStart),
+        producersStoppedAfter,
+        drainedAfter,
+        consumersStoppedAfter);
+
+    // Frames abandoned at the drain deadline have never been read. They are
+    // the last frames of their producers, so they don't show up as gaps;
+    // the report only covers the frames read.
+    if (consumerConfig.verifier != NULL
+        && !payloadVerifierReport(consumerConfig.verifier)) {
+        programExitStatus = EXIT_FAILURE;
+    }
+
+    if (consumerConfig.recorder != NULL) {
+        uint64_t recordedCount;
+
+        if (workloadRecorderFree(consumerConfig.recorder, &recordedCount)) {
+            printf(
+                "Recorded %llu messages to %s.\n",
+                (unsigned long long) recordedCount,
+                commandLineArguments.recordPath);
+        }
+        else {
+            fprintf(
+                stderr,
+                "Could not record to %s\n",
+                commandLineArguments.recordPath);
+            programExitStatus = EXIT_FAILURE;
+        }
+    }
+
+    if (!finishTrace(commandLineArguments.tracePath)) {
+        programExitStatus = EXIT_FAILURE;
+    }
+
+    workloadReplayFree(replay);
+    free(producerConfig.writeCounts);
+    free((void *) producerConfig.ingestPaths);
+    payloadVerifierFree(consumerConfig.verifier);
+    aggregatorFree(consumerConfig.aggregator);
+    watchdogFree(watchdog);
+    arenaFree(arena);
+    statusCode = partitionedRingFree(partitions);
+
+    if (RB_FAILURE(statusCode)) {
+        fprintf(
+            stderr,
+            "Could not free the partitions: %s\n",
+            ringBufferStatusCodeToString(statusCode));
         programExitStatus = EXIT_FAILURE;
     }
 
@@ -202,16 +1432,57 @@ int main(int argc, char **argv)
     return programExitStatus;
 
 error:
+    // Request the shutdown before releasing the threads held at the start
+    // barrier, so that they see it as soon as they start rather than doing
+    // any work first.
+    requestShutdown(producers, commandLineArguments.producerCount);
+    requestShutdown(consumers, commandLineArguments.consumerCount);
+    threadReleaseStart();
+
+    if (ringBuffer != NULL) {
+        shutdownRings(ringBuffer, partitions);
+    }
+
+    if (watchdogThread != NULL) {
+        int watchdogExitStatus;
+        threadRequestShutdown(watchdogThread);
+        threadFree(watchdogThread, &watchdogExitStatus);
+    }
+
+    if (supervisor != NULL) {
+        int supervisorExitStatus;
+        threadRequestShutdown(supervisor);
+        ringBufferShutdown(ringBuffer);
+        threadFree(supervisor, &supervisorExitStatus);
+    }
+
     freeThreads(
         consumers,
         commandLineArguments.consumerCount,
         "Consumer exited with",
         "Could not free consumer thread");
+
+    if (merger != NULL) {
+        int mergerExitStatus;
+        threadRequestShutdown(merger);
+        threadFree(merger, &mergerExitStatus);
+    }
+
     freeThreads(
         producers,
         commandLineArguments.producerCount,
         "Producer exited with",
         "Could not free producer thread");
+    traceDisable();
+    workloadRecorderFree(consumerConfig.recorder, NULL);
+    workloadReplayFree(replay);
+    partitionedRingFree(partitions);
+    free(producerConfig.writeCounts);
+    free((void *) producerConfig.ingestPaths);
+    payloadVerifierFree(consumerConfig.verifier);
+    aggregatorFree(consumerConfig.aggregator);
+    watchdogFree(watchdog);
+    arenaFree(arena);
 
     if (RB_FAILURE(statusCode)) {
         fprintf(
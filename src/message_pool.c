@@ -0,0 +1,187 @@
+#include <stdint.h>
+
+#include "byte.h"
+#include "message_pool.h"
+
+/*!
+ * \def MESSAGE_POOL_EMPTY
+ * \brief Terminates the recycle queues.
+ **/
+#define MESSAGE_POOL_EMPTY UINT32_MAX
+
+/*!
+ * \brief The buffers of an owner.
+ *
+ * Allocated on cache lines of their own. The recycle queue is written by
+ * the consumers, the cache only by the owner, hence the padding in between.
+ **/
+typedef struct {
+    MessageHandle recycled; /*!< Atomic; the top of the recycle queue */
+    byte          padding[ARENA_ALIGNMENT - sizeof(MessageHandle)];
+    MessageHandle *cache;      /*!< Stack of free handles */
+    size_t         cacheCount; /*!< The amount of handles in `cache` */
+} MessagePoolOwner;
+
+/*!
+ * \brief Message pool implementation type.
+ **/
+typedef struct {
+    Arena *            arena;           /*!< The arena the pool lives in */
+    size_t             ownerCount;      /*!< The amount of owners */
+    size_t             buffersPerOwner; /*!< The buffers of every owner */
+    size_t             bufferStride;    /*!< The aligned size of a buffer */
+    byte *             buffers;         /*!< All the buffers */
+    MessageHandle *    next;            /*!< Links of the recycle queues */
+    MessagePoolOwner **owners;          /*!< The owners */
+} MessagePoolImpl;
+
+static MessagePoolImpl *impl(MessagePool *pool)
+{
+    return (MessagePoolImpl *) pool;
+}
+
+static MessagePool *opaque(MessagePoolImpl *pool)
+{
+    return (MessagePool *) pool;
+}
+
+size_t messagePoolArenaSize(
+    size_t ownerCount,
+    size_t buffersPerOwner,
+    size_t bufferSize)
+{
+    const size_t bufferCount = ownerCount * buffersPerOwner;
+
+    return arenaFootprint(sizeof(MessagePoolImpl))
+           + arenaFootprint(bufferCount * sizeof(MessageHandle))
+           + arenaFootprint(ownerCount * sizeof(MessagePoolOwner *))
+           + ownerCount
+                 * (arenaFootprint(sizeof(MessagePoolOwner))
+                    + arenaFootprint(buffersPerOwner * sizeof(MessageHandle)))
+           + bufferCount * arenaFootprint(bufferSize);
+}
+
+RingBufferStatusCode messagePoolCreate(
+    Arena *       arena,
+    size_t        ownerCount,
+    size_t        buffersPerOwner,
+    size_t        bufferSize,
+    MessagePool **pool)
+{
+    const size_t bufferCount = ownerCount * buffersPerOwner;
+
+    if (bufferCount == 0 || bufferSize == 0
+        || bufferCount >= MESSAGE_POOL_EMPTY) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    MessagePoolImpl *p = arenaAllocate(arena, sizeof(MessagePoolImpl));
+
+    if (p == NULL) {
+        return RB_NOMEM;
+    }
+
+    p->arena           = arena;
+    p->ownerCount      = ownerCount;
+    p->buffersPerOwner = buffersPerOwner;
+    p->bufferStride    = arenaFootprint(bufferSize);
+    p->next  = arenaAllocate(arena, bufferCount * sizeof(MessageHandle));
+    p->owners = arenaAllocate(arena, ownerCount * sizeof(MessagePoolOwner *));
+
+    if (p->next == NULL || p->owners == NULL) {
+        return RB_NOMEM;
+    }
+
+    for (size_t o = 0; o < ownerCount; ++o) {
+        MessagePoolOwner *owner
+            = arenaAllocate(arena, sizeof(MessagePoolOwner));
+
+        if (owner == NULL) {
+            return RB_NOMEM;
+        }
+
+        owner->recycled = MESSAGE_POOL_EMPTY;
+        owner->cache
+            = arenaAllocate(arena, buffersPerOwner * sizeof(MessageHandle));
+
+        if (owner->cache == NULL) {
+            return RB_NOMEM;
+        }
+
+        // Hand out the lowest handles first.
+        for (size_t b = 0; b < buffersPerOwner; ++b) {
+            owner->cache[b] = (MessageHandle) (
+                o * buffersPerOwner + buffersPerOwner - 1 - b);
+        }
+
+        owner->cacheCount = buffersPerOwner;
+        p->owners[o]      = owner;
+    }
+
+    // Last, so that the buffers of an owner are next to each other.
+    p->buffers = arenaAllocate(arena, bufferCount * p->bufferStride);
+
+    if (p->buffers == NULL) {
+        return RB_NOMEM;
+    }
+
+    *pool = opaque(p);
+    return RB_OK;
+}
+
+Arena *messagePoolArena(MessagePool *pool)
+{
+    return impl(pool)->arena;
+}
+
+bool messagePoolAcquire(
+    MessagePool *  pool,
+    size_t         ownerIndex,
+    MessageHandle *handle)
+{
+    MessagePoolImpl * p     = impl(pool);
+    MessagePoolOwner *owner = p->owners[ownerIndex];
+
+    // Take all that was recycled at once; only the owner ever takes from
+    // the queue, so there is no ABA problem.
+    if (owner->cacheCount == 0) {
+        MessageHandle recycled = __atomic_exchange_n(
+            &owner->recycled, MESSAGE_POOL_EMPTY, __ATOMIC_ACQUIRE);
+
+        while (recycled != MESSAGE_POOL_EMPTY) {
+            owner->cache[owner->cacheCount++] = recycled;
+            recycled                          = p->next[recycled];
+        }
+    }
+
+    if (owner->cacheCount == 0) {
+        return false;
+    }
+
+    *handle = owner->cache[--owner->cacheCount];
+    return true;
+}
+
+void *messagePoolData(MessagePool *pool, MessageHandle handle)
+{
+    MessagePoolImpl *p = impl(pool);
+    return p->buffers + (size_t) handle * p->bufferStride;
+}
+
+void messagePoolRecycle(MessagePool *pool, MessageHandle handle)
+{
+    MessagePoolImpl * p     = impl(pool);
+    MessagePoolOwner *owner = p->owners[handle / p->buffersPerOwner];
+    MessageHandle     top
+        = __atomic_load_n(&owner->recycled, __ATOMIC_RELAXED);
+
+    do {
+        p->next[handle] = top;
+    } while (!__atomic_compare_exchange_n(
+        &owner->recycled,
+        &top,
+        handle,
+        /* weak */ true,
+        __ATOMIC_RELEASE,
+        __ATOMIC_RELAXED));
+}
@@ -0,0 +1,604 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "partitioned_ring.h"
+
+/*!
+ * \def PARTITION_UNOWNED
+ * \brief Marks a partition that no consumer owns or holds.
+ **/
+#define PARTITION_UNOWNED SIZE_MAX
+
+/*!
+ * \brief The view of a consumer on the partitions.
+ *
+ * Only ever touched by the consumer itself, so that reading takes no lock
+ * unless the partitions have been reassigned.
+ **/
+typedef struct {
+    bool     isMember;   /*!< Whether the consumer has joined */
+    uint64_t generation; /*!< The assignment that `held` reflects */
+    size_t * held;       /*!< The partitions the consumer may read */
+    size_t   heldCount;  /*!< The amount of partitions in `held` */
+    size_t   next;       /*!< The index into `held` to read from first */
+} PartitionedRingConsumer;
+
+/*!
+ * \brief Partitioned ring implementation type.
+ **/
+typedef struct {
+    RingBuffer **           partitions;     /*!< One per partition */
+    size_t                  partitionCount; /*!< The amount of partitions */
+    size_t                  maxConsumers;   /*!< The size of `consumers` */
+    PartitionedRingConsumer *consumers;     /*!< Indexed by consumer index */
+    pthread_mutex_t         mutex;         /*!< Protects the below */
+    pthread_cond_t          dataAvailable; /*!< Idle consumers wait on it */
+    size_t *                owners;  /*!< The owner of every partition */
+    size_t *                holders; /*!< The consumer that still may be
+                                      *   processing records of every
+                                      *   partition
+                                      */
+    uint64_t generation; /*!< Atomic; bumped whenever `owners` or `holders`
+                          *   change
+                          */
+    uint64_t published;  /*!< Atomic; bumped whenever there might be
+                          *   something new to read
+                          */
+    size_t sleepers;     /*!< Atomic; consumers waiting on `dataAvailable` */
+} PartitionedRingImpl;
+
+static PartitionedRingImpl *impl(PartitionedRing *partitionedRing)
+{
+    return (PartitionedRingImpl *) partitionedRing;
+}
+
+static const PartitionedRingImpl *
+constImpl(const PartitionedRing *partitionedRing)
+{
+    return (const PartitionedRingImpl *) partitionedRing;
+}
+
+static PartitionedRing *opaque(PartitionedRingImpl *partitionedRing)
+{
+    return (PartitionedRing *) partitionedRing;
+}
+
+/*!
+ * \brief Tells the idle consumers that there might be something new.
+ * \param pr The partitioned ring; its mutex must be held if `isLocked`.
+ * \param isLocked Whether the caller holds the mutex.
+ * \return The status code.
+ *
+ * Pairs with `waitForData`: the consumers announce themselves before they
+ * look at `published` for the last time, and this function bumps
+ * `published` before it looks for consumers, so that either the consumer
+ * sees the bump or this function sees the consumer.
+ **/
+static RingBufferStatusCode publish(PartitionedRingImpl *pr, bool isLocked)
+{
+    __atomic_add_fetch(&pr->published, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&pr->sleepers, __ATOMIC_SEQ_CST) == 0) {
+        return RB_OK;
+    }
+
+    if (!isLocked && pthread_mutex_lock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    const bool couldWake = pthread_cond_broadcast(&pr->dataAvailable) == 0;
+
+    if (!isLocked && pthread_mutex_unlock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return couldWake ? RB_OK : RB_FAILURE_TO_SIGNAL_CONDVAR;
+}
+
+/*!
+ * \brief Spreads the partitions over the consumers that have joined.
+ * \param pr The partitioned ring; its mutex must be held.
+ * \return The status code.
+ *
+ * The holders are left alone; every consumer hands over the partitions it
+ * lost on its own once it comes back for more, see `syncAssignment`.
+ **/
+static RingBufferStatusCode rebalance(PartitionedRingImpl *pr)
+{
+    size_t memberCount = 0;
+
+    for (size_t c = 0; c < pr->maxConsumers; ++c) {
+        memberCount += pr->consumers[c].isMember ? 1 : 0;
+    }
+
+    // Round robin over the members, in the order of their indices.
+    size_t member = 0;
+
+    for (size_t p = 0; p < pr->partitionCount; ++p) {
+        pr->owners[p] = PARTITION_UNOWNED;
+
+        if (memberCount == 0) {
+            continue;
+        }
+
+        size_t rank = p % memberCount;
+
+        for (size_t c = 0; c < pr->maxConsumers; ++c) {
+            if (pr->consumers[c].isMember && rank-- == 0) {
+                member = c;
+                break;
+            }
+        }
+
+        pr->owners[p] = member;
+    }
+
+    __atomic_add_fetch(&pr->generation, 1, __ATOMIC_RELEASE);
+    return publish(pr, /* isLocked */ true);
+}
+
+/*!
+ * \brief Brings the view of a consumer up to date with the assignment.
+ * \param pr The partitioned ring; its mutex must be held.
+ * \param consumerIndex The consumer.
+ * \return The status code.
+ *
+ * Hands the partitions the consumer lost to their new owners and takes
+ * over the ones it gained, unless their previous owner still holds them.
+ **/
+static RingBufferStatusCode
+syncAssignment(PartitionedRingImpl *pr, size_t consumerIndex)
+{
+    PartitionedRingConsumer *consumer  = &pr->consumers[consumerIndex];
+    bool                     handedOff = false;
+
+    consumer->heldCount = 0;
+
+    for (size_t p = 0; p < pr->partitionCount; ++p) {
+        if (pr->holders[p] == consumerIndex
+            && pr->owners[p] != consumerIndex) {
+            pr->holders[p] = PARTITION_UNOWNED;
+            handedOff      = true;
+        }
+
+        if (pr->owners[p] == consumerIndex
+            && pr->holders[p] == PARTITION_UNOWNED) {
+            pr->holders[p] = consumerIndex;
+        }
+
+        if (pr->holders[p] == consumerIndex) {
+            consumer->held[consumer->heldCount++] = p;
+        }
+    }
+
+    if (consumer->next >= consumer->heldCount) {
+        consumer->next = 0;
+    }
+
+    // Wake the new owners, which may be waiting for the handover.
+    if (handedOff) {
+        __atomic_add_fetch(&pr->generation, 1, __ATOMIC_RELEASE);
+    }
+
+    consumer->generation
+        = __atomic_load_n(&pr->generation, __ATOMIC_RELAXED);
+    return handedOff ? publish(pr, /* isLocked */ true) : RB_OK;
+}
+
+/*!
+ * \brief Waits until there might be something new for a consumer.
+ * \param pr The partitioned ring.
+ * \param consumerIndex The consumer.
+ * \param published The value of `published` before the consumer found
+ *                  nothing to read.
+ * \param self The consumer thread.
+ * \return The status code; RB_THREAD_SHOULD_SHUTDOWN if `self` should shut
+ *         down.
+ **/
+static RingBufferStatusCode waitForData(
+    PartitionedRingImpl *pr,
+    size_t               consumerIndex,
+    uint64_t             published,
+    Thread *             self)
+{
+    const PartitionedRingConsumer *consumer = &pr->consumers[consumerIndex];
+
+    if (pthread_mutex_lock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    RingBufferStatusCode statusCode = RB_OK;
+    __atomic_add_fetch(&pr->sleepers, 1, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&pr->published, __ATOMIC_SEQ_CST) == published
+           && __atomic_load_n(&pr->generation, __ATOMIC_RELAXED)
+                  == consumer->generation) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            statusCode = RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            statusCode = RB_THREAD_SHOULD_SHUTDOWN;
+            break;
+        }
+
+        if (pthread_cond_wait(&pr->dataAvailable, &pr->mutex) != 0) {
+            statusCode = RB_FAILURE_TO_WAIT_ON_CONDVAR;
+            break;
+        }
+    }
+
+    __atomic_sub_fetch(&pr->sleepers, 1, __ATOMIC_SEQ_CST);
+
+    if (pthread_mutex_unlock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return statusCode;
+}
+
+RingBufferStatusCode partitionedRingCreate(
+    size_t            partitionCount,
+    size_t            partitionSize,
+    size_t            maxConsumers,
+    PartitionedRing **partitionedRing)
+{
+    if (partitionCount == 0 || maxConsumers == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    PartitionedRingImpl *pr = calloc(1, sizeof(PartitionedRingImpl));
+
+    if (pr == NULL) {
+        return RB_NOMEM;
+    }
+
+    RingBufferStatusCode statusCode = RB_NOMEM;
+    pr->partitionCount              = partitionCount;
+    pr->maxConsumers                = maxConsumers;
+    pr->generation                  = 1;
+    pr->partitions = calloc(partitionCount, sizeof(RingBuffer *));
+    pr->owners     = malloc(partitionCount * sizeof(size_t));
+    pr->holders    = malloc(partitionCount * sizeof(size_t));
+    pr->consumers  = calloc(maxConsumers, sizeof(PartitionedRingConsumer));
+
+    if (pr->partitions == NULL || pr->owners == NULL || pr->holders == NULL
+        || pr->consumers == NULL) {
+        goto errorFree;
+    }
+
+    for (size_t p = 0; p < partitionCount; ++p) {
+        pr->owners[p]  = PARTITION_UNOWNED;
+        pr->holders[p] = PARTITION_UNOWNED;
+    }
+
+    for (size_t c = 0; c < maxConsumers; ++c) {
+        pr->consumers[c].held = malloc(partitionCount * sizeof(size_t));
+
+        if (pr->consumers[c].held == NULL) {
+            goto errorFree;
+        }
+    }
+
+    for (size_t p = 0; p < partitionCount; ++p) {
+        statusCode = ringBufferCreate(partitionSize, &pr->partitions[p]);
+
+        if (RB_FAILURE(statusCode)) {
+            goto errorFree;
+        }
+    }
+
+    statusCode = RB_FAILURE_TO_INIT_MUTEX;
+
+    if (pthread_mutex_init(&pr->mutex, NULL) != 0) {
+        goto errorFree;
+    }
+
+    statusCode = RB_FAILURE_TO_INIT_CONDVAR;
+
+    if (pthread_cond_init(&pr->dataAvailable, NULL) != 0) {
+        goto errorDestroyMutex;
+    }
+
+    *partitionedRing = opaque(pr);
+    return RB_OK;
+
+errorDestroyMutex:
+    pthread_mutex_destroy(&pr->mutex);
+errorFree:
+    for (size_t p = 0; pr->partitions != NULL && p < partitionCount; ++p) {
+        ringBufferFree(pr->partitions[p]);
+    }
+
+    for (size_t c = 0; pr->consumers != NULL && c < maxConsumers; ++c) {
+        free(pr->consumers[c].held);
+    }
+
+    free(pr->consumers);
+    free(pr->holders);
+    free(pr->owners);
+    free(pr->partitions);
+    free(pr);
+    return statusCode;
+}
+
+RingBufferStatusCode partitionedRingFree(PartitionedRing *partitionedRing)
+{
+    PartitionedRingImpl *pr = impl(partitionedRing);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (pr == NULL) {
+        return RB_OK;
+    }
+
+    RingBufferStatusCode statusCode = RB_OK;
+
+    for (size_t p = 0; p < pr->partitionCount; ++p) {
+        const RingBufferStatusCode partitionStatusCode
+            = ringBufferFree(pr->partitions[p]);
+
+        if (RB_FAILURE(partitionStatusCode)) {
+            statusCode = partitionStatusCode;
+        }
+    }
+
+    for (size_t c = 0; c < pr->maxConsumers; ++c) {
+        free(pr->consumers[c].held);
+    }
+
+    if (pthread_cond_destroy(&pr->dataAvailable) != 0) {
+        statusCode = RB_FAILURE_TO_DESTROY_CONDVAR;
+    }
+
+    if (pthread_mutex_destroy(&pr->mutex) != 0) {
+        statusCode = RB_FAILURE_TO_DESTROY_MUTEX;
+    }
+
+    free(pr->consumers);
+    free(pr->holders);
+    free(pr->owners);
+    free(pr->partitions);
+    free(pr);
+    return statusCode;
+}
+
+size_t partitionedRingPartitionOf(
+    const PartitionedRing *partitionedRing,
+    uint64_t               key)
+{
+    // The finalizer of SplitMix64, so that keys that only differ in a few
+    // bits, e.g. consecutive IDs, still spread evenly.
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9u;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBu;
+    key ^= key >> 31;
+    return (size_t) (key % constImpl(partitionedRing)->partitionCount);
+}
+
+RingBufferStatusCode partitionedRingWrite(
+    PartitionedRing *partitionedRing,
+    uint64_t         key,
+    const byte *     source,
+    size_t           byteCount,
+    int              threadId,
+    Thread *         self)
+{
+    PartitionedRingImpl *      pr = impl(partitionedRing);
+    const RingBufferStatusCode statusCode = ringBufferWriteRecord(
+        pr->partitions[partitionedRingPartitionOf(partitionedRing, key)],
+        source,
+        byteCount,
+        threadId,
+        self);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    return publish(pr, /* isLocked */ false);
+}
+
+RingBufferStatusCode partitionedRingJoin(
+    PartitionedRing *partitionedRing,
+    size_t *         consumerIndex)
+{
+    PartitionedRingImpl *pr = impl(partitionedRing);
+
+    if (pthread_mutex_lock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    RingBufferStatusCode statusCode = RB_INVALID_ARGUMENT;
+
+    for (size_t c = 0; c < pr->maxConsumers; ++c) {
+        if (!pr->consumers[c].isMember) {
+            pr->consumers[c].isMember   = true;
+            pr->consumers[c].generation = 0;
+            pr->consumers[c].heldCount  = 0;
+            *consumerIndex              = c;
+            statusCode                  = rebalance(pr);
+            break;
+        }
+    }
+
+    if (pthread_mutex_unlock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return statusCode;
+}
+
+RingBufferStatusCode partitionedRingLeave(
+    PartitionedRing *partitionedRing,
+    size_t           consumerIndex)
+{
+    PartitionedRingImpl *pr = impl(partitionedRing);
+
+    if (pthread_mutex_lock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // Nothing is being processed anymore, so let go of everything at once.
+    for (size_t p = 0; p < pr->partitionCount; ++p) {
+        if (pr->holders[p] == consumerIndex) {
+            pr->holders[p] = PARTITION_UNOWNED;
+        }
+    }
+
+    pr->consumers[consumerIndex].isMember = false;
+    const RingBufferStatusCode statusCode = rebalance(pr);
+
+    if (pthread_mutex_unlock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return statusCode;
+}
+
+RingBufferStatusCode partitionedRingRead(
+    PartitionedRing *partitionedRing,
+    size_t           consumerIndex,
+    byte *           destination,
+    size_t           recordSize,
+    size_t           maxRecords,
+    size_t *         recordsRead,
+    int              threadId,
+    Thread *         self)
+{
+    PartitionedRingImpl *    pr       = impl(partitionedRing);
+    PartitionedRingConsumer *consumer = &pr->consumers[consumerIndex];
+
+    for (;;) {
+        // Only lock if the partitions have been reassigned in the meantime.
+        if (__atomic_load_n(&pr->generation, __ATOMIC_ACQUIRE)
+            != consumer->generation) {
+            if (pthread_mutex_lock(&pr->mutex) != 0) {
+                return RB_FAILURE_TO_LOCK_MUTEX;
+            }
+
+            const RingBufferStatusCode statusCode
+                = syncAssignment(pr, consumerIndex);
+
+            if (pthread_mutex_unlock(&pr->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            if (RB_FAILURE(statusCode)) {
+                return statusCode;
+            }
+        }
+
+        const uint64_t published
+            = __atomic_load_n(&pr->published, __ATOMIC_SEQ_CST);
+
+        // Start after the partition read last, so that a busy partition
+        // doesn't starve the others.
+        for (size_t i = 0; i < consumer->heldCount; ++i) {
+            const size_t index = (consumer->next + i) % consumer->heldCount;
+            const RingBufferStatusCode statusCode = ringBufferTryReadRecords(
+                pr->partitions[consumer->held[index]],
+                destination,
+                recordSize,
+                maxRecords,
+                recordsRead,
+                threadId);
+
+            if (RB_FAILURE(statusCode)) {
+                return statusCode;
+            }
+
+            if (*recordsRead != 0) {
+                consumer->next = (index + 1) % consumer->heldCount;
+                return RB_OK;
+            }
+        }
+
+        const RingBufferStatusCode statusCode
+            = waitForData(pr, consumerIndex, published, self);
+
+        if (RB_FAILURE(statusCode)) {
+            return statusCode;
+        }
+    }
+}
+
+RingBufferStatusCode partitionedRingWaitDrained(
+    PartitionedRing *partitionedRing,
+    int32_t          timeoutMilliseconds,
+    size_t *         remaining)
+{
+    PartitionedRingImpl *pr = impl(partitionedRing);
+    struct timespec      start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    RingBufferStatusCode statusCode = RB_OK;
+    *remaining                      = 0;
+
+    // One after the other, each with what is left of the timeout.
+    for (size_t p = 0; p < pr->partitionCount; ++p) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        const int64_t elapsedMilliseconds
+            = (int64_t) (now.tv_sec - start.tv_sec) * 1000
+              + (now.tv_nsec - start.tv_nsec) / 1000000;
+        const int32_t leftMilliseconds
+            = elapsedMilliseconds >= timeoutMilliseconds
+                  ? 0
+                  : (int32_t) (timeoutMilliseconds - elapsedMilliseconds);
+        size_t                     partitionRemaining;
+        const RingBufferStatusCode partitionStatusCode
+            = ringBufferWaitDrained(
+                pr->partitions[p], leftMilliseconds, &partitionRemaining);
+
+        if (partitionStatusCode == RB_TIMED_OUT) {
+            statusCode = RB_TIMED_OUT;
+        }
+        else if (RB_FAILURE(partitionStatusCode)) {
+            return partitionStatusCode;
+        }
+
+        *remaining += partitionRemaining;
+    }
+
+    return statusCode;
+}
+
+RingBufferStatusCode partitionedRingShutdown(PartitionedRing *partitionedRing)
+{
+    PartitionedRingImpl *pr = impl(partitionedRing);
+
+    // Wakes the writers waiting for space.
+    for (size_t p = 0; p < pr->partitionCount; ++p) {
+        const RingBufferStatusCode statusCode
+            = ringBufferShutdown(pr->partitions[p]);
+
+        if (RB_FAILURE(statusCode)) {
+            return statusCode;
+        }
+    }
+
+    // Taking the mutex makes sure that no consumer is between checking its
+    // shutdown state and going to sleep.
+    if (pthread_mutex_lock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    const bool couldWake = pthread_cond_broadcast(&pr->dataAvailable) == 0;
+
+    if (pthread_mutex_unlock(&pr->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return couldWake ? RB_OK : RB_FAILURE_TO_SIGNAL_CONDVAR;
+}
@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "payload.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PAYLOAD_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+/*!
+ * \def PAYLOAD_ALPHABET_SIZE
+ * \brief The amount of letters in the alphabet.
+ **/
+#define PAYLOAD_ALPHABET_SIZE 26
+
+/*!
+ * \brief The alphabet followed by as much of it again as a vector load
+ *        starting at any letter needs.
+ **/
+static const byte alphabetPattern[PAYLOAD_ALPHABET_SIZE + 32]
+    = "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdef";
+
+/*!
+ * \brief Turning off this bit of a lower case letter yields upper case.
+ **/
+static const byte lowerCaseBit = 0x20;
+
+typedef void (*FillKernel)(byte *, size_t, size_t, bool);
+typedef uint32_t (*Crc32cKernel)(uint32_t, const byte *, size_t);
+
+static FillKernel   fillKernel;
+static Crc32cKernel crc32cKernel;
+static char         kernelNames[64];
+static uint32_t     crc32cTable[256];
+
+/*!
+ * \brief Fills byte by byte.
+ * \param destination The buffer to fill.
+ * \param size The size of `destination`.
+ * \param letter The index of the first letter.
+ * \param upperCase true for upper case letters.
+ **/
+static void
+fillScalar(byte *destination, size_t size, size_t letter, bool upperCase)
+{
+    const byte mask = upperCase ? (byte) ~lowerCaseBit : (byte) 0xFF;
+
+    for (size_t i = 0; i < size; ++i) {
+        destination[i] = alphabetPattern[letter] & mask;
+
+        if (++letter == PAYLOAD_ALPHABET_SIZE) {
+            letter = 0;
+        }
+    }
+}
+
+#ifdef PAYLOAD_HAVE_X86_KERNELS
+/*!
+ * \brief Fills 16 bytes at a time.
+ * \param destination The buffer to fill.
+ * \param size The size of `destination`.
+ * \param letter The index of the first letter.
+ * \param upperCase true for upper case letters.
+ **/
+__attribute__((target("sse2"))) static void
+fillSse2(byte *destination, size_t size, size_t letter, bool upperCase)
+{
+    const __m128i mask
+        = _mm_set1_epi8((char) (upperCase ? ~lowerCaseBit : 0xFF));
+
+    for (; size >= 16; size -= 16, destination += 16) {
+        const __m128i letters
+            = _mm_loadu_si128((const __m128i *) &alphabetPattern[letter]);
+        _mm_storeu_si128(
+            (__m128i *) destination, _mm_and_si128(letters, mask));
+        letter = (letter + 16) % PAYLOAD_ALPHABET_SIZE;
+    }
+
+    fillScalar(destination, size, letter, upperCase);
+}
+
+/*!
+ * \brief Fills 32 bytes at a time.
+ * \param destination The buffer to fill.
+ * \param size The size of `destination`.
+ * \param letter The index of the first letter.
+ * \param upperCase true for upper case letters.
+ **/
+__attribute__((target("avx2"))) static void
+fillAvx2(byte *destination, size_t size, size_t letter, bool upperCase)
+{
+    const __m256i mask
+        = _mm256_set1_epi8((char) (upperCase ? ~lowerCaseBit : 0xFF));
+
+    for (; size >= 32; size -= 32, destination += 32) {
+        const __m256i letters
+            = _mm256_loadu_si256((const __m256i *) &alphabetPattern[letter]);
+        _mm256_storeu_si256(
+            (__m256i *) destination, _mm256_and_si256(letters, mask));
+        letter = (letter + 32) % PAYLOAD_ALPHABET_SIZE;
+    }
+
+    fillScalar(destination, size, letter, upperCase);
+}
+
+/*!
+ * \brief Computes CRC32C using the crc32 instruction, 8 bytes at a time.
+ * \param crc The CRC so far.
+ * \param data The bytes.
+ * \param size The amount of bytes.
+ * \return The CRC including `data`.
+ **/
+__attribute__((target("sse4.2"))) static uint32_t
+crc32cSse42(uint32_t crc, const byte *data, size_t size)
+{
+    crc = ~crc;
+
+#ifdef __x86_64__
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = (uint32_t) _mm_crc32_u64(crc, word);
+    }
+#endif
+
+    for (; size >= 4; size -= 4, data += 4) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+
+    for (; size > 0; --size, ++data) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+
+    return ~crc;
+}
+#endif
+
+/*!
+ * \brief Computes CRC32C a byte at a time using a table.
+ * \param crc The CRC so far.
+ * \param data The bytes.
+ * \param size The amount of bytes.
+ * \return The CRC including `data`.
+ **/
+static uint32_t crc32cTableDriven(uint32_t crc, const byte *data, size_t size)
+{
+    crc = ~crc;
+
+    for (size_t i = 0; i < size; ++i) {
+        crc = crc32cTable[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+/*!
+ * \brief Picks the kernels for the CPU we're running on.
+ **/
+static void selectKernels(void)
+{
+    // The reflected Castagnoli polynomial.
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t entry = i;
+
+        for (int bit = 0; bit < 8; ++bit) {
+            entry = (entry & 1u) != 0 ? (entry >> 1) ^ 0x82F63B78u
+                                      : entry >> 1;
+        }
+
+        crc32cTable[i] = entry;
+    }
+
+    const char *fillName   = "scalar";
+    const char *crc32cName = "table";
+    fillKernel             = &fillScalar;
+    crc32cKernel           = &crc32cTableDriven;
+
+#ifdef PAYLOAD_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        fillName   = "avx2";
+        fillKernel = &fillAvx2;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        fillName   = "sse2";
+        fillKernel = &fillSse2;
+    }
+
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32cName   = "sse4.2";
+        crc32cKernel = &crc32cSse42;
+    }
+#endif
+
+    snprintf(
+        kernelNames,
+        sizeof(kernelNames),
+        "fill: %s, crc32c: %s",
+        fillName,
+        crc32cName);
+}
+
+static pthread_once_t kernelsSelected = PTHREAD_ONCE_INIT;
+
+void payloadFill(
+    byte *   destination,
+    size_t   size,
+    uint64_t streamOffset,
+    bool     upperCase)
+{
+    pthread_once(&kernelsSelected, &selectKernels);
+    fillKernel(
+        destination,
+        size,
+        (size_t) (streamOffset % PAYLOAD_ALPHABET_SIZE),
+        upperCase);
+}
+
+uint32_t payloadCrc32c(uint32_t crc, const byte *data, size_t size)
+{
+    pthread_once(&kernelsSelected, &selectKernels);
+    return crc32cKernel(crc, data, size);
+}
+
+const char *payloadKernelNames(void)
+{
+    pthread_once(&kernelsSelected, &selectKernels);
+    return kernelNames;
+}
+
+void payloadBuildFrame(
+    byte *   frame,
+    size_t   payloadSize,
+    int      producerId,
+    uint64_t sequence)
+{
+    byte *const payload = frame + sizeof(PayloadFrameHeader);
+
+    // Continue the producer's stream of letters where the last frame ended.
+    // If the producer ID is an odd number use upper case letters.
+    payloadFill(
+        payload, payloadSize, sequence * payloadSize, (producerId & 1) != 0);
+
+    PayloadFrameHeader header;
+    header.magic      = PAYLOAD_FRAME_MAGIC;
+    header.producerId = (uint32_t) producerId;
+    header.sequence   = sequence;
+    header.length     = (uint32_t) payloadSize;
+    header.crc        = payloadCrc32c(0, payload, payloadSize);
+    memcpy(frame, &header, sizeof(header));
+}
+
+/*!
+ * \brief Counters of a consumer about a producer.
+ **/
+typedef struct {
+    uint64_t received;     /*!< Frames received */
+    uint64_t nextSequence; /*!< One past the highest sequence number seen */
+    uint64_t reordered;    /*!< Frames older than one received before */
+} PayloadProducerCounters;
+
+/*!
+ * \brief Counters of a consumer.
+ **/
+typedef struct {
+    PayloadProducerCounters *producers; /*!< Indexed by producer ID - 1 */
+    uint64_t                 corrupted; /*!< Frames failing the checks */
+} PayloadConsumerCounters;
+
+/*!
+ * \brief Payload verifier implementation type.
+ **/
+typedef struct {
+    size_t                   producerCount; /*!< The amount of producers */
+    size_t                   consumerCount; /*!< The amount of consumers */
+    size_t                   attachedCount; /*!< Atomic; consumers attached */
+    PayloadConsumerCounters *consumers;     /*!< One per consumer */
+} PayloadVerifierImpl;
+
+static PayloadVerifierImpl *impl(PayloadVerifier *verifier)
+{
+    return (PayloadVerifierImpl *) verifier;
+}
+
+static PayloadVerifier *opaque(PayloadVerifierImpl *verifier)
+{
+    return (PayloadVerifier *) verifier;
+}
+
+PayloadVerifier *
+payloadVerifierCreate(size_t producerCount, size_t consumerCount)
+{
+    PayloadVerifierImpl *v = calloc(1, sizeof(PayloadVerifierImpl));
+
+    if (v == NULL) {
+        return NULL;
+    }
+
+    v->producerCount = producerCount;
+    v->consumerCount = consumerCount;
+    v->consumers     = calloc(consumerCount, sizeof(PayloadConsumerCounters));
+
+    if (v->consumers == NULL) {
+        free(v);
+        return NULL;
+    }
+
+    // Separate allocations keep the consumers off each other's cache lines.
+    for (size_t i = 0; i < consumerCount; ++i) {
+        v->consumers[i].producers
+            = calloc(producerCount, sizeof(PayloadProducerCounters));
+
+        if (v->consumers[i].producers == NULL) {
+            payloadVerifierFree(opaque(v));
+            return NULL;
+        }
+    }
+
+    return opaque(v);
+}
+
+void payloadVerifierFree(PayloadVerifier *verifier)
+{
+    PayloadVerifierImpl *v = impl(verifier);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (v == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < v->consumerCount; ++i) {
+        free(v->consumers[i].producers);
+    }
+
+    free(v->consumers);
+    free(v);
+}
+
+bool payloadVerifierAttach(PayloadVerifier *verifier, size_t *consumerIndex)
+{
+    PayloadVerifierImpl *v = impl(verifier);
+    const size_t         index
+        = __atomic_fetch_add(&v->attachedCount, 1, __ATOMIC_RELAXED);
+
+    if (index >= v->consumerCount) {
+        return false;
+    }
+
+    *consumerIndex = index;
+    return true;
+}
+
+bool payloadVerifierCheck(
+    PayloadVerifier *verifier,
+    size_t           consumerIndex,
+    const byte *     frames,
+    size_t           frameSize,
+    size_t           frameCount,
+    int              consumerId)
+{
+    PayloadVerifierImpl *    v        = impl(verifier);
+    PayloadConsumerCounters *counters = &v->consumers[consumerIndex];
+    bool                     isIntact = true;
+
+    for (size_t i = 0; i < frameCount; ++i, frames += frameSize) {
+        PayloadFrameHeader header;
+        memcpy(&header, frames, sizeof(header));
+
+        const byte *const payload = frames + sizeof(header);
+
+        if (header.magic != PAYLOAD_FRAME_MAGIC
+            || header.length != frameSize - sizeof(header)
+            || header.producerId == 0 || header.producerId > v->producerCount
+            || header.crc != payloadCrc32c(0, payload, header.length)) {
+            fprintf(
+                stderr,
+                "Consumer (tid: %d) received a corrupted frame (producer: "
+                "%u, sequence: %llu).\n",
+                consumerId,
+                header.producerId,
+                (unsigned long long) header.sequence);
+            ++counters->corrupted;
+            isIntact = false;
+            continue;
+        }
+
+        PayloadProducerCounters *producer
+            = &counters->producers[header.producerId - 1];
+        ++producer->received;
+
+        // A consumer sees the frames of a producer in the order they were
+        // written, even if other consumers take some of them.
+        if (header.sequence < producer->nextSequence) {
+            fprintf(
+                stderr,
+                "Consumer (tid: %d) received frame %llu of producer %u after "
+                "frame %llu.\n",
+                consumerId,
+                (unsigned long long) header.sequence,
+                header.producerId,
+                (unsigned long long) (producer->nextSequence - 1));
+            ++producer->reordered;
+            isIntact = false;
+            continue;
+        }
+
+        producer->nextSequence = header.sequence + 1;
+    }
+
+    return isIntact;
+}
+
+bool payloadVerifierReport(PayloadVerifier *verifier)
+{
+    PayloadVerifierImpl *v = impl(verifier);
+
+    uint64_t totalReceived   = 0;
+    uint64_t totalLost       = 0;
+    uint64_t totalDuplicated = 0;
+    uint64_t totalReordered  = 0;
+    uint64_t totalCorrupted  = 0;
+
+    for (size_t c = 0; c < v->consumerCount; ++c) {
+        totalCorrupted += v->consumers[c].corrupted;
+    }
+
+    for (size_t p = 0; p < v->producerCount; ++p) {
+        uint64_t received     = 0;
+        uint64_t nextSequence = 0;
+        uint64_t reordered    = 0;
+
+        for (size_t c = 0; c < v->consumerCount; ++c) {
+            const PayloadProducerCounters *counters
+                = &v->consumers[c].producers[p];
+            received += counters->received;
+            reordered += counters->reordered;
+
+            if (counters->nextSequence > nextSequence) {
+                nextSequence = counters->nextSequence;
+            }
+        }
+
+        // Every frame up to the newest one seen should have arrived exactly
+        // once; frames still in the ring buffer are all newer than that.
+        const uint64_t lost
+            = received < nextSequence ? nextSequence - received : 0;
+        const uint64_t duplicated
+            = received > nextSequence ? received - nextSequence : 0;
+
+        if (lost != 0 || duplicated != 0) {
+            fprintf(
+                stderr,
+                "Producer %zu: %llu frames lost, %llu duplicated.\n",
+                p + 1,
+                (unsigned long long) lost,
+                (unsigned long long) duplicated);
+        }
+
+        totalReceived += received;
+        totalLost += lost;
+        totalDuplicated += duplicated;
+        totalReordered += reordered;
+    }
+
+    printf(
+        "Verified %llu frames: %llu lost, %llu duplicated, %llu reordered, "
+        "%llu corrupted (%s).\n",
+        (unsigned long long) totalReceived,
+        (unsigned long long) totalLost,
+        (unsigned long long) totalDuplicated,
+        (unsigned long long) totalReordered,
+        (unsigned long long) totalCorrupted,
+        payloadKernelNames());
+
+    return totalLost == 0 && totalDuplicated == 0 && totalReordered == 0
+           && totalCorrupted == 0;
+}
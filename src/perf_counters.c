@@ -0,0 +1,216 @@
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perf_counters.h"
+
+/*!
+ * \brief Perf counters implementation type.
+ **/
+typedef struct {
+    int fds[PERF_COUNTER_COUNT]; /*!< One per counter; -1 if unavailable */
+} PerfCountersImpl;
+
+static PerfCountersImpl *impl(PerfCounters *counters)
+{
+    return (PerfCountersImpl *) counters;
+}
+
+static PerfCounters *opaque(PerfCountersImpl *counters)
+{
+    return (PerfCounters *) counters;
+}
+
+#ifdef __linux__
+/*!
+ * \brief Opens a single counter.
+ * \param type The PERF_TYPE_* of the counter.
+ * \param config The PERF_COUNT_* of the counter.
+ * \return The file descriptor on success; otherwise -1.
+ *
+ * The counters are opened one by one rather than as a group, as a group
+ * can't be read across inherited threads and fails as a whole if a single
+ * counter is missing, as is common in virtual machines.
+ * Counts the kernel too, as that's where contended mutexes end up waiting,
+ * unless `perf_event_paranoid` only permits counting user space.
+ **/
+static int openCounter(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attribute;
+    memset(&attribute, 0, sizeof(attribute));
+
+    attribute.size        = sizeof(attribute);
+    attribute.type        = type;
+    attribute.config      = config;
+    attribute.disabled    = 1;
+    attribute.inherit     = 1;
+    attribute.exclude_hv  = 1;
+    attribute.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    for (;;) {
+        const int fd = (int) syscall(
+            SYS_perf_event_open,
+            &attribute,
+            /* pid: the calling thread */ 0,
+            /* cpu: any */ -1,
+            /* groupFd */ -1,
+            /* flags */ 0UL);
+
+        if (fd != -1 || (errno != EACCES && errno != EPERM)
+            || attribute.exclude_kernel) {
+            return fd;
+        }
+
+        attribute.exclude_kernel = 1;
+    }
+}
+#endif
+
+PerfCounters *perfCountersCreate(void)
+{
+    PerfCountersImpl *c = malloc(sizeof(PerfCountersImpl));
+
+    if (c == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        c->fds[i] = -1;
+    }
+
+#ifdef __linux__
+    c->fds[PERF_COUNTER_CYCLES]
+        = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    c->fds[PERF_COUNTER_INSTRUCTIONS]
+        = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    c->fds[PERF_COUNTER_CACHE_MISSES]
+        = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    c->fds[PERF_COUNTER_BRANCH_MISSES]
+        = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    c->fds[PERF_COUNTER_CONTEXT_SWITCHES]
+        = openCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+#endif
+
+    return opaque(c);
+}
+
+void perfCountersFree(PerfCounters *counters)
+{
+    PerfCountersImpl *c = impl(counters);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (c == NULL) {
+        return;
+    }
+
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (c->fds[i] != -1) {
+            close(c->fds[i]);
+        }
+    }
+#endif
+
+    free(c);
+}
+
+void perfCountersStart(PerfCounters *counters)
+{
+#ifdef __linux__
+    PerfCountersImpl *c = impl(counters);
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (c->fds[i] != -1) {
+            ioctl(c->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(c->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void) counters;
+#endif
+}
+
+void perfCountersStop(PerfCounters *counters)
+{
+#ifdef __linux__
+    PerfCountersImpl *c = impl(counters);
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (c->fds[i] != -1) {
+            ioctl(c->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#else
+    (void) counters;
+#endif
+}
+
+bool perfCountersRead(
+    PerfCounters *counters,
+    PerfCounter   counter,
+    uint64_t *    value)
+{
+#ifdef __linux__
+    PerfCountersImpl *c = impl(counters);
+
+    if (c->fds[counter] == -1) {
+        return false;
+    }
+
+    // The value, the time enabled and the time running.
+    uint64_t values[3];
+
+    if (read(c->fds[counter], values, sizeof(values))
+        != (ssize_t) sizeof(values)) {
+        return false;
+    }
+
+    // Never scheduled, e.g. because other counters took the hardware.
+    if (values[2] == 0) {
+        return false;
+    }
+
+    *value = values[2] == values[1]
+                 ? values[0]
+                 : (uint64_t) ((double) values[0] * (double) values[1]
+                               / (double) values[2]);
+    return true;
+#else
+    (void) counters;
+    (void) counter;
+    (void) value;
+    return false;
+#endif
+}
+
+const char *perfCounterName(PerfCounter counter)
+{
+    switch (counter) {
+    case PERF_COUNTER_CYCLES:
+        return "cycles";
+    case PERF_COUNTER_INSTRUCTIONS:
+        return "instructions";
+    case PERF_COUNTER_CACHE_MISSES:
+        return "cache-misses";
+    case PERF_COUNTER_BRANCH_MISSES:
+        return "branch-misses";
+    case PERF_COUNTER_CONTEXT_SWITCHES:
+        return "context-switches";
+    default:
+        break;
+    }
+
+    return "unknown";
+}
@@ -1,12 +1,48 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "byte.h"
+#ifndef _WIN32
+#include "ingest.h"
+#endif
+#include "payload.h"
 #include "producer.h"
 #include "ring_buffer.h"
 #include "sleep_thread.h"
 
+/*!
+ * \def PRODUCER_REPLAY_POLL_NANOSECONDS
+ * \brief The longest a replaying producer sleeps before it looks at its
+ *        shutdown state again.
+ **/
+#define PRODUCER_REPLAY_POLL_NANOSECONDS 100000000u
+
+/*!
+ * \def PRODUCER_INGEST_CHUNK_SIZE
+ * \brief The most bytes an ingesting producer reads into the ring buffer at
+ *        once.
+ **/
+#define PRODUCER_INGEST_CHUNK_SIZE ((size_t) 64 * 1024)
+
+/*!
+ * \def PRODUCER_INGEST_POLL_MILLISECONDS
+ * \brief The longest an ingesting producer waits for input before it looks
+ *        at its shutdown state again.
+ **/
+#define PRODUCER_INGEST_POLL_MILLISECONDS 100
+
+/*!
+ * \brief The (lower case) English alphabet, which the producers write.
+ **/
+static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz";
+
+/*!
+ * \brief The amount of letters in `alphabet`.
+ **/
+static const size_t alphabetSize = sizeof(alphabet) - 1;
+
 /*!
  * \brief Converts a character to its upper case variant.
  * \param character The character to get the upper case variant of.
@@ -20,12 +56,25 @@ static char toUpper(char character)
     return (char) uc;
 }
 
+/*!
+ * \brief Counts writes of a producer.
+ * \param config The configuration of the producer.
+ * \param id The thread ID of the producer.
+ * \param count The amount of bytes or frames written.
+ **/
+static void countWrite(const ProducerConfig *config, int id, size_t count)
+{
+    if (config->writeCounts != NULL) {
+        config->writeCounts[id - 1] += count;
+    }
+}
+
 /*!
  * \brief The thread function for the producers.
  * \param ringBuffer The ring buffer to write to.
  * \param sleepTimeSeconds The count of seconds to sleep for every iteration.
  * \param id The thread ID.
- * \param self The thread itself.
+ * \param self The thread itself; its context is the `ProducerConfig`.
  **/
 static int producerThreadFunction(
     RingBuffer *ringBuffer,
@@ -33,11 +82,14 @@ static int producerThreadFunction(
     int         id,
     Thread *    self)
 {
-    // The (lower case) English alphabet.
-    static const char   alphabet[]   = "abcdefghijklmnopqrstuvwxyz";
-    static const size_t alphabetSize = sizeof(alphabet) - 1;
+    const ProducerConfig *config = threadContext(self);
+    size_t                index  = 0;
+    size_t                slot;
 
-    size_t index = 0;
+    if (RB_FAILURE(watchdogJoin(
+            config->watchdog, WATCHDOG_ROLE_PRODUCER, id, &slot))) {
+        return EXIT_FAILURE;
+    }
 
     for (;;) {
         bool       shouldShutdown;
@@ -58,6 +110,7 @@ static int producerThreadFunction(
         const byte byteToWrite
             = (id & 1) == 0 ? alphabet[index] : toUpper(alphabet[index]);
 
+        watchdogWaiting(config->watchdog, slot);
         const RingBufferStatusCode statusCode
             = ringBufferWrite(ringBuffer, byteToWrite, id, self);
 
@@ -73,6 +126,8 @@ static int producerThreadFunction(
             return EXIT_FAILURE;
         }
 
+        watchdogBeat(config->watchdog, slot);
+        countWrite(config, id, 1);
         printf("Producer (tid: %d) just wrote %c.\n", id, byteToWrite);
 
         sleepThread(sleepTimeSeconds);
@@ -87,8 +142,704 @@ static int producerThreadFunction(
     return EXIT_SUCCESS;
 }
 
-Thread *producerCreate(RingBuffer *ringBuffer, int32_t sleepTimeSeconds, int id)
+/*!
+ * \brief Writes the bytes collected by a lingering producer at once.
+ * \param ringBuffer The ring buffer to write to.
+ * \param config The configuration of the producer.
+ * \param batch The bytes collected.
+ * \param batchCount The amount of bytes in `batch`; 0 once written.
+ * \param slot The watchdog slot of the producer.
+ * \param id The thread ID.
+ * \param self The thread itself; NULL to wait for space regardless of any
+ *             shutdown.
+ * \return The status code.
+ **/
+static RingBufferStatusCode flushBatch(
+    RingBuffer *          ringBuffer,
+    const ProducerConfig *config,
+    const byte *          batch,
+    size_t *              batchCount,
+    size_t                slot,
+    int                   id,
+    Thread *              self)
+{
+    watchdogWaiting(config->watchdog, slot);
+    const RingBufferStatusCode statusCode
+        = ringBufferWriteRecord(ringBuffer, batch, *batchCount, id, self);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    watchdogBeat(config->watchdog, slot);
+    countWrite(config, id, *batchCount);
+    printf(
+        "Producer (tid: %d) just wrote %zu bytes: %.*s.\n",
+        id,
+        *batchCount,
+        (int) *batchCount,
+        (const char *) batch);
+    *batchCount = 0;
+    return RB_OK;
+}
+
+/*!
+ * \brief The thread function for the producers collecting bytes into
+ *        batches.
+ * \param ringBuffer The ring buffer to write to.
+ * \param sleepTimeSeconds The count of seconds to sleep for every byte.
+ * \param id The thread ID.
+ * \param self The thread itself; its context is the `ProducerConfig`.
+ *
+ * Writes the same bytes as `producerThreadFunction`, but only once
+ * `lingerBatchSize` of them have been collected or the first of them has
+ * waited for `lingerMilliseconds`, taking the ring buffer's mutex once per
+ * batch rather than once per byte. Batches are written as records, so the
+ * bytes of a batch stay together. What has been collected when the
+ * producer shuts down is still written.
+ **/
+static int lingeringProducerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    const ProducerConfig *config = threadContext(self);
+    const uint64_t        linger
+        = (uint64_t) config->lingerMilliseconds * 1000000u;
+    byte *   batch      = malloc(config->lingerBatchSize);
+    size_t   batchCount = 0;
+    uint64_t deadline   = 0;
+    size_t   index      = 0;
+    size_t   slot;
+
+    if (batch == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    if (RB_FAILURE(watchdogJoin(
+            config->watchdog, WATCHDOG_ROLE_PRODUCER, id, &slot))) {
+        free(batch);
+        return EXIT_FAILURE;
+    }
+
+    int                  exitStatus = EXIT_SUCCESS;
+    RingBufferStatusCode statusCode = RB_OK;
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        batch[batchCount] = (id & 1) == 0 ? alphabet[index]
+                                          : toUpper(alphabet[index]);
+
+        if (++batchCount == 1) {
+            deadline = workloadNanoseconds() + linger;
+        }
+
+        if (++index == alphabetSize) {
+            index = 0;
+        }
+
+        if (batchCount == config->lingerBatchSize
+            || workloadNanoseconds() >= deadline) {
+            statusCode = flushBatch(
+                ringBuffer, config, batch, &batchCount, slot, id, self);
+        }
+
+        // Don't sleep past the linger time of the bytes collected.
+        if (statusCode == RB_OK && sleepTimeSeconds > 0) {
+            const uint64_t wakeUp
+                = workloadNanoseconds()
+                  + (uint64_t) sleepTimeSeconds * 1000000000u;
+
+            if (batchCount != 0 && deadline < wakeUp) {
+                workloadSleepUntil(deadline);
+                statusCode = flushBatch(
+                    ringBuffer, config, batch, &batchCount, slot, id, self);
+            }
+
+            workloadSleepUntil(wakeUp);
+        }
+
+        // The batch is written once the loop is left.
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            break;
+        }
+
+        if (RB_FAILURE(statusCode)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    // Write what's left rather than lose it. The consumers keep reading
+    // until the producers have stopped, so the space will come.
+    if (exitStatus == EXIT_SUCCESS && batchCount != 0
+        && RB_FAILURE(flushBatch(
+            ringBuffer, config, batch, &batchCount, slot, id, NULL))) {
+        exitStatus = EXIT_FAILURE;
+    }
+
+    free(batch);
+    return exitStatus;
+}
+
+/*!
+ * \brief The thread function for the producers writing frames.
+ * \param ringBuffer The ring buffer to write to.
+ * \param sleepTimeSeconds The count of seconds to sleep for every frame.
+ * \param id The thread ID.
+ * \param self The thread itself; its context is the `ProducerConfig`.
+ **/
+static int framedProducerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    const ProducerConfig *config    = threadContext(self);
+    const size_t          frameSize = sizeof(PayloadFrameHeader)
+                                      + config->payloadSize;
+    byte * frame = malloc(frameSize);
+    size_t slot;
+
+    if (frame == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    if (RB_FAILURE(watchdogJoin(
+            config->watchdog, WATCHDOG_ROLE_PRODUCER, id, &slot))) {
+        free(frame);
+        return EXIT_FAILURE;
+    }
+
+    int exitStatus = EXIT_SUCCESS;
+
+    for (uint64_t sequence = 0;; ++sequence) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        payloadBuildFrame(frame, config->payloadSize, id, sequence);
+
+        // Keyed by producer, so that every producer's frames stay in order.
+        watchdogWaiting(config->watchdog, slot);
+        const RingBufferStatusCode statusCode
+            = config->partitions == NULL
+                  ? ringBufferWriteRecord(
+                      ringBuffer, frame, frameSize, id, self)
+                  : partitionedRingWrite(
+                      config->partitions,
+                      (uint64_t) id,
+                      frame,
+                      frameSize,
+                      id,
+                      self);
+
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            break;
+        }
+
+        if (RB_FAILURE(statusCode)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        watchdogBeat(config->watchdog, slot);
+        countWrite(config, id, 1);
+        printf(
+            "Producer (tid: %d) just wrote frame %llu.\n",
+            id,
+            (unsigned long long) sequence);
+
+        sleepThread(sleepTimeSeconds);
+    }
+
+    free(frame);
+    return exitStatus;
+}
+
+/*!
+ * \brief The thread function for the producers building frames in pooled
+ *        buffers.
+ * \param ringBuffer The ring buffer to write the handles to.
+ * \param sleepTimeSeconds The count of seconds to sleep for every frame.
+ * \param id The thread ID.
+ * \param self The thread itself; its context is the `ProducerConfig`.
+ **/
+static int pooledProducerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    const ProducerConfig *config     = threadContext(self);
+    const size_t          ownerIndex = (size_t) id - 1;
+
+    for (uint64_t sequence = 0;; ++sequence) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            return EXIT_FAILURE;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        // The pool is sized to cover every buffer the ring buffer and the
+        // consumers can hold, so running dry is a bug.
+        MessageHandle handle;
+
+        if (!messagePoolAcquire(config->pool, ownerIndex, &handle)) {
+            fprintf(stderr, "Producer (tid: %d) ran out of buffers.\n", id);
+            return EXIT_FAILURE;
+        }
+
+        payloadBuildFrame(
+            messagePoolData(config->pool, handle),
+            config->payloadSize,
+            id,
+            sequence);
+
+        const RingBufferStatusCode statusCode = ringBufferWriteRecord(
+            ringBuffer, (const byte *) &handle, sizeof(handle), id, self);
+
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            messagePoolRecycle(config->pool, handle);
+            break;
+        }
+
+        if (RB_FAILURE(statusCode)) {
+            messagePoolRecycle(config->pool, handle);
+            return EXIT_FAILURE;
+        }
+
+        countWrite(config, id, 1);
+        printf(
+            "Producer (tid: %d) just passed frame %llu.\n",
+            id,
+            (unsigned long long) sequence);
+
+        sleepThread(sleepTimeSeconds);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Waits until a replayed message is due.
+ * \param dueNanoseconds When the message is due.
+ * \param self The thread.
+ * \param shouldShutdown Output parameter; true if the thread should shut
+ *                       down rather than write the message.
+ * \return true on success; false if the shutdown state couldn't be
+ *         determined.
+ **/
+static bool
+waitUntilDue(uint64_t dueNanoseconds, Thread *self, bool *shouldShutdown)
+{
+    for (;;) {
+        if (!threadShouldShutdown(self, shouldShutdown)) {
+            return false;
+        }
+
+        const uint64_t now = workloadNanoseconds();
+
+        if (*shouldShutdown || now >= dueNanoseconds) {
+            return true;
+        }
+
+        workloadSleepUntil(
+            dueNanoseconds - now > PRODUCER_REPLAY_POLL_NANOSECONDS
+                ? now + PRODUCER_REPLAY_POLL_NANOSECONDS
+                : dueNanoseconds);
+    }
+}
+
+/*!
+ * \brief The thread function for the producers replaying a recorded
+ *        workload.
+ * \param ringBuffer The ring buffer to write to.
+ * \param sleepTimeSeconds Unused; the recording has the timing.
+ * \param id The thread ID.
+ * \param self The thread itself; its context is the `ProducerConfig`.
+ *
+ * Frames are renumbered as the producer's own, so that verifying consumers
+ * can tell every replaying producer apart. Once the workload has been
+ * replayed the producer exits.
+ **/
+static int replayProducerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) sleepTimeSeconds;
+
+    const ProducerConfig *config      = threadContext(self);
+    const size_t          messageSize = workloadReplayMessageSize(
+        config->replay);
+    byte *frame = NULL;
+
+    if (messageSize != 0) {
+        frame = malloc(messageSize);
+
+        if (frame == NULL) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    int            exitStatus = EXIT_SUCCESS;
+    uint64_t       sequence   = 0;
+    const uint64_t start      = workloadNanoseconds();
+    WorkloadCursor cursor;
+    const byte *   message;
+    workloadCursorRewind(&cursor);
+
+    while (workloadReplayNext(config->replay, &cursor, &message)) {
+        const uint64_t due
+            = config->replaySpeed == 0
+                  ? start
+                  : start + cursor.offsetNanoseconds / config->replaySpeed;
+        bool shouldShutdown;
+
+        if (!waitUntilDue(due, self, &shouldShutdown)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        RingBufferStatusCode statusCode;
+
+        if (frame == NULL) {
+            statusCode = ringBufferWrite(ringBuffer, *message, id, self);
+        }
+        else {
+            PayloadFrameHeader header;
+            memcpy(frame, message, messageSize);
+            memcpy(&header, frame, sizeof(header));
+            header.producerId = (uint32_t) id;
+            header.sequence   = sequence;
+            memcpy(frame, &header, sizeof(header));
+            statusCode = ringBufferWriteRecord(
+                ringBuffer, frame, messageSize, id, self);
+        }
+
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            break;
+        }
+
+        if (RB_FAILURE(statusCode)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        countWrite(config, id, 1);
+        ++sequence;
+    }
+
+    printf(
+        "Producer (tid: %d) replayed %llu messages.\n",
+        id,
+        (unsigned long long) sequence);
+    free(frame);
+    return exitStatus;
+}
+
+#ifndef _WIN32
+/*!
+ * \brief Reads a chunk of input right into the ring buffer.
+ * \param ringBuffer The ring buffer to write to.
+ * \param source The input.
+ * \param id The thread ID.
+ * \param self The thread.
+ * \param bytesRead Output parameter for the amount of bytes read; 0 once
+ *                  the end of the input has been reached.
+ * \param couldRead Output parameter; false if reading the input failed.
+ * \return The status code.
+ **/
+static RingBufferStatusCode ingestChunk(
+    RingBuffer *  ringBuffer,
+    IngestSource *source,
+    int           id,
+    Thread *      self,
+    size_t *      bytesRead,
+    bool *        couldRead)
+{
+    RingBufferWriteReservation reservation;
+    RingBufferStatusCode       statusCode = ringBufferAcquireWrite(
+        ringBuffer, PRODUCER_INGEST_CHUNK_SIZE, &reservation, id, self);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    // The input is ready, so the ring buffer is only held for the copy.
+    *couldRead = ingestSourceRead(
+        source, reservation.data, reservation.size, bytesRead);
+
+    if (!*couldRead) {
+        *bytesRead = 0;
+    }
+
+    return ringBufferCommitWrite(ringBuffer, &reservation, *bytesRead, id);
+}
+
+/*!
+ * \brief The thread function for the producers streaming input into the
+ *        ring buffer.
+ * \param ringBuffer The ring buffer to write to.
+ * \param sleepTimeSeconds Unused; the input has the pace.
+ * \param id The thread ID.
+ * \param self The thread itself; its context is the `ProducerConfig`.
+ *
+ * Reads its input in chunks of up to PRODUCER_INGEST_CHUNK_SIZE bytes
+ * straight into space reserved in the ring buffer, rather than through a
+ * buffer of its own. Only waits for the ring buffer once input is ready, so
+ * that an idle pipe doesn't keep the other producers from writing. Once the
+ * end of the input has been reached the producer exits.
+ **/
+static int ingestProducerThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) sleepTimeSeconds;
+
+    const ProducerConfig *config = threadContext(self);
+    const char *const     path   = config->ingestPaths[id - 1];
+    IngestSource *const   source = ingestSourceOpen(path);
+
+    if (source == NULL) {
+        fprintf(stderr, "Producer (tid: %d) could not open %s.\n", id, path);
+        return EXIT_FAILURE;
+    }
+
+    int      exitStatus = EXIT_SUCCESS;
+    uint64_t total      = 0;
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        bool isReady;
+
+        if (!ingestSourceWait(
+                source, PRODUCER_INGEST_POLL_MILLISECONDS, &isReady)) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        if (!isReady) {
+            continue;
+        }
+
+        size_t                     bytesRead;
+        bool                       couldRead  = true;
+        const RingBufferStatusCode statusCode = ingestChunk(
+            ringBuffer, source, id, self, &bytesRead, &couldRead);
+
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            break;
+        }
+
+        if (RB_FAILURE(statusCode) || !couldRead) {
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        if (bytesRead == 0) {
+            break;
+        }
+
+        countWrite(config, id, bytesRead);
+        total += bytesRead;
+        printf("Producer (tid: %d) ingested %zu bytes.\n", id, bytesRead);
+    }
+
+    printf(
+        "Producer (tid: %d) ingested %llu bytes from %s%s.\n",
+        id,
+        (unsigned long long) total,
+        path,
+        ingestSourceIsMapped(source) ? " (mapped)" : "");
+
+    if (!ingestSourceFree(source)) {
+        exitStatus = EXIT_FAILURE;
+    }
+
+    return exitStatus;
+}
+#endif
+
+/*!
+ * \brief The fiber function for the producers.
+ * \param ringBuffer The ring buffer to write to.
+ * \param sleepTimeSeconds The count of seconds to sleep for every iteration.
+ * \param id The fiber ID.
+ * \param self The fiber itself.
+ **/
+static int producerFiberFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Fiber *     self)
+{
+#ifndef _WIN32
+    const int writableFd = ringBufferWritableFd(ringBuffer);
+
+    if (writableFd == -1) {
+        return EXIT_FAILURE;
+    }
+
+    size_t index = 0;
+
+    while (!fiberShouldShutdown(self)) {
+        // If the fiber ID is an odd number use upper case letters.
+        const byte byteToWrite
+            = (id & 1) == 0 ? alphabet[index] : toUpper(alphabet[index]);
+
+        size_t                     bytesWritten;
+        const RingBufferStatusCode statusCode = ringBufferTryWrite(
+            ringBuffer, &byteToWrite, 1, &bytesWritten, id);
+
+        if (RB_FAILURE(statusCode)) {
+            return EXIT_FAILURE;
+        }
+
+        // The ring buffer is full -> let the others run until it isn't.
+        if (bytesWritten == 0) {
+            fiberWait(self, writableFd);
+            continue;
+        }
+
+        printf("Producer (tid: %d) just wrote %c.\n", id, byteToWrite);
+
+        fiberSleep(self, sleepTimeSeconds);
+
+        ++index;
+
+        if (index == alphabetSize) {
+            index = 0;
+        }
+    }
+
+    return EXIT_SUCCESS;
+#else
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    (void) self;
+    return EXIT_FAILURE;
+#endif
+}
+
+Thread *producerCreate(
+    RingBuffer *          ringBuffer,
+    int32_t               sleepTimeSeconds,
+    int                   id,
+    const ProducerConfig *config)
+{
+    if (config->replay != NULL) {
+        return threadCreateWithContext(
+            &replayProducerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config);
+    }
+
+#ifndef _WIN32
+    if (config->ingestPaths != NULL) {
+        return threadCreateWithContext(
+            &ingestProducerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config);
+    }
+#endif
+
+    // Pooled producers keep their bookkeeping next to their buffers.
+    if (config->pool != NULL) {
+        return threadCreateInArena(
+            &pooledProducerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config,
+            messagePoolArena(config->pool));
+    }
+
+    if (config->payloadSize != 0) {
+        return threadCreateWithContext(
+            &framedProducerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config);
+    }
+
+    if (config->lingerBatchSize > 1) {
+        return threadCreateWithContext(
+            &lingeringProducerThreadFunction,
+            ringBuffer,
+            sleepTimeSeconds,
+            id,
+            (void *) config);
+    }
+
+    return threadCreateWithContext(
+        &producerThreadFunction,
+        ringBuffer,
+        sleepTimeSeconds,
+        id,
+        (void *) config);
+}
+
+bool producerSpawn(
+    FiberScheduler *scheduler,
+    RingBuffer *    ringBuffer,
+    int32_t         sleepTimeSeconds,
+    int             id)
 {
-    return threadCreate(
-        &producerThreadFunction, ringBuffer, sleepTimeSeconds, id);
+#ifndef _WIN32
+    return fiberSpawn(
+        scheduler, &producerFiberFunction, ringBuffer, sleepTimeSeconds, id);
+#else
+    (void) scheduler;
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    return false;
+#endif
 }
@@ -0,0 +1,456 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "request_channel.h"
+
+/*!
+ * \brief The header in front of every request in the ring buffer.
+ **/
+typedef struct {
+    RequestTicket ticket; /*!< Where to send the reply */
+    uint32_t      size;   /*!< The size of the request in bytes */
+    uint32_t      unused; /*!< Pads the header to 8 byte alignment */
+} RequestChannelHeader;
+
+/*!
+ * \brief The reply slot of a requester.
+ **/
+typedef struct {
+    uint32_t answered;  /*!< Atomic; the sequence of the last reply */
+    uint32_t isWaiting; /*!< Atomic; whether the requester blocks */
+    uint32_t sequence;  /*!< The sequence of the last request; only touched
+                         *   by the requester
+                         */
+    bool            isAttached; /*!< Protected by the channel's mutex */
+    size_t          replySize;  /*!< The size of `reply` in bytes */
+    byte *          reply;      /*!< The reply; maxReplySize bytes */
+    byte *          record;     /*!< Where requests are built */
+    pthread_mutex_t mutex;      /*!< Protects waiting on `answeredCv` */
+    pthread_cond_t  answeredCv; /*!< Signalled once `answered` changed */
+} RequestChannelSlot;
+
+/*!
+ * \brief Request channel implementation type.
+ **/
+typedef struct {
+    RingBuffer *        requests;       /*!< Carries the requests */
+    size_t              maxRequestSize; /*!< In bytes */
+    size_t              maxReplySize;   /*!< In bytes */
+    size_t              recordSize;     /*!< Header and maximum request */
+    size_t              slotCount;      /*!< The size of `slots` */
+    RequestChannelSlot *slots;          /*!< One per requester */
+    pthread_mutex_t     mutex;          /*!< Protects attaching */
+} RequestChannelImpl;
+
+static RequestChannelImpl *impl(RequestChannel *channel)
+{
+    return (RequestChannelImpl *) channel;
+}
+
+static const RequestChannelImpl *constImpl(const RequestChannel *channel)
+{
+    return (const RequestChannelImpl *) channel;
+}
+
+static RequestChannel *opaque(RequestChannelImpl *channel)
+{
+    return (RequestChannel *) channel;
+}
+
+/*!
+ * \brief Frees the reply slots created so far.
+ * \param ch The channel.
+ * \param slotCount The amount of slots whose synchronization primitives
+ *                  have been created.
+ **/
+static void freeSlots(RequestChannelImpl *ch, size_t slotCount)
+{
+    for (size_t s = 0; s < ch->slotCount; ++s) {
+        if (s < slotCount) {
+            pthread_cond_destroy(&ch->slots[s].answeredCv);
+            pthread_mutex_destroy(&ch->slots[s].mutex);
+        }
+
+        free(ch->slots[s].reply);
+        free(ch->slots[s].record);
+    }
+
+    free(ch->slots);
+}
+
+RingBufferStatusCode requestChannelCreate(
+    size_t           ringBufferSize,
+    size_t           maxRequesters,
+    size_t           maxRequestSize,
+    size_t           maxReplySize,
+    RequestChannel **channel)
+{
+    const size_t recordSize = sizeof(RequestChannelHeader) + maxRequestSize;
+
+    if (maxRequesters == 0 || maxRequesters > UINT32_MAX
+        || maxRequestSize > UINT32_MAX || ringBufferSize < recordSize) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    RequestChannelImpl *ch = malloc(sizeof(RequestChannelImpl));
+
+    if (ch == NULL) {
+        return RB_NOMEM;
+    }
+
+    ch->maxRequestSize = maxRequestSize;
+    ch->maxReplySize   = maxReplySize;
+    ch->recordSize     = recordSize;
+    ch->slotCount      = maxRequesters;
+    ch->slots          = calloc(maxRequesters, sizeof(RequestChannelSlot));
+
+    if (ch->slots == NULL) {
+        free(ch);
+        return RB_NOMEM;
+    }
+
+    RingBufferStatusCode statusCode  = RB_OK;
+    size_t               initialized = 0;
+
+    for (; initialized < maxRequesters; ++initialized) {
+        RequestChannelSlot *slot = &ch->slots[initialized];
+        slot->reply  = malloc(maxReplySize == 0 ? 1 : maxReplySize);
+        slot->record = malloc(recordSize);
+
+        if (slot->reply == NULL || slot->record == NULL) {
+            statusCode = RB_NOMEM;
+            break;
+        }
+
+        if (pthread_mutex_init(&slot->mutex, NULL) != 0) {
+            statusCode = RB_FAILURE_TO_INIT_MUTEX;
+            break;
+        }
+
+        if (pthread_cond_init(&slot->answeredCv, NULL) != 0) {
+            pthread_mutex_destroy(&slot->mutex);
+            statusCode = RB_FAILURE_TO_INIT_CONDVAR;
+            break;
+        }
+    }
+
+    if (RB_FAILURE(statusCode)) {
+        goto errorFreeSlots;
+    }
+
+    if (pthread_mutex_init(&ch->mutex, NULL) != 0) {
+        statusCode = RB_FAILURE_TO_INIT_MUTEX;
+        goto errorFreeSlots;
+    }
+
+    statusCode = ringBufferCreate(ringBufferSize, &ch->requests);
+
+    if (RB_FAILURE(statusCode)) {
+        goto errorDestroyMutex;
+    }
+
+    *channel = opaque(ch);
+    return RB_OK;
+
+errorDestroyMutex:
+    pthread_mutex_destroy(&ch->mutex);
+errorFreeSlots:
+    freeSlots(ch, initialized);
+    free(ch);
+    return statusCode;
+}
+
+RingBufferStatusCode requestChannelFree(RequestChannel *channel)
+{
+    RequestChannelImpl *ch = impl(channel);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (ch == NULL) {
+        return RB_OK;
+    }
+
+    RingBufferStatusCode statusCode = ringBufferFree(ch->requests);
+
+    if (pthread_mutex_destroy(&ch->mutex) != 0) {
+        statusCode = RB_FAILURE_TO_DESTROY_MUTEX;
+    }
+
+    freeSlots(ch, ch->slotCount);
+    free(ch);
+    return statusCode;
+}
+
+RingBufferStatusCode
+requestChannelAttach(RequestChannel *channel, uint32_t *requester)
+{
+    RequestChannelImpl *ch = impl(channel);
+
+    if (pthread_mutex_lock(&ch->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    RingBufferStatusCode statusCode = RB_INVALID_ARGUMENT;
+
+    for (size_t s = 0; s < ch->slotCount; ++s) {
+        if (!ch->slots[s].isAttached) {
+            ch->slots[s].isAttached = true;
+            *requester              = (uint32_t) s;
+            statusCode              = RB_OK;
+            break;
+        }
+    }
+
+    if (pthread_mutex_unlock(&ch->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return statusCode;
+}
+
+RingBufferStatusCode
+requestChannelDetach(RequestChannel *channel, uint32_t requester)
+{
+    RequestChannelImpl *ch = impl(channel);
+
+    if (pthread_mutex_lock(&ch->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    ch->slots[requester].isAttached = false;
+
+    if (pthread_mutex_unlock(&ch->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode requestChannelSubmit(
+    RequestChannel *channel,
+    uint32_t        requester,
+    const byte *    request,
+    size_t          size,
+    RequestTicket * ticket,
+    int             threadId,
+    Thread *        self)
+{
+    RequestChannelImpl *ch   = impl(channel);
+    RequestChannelSlot *slot = &ch->slots[requester];
+
+    if (size > ch->maxRequestSize
+        || __atomic_load_n(&slot->answered, __ATOMIC_ACQUIRE)
+               != slot->sequence) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    RequestChannelHeader header;
+    header.ticket.requester = requester;
+    header.ticket.sequence  = slot->sequence + 1;
+    header.size             = (uint32_t) size;
+    header.unused           = 0;
+
+    memcpy(slot->record, &header, sizeof(header));
+    memcpy(slot->record + sizeof(header), request, size);
+
+    const RingBufferStatusCode statusCode = ringBufferWriteRecord(
+        ch->requests, slot->record, ch->recordSize, threadId, self);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    slot->sequence = header.ticket.sequence;
+    *ticket        = header.ticket;
+    return RB_OK;
+}
+
+/*!
+ * \brief Copies a reply out of its slot.
+ * \param slot The slot; must have been answered.
+ * \param reply Where to copy the reply to.
+ * \param replySize Output parameter for the size of the reply.
+ **/
+static void
+copyReply(const RequestChannelSlot *slot, byte *reply, size_t *replySize)
+{
+    memcpy(reply, slot->reply, slot->replySize);
+    *replySize = slot->replySize;
+}
+
+RingBufferStatusCode requestChannelPoll(
+    RequestChannel *     channel,
+    const RequestTicket *ticket,
+    byte *               reply,
+    size_t *             replySize,
+    bool *               isDone)
+{
+    RequestChannelImpl *      ch   = impl(channel);
+    const RequestChannelSlot *slot = &ch->slots[ticket->requester];
+
+    // Pairs with the release in `requestChannelReply`, so that the reply is
+    // visible once `answered` is.
+    *isDone = __atomic_load_n(&slot->answered, __ATOMIC_ACQUIRE)
+              == ticket->sequence;
+
+    if (*isDone) {
+        copyReply(slot, reply, replySize);
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode requestChannelWait(
+    RequestChannel *     channel,
+    const RequestTicket *ticket,
+    byte *               reply,
+    size_t *             replySize,
+    Thread *             self)
+{
+    RequestChannelImpl *ch   = impl(channel);
+    RequestChannelSlot *slot = &ch->slots[ticket->requester];
+
+    // Answered already -> don't bother with the mutex.
+    if (__atomic_load_n(&slot->answered, __ATOMIC_ACQUIRE)
+        == ticket->sequence) {
+        copyReply(slot, reply, replySize);
+        return RB_OK;
+    }
+
+    if (pthread_mutex_lock(&slot->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // Announce the wait before looking at `answered`; the responder stores
+    // `answered` before it looks at `isWaiting`, so that one of the two
+    // sees the other.
+    RingBufferStatusCode statusCode = RB_OK;
+    __atomic_store_n(&slot->isWaiting, 1, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&slot->answered, __ATOMIC_SEQ_CST)
+           != ticket->sequence) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            statusCode = RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            statusCode = RB_THREAD_SHOULD_SHUTDOWN;
+            break;
+        }
+
+        if (pthread_cond_wait(&slot->answeredCv, &slot->mutex) != 0) {
+            statusCode = RB_FAILURE_TO_WAIT_ON_CONDVAR;
+            break;
+        }
+    }
+
+    __atomic_store_n(&slot->isWaiting, 0, __ATOMIC_RELAXED);
+
+    if (pthread_mutex_unlock(&slot->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    if (statusCode == RB_OK) {
+        copyReply(slot, reply, replySize);
+    }
+
+    return statusCode;
+}
+
+size_t requestChannelBufferSize(const RequestChannel *channel)
+{
+    return constImpl(channel)->recordSize;
+}
+
+RingBufferStatusCode requestChannelReceive(
+    RequestChannel *       channel,
+    byte *                 buffer,
+    RequestChannelRequest *request,
+    int                    threadId,
+    Thread *               self)
+{
+    RequestChannelImpl * ch = impl(channel);
+    size_t               recordsRead;
+    RequestChannelHeader header;
+
+    const RingBufferStatusCode statusCode = ringBufferReadRecords(
+        ch->requests, buffer, ch->recordSize, 1, &recordsRead, threadId, self);
+
+    if (RB_FAILURE(statusCode)) {
+        return statusCode;
+    }
+
+    memcpy(&header, buffer, sizeof(header));
+    request->ticket = header.ticket;
+    request->data   = buffer + sizeof(header);
+    request->size   = header.size;
+    return RB_OK;
+}
+
+RingBufferStatusCode requestChannelReply(
+    RequestChannel *     channel,
+    const RequestTicket *ticket,
+    const byte *         reply,
+    size_t               size)
+{
+    RequestChannelImpl *ch   = impl(channel);
+    RequestChannelSlot *slot = &ch->slots[ticket->requester];
+
+    if (size > ch->maxReplySize) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    memcpy(slot->reply, reply, size);
+    slot->replySize = size;
+    __atomic_store_n(&slot->answered, ticket->sequence, __ATOMIC_SEQ_CST);
+
+    // Polling requesters need no wake up.
+    if (__atomic_load_n(&slot->isWaiting, __ATOMIC_SEQ_CST) == 0) {
+        return RB_OK;
+    }
+
+    if (pthread_mutex_lock(&slot->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    const bool couldWake = pthread_cond_signal(&slot->answeredCv) == 0;
+
+    if (pthread_mutex_unlock(&slot->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return couldWake ? RB_OK : RB_FAILURE_TO_SIGNAL_CONDVAR;
+}
+
+RingBufferStatusCode requestChannelShutdown(RequestChannel *channel)
+{
+    RequestChannelImpl *ch = impl(channel);
+
+    // Wakes the requesters waiting for space and the responders waiting for
+    // requests.
+    RingBufferStatusCode statusCode = ringBufferShutdown(ch->requests);
+
+    // Taking the mutex makes sure that no requester is between checking its
+    // shutdown state and going to sleep.
+    for (size_t s = 0; s < ch->slotCount; ++s) {
+        RequestChannelSlot *slot = &ch->slots[s];
+
+        if (pthread_mutex_lock(&slot->mutex) != 0) {
+            return RB_FAILURE_TO_LOCK_MUTEX;
+        }
+
+        if (pthread_cond_broadcast(&slot->answeredCv) != 0) {
+            statusCode = RB_FAILURE_TO_SIGNAL_CONDVAR;
+        }
+
+        if (pthread_mutex_unlock(&slot->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+    }
+
+    return statusCode;
+}
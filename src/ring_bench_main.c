@@ -0,0 +1,1285 @@
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "arena.h"
+#include "channel_manager.h"
+#include "executor.h"
+#include "perf_counters.h"
+#include "request_channel.h"
+#include "ring_buffer.h"
+#include "thread.h"
+#include "typed_ring.h"
+
+/*!
+ * \def RING_BENCH_DEFAULT_ITERATIONS
+ * \brief The amount of operations measured per benchmark if none is given.
+ **/
+#define RING_BENCH_DEFAULT_ITERATIONS 1000000
+
+/*!
+ * \def RING_BENCH_DEFAULT_WRITERS
+ * \brief The amount of writers of the contended benchmark if none is given.
+ **/
+#define RING_BENCH_DEFAULT_WRITERS 4
+
+/*!
+ * \def RING_BENCH_MAX_THREADS
+ * \brief The maximum amount of threads of a benchmark.
+ **/
+#define RING_BENCH_MAX_THREADS 64
+
+/*!
+ * \def RING_BENCH_BATCH_SIZE
+ * \brief The amount of bytes the batching writers collect per write.
+ **/
+#define RING_BENCH_BATCH_SIZE 16
+
+/*!
+ * \def RING_BENCH_STREAM_CHUNK_SIZE
+ * \brief The amount of bytes the streaming benchmark reserves and acquires
+ *        at once.
+ **/
+#define RING_BENCH_STREAM_CHUNK_SIZE ((size_t) 4096)
+
+/*!
+ * \def RING_BENCH_REQUEST_RING_SIZE
+ * \brief The size of the request ring of the request/reply benchmarks.
+ **/
+#define RING_BENCH_REQUEST_RING_SIZE 64
+
+/*!
+ * \def RING_BENCH_CHANNEL_COUNT
+ * \brief The amount of channels of the channel benchmark.
+ **/
+#define RING_BENCH_CHANNEL_COUNT 1024
+
+/*!
+ * \def RING_BENCH_CHANNEL_CHUNK_SIZE
+ * \brief The chunk size, and quota, of every channel of the channel
+ *        benchmark.
+ **/
+#define RING_BENCH_CHANNEL_CHUNK_SIZE 64
+
+/*!
+ * \def RING_BENCH_EXECUTOR_QUEUE_CAPACITY
+ * \brief The amount of tasks the submission queue of the executor benchmark
+ *        holds.
+ **/
+#define RING_BENCH_EXECUTOR_QUEUE_CAPACITY 256
+
+/*!
+ * \brief The ring specialized at compile time to compare with `RingBuffer`.
+ **/
+DEFINE_RING(BenchRing, byte, 64);
+
+/*!
+ * \brief What a benchmark needs set up for its threads.
+ **/
+typedef enum {
+    BENCH_FORWARD_RING    = 0x01, /*!< `forward` */
+    BENCH_BACKWARD_RING   = 0x02, /*!< `backward` */
+    BENCH_TYPED_RINGS     = 0x04, /*!< `typedForward` and `typedBackward` */
+    BENCH_REQUEST_CHANNEL = 0x08, /*!< `channel` */
+    BENCH_CHANNELS        = 0x10, /*!< `channels` and `channelIds` */
+    BENCH_EXECUTOR        = 0x20  /*!< `executor` */
+} BenchResource;
+
+/*!
+ * \brief What the threads of a benchmark share.
+ **/
+typedef struct {
+    RingBuffer *    forward;       /*!< Written by the first role */
+    RingBuffer *    backward;      /*!< Written back by the second role */
+    BenchRing       typedForward;  /*!< `forward` for the typed benchmarks */
+    BenchRing       typedBackward; /*!< `backward` for the typed benchmarks */
+    bool            hasTypedRings; /*!< The typed rings are initialized */
+    RequestChannel *channel;       /*!< For the request/reply benchmarks */
+    ChannelManager *channels;      /*!< For the channel benchmark */
+    ChannelId       channelIds[RING_BENCH_CHANNEL_COUNT]; /*!< Open */
+    Executor *      executor;      /*!< For the executor benchmark */
+    size_t          perWriter;     /*!< Operations of every first role thread */
+    size_t          total;         /*!< Operations of all first role threads */
+    bool            pinThreads;    /*!< Pin thread `id` to CPU `id` */
+    ThreadFunction  first;         /*!< Run by the threads below `firstCount` */
+    ThreadFunction  second;        /*!< Run by the thread after them */
+    size_t          firstCount;    /*!< The amount of first role threads */
+    pthread_mutex_t mutex;         /*!< Protects `finishedCount` */
+    pthread_cond_t  allFinished;   /*!< Signaled as the last thread finishes */
+    size_t          finishedCount; /*!< Threads done running their role */
+} BenchContext;
+
+/*!
+ * \brief A benchmark of a ring buffer primitive.
+ **/
+typedef struct {
+    const char *   name;        /*!< Printed in the results */
+    size_t         ringSize;    /*!< The size of the ring buffers */
+    unsigned       resources;   /*!< The BenchResources to set up */
+    ThreadFunction first;       /*!< Run by the first role */
+    ThreadFunction second;      /*!< Run by the second role; may be NULL */
+    bool           manyWriters; /*!< Run the first role on `writers` threads */
+    bool           pinThreads;  /*!< Pin the threads to CPUs of their own */
+} Benchmark;
+
+/*!
+ * \brief Pins the calling thread to a CPU.
+ * \param cpu The CPU to pin to.
+ *
+ * Best effort; stays unpinned where that's not supported.
+ **/
+static void pinToCpu(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    (void) pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void) cpu;
+#endif
+}
+
+/*!
+ * \brief Writes and reads back a byte at a time on a single thread.
+ **/
+static int uncontendedFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        byte byteRead;
+
+        if (RB_FAILURE(ringBufferWrite(context->forward, 'a', id, self))
+            || RB_FAILURE(
+                ringBufferRead(context->forward, &byteRead, id, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Sends a byte and waits for it to come back.
+ **/
+static int pingFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+
+    if (context->pinThreads) {
+        pinToCpu(id);
+    }
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        byte byteRead;
+
+        if (RB_FAILURE(ringBufferWrite(context->forward, 'a', id, self))
+            || RB_FAILURE(
+                ringBufferRead(context->backward, &byteRead, id, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Sends back every byte received.
+ **/
+static int pongFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+
+    if (context->pinThreads) {
+        pinToCpu(id);
+    }
+
+    for (size_t i = 0; i < context->total; ++i) {
+        byte byteRead;
+
+        if (RB_FAILURE(ringBufferRead(context->forward, &byteRead, id, self))
+            || RB_FAILURE(
+                ringBufferWrite(context->backward, byteRead, id, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Writes a byte at a time.
+ **/
+static int writerFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        if (RB_FAILURE(ringBufferWrite(context->forward, 'a', id, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Writes RING_BENCH_BATCH_SIZE bytes at a time, like a lingering
+ *        producer whose batches fill up.
+ **/
+static int batchingWriterFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+    byte                batch[RING_BENCH_BATCH_SIZE];
+
+    memset(batch, 'a', sizeof(batch));
+
+    for (size_t i = 0; i < context->perWriter; i += RING_BENCH_BATCH_SIZE) {
+        const size_t left  = context->perWriter - i;
+        const size_t count = left < sizeof(batch) ? left : sizeof(batch);
+
+        if (RB_FAILURE(ringBufferWriteRecord(
+                context->forward, batch, count, id, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Reads everything the writers write, a byte at a time.
+ **/
+static int drainFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+
+    for (size_t i = 0; i < context->total; ++i) {
+        byte byteRead;
+
+        if (RB_FAILURE(
+                ringBufferRead(context->forward, &byteRead, id, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Writes in place, into space reserved RING_BENCH_STREAM_CHUNK_SIZE
+ *        bytes at a time, like an ingesting producer.
+ **/
+static int reservingWriterFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+
+    for (size_t i = 0; i < context->perWriter;) {
+        const size_t               left = context->perWriter - i;
+        RingBufferWriteReservation reservation;
+
+        if (RB_FAILURE(ringBufferAcquireWrite(
+                context->forward,
+                left < RING_BENCH_STREAM_CHUNK_SIZE
+                    ? left
+                    : RING_BENCH_STREAM_CHUNK_SIZE,
+                &reservation,
+                id,
+                self))) {
+            return EXIT_FAILURE;
+        }
+
+        memset(reservation.data, 'a', reservation.size);
+
+        if (RB_FAILURE(ringBufferCommitWrite(
+                context->forward, &reservation, reservation.size, id))) {
+            return EXIT_FAILURE;
+        }
+
+        i += reservation.size;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Reads in place, RING_BENCH_STREAM_CHUNK_SIZE bytes at a time.
+ **/
+static int acquiringReaderFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+
+    for (size_t i = 0; i < context->total;) {
+        RingBufferReadReservation reservation;
+
+        if (RB_FAILURE(ringBufferAcquireRead(
+                context->forward,
+                RING_BENCH_STREAM_CHUNK_SIZE,
+                &reservation,
+                id,
+                self))
+            || RB_FAILURE(
+                ringBufferReleaseRead(context->forward, &reservation, id))) {
+            return EXIT_FAILURE;
+        }
+
+        i += reservation.size;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief `uncontendedFunction` on the typed ring.
+ **/
+static int typedUncontendedFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    BenchContext *context = threadContext(self);
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        const byte toWrite = 'a';
+        byte       byteRead;
+
+        if (RB_FAILURE(BenchRingWrite(&context->typedForward, &toWrite, self))
+            || RB_FAILURE(
+                BenchRingRead(&context->typedForward, &byteRead, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief `pingFunction` on the typed rings.
+ **/
+static int typedPingFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    BenchContext *context = threadContext(self);
+
+    if (context->pinThreads) {
+        pinToCpu(id);
+    }
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        const byte toWrite = 'a';
+        byte       byteRead;
+
+        if (RB_FAILURE(BenchRingWrite(&context->typedForward, &toWrite, self))
+            || RB_FAILURE(
+                BenchRingRead(&context->typedBackward, &byteRead, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief `pongFunction` on the typed rings.
+ **/
+static int typedPongFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    BenchContext *context = threadContext(self);
+
+    if (context->pinThreads) {
+        pinToCpu(id);
+    }
+
+    for (size_t i = 0; i < context->total; ++i) {
+        byte byteRead;
+
+        if (RB_FAILURE(BenchRingRead(&context->typedForward, &byteRead, self))
+            || RB_FAILURE(
+                BenchRingWrite(&context->typedBackward, &byteRead, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Submits a request and blocks until it has been answered.
+ **/
+static int requesterFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+    uint32_t            requester;
+
+    if (context->pinThreads) {
+        pinToCpu(id);
+    }
+
+    if (RB_FAILURE(requestChannelAttach(context->channel, &requester))) {
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        const byte    request = 'a';
+        byte          reply;
+        size_t        replySize;
+        RequestTicket ticket;
+
+        if (RB_FAILURE(requestChannelSubmit(
+                context->channel, requester, &request, 1, &ticket, id, self))
+            || RB_FAILURE(requestChannelWait(
+                context->channel, &ticket, &reply, &replySize, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Submits a request and spins on its ticket until it has been
+ *        answered.
+ **/
+static int pollingRequesterFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+    uint32_t            requester;
+
+    if (context->pinThreads) {
+        pinToCpu(id);
+    }
+
+    if (RB_FAILURE(requestChannelAttach(context->channel, &requester))) {
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        const byte    request = 'a';
+        byte          reply;
+        size_t        replySize;
+        RequestTicket ticket;
+        bool          isDone = false;
+
+        if (RB_FAILURE(requestChannelSubmit(
+                context->channel, requester, &request, 1, &ticket, id, self))) {
+            return EXIT_FAILURE;
+        }
+
+        while (!isDone) {
+            if (RB_FAILURE(requestChannelPoll(
+                    context->channel, &ticket, &reply, &replySize, &isDone))) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Answers every request with the byte requested.
+ **/
+static int responderFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+    byte buffer[64];
+
+    if (context->pinThreads) {
+        pinToCpu(id);
+    }
+
+    if (requestChannelBufferSize(context->channel) > sizeof(buffer)) {
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < context->total; ++i) {
+        RequestChannelRequest request;
+
+        if (RB_FAILURE(requestChannelReceive(
+                context->channel, buffer, &request, id, self))
+            || RB_FAILURE(requestChannelReply(
+                context->channel, &request.ticket, request.data, 1))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Writes a byte at a time, to one channel after the other.
+ **/
+static int channelWriterFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    const BenchContext *context = threadContext(self);
+    const byte          value   = 'a';
+    size_t              bytesWritten;
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        if (RB_FAILURE(channelManagerWrite(
+                context->channels,
+                context->channelIds[i % RING_BENCH_CHANNEL_COUNT],
+                &value,
+                1,
+                &bytesWritten,
+                self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Reads a byte at a time, from one channel after the other.
+ **/
+static int channelReaderFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    const BenchContext *context = threadContext(self);
+
+    for (size_t i = 0; i < context->total; ++i) {
+        byte   byteRead;
+        size_t bytesRead;
+
+        if (RB_FAILURE(channelManagerRead(
+                context->channels,
+                context->channelIds[i % RING_BENCH_CHANNEL_COUNT],
+                &byteRead,
+                1,
+                &bytesRead,
+                self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Writes a byte at a time, to both rings in turn.
+ **/
+static int alternatingWriterFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context = threadContext(self);
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        RingBuffer *target = i % 2 == 0 ? context->forward : context->backward;
+
+        if (RB_FAILURE(ringBufferWrite(target, 'a', id, self))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Reads everything written to both rings, waiting on them together.
+ **/
+static int selectReaderFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    const BenchContext *context  = threadContext(self);
+    RingBufferSelector *selector = NULL;
+    int                 result   = EXIT_FAILURE;
+
+    if (RB_FAILURE(ringBufferSelectorCreate(2, &selector))) {
+        return EXIT_FAILURE;
+    }
+
+    if (RB_FAILURE(ringBufferSelectorAdd(
+            selector, context->forward, RB_SELECT_READABLE))
+        || RB_FAILURE(ringBufferSelectorAdd(
+            selector, context->backward, RB_SELECT_READABLE))) {
+        goto cleanup;
+    }
+
+    for (size_t read = 0; read < context->total;) {
+        RingBufferReady ready[2];
+        size_t          readyCount;
+
+        if (RB_FAILURE(
+                ringBufferSelect(selector, ready, 2, &readyCount, self))) {
+            goto cleanup;
+        }
+
+        for (size_t i = 0; i < readyCount; ++i) {
+            byte   buffer[64];
+            size_t bytesRead;
+
+            if (RB_FAILURE(ringBufferTryRead(
+                    ready[i].ringBuffer,
+                    buffer,
+                    sizeof(buffer),
+                    &bytesRead,
+                    id))) {
+                goto cleanup;
+            }
+
+            read += bytesRead;
+        }
+    }
+
+    result = EXIT_SUCCESS;
+
+cleanup:
+    ringBufferSelectorFree(selector);
+    return result;
+}
+
+/*!
+ * \brief A task doing nothing, so that running it costs only the overhead.
+ **/
+static void emptyTask(void *payload)
+{
+    (void) payload;
+}
+
+/*!
+ * \brief Submits a task at a time and waits for all of them to have run.
+ **/
+static int submitterFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    (void) id;
+    const BenchContext *context = threadContext(self);
+
+    for (size_t i = 0; i < context->perWriter; ++i) {
+        if (RB_FAILURE(
+                executorSubmit(context->executor, &emptyTask, NULL, 0))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return RB_FAILURE(executorWaitAll(context->executor)) ? EXIT_FAILURE
+                                                          : EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Returns the monotonic time in nanoseconds.
+ **/
+static uint64_t nowNanoseconds(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/*!
+ * \brief Prints the header of the results.
+ **/
+static void printHeader(void)
+{
+    printf("%-18s %10s %10s", "benchmark", "ops", "ns/op");
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        printf(" %16s", perfCounterName((PerfCounter) i));
+    }
+
+    printf("\n");
+}
+
+/*!
+ * \brief Runs the role of a thread and counts it finished, so that the
+ *        measurement can stop before the threads are joined.
+ **/
+static int roleFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    BenchContext *       context  = threadContext(self);
+    const ThreadFunction function = (size_t) id < context->firstCount
+                                        ? context->first
+                                        : context->second;
+    const int exitStatus = function(ringBuffer, sleepTimeSeconds, id, self);
+
+    pthread_mutex_lock(&context->mutex);
+    ++context->finishedCount;
+    pthread_cond_signal(&context->allFinished);
+    pthread_mutex_unlock(&context->mutex);
+    return exitStatus;
+}
+
+/*!
+ * \brief Sets up what a benchmark uses.
+ * \param benchmark The benchmark.
+ * \param writers The amount of writers for `manyWriters` benchmarks.
+ * \param context The context to set up; its pointers must be NULL.
+ * \param channelArena Output parameter for the arena of the channels.
+ * \return true on success; otherwise false, leaving what was set up to
+ *         `freeResources`.
+ **/
+static bool setUpResources(
+    const Benchmark *benchmark,
+    size_t           writers,
+    BenchContext *   context,
+    Arena **         channelArena)
+{
+    const unsigned resources = benchmark->resources;
+
+    if ((resources & BENCH_FORWARD_RING) != 0
+        && RB_FAILURE(
+            ringBufferCreate(benchmark->ringSize, &context->forward))) {
+        return false;
+    }
+
+    if ((resources & BENCH_BACKWARD_RING) != 0
+        && RB_FAILURE(
+            ringBufferCreate(benchmark->ringSize, &context->backward))) {
+        return false;
+    }
+
+    if ((resources & BENCH_TYPED_RINGS) != 0) {
+        if (RB_FAILURE(BenchRingInit(&context->typedForward))) {
+            return false;
+        }
+
+        if (RB_FAILURE(BenchRingInit(&context->typedBackward))) {
+            BenchRingDestroy(&context->typedForward);
+            return false;
+        }
+
+        context->hasTypedRings = true;
+    }
+
+    if ((resources & BENCH_REQUEST_CHANNEL) != 0
+        && RB_FAILURE(requestChannelCreate(
+            RING_BENCH_REQUEST_RING_SIZE,
+            /* maxRequesters */ 1,
+            /* maxRequestSize */ 1,
+            /* maxReplySize */ 1,
+            &context->channel))) {
+        return false;
+    }
+
+    if ((resources & BENCH_CHANNELS) != 0) {
+        // Every channel may hold a single chunk.
+        *channelArena = arenaCreate(channelManagerArenaSize(
+            RING_BENCH_CHANNEL_COUNT,
+            RING_BENCH_CHANNEL_COUNT,
+            RING_BENCH_CHANNEL_CHUNK_SIZE));
+
+        if (*channelArena == NULL
+            || RB_FAILURE(channelManagerCreate(
+                *channelArena,
+                RING_BENCH_CHANNEL_COUNT,
+                RING_BENCH_CHANNEL_COUNT,
+                RING_BENCH_CHANNEL_CHUNK_SIZE,
+                &context->channels))) {
+            return false;
+        }
+
+        for (size_t i = 0; i < RING_BENCH_CHANNEL_COUNT; ++i) {
+            if (RB_FAILURE(channelManagerOpen(
+                    context->channels,
+                    RING_BENCH_CHANNEL_CHUNK_SIZE,
+                    &context->channelIds[i]))) {
+                return false;
+            }
+        }
+    }
+
+    // As many workers as writers submitting to them.
+    return (resources & BENCH_EXECUTOR) == 0
+           || RB_SUCCESS(executorCreate(
+               writers,
+               RING_BENCH_EXECUTOR_QUEUE_CAPACITY,
+               &context->executor));
+}
+
+/*!
+ * \brief Shuts down what a benchmark uses, so that no thread stays blocked.
+ * \param context The context.
+ **/
+static void shutDownResources(BenchContext *context)
+{
+    if (context->forward != NULL) {
+        ringBufferShutdown(context->forward);
+    }
+
+    if (context->backward != NULL) {
+        ringBufferShutdown(context->backward);
+    }
+
+    if (context->hasTypedRings) {
+        BenchRingShutdown(&context->typedForward);
+        BenchRingShutdown(&context->typedBackward);
+    }
+
+    if (context->channel != NULL) {
+        requestChannelShutdown(context->channel);
+    }
+
+    if (context->channels != NULL) {
+        channelManagerShutdown(context->channels);
+    }
+}
+
+/*!
+ * \brief Frees what `setUpResources` set up.
+ * \param context The context.
+ * \param channelArena The arena of the channels; may be NULL.
+ **/
+static void freeResources(BenchContext *context, Arena *channelArena)
+{
+    executorFree(context->executor);
+    requestChannelFree(context->channel);
+    channelManagerDestroy(context->channels);
+    arenaFree(channelArena);
+
+    if (context->hasTypedRings) {
+        BenchRingDestroy(&context->typedBackward);
+        BenchRingDestroy(&context->typedForward);
+    }
+
+    ringBufferFree(context->backward);
+    ringBufferFree(context->forward);
+}
+
+/*!
+ * \brief Runs a benchmark and prints its results per operation.
+ * \param benchmark The benchmark to run.
+ * \param iterations The amount of operations to measure.
+ * \param writers The amount of writers for `manyWriters` benchmarks.
+ * \return true on success; otherwise false.
+ *
+ * The measured region begins once all the threads wait at the start barrier
+ * and ends once all of them have finished their role, so creating and
+ * joining them isn't measured.
+ **/
+static bool
+runBenchmark(const Benchmark *benchmark, size_t iterations, size_t writers)
+{
+    const size_t firstCount  = benchmark->manyWriters ? writers : 1;
+    const size_t secondCount = benchmark->second == NULL ? 0 : 1;
+    Thread *      threads[RING_BENCH_MAX_THREADS] = {NULL};
+    size_t        threadCount                      = 0;
+    bool          ok                               = false;
+    PerfCounters *counters                         = NULL;
+    Arena *       channelArena                     = NULL;
+    uint64_t      elapsed                          = 0;
+    BenchContext  context;
+
+    context.forward       = NULL;
+    context.backward      = NULL;
+    context.hasTypedRings = false;
+    context.channel       = NULL;
+    context.channels      = NULL;
+    context.executor      = NULL;
+    context.perWriter     = iterations / firstCount;
+    context.total         = context.perWriter * firstCount;
+    context.pinThreads    = benchmark->pinThreads;
+    context.first         = benchmark->first;
+    context.second        = benchmark->second;
+    context.firstCount    = firstCount;
+    context.finishedCount = 0;
+
+    if (pthread_mutex_init(&context.mutex, NULL) != 0) {
+        return false;
+    }
+
+    if (pthread_cond_init(&context.allFinished, NULL) != 0) {
+        pthread_mutex_destroy(&context.mutex);
+        return false;
+    }
+
+    if (!setUpResources(benchmark, writers, &context, &channelArena)) {
+        goto cleanup;
+    }
+
+    // Open the counters first, so that they count the threads created.
+    counters = perfCountersCreate();
+
+    if (counters == NULL) {
+        goto cleanup;
+    }
+
+    threadHoldStart();
+
+    for (size_t i = 0; i < firstCount + secondCount; ++i) {
+        threads[threadCount] = threadCreateWithContext(
+            &roleFunction, context.forward, 0, (int) threadCount, &context);
+
+        if (threads[threadCount] == NULL) {
+            break;
+        }
+
+        ++threadCount;
+    }
+
+    ok = threadCount == firstCount + secondCount;
+
+    if (ok) {
+        threadWaitStartReady(threadCount);
+        const uint64_t start = nowNanoseconds();
+        perfCountersStart(counters);
+        threadReleaseStart();
+
+        pthread_mutex_lock(&context.mutex);
+
+        while (context.finishedCount < threadCount) {
+            pthread_cond_wait(&context.allFinished, &context.mutex);
+        }
+
+        pthread_mutex_unlock(&context.mutex);
+
+        perfCountersStop(counters);
+        elapsed = nowNanoseconds() - start;
+    }
+    else {
+        // Don't leave threads blocked on the ring buffers if some are
+        // missing.
+        shutDownResources(&context);
+        threadReleaseStart();
+    }
+
+    for (size_t i = 0; i < threadCount; ++i) {
+        int exitStatus;
+
+        if (!threadFree(threads[i], &exitStatus)
+            || exitStatus != EXIT_SUCCESS) {
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        goto cleanup;
+    }
+
+    const double operations = (double) context.total;
+    printf(
+        "%-18s %10zu %10.1f",
+        benchmark->name,
+        context.total,
+        (double) elapsed / operations);
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        uint64_t value;
+
+        if (perfCountersRead(counters, (PerfCounter) i, &value)) {
+            printf(" %16.3f", (double) value / operations);
+        }
+        else {
+            printf(" %16s", "n/a");
+        }
+    }
+
+    printf("\n");
+
+cleanup:
+    perfCountersFree(counters);
+    freeResources(&context, channelArena);
+    pthread_cond_destroy(&context.allFinished);
+    pthread_mutex_destroy(&context.mutex);
+    return ok;
+}
+
+/*!
+ * \brief Parses a positive count.
+ * \param string The string to parse.
+ * \param count Output parameter for the count.
+ * \return true on success; otherwise false.
+ **/
+static bool parseCount(const char *string, size_t *count)
+{
+    char *              end;
+    const unsigned long value = strtoul(string, &end, 10);
+
+    if (*string == '\0' || *end != '\0' || value == 0) {
+        return false;
+    }
+
+    *count = (size_t) value;
+    return true;
+}
+
+/*!
+ * \brief Micro benchmarks of the ring buffer primitives.
+ * \param argc The count of command line arguments.
+ * \param argv The command line arguments.
+ * \return EXIT_SUCCESS on success; otherwise EXIT_FAILURE.
+ *
+ * Reports the wall clock time along with hardware and software counters per
+ * operation, so that the cost of an operation can be attributed to the
+ * mutex, the condition variable broadcasts or cache line transfers.
+ **/
+int main(int argc, char **argv)
+{
+    size_t iterations = RING_BENCH_DEFAULT_ITERATIONS;
+    size_t writers    = RING_BENCH_DEFAULT_WRITERS;
+
+    for (int index = 1; index < argc; index += 2) {
+        const char *const arg   = argv[index];
+        const char *const value = index + 1 < argc ? argv[index + 1] : "";
+        bool              ok;
+
+        if (strcmp(arg, "--iterations") == 0) {
+            ok = parseCount(value, &iterations);
+        }
+        else if (strcmp(arg, "--writers") == 0) {
+            ok = parseCount(value, &writers)
+                 && writers < RING_BENCH_MAX_THREADS;
+        }
+        else {
+            ok = false;
+        }
+
+        if (!ok) {
+            fprintf(
+                stderr,
+                "usage: %s [--iterations <count>] [--writers <count>]\n",
+                argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Ping-pong only crosses cores if there are two to pin to.
+    const bool pinThreads = sysconf(_SC_NPROCESSORS_ONLN) >= 2;
+
+    const Benchmark benchmarks[] = {
+        {"uncontended",
+         /* ringSize */ 64,
+         /* resources */ BENCH_FORWARD_RING,
+         &uncontendedFunction,
+         NULL,
+         /* manyWriters */ false,
+         /* pinThreads */ false},
+        {"ping-pong",
+         64,
+         BENCH_FORWARD_RING | BENCH_BACKWARD_RING,
+         &pingFunction,
+         &pongFunction,
+         false,
+         pinThreads},
+        {"contended",
+         1024,
+         BENCH_FORWARD_RING,
+         &writerFunction,
+         &drainFunction,
+         true,
+         false},
+        // The same writers collecting their bytes into batches first.
+        {"contended-batched",
+         1024,
+         BENCH_FORWARD_RING,
+         &batchingWriterFunction,
+         &drainFunction,
+         true,
+         false},
+        // A single writer and reader copying nothing but the bytes.
+        {"streaming",
+         64 * 1024,
+         BENCH_FORWARD_RING,
+         &reservingWriterFunction,
+         &acquiringReaderFunction,
+         false,
+         false},
+        // A ring buffer of a single byte is full or empty after every
+        // operation, so every operation wakes up the other side.
+        {"full-empty",
+         1,
+         BENCH_FORWARD_RING,
+         &writerFunction,
+         &drainFunction,
+         false,
+         false},
+        // The same on a ring specialized at compile time.
+        {"typed-uncontended",
+         64,
+         BENCH_TYPED_RINGS,
+         &typedUncontendedFunction,
+         NULL,
+         false,
+         false},
+        {"typed-ping-pong",
+         64,
+         BENCH_TYPED_RINGS,
+         &typedPingFunction,
+         &typedPongFunction,
+         false,
+         pinThreads},
+        // A round trip through the request ring and a reply slot, rather
+        // than through two rings.
+        {"request-reply",
+         64,
+         BENCH_REQUEST_CHANNEL,
+         &requesterFunction,
+         &responderFunction,
+         false,
+         pinThreads},
+        {"request-poll",
+         64,
+         BENCH_REQUEST_CHANNEL,
+         &pollingRequesterFunction,
+         &responderFunction,
+         false,
+         pinThreads},
+        // Many small channels carved out of one arena instead of a ring.
+        {"channels",
+         64,
+         BENCH_CHANNELS,
+         &channelWriterFunction,
+         &channelReaderFunction,
+         false,
+         false},
+        // One reader waiting on two rings at once.
+        {"select",
+         64,
+         BENCH_FORWARD_RING | BENCH_BACKWARD_RING,
+         &alternatingWriterFunction,
+         &selectReaderFunction,
+         false,
+         false},
+        // Empty tasks submitted to the executor one at a time, so that
+        // every operation is the overhead of a task.
+        {"executor",
+         64,
+         BENCH_EXECUTOR,
+         &submitterFunction,
+         NULL,
+         true,
+         false},
+    };
+
+    if (!pinThreads) {
+        printf("Only one CPU online; ping-pong runs unpinned.\n");
+    }
+
+    printf("Counters per operation, %zu writers contending.\n", writers);
+    printHeader();
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i) {
+        if (!runBenchmark(&benchmarks[i], iterations, writers)) {
+            fprintf(stderr, "Benchmark %s failed.\n", benchmarks[i].name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,9 +1,35 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
+#include <errno.h>
 #include <pthread.h>
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 #include "ring_buffer.h"
+#include "spill_queue.h"
+#include "trace.h"
+
+/*!
+ * \def RB_SPILL_BATCH_SIZE
+ * \brief The amount of bytes collected in memory before they are written to
+ *        the on-disk overflow tier.
+ **/
+#define RB_SPILL_BATCH_SIZE ((size_t) 64 * 1024)
+
+/*!
+ * \def RB_SPILL_SEGMENT_SIZE
+ * \brief The size of a segment file of the on-disk overflow tier.
+ **/
+#define RB_SPILL_SEGMENT_SIZE ((size_t) 64 * 1024 * 1024)
 
 /*!
  * \def RB_PRINTLN
@@ -12,7 +38,13 @@
 #ifdef RB_IO
 #define RB_PRINTLN(fmtStr, ...) printf("RingBuffer: " fmtStr "\n", __VA_ARGS__)
 #else
-#define RB_PRINTLN(...) (void) (__VA_ARGS__)
+// Keep the arguments type checked and used, but print nothing.
+#define RB_PRINTLN(fmtStr, ...)                                 \
+    do {                                                        \
+        if (0) {                                                \
+            printf("RingBuffer: " fmtStr "\n", __VA_ARGS__);    \
+        }                                                       \
+    } while (0)
 #endif
 
 const char *ringBufferStatusCodeToString(RingBufferStatusCode statusCode)
@@ -43,6 +75,18 @@ const char *ringBufferStatusCodeToString(RingBufferStatusCode statusCode)
     case RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE:
         return "Could not determine shutdown state for the thread operating on "
                "this ring buffer.";
+    case RB_INVALID_ARGUMENT:
+        return "An invalid argument was passed.";
+    case RB_FAILURE_TO_SPILL:
+        return "Could not write to or read from the on-disk overflow tier.";
+    case RB_FAILURE_TO_MAP_SHARED_MEMORY:
+        return "Could not create, attach to or map the shared memory object.";
+    case RB_FAILURE_TO_NOTIFY:
+        return "Could not create or signal a notification file descriptor.";
+    case RB_UNSUPPORTED:
+        return "The operation is not supported on this platform.";
+    case RB_TIMED_OUT:
+        return "The operation did not complete in time.";
     default:
         break;
     }
@@ -50,19 +94,114 @@ const char *ringBufferStatusCodeToString(RingBufferStatusCode statusCode)
     return "An unknown error occurred.";
 }
 
+/*!
+ * \def RB_MAX_PENDING_READS
+ * \brief The maximum amount of read reservations outstanding at any time.
+ **/
+#define RB_MAX_PENDING_READS 64
+
+/*!
+ * \brief Bytes acquired by a reader that may not be written over yet.
+ **/
+typedef struct {
+    size_t size;       /*!< The amount of bytes */
+    bool   isReleased; /*!< Whether the reader is done with them */
+} RingBufferPendingRead;
+
+/*!
+ * \brief A writer waiting in line for space.
+ *
+ * Lives on the stack of the writer while it waits.
+ **/
+typedef struct RingBufferWriter {
+    struct RingBufferWriter *next;   /*!< The writer after this one */
+    pthread_cond_t           wakeUp; /*!< Signaled once it may be its turn */
+} RingBufferWriter;
+
+struct RingBufferSelectorImpl;
+
+/*!
+ * \brief The registration of a selector with a ring buffer.
+ *
+ * Lives in a slot of the selector, linked into the list of the ring buffer
+ * while the ring buffer is part of the selector.
+ **/
+typedef struct RingBufferWatcher {
+    struct RingBufferWatcher *     next;       /*!< Next of the ring buffer */
+    struct RingBufferSelectorImpl *selector;   /*!< The selector owning it */
+    RingBuffer *                   ringBuffer; /*!< NULL if the slot is free */
+    unsigned                       events;     /*!< RingBufferSelectEvents */
+} RingBufferWatcher;
+
+/*!
+ * \brief Implementation type of the ring buffer selector.
+ *
+ * Ring buffers bump `generation` whenever they become readable or writable,
+ * so that a select doesn't miss a wakeup between examining the ring
+ * buffers and waiting.
+ **/
+typedef struct RingBufferSelectorImpl {
+    pthread_mutex_t    mutex;
+    pthread_cond_t     wakeUp;      /*!< Signaled on every wakeup */
+    uint64_t           generation;  /*!< Count of wakeups */
+    RingBufferWatcher *watchers;    /*!< One slot per ring buffer */
+    size_t             maxWatchers; /*!< The amount of slots */
+} RingBufferSelectorImpl;
+
 /*!
  * \brief Implementation type of the ring buffer
+ *
+ * Bytes read are only freed for writing once they and all the bytes before
+ * them have been released. Bytes read by `ringBufferRead` and
+ * `ringBufferTryRead` are released right away, bytes acquired by
+ * `ringBufferAcquireRead` only once `ringBufferReleaseRead` is called.
+ *
+ * Writers treat the ring buffer as full at `capacity` bytes, which only
+ * differs from `bufferSize` while `ringBufferResize` shrinks the storage.
+ * They also treat it as full while a write reservation holds the space at
+ * `in`, which only becomes part of `count` once committed.
+ *
+ * If fair, writers that have to wait queue up between `writersHead` and
+ * `writersTail`, each waiting on a condition variable of its own, and
+ * only the head of the line is woken once space is freed.
+ *
+ * Selectors waiting on the ring buffer are linked from `watchers`;
+ * `watcherCount` lets the notifying threads skip taking the mutex again if
+ * there are none.
  **/
 typedef struct {
-    byte * buffer;     /*!< Buffer to hold the data written by the threads */
-    size_t bufferSize; /*!< Size of the buffer in bytes */
-    byte * in;         /*!< The write pointer used to write to the buffer */
-    byte * out;        /*!< The read pointer used to read from the buffer */
-    size_t count; /*!< Count representing the amount of bytes still to be read
-                   *   from the buffer
-                   **/
-    pthread_mutex_t mutex;
-    pthread_cond_t  conditionVariable;
+    byte *                buffer;        /*!< The data written */
+    size_t                bufferSize;    /*!< Size of `buffer` in bytes */
+    size_t                capacity;      /*!< Bytes writers may fill */
+    byte *                in;            /*!< The write pointer */
+    byte *                out;           /*!< Oldest byte not yet freed */
+    byte *                reserveOut;    /*!< The read pointer */
+    size_t                count;         /*!< Bytes not yet freed */
+    size_t                reserved;      /*!< Bytes from out to reserveOut */
+    size_t                writeReserved; /*!< Bytes at `in` held by a writer */
+    uint64_t              takenTotal;    /*!< Count of bytes ever read */
+    RingBufferPendingRead pending[RB_MAX_PENDING_READS];
+    uint64_t              pendingBegin;  /*!< Oldest entry of `pending` */
+    uint64_t              pendingEnd;    /*!< One past the newest entry */
+    pthread_mutex_t       mutex;
+    pthread_cond_t        conditionVariable;
+    SpillQueue *          spillQueue;    /*!< On-disk tier; NULL if disabled */
+    size_t                spilled;       /*!< Bytes spilled, not yet refilled */
+    bool                  isRefilling;   /*!< A reader is reading the disk */
+    byte *                refillBuffer;  /*!< Bytes read from disk, staged */
+    size_t                refillSize;    /*!< Size of `refillBuffer` */
+    size_t                highWaterMark; /*!< Fill level at which to spill */
+    int                   readableFd;    /*!< eventfd: became readable; or -1 */
+    int                   writableFd;    /*!< eventfd: became writable; or -1 */
+    bool                  isResizing;    /*!< A resize is underway */
+    bool                  isRetiring;    /*!< No new reservations of `buffer` */
+    uint64_t              fullWaits;     /*!< Waits of writers for space */
+    uint64_t              emptyWaits;    /*!< Waits of readers for bytes */
+    bool                  isFair;        /*!< Writers wait in line */
+    RingBufferWriter *    writersHead;   /*!< The next writer in line */
+    RingBufferWriter *    writersTail;   /*!< The last writer in line */
+    RingBufferWatcher *   watchers;      /*!< Selectors waiting on it */
+    size_t                watcherCount;  /*!< Length of `watchers`; atomic */
 } RingBufferImpl;
 
 static RingBufferImpl *impl(RingBuffer *rb)
@@ -75,6 +214,34 @@ static RingBuffer *opaque(RingBufferImpl *rb)
     return (RingBuffer *) rb;
 }
 
+/*!
+ * \brief Waits on the condition variable, tracing the wait.
+ * \param rb The ring buffer implementation.
+ * \param begin TRACE_WAIT_FOR_SPACE_BEGIN or TRACE_WAIT_FOR_DATA_BEGIN.
+ * \param threadId The thread ID of the thread waiting.
+ * \return The result of `pthread_cond_wait`.
+ **/
+static int waitTraced(RingBufferImpl *rb, TraceEvent begin, int threadId)
+{
+    traceRecord(begin, threadId);
+    const int error = pthread_cond_wait(&rb->conditionVariable, &rb->mutex);
+    traceRecord((TraceEvent) (begin + 1), threadId);
+    return error;
+}
+
+/*!
+ * \brief Wakes all the threads waiting on the condition variable, tracing
+ *        the wakeup.
+ * \param rb The ring buffer implementation.
+ * \param threadId The thread ID of the thread waking the others.
+ * \return The result of `pthread_cond_broadcast`.
+ **/
+static int broadcastTraced(RingBufferImpl *rb, int threadId)
+{
+    traceRecord(TRACE_BROADCAST, threadId);
+    return pthread_cond_broadcast(&rb->conditionVariable);
+}
+
 RingBufferStatusCode ringBufferCreate(size_t byteCount, RingBuffer **ringBuffer)
 {
     RingBufferImpl *rb = malloc(sizeof(RingBufferImpl));
@@ -90,10 +257,34 @@ RingBufferStatusCode ringBufferCreate(size_t byteCount, RingBuffer **ringBuffer)
         return RB_NOMEM;
     }
 
-    rb->bufferSize = byteCount;
-    rb->in         = rb->buffer;
-    rb->out        = rb->buffer;
-    rb->count      = 0;
+    rb->bufferSize    = byteCount;
+    rb->capacity      = byteCount;
+    rb->in            = rb->buffer;
+    rb->out           = rb->buffer;
+    rb->reserveOut    = rb->buffer;
+    rb->count         = 0;
+    rb->reserved      = 0;
+    rb->writeReserved = 0;
+    rb->takenTotal    = 0;
+    rb->pendingBegin  = 0;
+    rb->pendingEnd    = 0;
+    rb->spillQueue    = NULL;
+    rb->spilled       = 0;
+    rb->isRefilling   = false;
+    rb->refillBuffer  = NULL;
+    rb->refillSize    = 0;
+    rb->highWaterMark = byteCount;
+    rb->readableFd    = -1;
+    rb->writableFd    = -1;
+    rb->isResizing    = false;
+    rb->isRetiring    = false;
+    rb->fullWaits     = 0;
+    rb->emptyWaits    = 0;
+    rb->isFair        = false;
+    rb->writersHead   = NULL;
+    rb->writersTail   = NULL;
+    rb->watchers      = NULL;
+    rb->watcherCount  = 0;
 
     if (pthread_mutex_init(&rb->mutex, NULL) != 0) {
         free(rb->buffer);
@@ -121,6 +312,16 @@ RingBufferStatusCode ringBufferFree(RingBuffer *ringBuffer)
         return RB_OK;
     }
 
+    const bool couldFreeSpillQueue = spillQueueFree(rb->spillQueue);
+    free(rb->refillBuffer);
+
+#ifdef __linux__
+    if (rb->readableFd != -1) {
+        close(rb->readableFd);
+        close(rb->writableFd);
+    }
+#endif
+
     if (pthread_mutex_destroy(&rb->mutex) != 0) {
         pthread_cond_destroy(&rb->conditionVariable);
         free(rb->buffer);
@@ -136,207 +337,2367 @@ RingBufferStatusCode ringBufferFree(RingBuffer *ringBuffer)
 
     free(rb->buffer);
     free(rb);
+    return couldFreeSpillQueue ? RB_OK : RB_FAILURE_TO_SPILL;
+}
+
+RingBufferStatusCode ringBufferEnableSpill(
+    RingBuffer *ringBuffer,
+    const char *directory,
+    size_t      highWaterMark)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (highWaterMark == 0 || highWaterMark > rb->capacity
+        || rb->spillQueue != NULL) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    rb->spillQueue = spillQueueCreate(
+        directory, RB_SPILL_BATCH_SIZE, RB_SPILL_SEGMENT_SIZE);
+
+    if (rb->spillQueue == NULL) {
+        return RB_FAILURE_TO_SPILL;
+    }
+
+    rb->highWaterMark = highWaterMark;
     return RB_OK;
 }
 
 /*!
- * \brief Helper function to advance a pointer in the ring buffer.
+ * \brief Returns the amount of bytes in the on-disk tier.
  * \param rb The ring buffer implementation.
- * \param ptr A pointer to the pointer to advance.
+ * \return The amount of bytes that have been spilled and not yet been read
+ *         back, including the ones a refill is carrying over right now.
+ * \note Must be called with the mutex held.
  **/
-static void advancePointer(RingBufferImpl *rb, byte **ptr)
+static size_t spilledCount(const RingBufferImpl *rb)
 {
-    // If we're at the end -> go to the front.
-    if (*ptr == (rb->buffer + rb->bufferSize - 1)) {
-        *ptr = rb->buffer;
-    }
-    else {
-        // Otherwise -> Just bump the pointer.
-        ++*ptr;
-    }
+    return rb->spilled;
 }
 
-RingBufferStatusCode ringBufferWrite(
-    RingBuffer *ringBuffer,
-    byte        toWrite,
-    int         threadId,
-    Thread *    self)
+/*!
+ * \brief Checks whether writers have to wait for space.
+ * \param rb The ring buffer implementation.
+ * \return true if the ring buffer is full; otherwise false.
+ **/
+static bool isFull(const RingBufferImpl *rb)
+{
+    return rb->writeReserved != 0 || rb->count >= rb->capacity;
+}
+
+/*!
+ * \brief Returns the amount of bytes writers may write right now.
+ * \param rb The ring buffer implementation.
+ * \return The free space in bytes.
+ **/
+static size_t freeSpace(const RingBufferImpl *rb)
+{
+    return isFull(rb) ? 0 : rb->capacity - rb->count;
+}
+
+RingBufferStatusCode ringBufferEnableNotifications(RingBuffer *ringBuffer)
 {
+#ifdef __linux__
     RingBufferImpl *rb = impl(ringBuffer);
 
-    if (pthread_mutex_lock(&rb->mutex) != 0) {
-        return RB_FAILURE_TO_LOCK_MUTEX;
+    if (rb->readableFd != -1) {
+        return RB_INVALID_ARGUMENT;
     }
 
-    RB_PRINTLN(
-        "Producer (tid: %d) got the mutex and tries to write %c",
-        threadId,
-        toWrite);
+    rb->readableFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
-    // Condition variable loop.
-    // Wait for slots in the ring buffer to become free.
-    while (rb->count >= rb->bufferSize) {
-        bool       shouldShutdown;
-        const bool ok = threadShouldShutdown(self, &shouldShutdown);
+    if (rb->readableFd == -1) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
 
-        // If we couldn't query the shutdown state -> error.
-        if (!ok) {
-            // Give back the mutex, because the condition variable will have
-            // reacquired it.
-            if (pthread_mutex_unlock(&rb->mutex) != 0) {
-                return RB_FAILURE_TO_UNLOCK_MUTEX;
-            }
+    rb->writableFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
-            return RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
-        }
+    if (rb->writableFd == -1) {
+        close(rb->readableFd);
+        rb->readableFd = -1;
+        return RB_FAILURE_TO_NOTIFY;
+    }
 
-        // If we could got the shutdown state and we should shut down.
-        // -> Shut down.
-        if (shouldShutdown) {
-            // Release the mutex because the condition variable had reacquired
-            // it.
-            if (pthread_mutex_unlock(&rb->mutex) != 0) {
-                return RB_FAILURE_TO_UNLOCK_MUTEX;
-            }
+    return RB_OK;
+#else
+    (void) ringBuffer;
+    return RB_UNSUPPORTED;
+#endif
+}
 
-            // Signal shut down to the thread.
-            return RB_THREAD_SHOULD_SHUTDOWN;
-        }
+int ringBufferReadableFd(RingBuffer *ringBuffer)
+{
+    return impl(ringBuffer)->readableFd;
+}
 
-        RB_PRINTLN(
-            "Producer (tid: %d) has to wait for space to become free, trying "
-            "to "
-            "write %c",
-            threadId,
-            toWrite);
+int ringBufferWritableFd(RingBuffer *ringBuffer)
+{
+    return impl(ringBuffer)->writableFd;
+}
 
-        // Go wait on the condition variable.
-        if (pthread_cond_wait(&rb->conditionVariable, &rb->mutex) != 0) {
-            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
-        }
+/*!
+ * \brief Signals a notification eventfd.
+ * \param fd The eventfd; -1 if notifications are disabled.
+ * \return true on success; otherwise false.
+ **/
+static bool notify(int fd)
+{
+#ifdef __linux__
+    if (fd == -1) {
+        return true;
     }
 
-    // Write.
-    *rb->in = toWrite;
-    ++rb->count; // 1 more byte to read.
-    advancePointer(rb, &rb->in);
+    const uint64_t one = 1;
 
-    RB_PRINTLN(
-        "Producer (tid: %d) incremented count. There are now %zu bytes to "
-        "read.",
-        threadId,
-        rb->count);
+    // EAGAIN means the counter is saturated, which still reads as signaled.
+    return write(fd, &one, sizeof(one)) == (ssize_t) sizeof(one)
+           || errno == EAGAIN;
+#else
+    (void) fd;
+    return true;
+#endif
+}
 
-    if (pthread_mutex_unlock(&rb->mutex) != 0) {
-        return RB_FAILURE_TO_UNLOCK_MUTEX;
+/*!
+ * \brief Wakes the selectors waiting for an event of a ring buffer.
+ * \param rb The ring buffer implementation.
+ * \param events The RingBufferSelectEvents that occurred.
+ * \note Must be called with the mutex held.
+ **/
+static void wakeWatchers(RingBufferImpl *rb, unsigned events)
+{
+    for (RingBufferWatcher *w = rb->watchers; w != NULL; w = w->next) {
+        if ((w->events & events) == 0) {
+            continue;
+        }
+
+        RingBufferSelectorImpl *selector = w->selector;
+
+        pthread_mutex_lock(&selector->mutex);
+        ++selector->generation;
+        pthread_cond_signal(&selector->wakeUp);
+        pthread_mutex_unlock(&selector->mutex);
     }
+}
 
-    // Wake everyone who is waiting on the condition variable.
-    if (pthread_cond_broadcast(&rb->conditionVariable) != 0) {
-        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+/*!
+ * \brief Wakes the selectors waiting for an event of a ring buffer.
+ * \param rb The ring buffer implementation.
+ * \param events The RingBufferSelectEvents that occurred.
+ * \return true on success; otherwise false.
+ * \note Must be called without holding the mutex.
+ **/
+static bool wakeSelectors(RingBufferImpl *rb, unsigned events)
+{
+    // A selector added after this load examines the ring buffer itself.
+    if (__atomic_load_n(&rb->watcherCount, __ATOMIC_ACQUIRE) == 0) {
+        return true;
     }
 
-    RB_PRINTLN(
-        "Producer (tid: %d): Write done. Broadcast condition variable",
-        threadId);
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return false;
+    }
 
-    return RB_OK;
+    wakeWatchers(rb, events);
+    return pthread_mutex_unlock(&rb->mutex) == 0;
 }
 
-RingBufferStatusCode ringBufferRead(
-    RingBuffer *ringBuffer,
-    byte *      byteRead,
-    int         threadId,
-    Thread *    self)
+/*!
+ * \brief Signals that a ring buffer became readable.
+ * \param rb The ring buffer implementation.
+ * \return true on success; otherwise false.
+ **/
+static bool notifyReadable(RingBufferImpl *rb)
 {
-    RingBufferImpl *rb = impl(ringBuffer);
+    return notify(rb->readableFd) && wakeSelectors(rb, RB_SELECT_READABLE);
+}
 
-    if (pthread_mutex_lock(&rb->mutex) != 0) {
-        return RB_FAILURE_TO_LOCK_MUTEX;
-    }
+/*!
+ * \brief Signals that a ring buffer became writable.
+ * \param rb The ring buffer implementation.
+ * \return true on success; otherwise false.
+ **/
+static bool notifyWritable(RingBufferImpl *rb)
+{
+    return notify(rb->writableFd) && wakeSelectors(rb, RB_SELECT_WRITABLE);
+}
 
-    RB_PRINTLN("Consumer (tid: %d) got the mutex and tries to read.", threadId);
+/*!
+ * \brief Copies bytes into the free space of the ring buffer.
+ * \param rb The ring buffer implementation.
+ * \param source The bytes to copy.
+ * \param byteCount The amount of bytes to copy; must fit.
+ * \note Must be called with the mutex held.
+ **/
+static void copyIn(RingBufferImpl *rb, const byte *source, size_t byteCount)
+{
+    const size_t untilEnd = (size_t) (rb->buffer + rb->bufferSize - rb->in);
+    const size_t first    = byteCount < untilEnd ? byteCount : untilEnd;
 
-    // Condition variable loop.
-    // Wait for data to become available for reading.
-    while (rb->count == 0) {
-        bool       shouldShutdown;
-        const bool ok = threadShouldShutdown(self, &shouldShutdown);
+    memcpy(rb->in, source, first);
+    memcpy(rb->buffer, source + first, byteCount - first);
 
-        // If we couldn't get the shut down state -> Exit with error.
-        if (!ok) {
-            // Release the mutex because the condition variable had reacquired
-            // it.
-            if (pthread_mutex_unlock(&rb->mutex) != 0) {
-                return RB_FAILURE_TO_UNLOCK_MUTEX;
-            }
+    rb->in = first == untilEnd ? rb->buffer + (byteCount - first)
+                               : rb->in + first;
+    rb->count += byteCount;
+}
 
-            return RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
-        }
+/*!
+ * \brief Refills the (empty) in-memory ring from the on-disk tier.
+ *
+ * Reading the disk happens in `refillBuffer` without holding the mutex;
+ * only the copy into the ring does. Meanwhile `isRefilling` keeps the
+ * other readers from refilling as well and the writers spilling, as the
+ * bytes underway are older than theirs.
+ * \param rb The ring buffer implementation.
+ * \param threadId The thread ID of the calling thread.
+ * \return true on success, even if no bytes could be read yet; otherwise
+ *         false.
+ * \note Must be called with the mutex held, `rb->count` being 0 and no
+ *       other refill underway. The mutex is held again on return.
+ **/
+static bool refillFromSpill(RingBufferImpl *rb, int threadId)
+{
+    const size_t maxCount = rb->capacity;
+    size_t       popped   = 0;
+    bool         success  = true;
 
-        // If we successfully got the shut down state and it indicates that
-        // we should shut down -> Shut down.
-        if (shouldShutdown) {
-            // Release the mutex because the condition variable had reacquired
-            // it.
-            if (pthread_mutex_unlock(&rb->mutex) != 0) {
-                return RB_FAILURE_TO_UNLOCK_MUTEX;
-            }
+    rb->isRefilling = true;
 
-            // Indicate that the thread should shut down.
-            return RB_THREAD_SHOULD_SHUTDOWN;
-        }
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return false;
+    }
 
-        RB_PRINTLN(
-            "Consumer (tid: %d) has to wait for data to be written while "
-            "trying to "
-            "read.",
-            threadId);
+    // Only the thread refilling touches the buffer.
+    if (rb->refillSize < maxCount) {
+        byte *buffer = realloc(rb->refillBuffer, maxCount);
 
-        // Wait on the condition variable.
-        if (pthread_cond_wait(&rb->conditionVariable, &rb->mutex) != 0) {
-            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        if (buffer == NULL) {
+            success = false;
+        }
+        else {
+            rb->refillBuffer = buffer;
+            rb->refillSize   = maxCount;
         }
     }
 
-    // Read a byte.
-    const byte byteJustRead = *rb->out;
-    --rb->count; // Now there's one fewer byte to read.
-    advancePointer(rb, &rb->out);
-
-    RB_PRINTLN(
-        "Consumer (tid: %d) decremented count. There are now %zu bytes to "
-        "read.",
-        threadId,
-        rb->count);
+    if (success) {
+        success = spillQueuePop(
+            rb->spillQueue, rb->refillBuffer, maxCount, &popped);
+    }
 
-    if (pthread_mutex_unlock(&rb->mutex) != 0) {
-        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return false;
     }
 
-    // Wake every thread that's waiting on the condition variable.
-    if (pthread_cond_broadcast(&rb->conditionVariable) != 0) {
-        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    // The ring has been kept empty and a resize waits for the refill before
+    // shrinking the storage, so the bytes fit.
+    copyIn(rb, rb->refillBuffer, popped);
+    rb->spilled -= popped;
+    rb->isRefilling = false;
+
+    // Wake the readers, selectors and resizes that waited for the refill.
+    if (broadcastTraced(rb, threadId) != 0) {
+        return false;
     }
 
-    RB_PRINTLN(
-        "Consumer (tid: %d): Read %c. Broadcast condition variable.",
-        threadId,
-        byteJustRead);
+    if (popped != 0) {
+        success = notify(rb->readableFd) && success;
+        wakeWatchers(rb, RB_SELECT_READABLE);
+    }
 
-    *byteRead = byteJustRead;
-    return RB_OK;
+    return success;
 }
 
-RingBufferStatusCode ringBufferShutdown(RingBuffer *ringBuffer)
+/*!
+ * \brief Writes the batches spilled to disk and wakes the readers waiting
+ *        for them.
+ * \param rb The ring buffer implementation.
+ * \param threadId The thread ID of the calling thread.
+ * \return true on success; otherwise false.
+ * \note Must be called without the mutex held: the point is that the disk
+ *       is written to without blocking the others.
+ **/
+static bool flushSpill(RingBufferImpl *rb, int threadId)
 {
-    RingBufferImpl *rb = impl(ringBuffer);
+    size_t     bytesFlushed;
+    const bool couldFlush = spillQueueFlush(rb->spillQueue, &bytesFlushed);
 
-    // Wake all the threads that wait on the condition variable.
-    // This way they will reexamine their shut down state as soon as possible.
-    if (pthread_cond_broadcast(&rb->conditionVariable) != 0) {
+    if (bytesFlushed == 0 && couldFlush) {
+        return true;
+    }
+
+    RB_PRINTLN(
+        "Producer (tid: %d) flushed %zu spilled bytes to disk.",
+        threadId,
+        bytesFlushed);
+
+    // Readers that have caught up with the on-disk tier wait for the bytes
+    // just written. Taking the mutex makes sure they either wait already or
+    // have yet to look, so that the wakeup can't get lost.
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return false;
+    }
+
+    const bool isDrained = rb->count == 0;
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0
+        || broadcastTraced(rb, threadId) != 0
+        || (isDrained && !notifyReadable(rb))) {
+        return false;
+    }
+
+    return couldFlush;
+}
+
+RingBufferStatusCode ringBufferEnableFairness(RingBuffer *ringBuffer)
+{
+    impl(ringBuffer)->isFair = true;
+    return RB_OK;
+}
+
+/*!
+ * \brief Wakes the writer first in line, if any, to check for space.
+ * \param rb The ring buffer implementation.
+ * \note Must be called with the mutex held, which keeps the writer from
+ *       leaving the line meanwhile.
+ **/
+static void wakeFirstWriter(RingBufferImpl *rb)
+{
+    if (rb->writersHead != NULL) {
+        pthread_cond_signal(&rb->writersHead->wakeUp);
+    }
+}
+
+/*!
+ * \brief Removes a writer from the line.
+ * \param rb The ring buffer implementation.
+ * \param writer The writer, which must be in line.
+ * \note Must be called with the mutex held.
+ **/
+static void leaveLine(RingBufferImpl *rb, RingBufferWriter *writer)
+{
+    RingBufferWriter *previous = NULL;
+
+    // Writers usually leave from the head, after their turn.
+    for (RingBufferWriter *w = rb->writersHead; w != writer; w = w->next) {
+        previous = w;
+    }
+
+    if (previous == NULL) {
+        rb->writersHead = writer->next;
+    }
+    else {
+        previous->next = writer->next;
+    }
+
+    if (rb->writersTail == writer) {
+        rb->writersTail = previous;
+    }
+}
+
+/*!
+ * \brief Waits for the turn of a writer of a fair ring buffer.
+ * \param rb The ring buffer implementation.
+ * \param byteCount The amount of bytes the writer needs space for.
+ * \param threadId The thread ID of the writer.
+ * \param self The writer; NULL to wait regardless of shutdown.
+ * \return The status code.
+ *
+ * Writers only skip the line if nobody is waiting and there is space.
+ * Otherwise they queue up and go in the order they arrived in, once the
+ * one before them has written; no writer can overtake another one, no
+ * matter how often it writes.
+ * \note Must be called with the mutex held. On success it is still held and
+ *       `byteCount` bytes are free; on failure it has been released.
+ **/
+static RingBufferStatusCode waitInLine(
+    RingBufferImpl *rb,
+    size_t          byteCount,
+    int             threadId,
+    Thread *        self)
+{
+    if (rb->writersHead == NULL && freeSpace(rb) >= byteCount) {
+        return RB_OK;
+    }
+
+    RingBufferWriter writer;
+    writer.next = NULL;
+
+    if (pthread_cond_init(&writer.wakeUp, NULL) != 0) {
+        pthread_mutex_unlock(&rb->mutex);
+        return RB_FAILURE_TO_INIT_CONDVAR;
+    }
+
+    if (rb->writersTail == NULL) {
+        rb->writersHead = &writer;
+    }
+    else {
+        rb->writersTail->next = &writer;
+    }
+
+    rb->writersTail = &writer;
+
+    RingBufferStatusCode statusCode = RB_OK;
+
+    while (rb->writersHead != &writer || freeSpace(rb) < byteCount) {
+        bool shouldShutdown = false;
+
+        if (self != NULL && !threadShouldShutdown(self, &shouldShutdown)) {
+            statusCode = RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+            break;
+        }
+
+        if (shouldShutdown) {
+            statusCode = RB_THREAD_SHOULD_SHUTDOWN;
+            break;
+        }
+
+        RB_PRINTLN(
+            "Producer (tid: %d) waits in line for space for %zu bytes.",
+            threadId,
+            byteCount);
+
+        ++rb->fullWaits;
+        traceRecord(TRACE_WAIT_FOR_SPACE_BEGIN, threadId);
+        const int error = pthread_cond_wait(&writer.wakeUp, &rb->mutex);
+        traceRecord(TRACE_WAIT_FOR_SPACE_END, threadId);
+
+        if (error != 0) {
+            statusCode = RB_FAILURE_TO_WAIT_ON_CONDVAR;
+            break;
+        }
+    }
+
+    leaveLine(rb, &writer);
+    pthread_cond_destroy(&writer.wakeUp);
+
+    if (RB_FAILURE(statusCode)) {
+        // Pass the turn on.
+        wakeFirstWriter(rb);
+
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+    }
+
+    return statusCode;
+}
+
+/*!
+ * \brief Helper function to advance a pointer in the ring buffer.
+ * \param rb The ring buffer implementation.
+ * \param ptr A pointer to the pointer to advance.
+ **/
+static void advancePointer(RingBufferImpl *rb, byte **ptr)
+{
+    // If we're at the end -> go to the front.
+    if (*ptr == (rb->buffer + rb->bufferSize - 1)) {
+        *ptr = rb->buffer;
+    }
+    else {
+        // Otherwise -> Just bump the pointer.
+        ++*ptr;
+    }
+}
+
+/*!
+ * \brief Returns a pointer advanced by a given amount of bytes.
+ * \param rb The ring buffer implementation.
+ * \param ptr The pointer to advance.
+ * \param byteCount The amount of bytes to advance by; at most `bufferSize`.
+ * \return The pointer advanced, wrapped around to the front if needed.
+ **/
+static byte *advancedBy(RingBufferImpl *rb, byte *ptr, size_t byteCount)
+{
+    size_t offset = (size_t) (ptr - rb->buffer) + byteCount;
+
+    if (offset >= rb->bufferSize) {
+        offset -= rb->bufferSize;
+    }
+
+    return rb->buffer + offset;
+}
+
+/*!
+ * \brief Checks whether bytes can be taken from the ring buffer right now.
+ * \param rb The ring buffer implementation.
+ * \param willHoldReservation true if the bytes will be held by a read
+ *                            reservation; false if released immediately.
+ * \return true if bytes can be taken, possibly after refilling from disk.
+ **/
+static bool isReadable(const RingBufferImpl *rb, bool willHoldReservation)
+{
+    // Everything in memory has been released -> go to the disk, unless the
+    // bytes next up are still being written there or another reader is
+    // bringing them over already.
+    if (rb->count == 0) {
+        return rb->spillQueue != NULL && !rb->isRefilling
+               && spillQueueAvailable(rb->spillQueue) != 0;
+    }
+
+    if (rb->count == rb->reserved) {
+        return false;
+    }
+
+    // The storage is about to be replaced -> no new pointers into it.
+    if (willHoldReservation && rb->isRetiring) {
+        return false;
+    }
+
+    const uint64_t pendingCount = rb->pendingEnd - rb->pendingBegin;
+
+    if (pendingCount < RB_MAX_PENDING_READS) {
+        return true;
+    }
+
+    // Bytes released right away can be merged into the newest reservation if
+    // that one has been released already.
+    return !willHoldReservation
+           && rb->pending[(rb->pendingEnd - 1) % RB_MAX_PENDING_READS]
+                  .isReleased;
+}
+
+/*!
+ * \brief Takes bytes at `reserveOut`.
+ * \param rb The ring buffer implementation.
+ * \param byteCount The amount of bytes to take.
+ * \note The bytes still count as being in the ring buffer.
+ **/
+static void takeSlots(RingBufferImpl *rb, size_t byteCount)
+{
+    rb->reserveOut = advancedBy(rb, rb->reserveOut, byteCount);
+    rb->reserved += byteCount;
+    rb->takenTotal += byteCount;
+}
+
+/*!
+ * \brief Frees the oldest bytes taken, so that they may be written over.
+ * \param rb The ring buffer implementation.
+ * \param byteCount The amount of bytes to free.
+ **/
+static void freeSlots(RingBufferImpl *rb, size_t byteCount)
+{
+    rb->out = advancedBy(rb, rb->out, byteCount);
+    rb->count -= byteCount;
+    rb->reserved -= byteCount;
+    wakeFirstWriter(rb);
+}
+
+/*!
+ * \brief Releases bytes just taken without a reservation.
+ * \param rb The ring buffer implementation.
+ * \param byteCount The amount of bytes taken.
+ *
+ * The bytes are freed immediately unless older reservations are still
+ * outstanding, in which case they are freed together with those.
+ * \note `isReadable(rb, false)` must have been true.
+ **/
+static void consumeSlots(RingBufferImpl *rb, size_t byteCount)
+{
+    if (rb->pendingBegin == rb->pendingEnd) {
+        freeSlots(rb, byteCount);
+        return;
+    }
+
+    RingBufferPendingRead *newest
+        = &rb->pending[(rb->pendingEnd - 1) % RB_MAX_PENDING_READS];
+
+    if (newest->isReleased) {
+        newest->size += byteCount;
+        return;
+    }
+
+    RingBufferPendingRead *entry
+        = &rb->pending[rb->pendingEnd % RB_MAX_PENDING_READS];
+    entry->size       = byteCount;
+    entry->isReleased = true;
+    ++rb->pendingEnd;
+}
+
+/*!
+ * \brief Implements `ringBufferWrite`, which traces it.
+ **/
+static RingBufferStatusCode writeByte(
+    RingBuffer *ringBuffer,
+    byte        toWrite,
+    int         threadId,
+    Thread *    self)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    RB_PRINTLN(
+        "Producer (tid: %d) got the mutex and tries to write %c",
+        threadId,
+        toWrite);
+
+    // Once the in-memory ring has passed the high-water mark or there are
+    // bytes on disk already (which are older than this one) -> append to the
+    // on-disk tier instead of waiting.
+    if (rb->spillQueue != NULL
+        && (rb->count >= rb->highWaterMark || isFull(rb)
+            || spilledCount(rb) != 0)) {
+        const bool couldSpill = spillQueuePush(rb->spillQueue, toWrite);
+
+        if (couldSpill) {
+            ++rb->spilled;
+        }
+
+        RB_PRINTLN(
+            "Producer (tid: %d) spilled %c to disk. There are now %zu bytes on "
+            "disk.",
+            threadId,
+            toWrite,
+            spilledCount(rb));
+
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        // No need to wake anyone for the byte: readers only wait if both
+        // tiers are empty, which they weren't, or for the bytes being
+        // written to disk, which `flushSpill` wakes them for.
+        return couldSpill && flushSpill(rb, threadId) ? RB_OK
+                                                      : RB_FAILURE_TO_SPILL;
+    }
+
+    // Fair -> wait in line, which also waits for space.
+    if (rb->isFair) {
+        const RingBufferStatusCode statusCode
+            = waitInLine(rb, 1, threadId, self);
+
+        if (RB_FAILURE(statusCode)) {
+            return statusCode;
+        }
+    }
+
+    // Condition variable loop.
+    // Wait for slots in the ring buffer to become free.
+    while (isFull(rb)) {
+        bool       shouldShutdown;
+        const bool ok = threadShouldShutdown(self, &shouldShutdown);
+
+        // If we couldn't query the shutdown state -> error.
+        if (!ok) {
+            // Give back the mutex, because the condition variable will have
+            // reacquired it.
+            if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            return RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+        }
+
+        // If we could got the shutdown state and we should shut down.
+        // -> Shut down.
+        if (shouldShutdown) {
+            // Release the mutex because the condition variable had reacquired
+            // it.
+            if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            // Signal shut down to the thread.
+            return RB_THREAD_SHOULD_SHUTDOWN;
+        }
+
+        RB_PRINTLN(
+            "Producer (tid: %d) has to wait for space to become free, trying "
+            "to "
+            "write %c",
+            threadId,
+            toWrite);
+
+        ++rb->fullWaits;
+
+        // Go wait on the condition variable.
+        if (waitTraced(rb, TRACE_WAIT_FOR_SPACE_BEGIN, threadId) != 0) {
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    // Only the transition from empty to non-empty is signaled.
+    const bool becameReadable = !isReadable(rb, false);
+
+    // Write.
+    *rb->in = toWrite;
+    ++rb->count; // 1 more byte to read.
+    advancePointer(rb, &rb->in);
+
+    // Space may be left for the next writer in line.
+    wakeFirstWriter(rb);
+
+    RB_PRINTLN(
+        "Producer (tid: %d) incremented count. There are now %zu bytes to "
+        "read.",
+        threadId,
+        rb->count);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    // Wake everyone who is waiting on the condition variable.
+    if (broadcastTraced(rb, threadId) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    RB_PRINTLN(
+        "Producer (tid: %d): Write done. Broadcast condition variable",
+        threadId);
+
+    if (becameReadable && !notifyReadable(rb)) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferWrite(
+    RingBuffer *ringBuffer,
+    byte        toWrite,
+    int         threadId,
+    Thread *    self)
+{
+    traceRecord(TRACE_WRITE_BEGIN, threadId);
+    const RingBufferStatusCode statusCode = writeByte(
+        ringBuffer, toWrite, threadId, self);
+    traceRecord(TRACE_WRITE_END, threadId);
+    return statusCode;
+}
+
+/*!
+ * \brief Implements `ringBufferRead`, which traces it.
+ **/
+static RingBufferStatusCode readByte(
+    RingBuffer *ringBuffer,
+    byte *      byteRead,
+    int         threadId,
+    Thread *    self)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    RB_PRINTLN("Consumer (tid: %d) got the mutex and tries to read.", threadId);
+
+    // Condition variable loop.
+    // Wait for data to become available for reading in memory.
+    while (rb->count == 0 || !isReadable(rb, /* willHoldReservation */ false)) {
+        // The in-memory tier has been drained -> Continue with the on-disk
+        // tier.
+        if (rb->count == 0 && isReadable(rb, /* willHoldReservation */ false)) {
+            if (!refillFromSpill(rb, threadId)) {
+                if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                    return RB_FAILURE_TO_UNLOCK_MUTEX;
+                }
+
+                return RB_FAILURE_TO_SPILL;
+            }
+
+            RB_PRINTLN(
+                "Consumer (tid: %d) refilled the ring from disk. There are "
+                "now %zu bytes to read and %zu bytes on disk.",
+                threadId,
+                rb->count,
+                spilledCount(rb));
+            continue;
+        }
+
+        bool       shouldShutdown;
+        const bool ok = threadShouldShutdown(self, &shouldShutdown);
+
+        // If we couldn't get the shut down state -> Exit with error.
+        if (!ok) {
+            // Release the mutex because the condition variable had reacquired
+            // it.
+            if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            return RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+        }
+
+        // If we successfully got the shut down state and it indicates that
+        // we should shut down -> Shut down.
+        if (shouldShutdown) {
+            // Release the mutex because the condition variable had reacquired
+            // it.
+            if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            // Indicate that the thread should shut down.
+            return RB_THREAD_SHOULD_SHUTDOWN;
+        }
+
+        RB_PRINTLN(
+            "Consumer (tid: %d) has to wait for data to be written while "
+            "trying to "
+            "read.",
+            threadId);
+
+        ++rb->emptyWaits;
+
+        // Wait on the condition variable.
+        if (waitTraced(rb, TRACE_WAIT_FOR_DATA_BEGIN, threadId) != 0) {
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    // Only the transition from full to not full is signaled.
+    const bool wasFull = isFull(rb);
+
+    // Read a byte.
+    const byte byteJustRead = *rb->reserveOut;
+    advancePointer(rb, &rb->reserveOut);
+    ++rb->reserved;
+    ++rb->takenTotal;
+    consumeSlots(rb, 1); // Now there's one fewer byte to read.
+
+    const bool becameWritable = wasFull && !isFull(rb);
+
+    RB_PRINTLN(
+        "Consumer (tid: %d) decremented count. There are now %zu bytes to "
+        "read.",
+        threadId,
+        rb->count);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    // Wake every thread that's waiting on the condition variable.
+    if (broadcastTraced(rb, threadId) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    RB_PRINTLN(
+        "Consumer (tid: %d): Read %c. Broadcast condition variable.",
+        threadId,
+        byteJustRead);
+
+    *byteRead = byteJustRead;
+
+    if (becameWritable && !notifyWritable(rb)) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferRead(
+    RingBuffer *ringBuffer,
+    byte *      byteRead,
+    int         threadId,
+    Thread *    self)
+{
+    traceRecord(TRACE_READ_BEGIN, threadId);
+    const RingBufferStatusCode statusCode = readByte(
+        ringBuffer, byteRead, threadId, self);
+    traceRecord(TRACE_READ_END, threadId);
+    return statusCode;
+}
+
+/*!
+ * \brief Copies bytes out of the ring buffer.
+ * \param rb The ring buffer implementation.
+ * \param destination The buffer to copy to.
+ * \param byteCount The amount of bytes to copy; must be available.
+ * \note Must be called with the mutex held.
+ **/
+static void copyOut(RingBufferImpl *rb, byte *destination, size_t byteCount)
+{
+    const size_t untilEnd
+        = (size_t) (rb->buffer + rb->bufferSize - rb->reserveOut);
+    const size_t first = byteCount < untilEnd ? byteCount : untilEnd;
+
+    memcpy(destination, rb->reserveOut, first);
+    memcpy(destination + first, rb->buffer, byteCount - first);
+
+    takeSlots(rb, byteCount);
+    consumeSlots(rb, byteCount);
+}
+
+/*!
+ * \brief Implements `ringBufferTryWrite`, which traces it.
+ **/
+static RingBufferStatusCode tryWriteBytes(
+    RingBuffer *ringBuffer,
+    const byte *source,
+    size_t      byteCount,
+    size_t *    bytesWritten,
+    int         threadId)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    const bool becameReadable = !isReadable(rb, false);
+    size_t     written        = 0;
+
+    // The in-memory tier takes bytes as long as it has space and nothing
+    // older is waiting on disk. Writers waiting in line go first.
+    if (spilledCount(rb) == 0 && rb->writersHead == NULL
+        && rb->writeReserved == 0) {
+        const size_t limit
+            = rb->spillQueue == NULL || rb->highWaterMark > rb->capacity
+                  ? rb->capacity
+                  : rb->highWaterMark;
+        const size_t space = rb->count < limit ? limit - rb->count : 0;
+
+        written = byteCount < space ? byteCount : space;
+        copyIn(rb, source, written);
+    }
+
+    // The on-disk tier takes all the rest.
+    bool couldSpill = true;
+
+    if (rb->spillQueue != NULL) {
+        while (couldSpill && written < byteCount) {
+            couldSpill = spillQueuePush(rb->spillQueue, source[written]);
+
+            if (couldSpill) {
+                ++written;
+                ++rb->spilled;
+            }
+        }
+    }
+
+    RB_PRINTLN(
+        "Producer (tid: %d) wrote %zu of %zu bytes without blocking.",
+        threadId,
+        written,
+        byteCount);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    *bytesWritten = written;
+
+    if (rb->spillQueue != NULL && couldSpill) {
+        couldSpill = flushSpill(rb, threadId);
+    }
+
+    if (written != 0) {
+        if (broadcastTraced(rb, threadId) != 0) {
+            return RB_FAILURE_TO_SIGNAL_CONDVAR;
+        }
+
+        if (becameReadable && !notifyReadable(rb)) {
+            return RB_FAILURE_TO_NOTIFY;
+        }
+    }
+
+    return couldSpill ? RB_OK : RB_FAILURE_TO_SPILL;
+}
+
+RingBufferStatusCode ringBufferTryWrite(
+    RingBuffer *ringBuffer,
+    const byte *source,
+    size_t      byteCount,
+    size_t *    bytesWritten,
+    int         threadId)
+{
+    traceRecord(TRACE_WRITE_BEGIN, threadId);
+    const RingBufferStatusCode statusCode = tryWriteBytes(
+        ringBuffer, source, byteCount, bytesWritten, threadId);
+    traceRecord(TRACE_WRITE_END, threadId);
+    return statusCode;
+}
+
+/*!
+ * \brief Implements `ringBufferTryRead`, which traces it.
+ **/
+static RingBufferStatusCode tryReadBytes(
+    RingBuffer *ringBuffer,
+    byte *      destination,
+    size_t      maxCount,
+    size_t *    bytesRead,
+    int         threadId)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // The in-memory tier has been drained -> Continue with the on-disk tier.
+    if (rb->count == 0 && isReadable(rb, /* willHoldReservation */ false)
+        && !refillFromSpill(rb, threadId)) {
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        return RB_FAILURE_TO_SPILL;
+    }
+
+    const bool   wasFull  = isFull(rb);
+    const size_t readable = isReadable(rb, /* willHoldReservation */ false)
+                                ? rb->count - rb->reserved
+                                : 0;
+    const size_t count = maxCount < readable ? maxCount : readable;
+
+    copyOut(rb, destination, count);
+
+    const bool becameWritable = wasFull && !isFull(rb);
+
+    RB_PRINTLN(
+        "Consumer (tid: %d) read %zu bytes without blocking. There are now "
+        "%zu bytes to read.",
+        threadId,
+        count,
+        rb->count);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    *bytesRead = count;
+
+    if (count != 0) {
+        if (broadcastTraced(rb, threadId) != 0) {
+            return RB_FAILURE_TO_SIGNAL_CONDVAR;
+        }
+
+        if (becameWritable && !notifyWritable(rb)) {
+            return RB_FAILURE_TO_NOTIFY;
+        }
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferTryRead(
+    RingBuffer *ringBuffer,
+    byte *      destination,
+    size_t      maxCount,
+    size_t *    bytesRead,
+    int         threadId)
+{
+    traceRecord(TRACE_READ_BEGIN, threadId);
+    const RingBufferStatusCode statusCode = tryReadBytes(
+        ringBuffer, destination, maxCount, bytesRead, threadId);
+    traceRecord(TRACE_READ_END, threadId);
+    return statusCode;
+}
+
+/*!
+ * \brief Implements `ringBufferWriteRecord`, which traces it.
+ **/
+static RingBufferStatusCode writeRecord(
+    RingBuffer *ringBuffer,
+    const byte *source,
+    size_t      byteCount,
+    int         threadId,
+    Thread *    self)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (byteCount == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // The size may change, so check while holding the mutex.
+    if (byteCount > rb->capacity) {
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        return RB_INVALID_ARGUMENT;
+    }
+
+    // Spilled bytes are read back byte by byte, which could split records.
+    if (rb->spillQueue != NULL) {
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        return RB_UNSUPPORTED;
+    }
+
+    // Fair -> wait in line, which also waits for space.
+    if (rb->isFair) {
+        const RingBufferStatusCode statusCode
+            = waitInLine(rb, byteCount, threadId, self);
+
+        if (RB_FAILURE(statusCode)) {
+            return statusCode;
+        }
+    }
+
+    // Condition variable loop.
+    // Wait for the whole record to fit.
+    while (freeSpace(rb) < byteCount) {
+        bool shouldShutdown = false;
+        bool ok             = true;
+
+        if (self != NULL) {
+            ok = threadShouldShutdown(self, &shouldShutdown);
+        }
+
+        if (!ok || shouldShutdown) {
+            if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            return ok ? RB_THREAD_SHOULD_SHUTDOWN
+                      : RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+        }
+
+        RB_PRINTLN(
+            "Producer (tid: %d) has to wait for space for a record of %zu "
+            "bytes.",
+            threadId,
+            byteCount);
+
+        ++rb->fullWaits;
+
+        if (waitTraced(rb, TRACE_WAIT_FOR_SPACE_BEGIN, threadId) != 0) {
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    const bool becameReadable = !isReadable(rb, false);
+
+    copyIn(rb, source, byteCount);
+
+    // Space may be left for the next writer in line.
+    wakeFirstWriter(rb);
+
+    RB_PRINTLN(
+        "Producer (tid: %d) wrote a record of %zu bytes.",
+        threadId,
+        byteCount);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    if (broadcastTraced(rb, threadId) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    if (becameReadable && !notifyReadable(rb)) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferWriteRecord(
+    RingBuffer *ringBuffer,
+    const byte *source,
+    size_t      byteCount,
+    int         threadId,
+    Thread *    self)
+{
+    traceRecord(TRACE_WRITE_BEGIN, threadId);
+    const RingBufferStatusCode statusCode = writeRecord(
+        ringBuffer, source, byteCount, threadId, self);
+    traceRecord(TRACE_WRITE_END, threadId);
+    return statusCode;
+}
+
+/*!
+ * \brief Returns the amount of whole records that can be read right now.
+ * \param rb The ring buffer implementation.
+ * \param recordSize The size of every record in bytes.
+ * \return The amount of records.
+ * \note Must be called with the mutex held.
+ **/
+static size_t readableRecords(const RingBufferImpl *rb, size_t recordSize)
+{
+    return isReadable(rb, /* willHoldReservation */ false)
+               ? (rb->count - rb->reserved) / recordSize
+               : 0;
+}
+
+/*!
+ * \brief Copies whole records out of the ring buffer.
+ * \param rb The ring buffer implementation.
+ * \param destination The buffer to copy to.
+ * \param recordSize The size of every record in bytes.
+ * \param maxRecords The maximum amount of records to copy.
+ * \param becameWritable Output parameter; true if the ring buffer is no
+ *                       longer full.
+ * \return The amount of records copied.
+ * \note Must be called with the mutex held.
+ **/
+static size_t copyOutRecords(
+    RingBufferImpl *rb,
+    byte *          destination,
+    size_t          recordSize,
+    size_t          maxRecords,
+    bool *          becameWritable)
+{
+    const bool   wasFull  = isFull(rb);
+    const size_t readable = readableRecords(rb, recordSize);
+    const size_t count    = maxRecords < readable ? maxRecords : readable;
+
+    copyOut(rb, destination, count * recordSize);
+
+    *becameWritable = wasFull && !isFull(rb);
+    return count;
+}
+
+/*!
+ * \brief Implements `ringBufferReadRecords`, which traces it.
+ **/
+static RingBufferStatusCode readRecords(
+    RingBuffer *ringBuffer,
+    byte *      destination,
+    size_t      recordSize,
+    size_t      maxRecords,
+    size_t *    recordsRead,
+    int         threadId,
+    Thread *    self)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (recordSize == 0 || maxRecords == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // Condition variable loop.
+    // Wait for a whole record to become available.
+    while (readableRecords(rb, recordSize) == 0) {
+        bool       shouldShutdown;
+        const bool ok = threadShouldShutdown(self, &shouldShutdown);
+
+        if (!ok || shouldShutdown) {
+            if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            return ok ? RB_THREAD_SHOULD_SHUTDOWN
+                      : RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+        }
+
+        RB_PRINTLN(
+            "Consumer (tid: %d) has to wait for a record to be written.",
+            threadId);
+
+        ++rb->emptyWaits;
+
+        if (waitTraced(rb, TRACE_WAIT_FOR_DATA_BEGIN, threadId) != 0) {
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    bool         becameWritable;
+    const size_t count = copyOutRecords(
+        rb, destination, recordSize, maxRecords, &becameWritable);
+
+    RB_PRINTLN("Consumer (tid: %d) read %zu records.", threadId, count);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    *recordsRead = count;
+
+    if (broadcastTraced(rb, threadId) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    if (becameWritable && !notifyWritable(rb)) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferReadRecords(
+    RingBuffer *ringBuffer,
+    byte *      destination,
+    size_t      recordSize,
+    size_t      maxRecords,
+    size_t *    recordsRead,
+    int         threadId,
+    Thread *    self)
+{
+    traceRecord(TRACE_READ_BEGIN, threadId);
+    const RingBufferStatusCode statusCode = readRecords(
+        ringBuffer,
+        destination,
+        recordSize,
+        maxRecords,
+        recordsRead,
+        threadId,
+        self);
+    traceRecord(TRACE_READ_END, threadId);
+    return statusCode;
+}
+
+/*!
+ * \brief Implements `ringBufferTryReadRecords`, which traces it.
+ **/
+static RingBufferStatusCode tryReadRecords(
+    RingBuffer *ringBuffer,
+    byte *      destination,
+    size_t      recordSize,
+    size_t      maxRecords,
+    size_t *    recordsRead,
+    int         threadId)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (recordSize == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    bool         becameWritable;
+    const size_t count = copyOutRecords(
+        rb, destination, recordSize, maxRecords, &becameWritable);
+
+    RB_PRINTLN(
+        "Consumer (tid: %d) read %zu records without blocking.",
+        threadId,
+        count);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    *recordsRead = count;
+
+    if (count != 0) {
+        if (broadcastTraced(rb, threadId) != 0) {
+            return RB_FAILURE_TO_SIGNAL_CONDVAR;
+        }
+
+        if (becameWritable && !notifyWritable(rb)) {
+            return RB_FAILURE_TO_NOTIFY;
+        }
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferTryReadRecords(
+    RingBuffer *ringBuffer,
+    byte *      destination,
+    size_t      recordSize,
+    size_t      maxRecords,
+    size_t *    recordsRead,
+    int         threadId)
+{
+    traceRecord(TRACE_READ_BEGIN, threadId);
+    const RingBufferStatusCode statusCode = tryReadRecords(
+        ringBuffer, destination, recordSize, maxRecords, recordsRead, threadId);
+    traceRecord(TRACE_READ_END, threadId);
+    return statusCode;
+}
+
+/*!
+ * \brief Acquires bytes for a read reservation.
+ * \param rb The ring buffer implementation.
+ * \param maxCount The maximum amount of bytes to acquire.
+ * \param reservation Output parameter for the reservation.
+ * \note Must be called with the mutex held, `isReadable(rb, true)` and
+ *       `rb->count` not being 0.
+ **/
+static void acquireLocked(
+    RingBufferImpl *           rb,
+    size_t                     maxCount,
+    RingBufferReadReservation *reservation)
+{
+    // Only hand out contiguous bytes.
+    const size_t untilEnd
+        = (size_t) (rb->buffer + rb->bufferSize - rb->reserveOut);
+    size_t size = rb->count - rb->reserved;
+
+    if (size > untilEnd) {
+        size = untilEnd;
+    }
+
+    if (size > maxCount) {
+        size = maxCount;
+    }
+
+    reservation->data     = rb->reserveOut;
+    reservation->size     = size;
+    reservation->position = rb->takenTotal;
+    reservation->sequence = rb->pendingEnd;
+
+    RingBufferPendingRead *entry
+        = &rb->pending[rb->pendingEnd % RB_MAX_PENDING_READS];
+    entry->size       = size;
+    entry->isReleased = false;
+    ++rb->pendingEnd;
+
+    takeSlots(rb, size);
+    reservation->backlog = rb->count - rb->reserved + spilledCount(rb);
+}
+
+/*!
+ * \brief Implements `ringBufferAcquireRead`, which traces it.
+ **/
+static RingBufferStatusCode acquireRead(
+    RingBuffer *               ringBuffer,
+    size_t                     maxCount,
+    RingBufferReadReservation *reservation,
+    int                        threadId,
+    Thread *                   self)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (maxCount == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // Condition variable loop.
+    // Wait for data to become available in memory and for a free
+    // reservation.
+    while (rb->count == 0 || !isReadable(rb, /* willHoldReservation */ true)) {
+        // The in-memory tier has been drained -> Continue with the on-disk
+        // tier.
+        if (rb->count == 0 && isReadable(rb, /* willHoldReservation */ true)) {
+            if (!refillFromSpill(rb, threadId)) {
+                if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                    return RB_FAILURE_TO_UNLOCK_MUTEX;
+                }
+
+                return RB_FAILURE_TO_SPILL;
+            }
+
+            continue;
+        }
+
+        bool       shouldShutdown;
+        const bool ok = threadShouldShutdown(self, &shouldShutdown);
+
+        if (!ok || shouldShutdown) {
+            if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            return ok ? RB_THREAD_SHOULD_SHUTDOWN
+                      : RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+        }
+
+        RB_PRINTLN(
+            "Consumer (tid: %d) has to wait for data to be written while "
+            "trying to acquire.",
+            threadId);
+
+        ++rb->emptyWaits;
+
+        if (waitTraced(rb, TRACE_WAIT_FOR_DATA_BEGIN, threadId) != 0) {
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    acquireLocked(rb, maxCount, reservation);
+
+    RB_PRINTLN(
+        "Consumer (tid: %d) acquired %zu bytes at position %llu.",
+        threadId,
+        reservation->size,
+        (unsigned long long) reservation->position);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferAcquireRead(
+    RingBuffer *               ringBuffer,
+    size_t                     maxCount,
+    RingBufferReadReservation *reservation,
+    int                        threadId,
+    Thread *                   self)
+{
+    traceRecord(TRACE_READ_BEGIN, threadId);
+    const RingBufferStatusCode statusCode = acquireRead(
+        ringBuffer, maxCount, reservation, threadId, self);
+    traceRecord(TRACE_READ_END, threadId);
+    return statusCode;
+}
+
+RingBufferStatusCode ringBufferTryAcquireRead(
+    RingBuffer *               ringBuffer,
+    size_t                     maxCount,
+    RingBufferReadReservation *reservation,
+    int                        threadId)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (maxCount == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // The in-memory tier has been drained -> Continue with the on-disk tier.
+    const bool couldAcquire
+        = rb->count != 0 || !isReadable(rb, /* willHoldReservation */ true)
+          || refillFromSpill(rb, threadId);
+
+    if (couldAcquire && rb->count != 0
+        && isReadable(rb, /* willHoldReservation */ true)) {
+        acquireLocked(rb, maxCount, reservation);
+    }
+    else {
+        reservation->data     = NULL;
+        reservation->size     = 0;
+        reservation->position = rb->takenTotal;
+        reservation->sequence = 0;
+        reservation->backlog  = 0;
+    }
+
+    RB_PRINTLN(
+        "Consumer (tid: %d) acquired %zu bytes without blocking.",
+        threadId,
+        couldAcquire ? reservation->size : 0);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return couldAcquire ? RB_OK : RB_FAILURE_TO_SPILL;
+}
+
+RingBufferStatusCode ringBufferReleaseRead(
+    RingBuffer *                     ringBuffer,
+    const RingBufferReadReservation *reservation,
+    int                              threadId)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    // Nothing was acquired -> nothing to release.
+    if (reservation->size == 0) {
+        return RB_OK;
+    }
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    if (reservation->sequence < rb->pendingBegin
+        || reservation->sequence >= rb->pendingEnd) {
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        return RB_INVALID_ARGUMENT;
+    }
+
+    rb->pending[reservation->sequence % RB_MAX_PENDING_READS].isReleased
+        = true;
+
+    const bool wasFull   = isFull(rb);
+    size_t     freedSize = 0;
+
+    // Free the longest prefix of released reservations.
+    while (rb->pendingBegin != rb->pendingEnd) {
+        const RingBufferPendingRead *oldest
+            = &rb->pending[rb->pendingBegin % RB_MAX_PENDING_READS];
+
+        if (!oldest->isReleased) {
+            break;
+        }
+
+        freeSlots(rb, oldest->size);
+        freedSize += oldest->size;
+        ++rb->pendingBegin;
+    }
+
+    const bool becameWritable = wasFull && !isFull(rb);
+
+    RB_PRINTLN(
+        "Consumer (tid: %d) released %zu bytes, freeing %zu.",
+        threadId,
+        reservation->size,
+        freedSize);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    // Wake the writers waiting for space, as well as the readers waiting for
+    // a free reservation.
+    if (broadcastTraced(rb, threadId) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    if (becameWritable && !notifyWritable(rb)) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
+
+    return RB_OK;
+}
+
+/*!
+ * \brief Implements `ringBufferAcquireWrite`, which traces it.
+ **/
+static RingBufferStatusCode acquireWrite(
+    RingBuffer *                ringBuffer,
+    size_t                      maxCount,
+    RingBufferWriteReservation *reservation,
+    int                         threadId,
+    Thread *                    self)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (maxCount == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // Spilled bytes would have to be written before the reserved ones.
+    if (rb->spillQueue != NULL) {
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        return RB_UNSUPPORTED;
+    }
+
+    // Fair -> wait in line, which also waits for space.
+    if (rb->isFair) {
+        const RingBufferStatusCode statusCode
+            = waitInLine(rb, 1, threadId, self);
+
+        if (RB_FAILURE(statusCode)) {
+            return statusCode;
+        }
+    }
+
+    // Condition variable loop.
+    // Wait for space and for the storage to stay.
+    while (freeSpace(rb) == 0 || rb->isRetiring) {
+        bool shouldShutdown = false;
+        bool ok             = true;
+
+        if (self != NULL) {
+            ok = threadShouldShutdown(self, &shouldShutdown);
+        }
+
+        if (!ok || shouldShutdown) {
+            // Pass the turn on.
+            wakeFirstWriter(rb);
+
+            if (pthread_mutex_unlock(&rb->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            return ok ? RB_THREAD_SHOULD_SHUTDOWN
+                      : RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+        }
+
+        RB_PRINTLN(
+            "Producer (tid: %d) has to wait for space to reserve.", threadId);
+
+        ++rb->fullWaits;
+
+        if (waitTraced(rb, TRACE_WAIT_FOR_SPACE_BEGIN, threadId) != 0) {
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    // Only hand out contiguous space.
+    const size_t untilEnd = (size_t) (rb->buffer + rb->bufferSize - rb->in);
+    size_t       size     = freeSpace(rb);
+
+    if (size > untilEnd) {
+        size = untilEnd;
+    }
+
+    if (size > maxCount) {
+        size = maxCount;
+    }
+
+    rb->writeReserved = size;
+    reservation->data = rb->in;
+    reservation->size = size;
+
+    RB_PRINTLN("Producer (tid: %d) reserved %zu bytes.", threadId, size);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferAcquireWrite(
+    RingBuffer *                ringBuffer,
+    size_t                      maxCount,
+    RingBufferWriteReservation *reservation,
+    int                         threadId,
+    Thread *                    self)
+{
+    traceRecord(TRACE_WRITE_BEGIN, threadId);
+    const RingBufferStatusCode statusCode = acquireWrite(
+        ringBuffer, maxCount, reservation, threadId, self);
+    traceRecord(TRACE_WRITE_END, threadId);
+    return statusCode;
+}
+
+RingBufferStatusCode ringBufferCommitWrite(
+    RingBuffer *                      ringBuffer,
+    const RingBufferWriteReservation *reservation,
+    size_t                            byteCount,
+    int                               threadId)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    if (rb->writeReserved == 0 || reservation->data != rb->in
+        || reservation->size != rb->writeReserved
+        || byteCount > reservation->size) {
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        return RB_INVALID_ARGUMENT;
+    }
+
+    const bool becameReadable = byteCount != 0 && !isReadable(rb, false);
+
+    rb->in            = advancedBy(rb, rb->in, byteCount);
+    rb->count         = rb->count + byteCount;
+    rb->writeReserved = 0;
+
+    const bool isWritable = !isFull(rb);
+
+    // The space is free for the next writer in line.
+    wakeFirstWriter(rb);
+
+    RB_PRINTLN(
+        "Producer (tid: %d) committed %zu of %zu bytes reserved.",
+        threadId,
+        byteCount,
+        reservation->size);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    // Wake the readers, as well as the writers and resizes waiting for the
+    // reservation to go.
+    if (broadcastTraced(rb, threadId) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    if (becameReadable && !notifyReadable(rb)) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
+
+    if (isWritable && !notifyWritable(rb)) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
+
+    return RB_OK;
+}
+
+void ringBufferStorage(RingBuffer *ringBuffer, const byte **data, size_t *size)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    *data = rb->buffer;
+    *size = rb->bufferSize;
+}
+
+/*!
+ * \brief Waits on the condition variable during a resize.
+ * \param rb The ring buffer implementation.
+ * \param self The thread resizing; NULL to wait regardless of shutdown.
+ * \return The status code.
+ * \note Must be called with the mutex held, which is still held on return.
+ **/
+static RingBufferStatusCode waitForResize(RingBufferImpl *rb, Thread *self)
+{
+    bool shouldShutdown = false;
+
+    if (self != NULL && !threadShouldShutdown(self, &shouldShutdown)) {
+        return RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+    }
+
+    if (shouldShutdown) {
+        return RB_THREAD_SHOULD_SHUTDOWN;
+    }
+
+    // Waiting for the readers to make room.
+    if (waitTraced(rb, TRACE_WAIT_FOR_SPACE_BEGIN, /* threadId */ 0) != 0) {
+        return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode
+ringBufferResize(RingBuffer *ringBuffer, size_t byteCount, Thread *self)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (byteCount == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    // Allocate before taking the mutex, so that nobody waits for it.
+    byte *buffer = calloc(byteCount, 1);
+
+    if (buffer == NULL) {
+        return RB_NOMEM;
+    }
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        free(buffer);
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    RingBufferStatusCode statusCode = RB_OK;
+
+    while (rb->isResizing && RB_SUCCESS(statusCode)) {
+        statusCode = waitForResize(rb, self);
+    }
+
+    if (RB_FAILURE(statusCode)) {
+        pthread_mutex_unlock(&rb->mutex);
+        free(buffer);
+        return statusCode;
+    }
+
+    rb->isResizing = true;
+
+    // Keep the writers from filling in more than the new storage can take
+    // and wait for the readers to make room.
+    const size_t oldCapacity = rb->capacity;
+
+    if (byteCount < rb->capacity) {
+        rb->capacity = byteCount;
+    }
+
+    // A refill underway may still fill up to the old capacity.
+    while ((rb->count + rb->writeReserved > byteCount || rb->isRefilling)
+           && RB_SUCCESS(statusCode)) {
+        statusCode = waitForResize(rb, self);
+    }
+
+    // Reservations point into the old storage -> wait for all of them to be
+    // released or committed. No new ones are handed out meanwhile.
+    rb->isRetiring = true;
+
+    while ((rb->pendingBegin != rb->pendingEnd || rb->writeReserved != 0)
+           && RB_SUCCESS(statusCode)) {
+        statusCode = waitForResize(rb, self);
+    }
+
+    rb->isRetiring = false;
+    rb->isResizing = false;
+
+    byte *const oldBuffer = RB_SUCCESS(statusCode) ? rb->buffer : buffer;
+
+    if (RB_SUCCESS(statusCode)) {
+        // Nothing is reserved, so `out` is the oldest byte to read; copy the
+        // bytes to the front of the new storage in order.
+        const size_t untilEnd
+            = (size_t) (rb->buffer + rb->bufferSize - rb->out);
+        const size_t first = rb->count < untilEnd ? rb->count : untilEnd;
+
+        memcpy(buffer, rb->out, first);
+        memcpy(buffer + first, rb->buffer, rb->count - first);
+
+        // A high-water mark at the old size meant spilling once full; keep
+        // it that way.
+        if (rb->highWaterMark >= rb->bufferSize
+            || rb->highWaterMark > byteCount) {
+            rb->highWaterMark = byteCount;
+        }
+
+        rb->buffer     = buffer;
+        rb->bufferSize = byteCount;
+        rb->capacity   = byteCount;
+        rb->out        = buffer;
+        rb->reserveOut = buffer;
+        rb->in         = buffer + (rb->count == byteCount ? 0 : rb->count);
+
+        RB_PRINTLN(
+            "Resized to %zu bytes, keeping %zu bytes to read.",
+            byteCount,
+            rb->count);
+    }
+    else {
+        rb->capacity = oldCapacity;
+    }
+
+    const bool isWritable = !isFull(rb);
+
+    wakeFirstWriter(rb);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        free(oldBuffer);
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    free(oldBuffer);
+
+    // Wake the writers waiting for space, the readers waiting for a
+    // reservation and other resizes.
+    if (broadcastTraced(rb, /* threadId */ 0) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    if (isWritable && !notifyWritable(rb)) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
+
+    return statusCode;
+}
+
+RingBufferStatusCode
+ringBufferStats(RingBuffer *ringBuffer, RingBufferStats *stats)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    stats->size       = rb->bufferSize;
+    stats->count      = rb->count + spilledCount(rb);
+    stats->fullWaits  = rb->fullWaits;
+    stats->emptyWaits = rb->emptyWaits;
+
+    // Bytes held by read reservations have been read already.
+    stats->readTotal    = rb->takenTotal;
+    stats->writtenTotal = rb->takenTotal + (stats->count - rb->reserved);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferWaitDrained(
+    RingBuffer *ringBuffer,
+    int32_t     timeoutMilliseconds,
+    size_t *    remaining)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (timeoutMilliseconds < 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    // The condition variable uses the realtime clock.
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMilliseconds / 1000;
+    deadline.tv_nsec += (long) (timeoutMilliseconds % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    RingBufferStatusCode statusCode = RB_OK;
+
+    // Every read and release broadcasts, so check again on every wake up.
+    while (rb->count + spilledCount(rb) != 0) {
+        const int error = pthread_cond_timedwait(
+            &rb->conditionVariable, &rb->mutex, &deadline);
+
+        if (error == ETIMEDOUT) {
+            statusCode = RB_TIMED_OUT;
+            break;
+        }
+
+        if (error != 0) {
+            pthread_mutex_unlock(&rb->mutex);
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    *remaining = rb->count + spilledCount(rb);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return statusCode;
+}
+
+RingBufferStatusCode ringBufferShutdown(RingBuffer *ringBuffer)
+{
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    traceRecord(TRACE_SHUTDOWN, /* threadId */ 0);
+
+    // Wake all the writers waiting in line, which don't wait on the
+    // condition variable.
+    if (rb->isFair) {
+        if (pthread_mutex_lock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_LOCK_MUTEX;
+        }
+
+        for (RingBufferWriter *w = rb->writersHead; w != NULL; w = w->next) {
+            pthread_cond_signal(&w->wakeUp);
+        }
+
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+    }
+
+    // Wake all the threads that wait on the condition variable.
+    // This way they will reexamine their shut down state as soon as possible.
+    if (broadcastTraced(rb, /* threadId */ 0) != 0) {
         return RB_FAILURE_TO_SIGNAL_CONDVAR;
     }
 
+    // Wake event loops and selectors, too.
+    if (!notify(rb->readableFd) || !notify(rb->writableFd)
+        || !wakeSelectors(rb, RB_SELECT_READABLE | RB_SELECT_WRITABLE)) {
+        return RB_FAILURE_TO_NOTIFY;
+    }
+
+    return RB_OK;
+}
+
+static RingBufferSelectorImpl *selectorImpl(RingBufferSelector *selector)
+{
+    return (RingBufferSelectorImpl *) selector;
+}
+
+static RingBufferSelector *selectorOpaque(RingBufferSelectorImpl *selector)
+{
+    return (RingBufferSelector *) selector;
+}
+
+RingBufferStatusCode ringBufferSelectorCreate(
+    size_t               maxRingBuffers,
+    RingBufferSelector **selector)
+{
+    if (maxRingBuffers == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    RingBufferSelectorImpl *sel = malloc(sizeof(RingBufferSelectorImpl));
+
+    if (sel == NULL) {
+        return RB_NOMEM;
+    }
+
+    sel->watchers = calloc(maxRingBuffers, sizeof(RingBufferWatcher));
+
+    if (sel->watchers == NULL) {
+        free(sel);
+        return RB_NOMEM;
+    }
+
+    sel->generation  = 0;
+    sel->maxWatchers = maxRingBuffers;
+
+    for (size_t i = 0; i < maxRingBuffers; ++i) {
+        sel->watchers[i].selector = sel;
+    }
+
+    if (pthread_mutex_init(&sel->mutex, NULL) != 0) {
+        free(sel->watchers);
+        free(sel);
+        return RB_FAILURE_TO_INIT_MUTEX;
+    }
+
+    if (pthread_cond_init(&sel->wakeUp, NULL) != 0) {
+        pthread_mutex_destroy(&sel->mutex);
+        free(sel->watchers);
+        free(sel);
+        return RB_FAILURE_TO_INIT_CONDVAR;
+    }
+
+    *selector = selectorOpaque(sel);
+    return RB_OK;
+}
+
+/*!
+ * \brief Finds the slot of a ring buffer in a selector.
+ * \param sel The selector implementation.
+ * \param ringBuffer The ring buffer; NULL to find a free slot.
+ * \return The slot; NULL if there is none.
+ **/
+static RingBufferWatcher *
+findWatcher(RingBufferSelectorImpl *sel, RingBuffer *ringBuffer)
+{
+    for (size_t i = 0; i < sel->maxWatchers; ++i) {
+        if (sel->watchers[i].ringBuffer == ringBuffer) {
+            return &sel->watchers[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*!
+ * \brief Unlinks a slot of a selector from its ring buffer.
+ * \param watcher The slot; must be in use.
+ * \return The status code.
+ **/
+static RingBufferStatusCode unlinkWatcher(RingBufferWatcher *watcher)
+{
+    RingBufferImpl *rb = impl(watcher->ringBuffer);
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    RingBufferWatcher **link = &rb->watchers;
+
+    while (*link != watcher) {
+        link = &(*link)->next;
+    }
+
+    *link = watcher->next;
+    __atomic_fetch_sub(&rb->watcherCount, 1, __ATOMIC_RELEASE);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    watcher->next       = NULL;
+    watcher->ringBuffer = NULL;
+    return RB_OK;
+}
+
+RingBufferStatusCode ringBufferSelectorFree(RingBufferSelector *selector)
+{
+    RingBufferSelectorImpl *sel = selectorImpl(selector);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (sel == NULL) {
+        return RB_OK;
+    }
+
+    RingBufferStatusCode statusCode = RB_OK;
+
+    for (size_t i = 0; i < sel->maxWatchers; ++i) {
+        if (sel->watchers[i].ringBuffer != NULL) {
+            const RingBufferStatusCode code = unlinkWatcher(&sel->watchers[i]);
+
+            if (code != RB_OK) {
+                statusCode = code;
+            }
+        }
+    }
+
+    if (pthread_cond_destroy(&sel->wakeUp) != 0 && statusCode == RB_OK) {
+        statusCode = RB_FAILURE_TO_DESTROY_CONDVAR;
+    }
+
+    if (pthread_mutex_destroy(&sel->mutex) != 0 && statusCode == RB_OK) {
+        statusCode = RB_FAILURE_TO_DESTROY_MUTEX;
+    }
+
+    free(sel->watchers);
+    free(sel);
+    return statusCode;
+}
+
+RingBufferStatusCode ringBufferSelectorAdd(
+    RingBufferSelector *selector,
+    RingBuffer *        ringBuffer,
+    unsigned            events)
+{
+    RingBufferSelectorImpl *sel = selectorImpl(selector);
+    const unsigned          all = RB_SELECT_READABLE | RB_SELECT_WRITABLE;
+
+    if (ringBuffer == NULL || events == 0 || (events & ~all) != 0
+        || findWatcher(sel, ringBuffer) != NULL) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    RingBufferWatcher *watcher = findWatcher(sel, NULL);
+
+    if (watcher == NULL) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    RingBufferImpl *rb = impl(ringBuffer);
+
+    if (pthread_mutex_lock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    watcher->ringBuffer = ringBuffer;
+    watcher->events     = events;
+    watcher->next       = rb->watchers;
+    rb->watchers        = watcher;
+    __atomic_fetch_add(&rb->watcherCount, 1, __ATOMIC_RELEASE);
+
+    if (pthread_mutex_unlock(&rb->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode
+ringBufferSelectorRemove(RingBufferSelector *selector, RingBuffer *ringBuffer)
+{
+    RingBufferWatcher *watcher
+        = ringBuffer == NULL ? NULL
+                             : findWatcher(selectorImpl(selector), ringBuffer);
+
+    if (watcher == NULL) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    return unlinkWatcher(watcher);
+}
+
+/*!
+ * \brief Examines the ring buffers of a selector.
+ * \param sel The selector implementation.
+ * \param ready The buffer to report the ring buffers ready in.
+ * \param maxReady The size of `ready` in elements.
+ * \param readyCount Output parameter for the amount of ring buffers ready.
+ * \return The status code.
+ **/
+static RingBufferStatusCode collectReady(
+    RingBufferSelectorImpl *sel,
+    RingBufferReady *       ready,
+    size_t                  maxReady,
+    size_t *                readyCount)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < sel->maxWatchers && count < maxReady; ++i) {
+        const RingBufferWatcher *watcher = &sel->watchers[i];
+
+        if (watcher->ringBuffer == NULL) {
+            continue;
+        }
+
+        RingBufferImpl *rb     = impl(watcher->ringBuffer);
+        unsigned        events = 0;
+
+        if (pthread_mutex_lock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_LOCK_MUTEX;
+        }
+
+        if ((watcher->events & RB_SELECT_READABLE) != 0
+            && isReadable(rb, false)) {
+            events |= RB_SELECT_READABLE;
+        }
+
+        if ((watcher->events & RB_SELECT_WRITABLE) != 0 && !isFull(rb)) {
+            events |= RB_SELECT_WRITABLE;
+        }
+
+        if (pthread_mutex_unlock(&rb->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        if (events != 0) {
+            ready[count].ringBuffer = watcher->ringBuffer;
+            ready[count].events     = events;
+            ++count;
+        }
+    }
+
+    *readyCount = count;
     return RB_OK;
 }
+
+RingBufferStatusCode ringBufferSelect(
+    RingBufferSelector *selector,
+    RingBufferReady *   ready,
+    size_t              maxReady,
+    size_t *            readyCount,
+    Thread *            self)
+{
+    RingBufferSelectorImpl *sel = selectorImpl(selector);
+
+    if (maxReady == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    for (;;) {
+        // Take the generation before examining the ring buffers, so that
+        // anything becoming ready afterwards cuts the wait short.
+        if (pthread_mutex_lock(&sel->mutex) != 0) {
+            return RB_FAILURE_TO_LOCK_MUTEX;
+        }
+
+        const uint64_t generation = sel->generation;
+
+        if (pthread_mutex_unlock(&sel->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+
+        const RingBufferStatusCode statusCode
+            = collectReady(sel, ready, maxReady, readyCount);
+
+        if (statusCode != RB_OK || *readyCount != 0) {
+            return statusCode;
+        }
+
+        bool shouldShutdown = false;
+
+        if (self != NULL && !threadShouldShutdown(self, &shouldShutdown)) {
+            return RB_FAILURE_TO_DETERMINE_SHUTDOWN_STATE;
+        }
+
+        if (shouldShutdown) {
+            return RB_THREAD_SHOULD_SHUTDOWN;
+        }
+
+        if (pthread_mutex_lock(&sel->mutex) != 0) {
+            return RB_FAILURE_TO_LOCK_MUTEX;
+        }
+
+        while (sel->generation == generation) {
+            if (pthread_cond_wait(&sel->wakeUp, &sel->mutex) != 0) {
+                pthread_mutex_unlock(&sel->mutex);
+                return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+            }
+        }
+
+        if (pthread_mutex_unlock(&sel->mutex) != 0) {
+            return RB_FAILURE_TO_UNLOCK_MUTEX;
+        }
+    }
+}
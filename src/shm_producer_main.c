@@ -0,0 +1,171 @@
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pthread.h>
+
+#include "cmd_args.h"
+#include "shm_ring_buffer.h"
+#include "sleep_thread.h"
+
+/*!
+ * \brief Argument to the producer thread.
+ **/
+typedef struct {
+    ShmRingBuffer *ringBuffer;       /*!< The ring buffer to write to */
+    int32_t        sleepTimeSeconds; /*!< Sleep time */
+    int            id;               /*!< The thread ID */
+} ProducerArgument;
+
+/*!
+ * \brief The producer thread routine.
+ * \param argument Pointer to the `ProducerArgument`.
+ * \return The exit status casted to void*.
+ *
+ * Writes the alphabet to the ring buffer, in upper case if the thread ID is
+ * odd, just like the producers of the threaded application.
+ **/
+static void *producerRoutine(void *argument)
+{
+    const ProducerArgument *arg = (const ProducerArgument *) argument;
+
+    // The (lower case) English alphabet.
+    static const char   alphabet[]   = "abcdefghijklmnopqrstuvwxyz";
+    static const size_t alphabetSize = sizeof(alphabet) - 1;
+
+    int    exitStatus = EXIT_SUCCESS;
+    size_t index      = 0;
+
+    for (;;) {
+        // Turning off the 3rd most significant bit yields upper case.
+        const byte byteToWrite = (arg->id & 1) == 0
+                                     ? (byte) alphabet[index]
+                                     : (byte) (alphabet[index] & ~0x20);
+
+        const RingBufferStatusCode statusCode
+            = shmRingBufferWrite(arg->ringBuffer, byteToWrite, arg->id);
+
+        if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+            break;
+        }
+
+        if (RB_FAILURE(statusCode)) {
+            fprintf(
+                stderr,
+                "Producer (tid: %d) could not write: %s\n",
+                arg->id,
+                ringBufferStatusCodeToString(statusCode));
+            exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        printf("Producer (tid: %d) just wrote %c.\n", arg->id, byteToWrite);
+
+        sleepThread(arg->sleepTimeSeconds);
+
+        ++index;
+
+        if (index == alphabetSize) {
+            index = 0;
+        }
+    }
+
+    /* cast to uintptr_t first to avoid warnings */
+    return (void *) (uintptr_t) exitStatus;
+}
+
+/*!
+ * \brief Global variable that will hold the last signal emitted.
+ **/
+volatile sig_atomic_t gSignalStatus = 0;
+
+/*!
+ * \brief The signal handler for this application.
+ * \param signal The signal that was emitted (should be SIGINT).
+ **/
+static void signalHandler(int signal)
+{
+    gSignalStatus = signal;
+}
+
+/*!
+ * \brief The entry point of the shared memory producer application.
+ * \param argc The count of command line arguments.
+ * \param argv The command line arguments.
+ * \return EXIT_SUCCESS on success; otherwise EXIT_FAILURE.
+ **/
+int main(int argc, char **argv)
+{
+    signal(SIGINT, &signalHandler);
+
+    const ShmCmdArgs commandLineArguments = parseShmCmdArgs(argc, argv);
+
+    if (!commandLineArguments.isOk) {
+        return EXIT_FAILURE;
+    }
+
+    const size_t ringBufferSize = commandLineArguments.ringBufferSize == 0
+                                      ? 10
+                                      : commandLineArguments.ringBufferSize;
+    ShmRingBuffer *      ringBuffer = NULL;
+    RingBufferStatusCode statusCode = shmRingBufferOpen(
+        commandLineArguments.name, ringBufferSize, &ringBuffer);
+
+    if (RB_FAILURE(statusCode)) {
+        fprintf(
+            stderr,
+            "Could not open shared memory ring buffer %s: %s\n",
+            commandLineArguments.name,
+            ringBufferStatusCodeToString(statusCode));
+        return EXIT_FAILURE;
+    }
+
+    ProducerArgument argument = {
+        ringBuffer,
+        commandLineArguments.sleepTime,
+        commandLineArguments.id};
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, &producerRoutine, &argument) != 0) {
+        shmRingBufferDetach(ringBuffer);
+        return EXIT_FAILURE;
+    }
+
+    // Have the main thread wait for SIGINT to be emitted.
+    while (gSignalStatus != SIGINT) {
+        sleepThread(/* seconds */ 1);
+    }
+
+    printf("Shutdown of the producer was requested.\n");
+
+    int programExitStatus = EXIT_SUCCESS;
+    statusCode            = shmRingBufferShutdown(ringBuffer);
+
+    if (RB_FAILURE(statusCode)) {
+        fprintf(
+            stderr,
+            "Could not shut down: %s\n",
+            ringBufferStatusCodeToString(statusCode));
+        programExitStatus = EXIT_FAILURE;
+    }
+
+    void *threadExitStatus;
+
+    if (pthread_join(thread, &threadExitStatus) != 0
+        || (int) (uintptr_t) threadExitStatus != EXIT_SUCCESS) {
+        programExitStatus = EXIT_FAILURE;
+    }
+
+    statusCode = shmRingBufferDetach(ringBuffer);
+
+    if (RB_FAILURE(statusCode)) {
+        fprintf(
+            stderr,
+            "Could not detach from the ring buffer: %s\n",
+            ringBufferStatusCodeToString(statusCode));
+        programExitStatus = EXIT_FAILURE;
+    }
+
+    return programExitStatus;
+}
@@ -0,0 +1,537 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shm_ring_buffer.h"
+#include "sleep_thread.h"
+
+/*!
+ * \def RB_PRINTLN
+ * \brief Macro to print a line form the ring buffer implementation.
+ **/
+#ifdef RB_IO
+#define RB_PRINTLN(fmtStr, ...) \
+    printf("ShmRingBuffer: " fmtStr "\n", __VA_ARGS__)
+#else
+#define RB_PRINTLN(...) (void) (__VA_ARGS__)
+#endif
+
+/*!
+ * \def SHM_RB_MAGIC
+ * \brief Written to the header last when creating a ring buffer, so that
+ *        attaching processes can tell that it has been fully initialized.
+ **/
+#define SHM_RB_MAGIC UINT32_C(0x53484D52)
+
+/*!
+ * \def SHM_RB_ATTACH_ATTEMPTS
+ * \brief How often `shmRingBufferOpen` tries to attach to a ring buffer that
+ *        another process is still initializing.
+ **/
+#define SHM_RB_ATTACH_ATTEMPTS 10
+
+/*!
+ * \def SHM_RB_ATTACH_MAX_BACKOFF_MILLISECONDS
+ * \brief Upper bound for the (doubling) wait between two attach attempts.
+ **/
+#define SHM_RB_ATTACH_MAX_BACKOFF_MILLISECONDS 100
+
+/*!
+ * \brief The part of the ring buffer that lives in shared memory.
+ *
+ * Uses indices rather than pointers, as the object is mapped at different
+ * addresses in different processes.
+ **/
+typedef struct {
+    volatile uint32_t magic;      /*!< SHM_RB_MAGIC once initialized */
+    size_t            bufferSize; /*!< Size of `buffer` in bytes */
+    size_t            in;         /*!< The write index */
+    size_t            out;        /*!< The read index */
+    size_t            count;      /*!< Count of bytes still to be read */
+    pthread_mutex_t   mutex;
+    pthread_cond_t    conditionVariable;
+    byte              buffer[]; /*!< The data, `bufferSize` bytes */
+} ShmRingBufferShared;
+
+/*!
+ * \brief Process local handle to a shared memory ring buffer.
+ **/
+typedef struct {
+    ShmRingBufferShared *shared;         /*!< The mapping */
+    size_t               mappingSize;    /*!< Size of the mapping in bytes */
+    char *               name;           /*!< Name of the shm object */
+    bool                 isCreator;      /*!< Whether this process created it */
+    bool                 shouldShutDown; /*!< Protected by the shared mutex */
+} ShmRingBufferImpl;
+
+static ShmRingBufferImpl *impl(ShmRingBuffer *rb)
+{
+    return (ShmRingBufferImpl *) rb;
+}
+
+static ShmRingBuffer *opaque(ShmRingBufferImpl *rb)
+{
+    return (ShmRingBuffer *) rb;
+}
+
+/*!
+ * \brief Creates the process local handle.
+ * \param name The name of the shared memory object.
+ * \param isCreator Whether the calling process creates the ring buffer.
+ * \return The handle on success; otherwise NULL.
+ **/
+static ShmRingBufferImpl *handleCreate(const char *name, bool isCreator)
+{
+    ShmRingBufferImpl *rb = malloc(sizeof(ShmRingBufferImpl));
+
+    if (rb == NULL) {
+        return NULL;
+    }
+
+    rb->name = malloc(strlen(name) + 1);
+
+    if (rb->name == NULL) {
+        free(rb);
+        return NULL;
+    }
+
+    strcpy(rb->name, name);
+    rb->shared         = NULL;
+    rb->mappingSize    = 0;
+    rb->isCreator      = isCreator;
+    rb->shouldShutDown = false;
+    return rb;
+}
+
+/*!
+ * \brief Frees the process local handle.
+ * \param rb The handle to free.
+ **/
+static void handleFree(ShmRingBufferImpl *rb)
+{
+    free(rb->name);
+    free(rb);
+}
+
+/*!
+ * \brief Initializes the process shared synchronization primitives.
+ * \param shared The shared part of the ring buffer.
+ * \return The status code.
+ **/
+static RingBufferStatusCode initSynchronization(ShmRingBufferShared *shared)
+{
+    pthread_mutexattr_t mutexAttributes;
+
+    if (pthread_mutexattr_init(&mutexAttributes) != 0) {
+        return RB_FAILURE_TO_INIT_MUTEX;
+    }
+
+    if (pthread_mutexattr_setpshared(&mutexAttributes, PTHREAD_PROCESS_SHARED)
+            != 0
+        || pthread_mutexattr_setrobust(&mutexAttributes, PTHREAD_MUTEX_ROBUST)
+               != 0
+        || pthread_mutex_init(&shared->mutex, &mutexAttributes) != 0) {
+        pthread_mutexattr_destroy(&mutexAttributes);
+        return RB_FAILURE_TO_INIT_MUTEX;
+    }
+
+    pthread_mutexattr_destroy(&mutexAttributes);
+
+    pthread_condattr_t condAttributes;
+
+    if (pthread_condattr_init(&condAttributes) != 0) {
+        pthread_mutex_destroy(&shared->mutex);
+        return RB_FAILURE_TO_INIT_CONDVAR;
+    }
+
+    if (pthread_condattr_setpshared(&condAttributes, PTHREAD_PROCESS_SHARED)
+            != 0
+        || pthread_cond_init(&shared->conditionVariable, &condAttributes)
+               != 0) {
+        pthread_condattr_destroy(&condAttributes);
+        pthread_mutex_destroy(&shared->mutex);
+        return RB_FAILURE_TO_INIT_CONDVAR;
+    }
+
+    pthread_condattr_destroy(&condAttributes);
+    return RB_OK;
+}
+
+RingBufferStatusCode shmRingBufferCreate(
+    const char *    name,
+    size_t          byteCount,
+    ShmRingBuffer **ringBuffer)
+{
+    if (name == NULL || byteCount == 0) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    ShmRingBufferImpl *rb = handleCreate(name, /* isCreator */ true);
+
+    if (rb == NULL) {
+        return RB_NOMEM;
+    }
+
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (fd == -1) {
+        handleFree(rb);
+        return RB_FAILURE_TO_MAP_SHARED_MEMORY;
+    }
+
+    rb->mappingSize = sizeof(ShmRingBufferShared) + byteCount;
+
+    if (ftruncate(fd, (off_t) rb->mappingSize) != 0) {
+        goto error;
+    }
+
+    void *mapping = mmap(
+        NULL, rb->mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (mapping == MAP_FAILED) {
+        goto error;
+    }
+
+    // The mapping stays valid after the file descriptor has been closed.
+    close(fd);
+
+    rb->shared             = mapping;
+    rb->shared->bufferSize = byteCount;
+    rb->shared->in         = 0;
+    rb->shared->out        = 0;
+    rb->shared->count      = 0;
+
+    const RingBufferStatusCode statusCode = initSynchronization(rb->shared);
+
+    if (RB_FAILURE(statusCode)) {
+        munmap(rb->shared, rb->mappingSize);
+        shm_unlink(name);
+        handleFree(rb);
+        return statusCode;
+    }
+
+    // Publish: from here on other processes may attach.
+    __sync_synchronize();
+    rb->shared->magic = SHM_RB_MAGIC;
+
+    *ringBuffer = opaque(rb);
+    return RB_OK;
+
+error:
+    close(fd);
+    shm_unlink(name);
+    handleFree(rb);
+    return RB_FAILURE_TO_MAP_SHARED_MEMORY;
+}
+
+RingBufferStatusCode
+shmRingBufferAttach(const char *name, ShmRingBuffer **ringBuffer)
+{
+    if (name == NULL) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    ShmRingBufferImpl *rb = handleCreate(name, /* isCreator */ false);
+
+    if (rb == NULL) {
+        return RB_NOMEM;
+    }
+
+    const int fd = shm_open(name, O_RDWR, 0);
+
+    if (fd == -1) {
+        handleFree(rb);
+        return RB_FAILURE_TO_MAP_SHARED_MEMORY;
+    }
+
+    struct stat status;
+
+    if (fstat(fd, &status) != 0
+        || (size_t) status.st_size <= sizeof(ShmRingBufferShared)) {
+        close(fd);
+        handleFree(rb);
+        return RB_FAILURE_TO_MAP_SHARED_MEMORY;
+    }
+
+    rb->mappingSize = (size_t) status.st_size;
+
+    void *mapping = mmap(
+        NULL, rb->mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        handleFree(rb);
+        return RB_FAILURE_TO_MAP_SHARED_MEMORY;
+    }
+
+    rb->shared = mapping;
+
+    // Reject objects that aren't (fully initialized) ring buffers.
+    if (rb->shared->magic != SHM_RB_MAGIC
+        || sizeof(ShmRingBufferShared) + rb->shared->bufferSize
+               != rb->mappingSize) {
+        munmap(rb->shared, rb->mappingSize);
+        handleFree(rb);
+        return RB_FAILURE_TO_MAP_SHARED_MEMORY;
+    }
+
+    __sync_synchronize();
+
+    *ringBuffer = opaque(rb);
+    return RB_OK;
+}
+
+RingBufferStatusCode shmRingBufferOpen(
+    const char *    name,
+    size_t          byteCount,
+    ShmRingBuffer **ringBuffer)
+{
+    const RingBufferStatusCode statusCode
+        = shmRingBufferCreate(name, byteCount, ringBuffer);
+
+    if (statusCode != RB_FAILURE_TO_MAP_SHARED_MEMORY || errno != EEXIST) {
+        return statusCode;
+    }
+
+    // Somebody else was first -> attach to theirs. They may not have sized
+    // the object or published the magic yet, so give them some time.
+    int32_t              backoffMilliseconds = 1;
+    RingBufferStatusCode attachStatusCode    = RB_FAILURE_TO_MAP_SHARED_MEMORY;
+
+    for (int attempt = 0; attempt < SHM_RB_ATTACH_ATTEMPTS; ++attempt) {
+        if (attempt > 0) {
+            RB_PRINTLN(
+                "\"%s\" isn't initialized yet, retrying in %d ms.",
+                name,
+                (int) backoffMilliseconds);
+            sleepThreadMilliseconds(backoffMilliseconds);
+
+            if (backoffMilliseconds < SHM_RB_ATTACH_MAX_BACKOFF_MILLISECONDS) {
+                backoffMilliseconds *= 2;
+            }
+        }
+
+        attachStatusCode = shmRingBufferAttach(name, ringBuffer);
+
+        if (attachStatusCode != RB_FAILURE_TO_MAP_SHARED_MEMORY) {
+            break;
+        }
+    }
+
+    return attachStatusCode;
+}
+
+RingBufferStatusCode shmRingBufferDetach(ShmRingBuffer *ringBuffer)
+{
+    ShmRingBufferImpl *rb = impl(ringBuffer);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (rb == NULL) {
+        return RB_OK;
+    }
+
+    bool success = munmap(rb->shared, rb->mappingSize) == 0;
+
+    // The mutex and condition variable aren't destroyed, as other processes
+    // may still be attached. They go away together with the memory.
+    if (rb->isCreator && shm_unlink(rb->name) != 0) {
+        success = false;
+    }
+
+    handleFree(rb);
+    return success ? RB_OK : RB_FAILURE_TO_MAP_SHARED_MEMORY;
+}
+
+/*!
+ * \brief Makes the mutex consistent again if its previous owner died.
+ * \param errorCode The return value of locking the mutex.
+ * \param shared The shared part of the ring buffer.
+ * \return true if the mutex is held now; otherwise false.
+ *
+ * The state protected is just a handful of counters, so it's fine to carry
+ * on. At worst the byte the dead process was transferring is lost.
+ **/
+static bool recoverMutex(int errorCode, ShmRingBufferShared *shared)
+{
+    if (errorCode == 0) {
+        return true;
+    }
+
+    if (errorCode == EOWNERDEAD) {
+        // count must never exceed the buffer size for the loops below to work.
+        if (shared->count > shared->bufferSize) {
+            shared->count = shared->bufferSize;
+        }
+
+        return pthread_mutex_consistent(&shared->mutex) == 0;
+    }
+
+    return false;
+}
+
+/*!
+ * \brief Helper function to advance an index in the ring buffer.
+ * \param shared The shared part of the ring buffer.
+ * \param index A pointer to the index to advance.
+ **/
+static void advanceIndex(ShmRingBufferShared *shared, size_t *index)
+{
+    // If we're at the end -> go to the front.
+    if (*index == shared->bufferSize - 1) {
+        *index = 0;
+    }
+    else {
+        // Otherwise -> Just bump the index.
+        ++*index;
+    }
+}
+
+RingBufferStatusCode
+shmRingBufferWrite(ShmRingBuffer *ringBuffer, byte toWrite, int threadId)
+{
+    ShmRingBufferImpl *  rb     = impl(ringBuffer);
+    ShmRingBufferShared *shared = rb->shared;
+
+    if (!recoverMutex(pthread_mutex_lock(&shared->mutex), shared)) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // Condition variable loop.
+    // Wait for slots in the ring buffer to become free.
+    // Look at the shutdown state first, so that shutting down doesn't
+    // depend on having to wait.
+    for (;;) {
+        if (rb->shouldShutDown) {
+            if (pthread_mutex_unlock(&shared->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            return RB_THREAD_SHOULD_SHUTDOWN;
+        }
+
+        if (!(shared->count >= shared->bufferSize)) {
+            break;
+        }
+
+        RB_PRINTLN(
+            "Producer (pid: %ld, tid: %d) has to wait for space to become "
+            "free, trying to write %c",
+            (long) getpid(),
+            threadId,
+            toWrite);
+
+        if (!recoverMutex(
+                pthread_cond_wait(&shared->conditionVariable, &shared->mutex),
+                shared)) {
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    // Write.
+    shared->buffer[shared->in] = toWrite;
+    ++shared->count;
+    advanceIndex(shared, &shared->in);
+
+    if (pthread_mutex_unlock(&shared->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    // Wake everyone who is waiting on the condition variable, in all the
+    // processes.
+    if (pthread_cond_broadcast(&shared->conditionVariable) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    return RB_OK;
+}
+
+RingBufferStatusCode
+shmRingBufferRead(ShmRingBuffer *ringBuffer, byte *byteRead, int threadId)
+{
+    ShmRingBufferImpl *  rb     = impl(ringBuffer);
+    ShmRingBufferShared *shared = rb->shared;
+
+    if (!recoverMutex(pthread_mutex_lock(&shared->mutex), shared)) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    // Condition variable loop.
+    // Wait for data to become available for reading.
+    // Look at the shutdown state first, so that shutting down doesn't
+    // depend on having to wait.
+    for (;;) {
+        if (rb->shouldShutDown) {
+            if (pthread_mutex_unlock(&shared->mutex) != 0) {
+                return RB_FAILURE_TO_UNLOCK_MUTEX;
+            }
+
+            return RB_THREAD_SHOULD_SHUTDOWN;
+        }
+
+        if (!(shared->count == 0)) {
+            break;
+        }
+
+        RB_PRINTLN(
+            "Consumer (pid: %ld, tid: %d) has to wait for data to be written "
+            "while trying to read.",
+            (long) getpid(),
+            threadId);
+
+        if (!recoverMutex(
+                pthread_cond_wait(&shared->conditionVariable, &shared->mutex),
+                shared)) {
+            return RB_FAILURE_TO_WAIT_ON_CONDVAR;
+        }
+    }
+
+    // Read a byte.
+    const byte byteJustRead = shared->buffer[shared->out];
+    --shared->count;
+    advanceIndex(shared, &shared->out);
+
+    if (pthread_mutex_unlock(&shared->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    if (pthread_cond_broadcast(&shared->conditionVariable) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    *byteRead = byteJustRead;
+    return RB_OK;
+}
+
+RingBufferStatusCode shmRingBufferShutdown(ShmRingBuffer *ringBuffer)
+{
+    ShmRingBufferImpl *  rb     = impl(ringBuffer);
+    ShmRingBufferShared *shared = rb->shared;
+
+    if (!recoverMutex(pthread_mutex_lock(&shared->mutex), shared)) {
+        return RB_FAILURE_TO_LOCK_MUTEX;
+    }
+
+    rb->shouldShutDown = true;
+
+    if (pthread_mutex_unlock(&shared->mutex) != 0) {
+        return RB_FAILURE_TO_UNLOCK_MUTEX;
+    }
+
+    // Wake all the waiters. The ones of other processes will go back to
+    // sleep.
+    if (pthread_cond_broadcast(&shared->conditionVariable) != 0) {
+        return RB_FAILURE_TO_SIGNAL_CONDVAR;
+    }
+
+    return RB_OK;
+}
@@ -0,0 +1,615 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SINK_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "sink.h"
+
+/*!
+ * \def SINK_MAX_IOVECS
+ * \brief The maximum amount of buffers gathered into a single writev.
+ **/
+#ifdef IOV_MAX
+#define SINK_MAX_IOVECS IOV_MAX
+#else
+#define SINK_MAX_IOVECS 16
+#endif
+
+/*!
+ * \brief A write submitted to the sink.
+ **/
+typedef struct {
+    struct iovec iov;      /*!< The bytes to write */
+    uint64_t     position; /*!< The file offset to write to */
+    uint64_t     tag;      /*!< Returned when the write completed */
+} SinkWrite;
+
+#ifdef SINK_HAVE_IO_URING
+/*!
+ * \brief The mappings of an io_uring instance.
+ **/
+typedef struct {
+    int                  fd;            /*!< The io_uring file descriptor */
+    void *               sqMapping;     /*!< The submission queue ring */
+    size_t               sqMappingSize; /*!< Size of `sqMapping` */
+    void *               cqMapping;     /*!< The completion queue ring */
+    size_t               cqMappingSize; /*!< Size of `cqMapping` */
+    struct io_uring_sqe *sqes;          /*!< The submission queue entries */
+    size_t               sqesSize;      /*!< Size of `sqes` in bytes */
+    unsigned *           sqTail;
+    unsigned *           sqMask;
+    unsigned *           sqArray;
+    unsigned *           cqHead;
+    unsigned *           cqTail;
+    unsigned *           cqMask;
+    struct io_uring_cqe *cqes;
+} IoUring;
+#endif
+
+/*!
+ * \brief Sink implementation type.
+ **/
+typedef struct {
+    int         fd;              /*!< The file written to */
+    bool        isSeekable;      /*!< false for pipes */
+    unsigned    queueDepth;      /*!< Maximum writes in flight */
+    unsigned    inFlight;        /*!< Writes not yet waited for */
+    SinkWrite * writes;          /*!< Submitted writes, `queueDepth` many */
+    unsigned    writeCount;      /*!< writev: Writes not yet issued */
+    uint64_t *  completed;       /*!< writev: Tags of completed writes */
+    unsigned    completedBegin;  /*!< writev: Oldest entry of `completed` */
+    unsigned    completedCount;  /*!< writev: Entries in `completed` */
+    const byte *fixedBuffer;     /*!< io_uring: The registered buffer */
+    size_t      fixedBufferSize; /*!< io_uring: Size of `fixedBuffer` */
+    bool        usesIoUring;     /*!< Whether io_uring is used */
+#ifdef SINK_HAVE_IO_URING
+    IoUring   ring;          /*!< The io_uring instance */
+    unsigned *freeSlots;     /*!< io_uring: Unused indices of `writes` */
+    unsigned  freeSlotCount; /*!< io_uring: Entries in `freeSlots` */
+#endif
+} SinkImpl;
+
+static SinkImpl *impl(Sink *sink)
+{
+    return (SinkImpl *) sink;
+}
+
+static const SinkImpl *constImpl(const Sink *sink)
+{
+    return (const SinkImpl *) sink;
+}
+
+static Sink *opaque(SinkImpl *sink)
+{
+    return (Sink *) sink;
+}
+
+/*!
+ * \brief Writes buffers completely, retrying after short writes.
+ * \param sink The sink.
+ * \param iov The buffers to write; modified.
+ * \param iovCount The amount of buffers.
+ * \param position The file offset to write to; ignored for pipes.
+ * \return true on success; otherwise false.
+ **/
+static bool
+writeAll(SinkImpl *sink, struct iovec *iov, int iovCount, uint64_t position)
+{
+    if (sink->isSeekable
+        && lseek(sink->fd, (off_t) position, SEEK_SET) == (off_t) -1) {
+        return false;
+    }
+
+    while (iovCount > 0) {
+        ssize_t written = writev(sink->fd, iov, iovCount);
+
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        // Skip what has been written.
+        while (iovCount > 0 && (size_t) written >= iov->iov_len) {
+            written -= (ssize_t) iov->iov_len;
+            ++iov;
+            --iovCount;
+        }
+
+        if (iovCount > 0) {
+            iov->iov_base = (byte *) iov->iov_base + written;
+            iov->iov_len -= (size_t) written;
+        }
+    }
+
+    return true;
+}
+
+#ifdef SINK_HAVE_IO_URING
+/*!
+ * \brief Sets up an io_uring instance.
+ * \param ring The instance to set up.
+ * \param entries The size of the queues.
+ * \return true on success; false if io_uring is unavailable.
+ **/
+static bool ioUringSetup(IoUring *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+
+    if (ring->fd == -1) {
+        return false;
+    }
+
+    ring->sqMappingSize
+        = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqMappingSize = params.cq_off.cqes
+                          + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    // Newer kernels map both rings at once.
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        if (ring->cqMappingSize > ring->sqMappingSize) {
+            ring->sqMappingSize = ring->cqMappingSize;
+        }
+
+        ring->cqMappingSize = ring->sqMappingSize;
+    }
+
+    ring->sqMapping = mmap(
+        NULL,
+        ring->sqMappingSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        ring->fd,
+        IORING_OFF_SQ_RING);
+
+    if (ring->sqMapping == MAP_FAILED) {
+        close(ring->fd);
+        return false;
+    }
+
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        ring->cqMapping = ring->sqMapping;
+    }
+    else {
+        ring->cqMapping = mmap(
+            NULL,
+            ring->cqMappingSize,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            ring->fd,
+            IORING_OFF_CQ_RING);
+
+        if (ring->cqMapping == MAP_FAILED) {
+            munmap(ring->sqMapping, ring->sqMappingSize);
+            close(ring->fd);
+            return false;
+        }
+    }
+
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes     = mmap(
+        NULL,
+        ring->sqesSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        ring->fd,
+        IORING_OFF_SQES);
+
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cqMapping != ring->sqMapping) {
+            munmap(ring->cqMapping, ring->cqMappingSize);
+        }
+
+        munmap(ring->sqMapping, ring->sqMappingSize);
+        close(ring->fd);
+        return false;
+    }
+
+    byte *sq      = ring->sqMapping;
+    byte *cq      = ring->cqMapping;
+    ring->sqTail  = (unsigned *) (sq + params.sq_off.tail);
+    ring->sqMask  = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *) (sq + params.sq_off.array);
+    ring->cqHead  = (unsigned *) (cq + params.cq_off.head);
+    ring->cqTail  = (unsigned *) (cq + params.cq_off.tail);
+    ring->cqMask  = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes    = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return true;
+}
+
+/*!
+ * \brief Tears down an io_uring instance.
+ * \param ring The instance to tear down.
+ **/
+static void ioUringTeardown(IoUring *ring)
+{
+    munmap(ring->sqes, ring->sqesSize);
+
+    if (ring->cqMapping != ring->sqMapping) {
+        munmap(ring->cqMapping, ring->cqMappingSize);
+    }
+
+    munmap(ring->sqMapping, ring->sqMappingSize);
+    close(ring->fd);
+}
+
+/*!
+ * \brief Submits a write to an io_uring instance.
+ * \param sink The sink.
+ * \param slot The index of the write in `sink->writes`.
+ * \return true on success; otherwise false.
+ **/
+static bool ioUringSubmit(SinkImpl *sink, unsigned slot)
+{
+    IoUring *        ring  = &sink->ring;
+    const SinkWrite *write = &sink->writes[slot];
+
+    // We are the only producer of submissions, so a relaxed load is enough.
+    const unsigned tail  = *ring->sqTail;
+    const unsigned index = tail & *ring->sqMask;
+
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd        = sink->fd;
+    sqe->off       = sink->isSeekable ? write->position : 0;
+    sqe->user_data = slot;
+
+    const byte *data = write->iov.iov_base;
+
+    if (sink->fixedBuffer != NULL && data >= sink->fixedBuffer
+        && data + write->iov.iov_len
+               <= sink->fixedBuffer + sink->fixedBufferSize) {
+        sqe->opcode    = IORING_OP_WRITE_FIXED;
+        sqe->addr      = (uint64_t) (uintptr_t) data;
+        sqe->len       = (uint32_t) write->iov.iov_len;
+        sqe->buf_index = 0;
+    }
+    else {
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->addr   = (uint64_t) (uintptr_t) &write->iov;
+        sqe->len    = 1;
+    }
+
+    ring->sqArray[index] = index;
+
+    // Publish the entry before the new tail.
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    for (;;) {
+        const long submitted
+            = syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+
+        if (submitted == 1) {
+            return true;
+        }
+
+        if (submitted == -1 && (errno == EINTR || errno == EAGAIN)) {
+            continue;
+        }
+
+        return false;
+    }
+}
+
+/*!
+ * \brief Waits for a completion of an io_uring instance.
+ * \param ring The io_uring instance.
+ * \param cqe Output parameter for the completion.
+ * \return true on success; otherwise false.
+ **/
+static bool ioUringWait(IoUring *ring, struct io_uring_cqe *cqe)
+{
+    for (;;) {
+        const unsigned head = *ring->cqHead;
+
+        if (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+            *cqe = ring->cqes[head & *ring->cqMask];
+            __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        const long result = syscall(
+            __NR_io_uring_enter,
+            ring->fd,
+            0,
+            1,
+            IORING_ENTER_GETEVENTS,
+            NULL,
+            0);
+
+        if (result == -1 && errno != EINTR && errno != EAGAIN) {
+            return false;
+        }
+    }
+}
+#endif
+
+Sink *sinkCreate(
+    const char *path,
+    unsigned    queueDepth,
+    const byte *fixedBuffer,
+    size_t      fixedBufferSize)
+{
+    if (path == NULL || queueDepth == 0) {
+        return NULL;
+    }
+
+    SinkImpl *sink = calloc(1, sizeof(SinkImpl));
+
+    if (sink == NULL) {
+        return NULL;
+    }
+
+    sink->writes    = calloc(queueDepth, sizeof(SinkWrite));
+    sink->completed = calloc(queueDepth, sizeof(uint64_t));
+
+    if (sink->writes == NULL || sink->completed == NULL) {
+        goto error;
+    }
+
+    sink->fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+
+    if (sink->fd == -1) {
+        goto error;
+    }
+
+    struct stat status;
+
+    if (fstat(sink->fd, &status) != 0) {
+        close(sink->fd);
+        goto error;
+    }
+
+    sink->isSeekable = S_ISREG(status.st_mode);
+    sink->queueDepth = queueDepth;
+
+#ifdef SINK_HAVE_IO_URING
+    sink->freeSlots = calloc(queueDepth, sizeof(unsigned));
+
+    if (sink->freeSlots != NULL && ioUringSetup(&sink->ring, queueDepth)) {
+        sink->usesIoUring = true;
+
+        for (unsigned slot = 0; slot < queueDepth; ++slot) {
+            sink->freeSlots[slot] = slot;
+        }
+
+        sink->freeSlotCount = queueDepth;
+
+        // Concurrent writes to a pipe could complete out of order.
+        if (!sink->isSeekable) {
+            sink->queueDepth = 1;
+        }
+
+        // Fixed buffer writes are just an optimization; carry on without.
+        if (fixedBuffer != NULL) {
+            struct iovec iov;
+            iov.iov_base = (void *) fixedBuffer;
+            iov.iov_len  = fixedBufferSize;
+
+            if (syscall(
+                    __NR_io_uring_register,
+                    sink->ring.fd,
+                    IORING_REGISTER_BUFFERS,
+                    &iov,
+                    1)
+                == 0) {
+                sink->fixedBuffer     = fixedBuffer;
+                sink->fixedBufferSize = fixedBufferSize;
+            }
+        }
+    }
+#else
+    (void) fixedBuffer;
+    (void) fixedBufferSize;
+#endif
+
+    return opaque(sink);
+
+error:
+#ifdef SINK_HAVE_IO_URING
+    free(sink->freeSlots);
+#endif
+    free(sink->completed);
+    free(sink->writes);
+    free(sink);
+    return NULL;
+}
+
+bool sinkFree(Sink *sink)
+{
+    SinkImpl *s = impl(sink);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (s == NULL) {
+        return true;
+    }
+
+    bool success = true;
+
+    while (s->inFlight != 0) {
+        uint64_t tag;
+
+        if (!sinkWaitCompletion(sink, &tag)) {
+            success = false;
+            break;
+        }
+    }
+
+#ifdef SINK_HAVE_IO_URING
+    if (s->usesIoUring) {
+        ioUringTeardown(&s->ring);
+    }
+
+    free(s->freeSlots);
+#endif
+
+    if (close(s->fd) != 0) {
+        success = false;
+    }
+
+    free(s->completed);
+    free(s->writes);
+    free(s);
+    return success;
+}
+
+bool sinkUsesIoUring(const Sink *sink)
+{
+    return constImpl(sink)->usesIoUring;
+}
+
+unsigned sinkQueueDepth(const Sink *sink)
+{
+    return constImpl(sink)->queueDepth;
+}
+
+unsigned sinkInFlight(const Sink *sink)
+{
+    return constImpl(sink)->inFlight;
+}
+
+bool sinkSubmit(
+    Sink *      sink,
+    const byte *data,
+    size_t      size,
+    uint64_t    position,
+    uint64_t    tag)
+{
+    SinkImpl *s = impl(sink);
+
+    if (s->inFlight >= s->queueDepth) {
+        return false;
+    }
+
+    const SinkWrite write = {{(void *) data, size}, position, tag};
+
+#ifdef SINK_HAVE_IO_URING
+    if (s->usesIoUring) {
+        const unsigned slot = s->freeSlots[--s->freeSlotCount];
+        s->writes[slot]     = write;
+
+        if (!ioUringSubmit(s, slot)) {
+            s->freeSlots[s->freeSlotCount++] = slot;
+            return false;
+        }
+
+        ++s->inFlight;
+        return true;
+    }
+#endif
+
+    // Just collect the write; it is issued together with the others when a
+    // completion is waited for.
+    s->writes[s->writeCount++] = write;
+    ++s->inFlight;
+    return true;
+}
+
+/*!
+ * \brief Issues all the writes collected using as few writev calls as
+ *        possible.
+ * \param s The sink.
+ * \return true on success; otherwise false.
+ **/
+static bool flushWrites(SinkImpl *s)
+{
+    struct iovec iov[SINK_MAX_IOVECS];
+    unsigned     begin = 0;
+
+    while (begin < s->writeCount) {
+        // Gather the writes to consecutive file offsets.
+        int      iovCount = 0;
+        unsigned end      = begin;
+        uint64_t expected = s->writes[begin].position;
+
+        while (end < s->writeCount && iovCount < SINK_MAX_IOVECS
+               && (!s->isSeekable || s->writes[end].position == expected)) {
+            iov[iovCount++] = s->writes[end].iov;
+            expected += s->writes[end].iov.iov_len;
+            ++end;
+        }
+
+        if (!writeAll(s, iov, iovCount, s->writes[begin].position)) {
+            return false;
+        }
+
+        for (unsigned i = begin; i < end; ++i) {
+            const unsigned index
+                = (s->completedBegin + s->completedCount) % s->queueDepth;
+            s->completed[index] = s->writes[i].tag;
+            ++s->completedCount;
+        }
+
+        begin = end;
+    }
+
+    s->writeCount = 0;
+    return true;
+}
+
+bool sinkWaitCompletion(Sink *sink, uint64_t *tag)
+{
+    SinkImpl *s = impl(sink);
+
+    if (s->inFlight == 0) {
+        return false;
+    }
+
+#ifdef SINK_HAVE_IO_URING
+    if (s->usesIoUring) {
+        struct io_uring_cqe cqe;
+
+        if (!ioUringWait(&s->ring, &cqe)) {
+            return false;
+        }
+
+        const unsigned slot  = (unsigned) cqe.user_data;
+        SinkWrite *    write = &s->writes[slot];
+        bool           ok    = cqe.res >= 0;
+
+        // Finish short writes synchronously; they are rare.
+        if (ok && (size_t) cqe.res < write->iov.iov_len) {
+            write->iov.iov_base = (byte *) write->iov.iov_base + cqe.res;
+            write->iov.iov_len -= (size_t) cqe.res;
+            ok = writeAll(s, &write->iov, 1, write->position + cqe.res);
+        }
+
+        *tag                             = write->tag;
+        s->freeSlots[s->freeSlotCount++] = slot;
+        --s->inFlight;
+        return ok;
+    }
+#endif
+
+    if (s->completedCount == 0 && !flushWrites(s)) {
+        return false;
+    }
+
+    *tag              = s->completed[s->completedBegin];
+    s->completedBegin = (s->completedBegin + 1) % s->queueDepth;
+    --s->completedCount;
+    --s->inFlight;
+    return true;
+}
@@ -1,6 +1,11 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #ifdef _WIN32
 #include <Windows.h>
 #else
+#include <time.h>
 #include <unistd.h>
 #endif
 
@@ -14,3 +19,15 @@ void sleepThread(int32_t seconds)
     sleep((unsigned) seconds);
 #endif
 }
+
+void sleepThreadMilliseconds(int32_t milliseconds)
+{
+#ifdef _WIN32
+    Sleep(/* dwMilliseconds */ (DWORD) milliseconds);
+#else
+    struct timespec duration;
+    duration.tv_sec  = milliseconds / 1000;
+    duration.tv_nsec = (long) (milliseconds % 1000) * 1000000L;
+    nanosleep(&duration, NULL);
+#endif
+}
@@ -0,0 +1,613 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "spill_queue.h"
+
+/*!
+ * \brief Bytes collected in memory.
+ **/
+typedef struct SpillBatch {
+    struct SpillBatch *next;  /*!< The next newer sealed batch */
+    size_t             begin; /*!< Index of the first unread byte */
+    size_t             end;   /*!< One past the last byte */
+    byte               bytes[]; /*!< `batchSize` bytes */
+} SpillBatch;
+
+/*!
+ * \brief Spill queue implementation type.
+ *
+ * The segment files are numbered sequentially. The bytes on disk are older
+ * than the batch being written, which is older than the sealed batches,
+ * which are older than `batch`.
+ * `mutex` protects the members shared with `spillQueueFlush`, which does
+ * its writes holding `writeMutex` only. Only the thread holding
+ * `writeMutex` while `writing` is set touches `writeFile`.
+ **/
+typedef struct {
+    pthread_mutex_t mutex;             /*!< Held briefly; never for writes */
+    pthread_mutex_t writeMutex;        /*!< Held while writing to disk */
+    char *          directory;         /*!< Directory of the segment files */
+    SpillBatch *    batch;             /*!< Bytes still being collected */
+    SpillBatch *    sealedHead;        /*!< Oldest full batch not written */
+    SpillBatch *    sealedTail;        /*!< Newest full batch not written */
+    SpillBatch *    writing;           /*!< Being written; NULL if none */
+    size_t          batchSize;         /*!< Capacity of a batch */
+    size_t          segmentSize;       /*!< Bytes that finish a segment */
+    FILE *          writeFile;         /*!< The segment appended to */
+    uint64_t        writeSegment;      /*!< Number of the segment appended */
+    size_t          writeSegmentBytes; /*!< Bytes written to `writeSegment` */
+    size_t          diskSize;          /*!< Bytes on disk not yet read */
+    FILE *          readFile;          /*!< The segment currently read from */
+    uint64_t        readSegment;       /*!< Number of the segment read from */
+    size_t          readOffset;        /*!< Bytes read from `readSegment` */
+    size_t          size;              /*!< Bytes in the queue (all tiers) */
+} SpillQueueImpl;
+
+static SpillQueueImpl *impl(SpillQueue *spillQueue)
+{
+    return (SpillQueueImpl *) spillQueue;
+}
+
+static const SpillQueueImpl *constImpl(const SpillQueue *spillQueue)
+{
+    return (const SpillQueueImpl *) spillQueue;
+}
+
+static SpillQueue *opaque(SpillQueueImpl *spillQueue)
+{
+    return (SpillQueue *) spillQueue;
+}
+
+/*!
+ * \brief Builds the path of a segment file.
+ * \param sq The spill queue.
+ * \param segment The number of the segment.
+ * \param path Output parameter for the path.
+ * \param pathSize The size of `path` in bytes.
+ **/
+static void segmentPath(
+    const SpillQueueImpl *sq,
+    uint64_t              segment,
+    char *                path,
+    size_t                pathSize)
+{
+    snprintf(
+        path,
+        pathSize,
+        "%s/segment-%020llu.spill",
+        sq->directory,
+        (unsigned long long) segment);
+}
+
+/*!
+ * \brief Opens a segment file.
+ * \param sq The spill queue.
+ * \param segment The number of the segment to open.
+ * \param mode The mode to pass to fopen.
+ * \return The file opened on success; otherwise NULL.
+ **/
+static FILE *openSegment(SpillQueueImpl *sq, uint64_t segment, const char *mode)
+{
+    char path[4096];
+    segmentPath(sq, segment, path, sizeof(path));
+
+    FILE *file = fopen(path, mode);
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    // We only ever read and write in large chunks ourselves, so stdio's
+    // buffering would only add another copy.
+    setvbuf(file, NULL, _IONBF, 0);
+    return file;
+}
+
+/*!
+ * \brief Deletes a segment file.
+ * \param sq The spill queue.
+ * \param segment The number of the segment to delete.
+ * \return true on success; otherwise false.
+ **/
+static bool removeSegment(SpillQueueImpl *sq, uint64_t segment)
+{
+    char path[4096];
+    segmentPath(sq, segment, path, sizeof(path));
+
+    return remove(path) == 0;
+}
+
+/*!
+ * \brief Allocates an empty batch.
+ * \param sq The spill queue.
+ * \return The batch allocated on success; otherwise NULL.
+ **/
+static SpillBatch *batchCreate(const SpillQueueImpl *sq)
+{
+    SpillBatch *batch = malloc(sizeof(SpillBatch) + sq->batchSize);
+
+    if (batch == NULL) {
+        return NULL;
+    }
+
+    batch->next  = NULL;
+    batch->begin = 0;
+    batch->end   = 0;
+    return batch;
+}
+
+SpillQueue *
+spillQueueCreate(const char *directory, size_t batchSize, size_t segmentSize)
+{
+    if (directory == NULL || batchSize == 0 || segmentSize == 0) {
+        return NULL;
+    }
+
+    SpillQueueImpl *sq = malloc(sizeof(SpillQueueImpl));
+
+    if (sq == NULL) {
+        return NULL;
+    }
+
+    sq->directory = malloc(strlen(directory) + 1);
+
+    if (sq->directory == NULL) {
+        goto errorFreeQueue;
+    }
+
+    strcpy(sq->directory, directory);
+
+    sq->batchSize = batchSize;
+    sq->batch     = batchCreate(sq);
+
+    if (sq->batch == NULL) {
+        goto errorFreeDirectory;
+    }
+
+    if (pthread_mutex_init(&sq->mutex, NULL) != 0) {
+        goto errorFreeBatch;
+    }
+
+    if (pthread_mutex_init(&sq->writeMutex, NULL) != 0) {
+        goto errorDestroyMutex;
+    }
+
+    sq->sealedHead        = NULL;
+    sq->sealedTail        = NULL;
+    sq->writing           = NULL;
+    sq->segmentSize       = segmentSize;
+    sq->writeFile         = NULL;
+    sq->writeSegment      = 0;
+    sq->writeSegmentBytes = 0;
+    sq->diskSize          = 0;
+    sq->readFile          = NULL;
+    sq->readSegment       = 0;
+    sq->readOffset        = 0;
+    sq->size              = 0;
+
+    return opaque(sq);
+
+errorDestroyMutex:
+    pthread_mutex_destroy(&sq->mutex);
+errorFreeBatch:
+    free(sq->batch);
+errorFreeDirectory:
+    free(sq->directory);
+errorFreeQueue:
+    free(sq);
+    return NULL;
+}
+
+bool spillQueueFree(SpillQueue *spillQueue)
+{
+    SpillQueueImpl *sq = impl(spillQueue);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (sq == NULL) {
+        return true;
+    }
+
+    bool success = true;
+
+    if (sq->readFile != NULL && fclose(sq->readFile) != 0) {
+        success = false;
+    }
+
+    if (sq->writeFile != NULL && fclose(sq->writeFile) != 0) {
+        success = false;
+    }
+
+    // Delete the segments that were never consumed.
+    // The segment being written to only exists if something was written.
+    for (uint64_t segment = sq->readSegment; segment < sq->writeSegment;
+         ++segment) {
+        if (!removeSegment(sq, segment)) {
+            success = false;
+        }
+    }
+
+    if (sq->writeSegmentBytes != 0 && !removeSegment(sq, sq->writeSegment)) {
+        success = false;
+    }
+
+    while (sq->sealedHead != NULL) {
+        SpillBatch *next = sq->sealedHead->next;
+        free(sq->sealedHead);
+        sq->sealedHead = next;
+    }
+
+    pthread_mutex_destroy(&sq->writeMutex);
+    pthread_mutex_destroy(&sq->mutex);
+    free(sq->batch);
+    free(sq->directory);
+    free(sq);
+    return success;
+}
+
+/*!
+ * \brief Appends bytes to the current segment file.
+ * \param sq The spill queue.
+ * \param bytes The bytes to append.
+ * \param byteCount The amount of bytes.
+ * \return true on success; otherwise false.
+ * \note Must be called holding `writeMutex` only, with `writing` set.
+ **/
+static bool
+appendToSegment(SpillQueueImpl *sq, const byte *bytes, size_t byteCount)
+{
+    if (sq->writeFile == NULL) {
+        sq->writeFile = openSegment(sq, sq->writeSegment, "wb");
+
+        if (sq->writeFile == NULL) {
+            return false;
+        }
+    }
+
+    if (fwrite(bytes, 1, byteCount, sq->writeFile) == byteCount) {
+        return true;
+    }
+
+    // Have a retry write over whatever part made it.
+    fseek(sq->writeFile, (long) sq->writeSegmentBytes, SEEK_SET);
+    return false;
+}
+
+/*!
+ * \brief Accounts for bytes appended to the current segment file.
+ * \param sq The spill queue.
+ * \param byteCount The amount of bytes appended.
+ * \return true on success; otherwise false.
+ * \note Must be called with `mutex` held.
+ **/
+static bool finishAppend(SpillQueueImpl *sq, size_t byteCount)
+{
+    sq->writeSegmentBytes += byteCount;
+    sq->diskSize += byteCount;
+
+    // Start a new segment once the current one is large enough.
+    if (sq->writeSegmentBytes >= sq->segmentSize) {
+        const bool couldClose = fclose(sq->writeFile) == 0;
+        sq->writeFile         = NULL;
+        ++sq->writeSegment;
+        sq->writeSegmentBytes = 0;
+
+        if (!couldClose) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool spillQueuePush(SpillQueue *spillQueue, byte toPush)
+{
+    SpillQueueImpl *sq = impl(spillQueue);
+
+    pthread_mutex_lock(&sq->mutex);
+
+    // Seal the full batch for `spillQueueFlush` to write.
+    if (sq->batch->end == sq->batchSize) {
+        SpillBatch *batch = batchCreate(sq);
+
+        if (batch == NULL) {
+            pthread_mutex_unlock(&sq->mutex);
+            return false;
+        }
+
+        if (sq->sealedTail == NULL) {
+            sq->sealedHead = sq->batch;
+        }
+        else {
+            sq->sealedTail->next = sq->batch;
+        }
+
+        sq->sealedTail = sq->batch;
+        sq->batch      = batch;
+    }
+
+    sq->batch->bytes[sq->batch->end] = toPush;
+    ++sq->batch->end;
+    ++sq->size;
+    pthread_mutex_unlock(&sq->mutex);
+    return true;
+}
+
+bool spillQueueFlush(SpillQueue *spillQueue, size_t *bytesFlushed)
+{
+    SpillQueueImpl *sq      = impl(spillQueue);
+    bool            success = true;
+
+    *bytesFlushed = 0;
+
+    // Nothing sealed -> don't wait for someone else's write.
+    pthread_mutex_lock(&sq->mutex);
+    const bool isSealed = sq->sealedHead != NULL;
+    pthread_mutex_unlock(&sq->mutex);
+
+    if (!isSealed) {
+        return true;
+    }
+
+    pthread_mutex_lock(&sq->writeMutex);
+
+    for (;;) {
+        pthread_mutex_lock(&sq->mutex);
+        SpillBatch *batch = sq->sealedHead;
+
+        if (batch == NULL) {
+            pthread_mutex_unlock(&sq->mutex);
+            break;
+        }
+
+        sq->sealedHead = batch->next;
+
+        if (sq->sealedHead == NULL) {
+            sq->sealedTail = NULL;
+        }
+
+        // Popping may have taken some of the bytes from memory already;
+        // from now on it waits for the rest to be on disk.
+        const size_t begin = batch->begin;
+        sq->writing        = batch;
+        pthread_mutex_unlock(&sq->mutex);
+
+        const size_t byteCount = batch->end - begin;
+        const bool   couldWrite
+            = appendToSegment(sq, batch->bytes + begin, byteCount);
+
+        pthread_mutex_lock(&sq->mutex);
+        sq->writing = NULL;
+
+        if (couldWrite) {
+            success = finishAppend(sq, byteCount);
+            *bytesFlushed += byteCount;
+            free(batch);
+        }
+        else {
+            // Keep the bytes in memory, where they can still be popped.
+            batch->next    = sq->sealedHead;
+            sq->sealedHead = batch;
+
+            if (sq->sealedTail == NULL) {
+                sq->sealedTail = batch;
+            }
+
+            success = false;
+        }
+
+        pthread_mutex_unlock(&sq->mutex);
+
+        if (!success) {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&sq->writeMutex);
+    return success;
+}
+
+/*!
+ * \brief Deletes the segment currently being read from and moves on to the
+ *        next one.
+ * \param sq The spill queue.
+ * \return true on success; otherwise false.
+ **/
+static bool finishReadSegment(SpillQueueImpl *sq)
+{
+    bool success = true;
+
+    if (sq->readFile != NULL) {
+        success      = fclose(sq->readFile) == 0;
+        sq->readFile = NULL;
+    }
+
+    if (!removeSegment(sq, sq->readSegment)) {
+        success = false;
+    }
+
+    ++sq->readSegment;
+    sq->readOffset = 0;
+    return success;
+}
+
+/*!
+ * \brief Reads bytes from the segment currently being read from.
+ * \param sq The spill queue.
+ * \param destination The buffer to read into.
+ * \param maxCount The maximum amount of bytes to read.
+ * \param bytesRead Output parameter for the amount of bytes read.
+ * \return true on success; otherwise false.
+ **/
+static bool readFromSegment(
+    SpillQueueImpl *sq,
+    byte *          destination,
+    size_t          maxCount,
+    size_t *        bytesRead)
+{
+    if (sq->readFile == NULL) {
+        sq->readFile = openSegment(sq, sq->readSegment, "rb");
+
+        if (sq->readFile == NULL) {
+            return false;
+        }
+    }
+
+    *bytesRead = fread(destination, 1, maxCount, sq->readFile);
+
+    if (*bytesRead != maxCount && ferror(sq->readFile)) {
+        return false;
+    }
+
+    sq->readOffset += *bytesRead;
+    return true;
+}
+
+/*!
+ * \brief Removes bytes from the front of a batch.
+ * \param batch The batch.
+ * \param destination The buffer to write the bytes removed to.
+ * \param maxCount The maximum amount of bytes to remove.
+ * \return The amount of bytes removed.
+ **/
+static size_t
+takeFromBatch(SpillBatch *batch, byte *destination, size_t maxCount)
+{
+    const size_t available = batch->end - batch->begin;
+    const size_t count     = maxCount < available ? maxCount : available;
+
+    memcpy(destination, batch->bytes + batch->begin, count);
+    batch->begin += count;
+    return count;
+}
+
+bool spillQueuePop(
+    SpillQueue *spillQueue,
+    byte *      destination,
+    size_t      maxCount,
+    size_t *    popped)
+{
+    SpillQueueImpl *sq    = impl(spillQueue);
+    size_t          total = 0;
+
+    pthread_mutex_lock(&sq->mutex);
+
+    while (total < maxCount && sq->size != 0) {
+        const size_t wanted = maxCount - total;
+        size_t       got    = 0;
+
+        if (sq->readSegment < sq->writeSegment) {
+            // A finished segment: read it until the end.
+            if (!readFromSegment(sq, destination + total, wanted, &got)) {
+                goto error;
+            }
+
+            if (got == 0 && !finishReadSegment(sq)) {
+                goto error;
+            }
+
+            sq->diskSize -= got;
+        }
+        else if (sq->readOffset < sq->writeSegmentBytes) {
+            // The segment still being appended to: only read what is known
+            // to have been written.
+            const size_t available = sq->writeSegmentBytes - sq->readOffset;
+
+            if (!readFromSegment(
+                    sq,
+                    destination + total,
+                    wanted < available ? wanted : available,
+                    &got)) {
+                goto error;
+            }
+
+            if (got == 0) {
+                goto error;
+            }
+
+            sq->diskSize -= got;
+        }
+        else if (sq->writing != NULL) {
+            // Everything on disk has been read, but the batch next up is
+            // still on its way there.
+            break;
+        }
+        else if (sq->sealedHead != NULL) {
+            // Take from memory what has not been written yet.
+            SpillBatch *batch = sq->sealedHead;
+            got = takeFromBatch(batch, destination + total, wanted);
+
+            if (batch->begin == batch->end) {
+                sq->sealedHead = batch->next;
+
+                if (sq->sealedHead == NULL) {
+                    sq->sealedTail = NULL;
+                }
+
+                free(batch);
+            }
+        }
+        else {
+            got = takeFromBatch(sq->batch, destination + total, wanted);
+        }
+
+        total += got;
+        sq->size -= got;
+    }
+
+    // Once the queue runs empty every segment has been consumed completely
+    // and can be deleted, including the one still being appended to. With
+    // nothing left, nothing is being written either.
+    if (sq->size == 0) {
+        sq->batch->begin = 0;
+        sq->batch->end   = 0;
+
+        if (sq->writeSegmentBytes != 0) {
+            if (sq->writeFile != NULL) {
+                const bool couldClose = fclose(sq->writeFile) == 0;
+                sq->writeFile         = NULL;
+
+                if (!couldClose) {
+                    goto error;
+                }
+            }
+
+            ++sq->writeSegment;
+            sq->writeSegmentBytes = 0;
+        }
+
+        while (sq->readSegment < sq->writeSegment) {
+            if (!finishReadSegment(sq)) {
+                goto error;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&sq->mutex);
+    *popped = total;
+    return true;
+
+error:
+    pthread_mutex_unlock(&sq->mutex);
+    *popped = total;
+    return false;
+}
+
+size_t spillQueueSize(const SpillQueue *spillQueue)
+{
+    return constImpl(spillQueue)->size;
+}
+
+size_t spillQueueAvailable(SpillQueue *spillQueue)
+{
+    SpillQueueImpl *sq = impl(spillQueue);
+
+    pthread_mutex_lock(&sq->mutex);
+    const size_t available = sq->writing == NULL ? sq->size : sq->diskSize;
+    pthread_mutex_unlock(&sq->mutex);
+
+    return available;
+}
@@ -0,0 +1,127 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ring_buffer.h"
+#include "sleep_thread.h"
+#include "supervisor.h"
+
+/*!
+ * \brief Decides on the size of the ring buffer.
+ * \param config The bounds.
+ * \param size The current size in bytes.
+ * \param fullWaits The waits of the writers during the last interval.
+ * \param emptyWaits The waits of the readers during the last interval.
+ * \return The size the ring buffer should have.
+ **/
+static size_t nextSize(
+    const SupervisorConfig *config,
+    size_t                  size,
+    uint64_t                fullWaits,
+    uint64_t                emptyWaits)
+{
+    if (fullWaits != 0) {
+        return size * 2 <= config->maxSize ? size * 2 : config->maxSize;
+    }
+
+    if (emptyWaits != 0) {
+        return size / 2 >= config->minSize ? size / 2 : config->minSize;
+    }
+
+    return size;
+}
+
+/*!
+ * \brief The thread function for the supervisor thread.
+ * \param ringBuffer The ring buffer to resize.
+ * \param sleepTimeSeconds Unused; the interval is part of the config.
+ * \param id The thread ID.
+ * \param self A pointer to the thread itself.
+ **/
+static int supervisorThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) sleepTimeSeconds;
+
+    const SupervisorConfig *config = threadContext(self);
+    RingBufferStats         previous;
+
+    if (RB_FAILURE(ringBufferStats(ringBuffer, &previous))) {
+        return EXIT_FAILURE;
+    }
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            return EXIT_FAILURE;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        sleepThreadMilliseconds(config->intervalMilliseconds);
+
+        RingBufferStats current;
+
+        if (RB_FAILURE(ringBufferStats(ringBuffer, &current))) {
+            return EXIT_FAILURE;
+        }
+
+        const uint64_t fullWaits  = current.fullWaits - previous.fullWaits;
+        const uint64_t emptyWaits = current.emptyWaits - previous.emptyWaits;
+        const size_t   size
+            = nextSize(config, current.size, fullWaits, emptyWaits);
+
+        if (size != current.size) {
+            const RingBufferStatusCode statusCode
+                = ringBufferResize(ringBuffer, size, self);
+
+            if (statusCode == RB_THREAD_SHOULD_SHUTDOWN) {
+                break;
+            }
+
+            if (RB_FAILURE(statusCode)) {
+                return EXIT_FAILURE;
+            }
+
+            printf(
+                "Supervisor (tid: %d) resized the ring buffer from %zu to "
+                "%zu bytes (full waits: %llu, empty waits: %llu).\n",
+                id,
+                current.size,
+                size,
+                (unsigned long long) fullWaits,
+                (unsigned long long) emptyWaits);
+        }
+
+        // Don't count the waits the resize caused itself.
+        if (RB_FAILURE(ringBufferStats(ringBuffer, &previous))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+Thread *supervisorCreate(
+    RingBuffer *            ringBuffer,
+    int                     id,
+    const SupervisorConfig *config)
+{
+    if (config->minSize == 0 || config->minSize > config->maxSize
+        || config->intervalMilliseconds <= 0) {
+        return NULL;
+    }
+
+    return threadCreateWithContext(
+        &supervisorThreadFunction,
+        ringBuffer,
+        /* sleepTimeSeconds */ 0,
+        id,
+        (void *) config);
+}
@@ -1,9 +1,13 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 #include <pthread.h>
 
+#include "arena.h"
 #include "ring_buffer.h"
 #include "thread.h"
 
@@ -14,6 +18,8 @@ typedef struct {
     pthread_t       handle;         /*!< The pthread handle */
     bool            shouldShutDown; /*!< The shutdown state */
     pthread_mutex_t mutex;          /*!< Mutex to protect `shouldShutDown` */
+    void *          context;        /*!< User supplied context; may be NULL */
+    Arena *         arena;          /*!< Allocated from; NULL for malloc */
 } ThreadImpl;
 
 /*!
@@ -25,8 +31,76 @@ typedef struct {
     int32_t        sleepTimeSeconds; /*!< Sleep time */
     int            id;               /*!< The thread ID */
     Thread *       self;             /*!< Pointer to the thread itself */
+    Arena *        arena;            /*!< Allocated from; NULL for malloc */
+    bool           isHeld;           /*!< Wait at the start barrier first */
+    uint64_t       startGeneration;  /*!< The release to wait for */
 } ThreadArgument;
 
+/*!
+ * \brief How the threads are started.
+ *
+ * Threads created while `isHolding` wait at the start barrier until the
+ * generation changes, so that they all start working at once.
+ **/
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  arrived;      /*!< Signaled when a thread waits */
+    pthread_cond_t  released;     /*!< Signaled when released */
+    bool            isHolding;    /*!< New threads wait at the barrier */
+    uint64_t        generation;   /*!< Count of releases */
+    size_t          waitingCount; /*!< Threads waiting at the barrier */
+    size_t          stackSize;    /*!< In bytes; 0 for the default */
+} ThreadStartup;
+
+/*!
+ * \brief The start settings of all the threads.
+ **/
+static ThreadStartup startup = {PTHREAD_MUTEX_INITIALIZER,
+                                PTHREAD_COND_INITIALIZER,
+                                PTHREAD_COND_INITIALIZER,
+                                false,
+                                0,
+                                0,
+                                0};
+
+/*!
+ * \brief A share of the threads created by `threadCreateParallel`.
+ **/
+typedef struct {
+    ThreadFactory factory;      /*!< Creates a thread */
+    void *        context;      /*!< Passed to `factory` */
+    Thread **     threads;      /*!< Where to store the threads */
+    size_t        count;        /*!< The amount of threads of all shares */
+    size_t        first;        /*!< The first index of this share */
+    size_t        stride;       /*!< The distance between its indices */
+    bool          isSuccessful; /*!< Whether all its threads were created */
+} ThreadCreatorShare;
+
+/*!
+ * \brief Allocates from an arena or from the heap.
+ * \param arena The arena; NULL to use malloc.
+ * \param size The amount of bytes to allocate.
+ * \return The memory allocated on success; otherwise NULL.
+ **/
+static void *allocate(Arena *arena, size_t size)
+{
+    return arena == NULL ? malloc(size) : arenaAllocate(arena, size);
+}
+
+/*!
+ * \brief Frees what `allocate` returned.
+ * \param arena The arena given to `allocate`.
+ * \param memory The memory to free.
+ *
+ * Memory of an arena is freed along with the arena.
+ **/
+static void deallocate(Arena *arena, void *memory)
+{
+    if (arena == NULL) {
+        free(memory);
+    }
+}
+
 /*!
  * \brief Creates a thread argument.
  * \param function The thread function.
@@ -34,6 +108,7 @@ typedef struct {
  * \param sleepTimeSeconds The sleep time.
  * \param id The thread ID.
  * \param self The thread itself.
+ * \param arena The arena to allocate from; NULL to use malloc.
  * \return The thread argument created on success; otherwise NULL.
  **/
 static ThreadArgument *threadArgumentCreate(
@@ -41,9 +116,10 @@ static ThreadArgument *threadArgumentCreate(
     RingBuffer *   ringBuffer,
     int32_t        sleepTimeSeconds,
     int            id,
-    Thread *       self)
+    Thread *       self,
+    Arena *        arena)
 {
-    ThreadArgument *argument = malloc(sizeof(ThreadArgument));
+    ThreadArgument *argument = allocate(arena, sizeof(ThreadArgument));
 
     if (argument == NULL) {
         return NULL;
@@ -54,6 +130,9 @@ static ThreadArgument *threadArgumentCreate(
     argument->sleepTimeSeconds = sleepTimeSeconds;
     argument->id               = id;
     argument->self             = self;
+    argument->arena            = arena;
+    argument->isHeld           = false;
+    argument->startGeneration  = 0;
 
     return argument;
 }
@@ -64,7 +143,7 @@ static ThreadArgument *threadArgumentCreate(
  **/
 static void threadArgumentFree(ThreadArgument *argument)
 {
-    free(argument);
+    deallocate(argument->arena, argument);
 }
 
 static Thread *opaque(ThreadImpl *thread)
@@ -77,6 +156,23 @@ static ThreadImpl *impl(Thread *thread)
     return (ThreadImpl *) thread;
 }
 
+/*!
+ * \brief Waits at the start barrier until released.
+ * \param argument The argument of the thread waiting.
+ **/
+static void waitForStart(const ThreadArgument *argument)
+{
+    pthread_mutex_lock(&startup.mutex);
+    ++startup.waitingCount;
+    pthread_cond_signal(&startup.arrived);
+
+    while (startup.generation == argument->startGeneration) {
+        pthread_cond_wait(&startup.released, &startup.mutex);
+    }
+
+    pthread_mutex_unlock(&startup.mutex);
+}
+
 /*!
  * \brief The actual thread routine.
  * \param argument The void* argument.
@@ -86,6 +182,10 @@ static void *startRoutine(void *argument)
 {
     ThreadArgument *arg = (ThreadArgument *) argument;
 
+    if (arg->isHeld) {
+        waitForStart(arg);
+    }
+
     // Run the thread function.
     const int threadExitStatus = arg->function(
         arg->ringBuffer, arg->sleepTimeSeconds, arg->id, arg->self);
@@ -102,38 +202,234 @@ Thread *threadCreate(
     int32_t        sleepTimeSeconds,
     int            id)
 {
-    ThreadImpl *thread = malloc(sizeof(ThreadImpl));
+    return threadCreateWithContext(
+        function, ringBuffer, sleepTimeSeconds, id, NULL);
+}
+
+Thread *threadCreateWithContext(
+    ThreadFunction function,
+    RingBuffer *   ringBuffer,
+    int32_t        sleepTimeSeconds,
+    int            id,
+    void *         context)
+{
+    return threadCreateInArena(
+        function, ringBuffer, sleepTimeSeconds, id, context, NULL);
+}
+
+size_t threadArenaSize(void)
+{
+    return arenaFootprint(sizeof(ThreadImpl))
+           + arenaFootprint(sizeof(ThreadArgument));
+}
+
+Thread *threadCreateInArena(
+    ThreadFunction function,
+    RingBuffer *   ringBuffer,
+    int32_t        sleepTimeSeconds,
+    int            id,
+    void *         context,
+    Arena *        arena)
+{
+    ThreadImpl *thread = allocate(arena, sizeof(ThreadImpl));
 
     if (thread == NULL) {
         return NULL;
     }
 
     ThreadArgument *argument = threadArgumentCreate(
-        function, ringBuffer, sleepTimeSeconds, id, opaque(thread));
+        function, ringBuffer, sleepTimeSeconds, id, opaque(thread), arena);
 
     if (argument == NULL) {
-        free(thread);
+        deallocate(arena, thread);
         return NULL;
     }
 
     thread->shouldShutDown = false;
+    thread->context        = context;
+    thread->arena          = arena;
 
     if (pthread_mutex_init(&thread->mutex, NULL) != 0) {
         threadArgumentFree(argument);
-        free(thread);
+        deallocate(arena, thread);
         return NULL;
     }
 
-    if (pthread_create(&thread->handle, NULL, &startRoutine, argument) != 0) {
+    pthread_attr_t attributes;
+
+    if (pthread_attr_init(&attributes) != 0) {
         pthread_mutex_destroy(&thread->mutex);
         threadArgumentFree(argument);
-        free(thread);
+        deallocate(arena, thread);
+        return NULL;
+    }
+
+    // Take the settings and the place in line at the start barrier at once.
+    pthread_mutex_lock(&startup.mutex);
+    argument->isHeld          = startup.isHolding;
+    argument->startGeneration = startup.generation;
+    const size_t stackSize    = startup.stackSize;
+    pthread_mutex_unlock(&startup.mutex);
+
+    const bool couldCreate
+        = (stackSize == 0
+           || pthread_attr_setstacksize(&attributes, stackSize) == 0)
+          && pthread_create(
+                 &thread->handle, &attributes, &startRoutine, argument)
+                 == 0;
+
+    pthread_attr_destroy(&attributes);
+
+    if (!couldCreate) {
+        pthread_mutex_destroy(&thread->mutex);
+        threadArgumentFree(argument);
+        deallocate(arena, thread);
         return NULL;
     }
 
     return opaque(thread);
 }
 
+/*!
+ * \brief Creates the threads of a share.
+ * \param argument The `ThreadCreatorShare`.
+ * \return NULL.
+ **/
+static void *createShare(void *argument)
+{
+    ThreadCreatorShare *share = argument;
+
+    for (size_t i = share->first; i < share->count; i += share->stride) {
+        share->threads[i] = share->factory(i, share->context);
+
+        if (share->threads[i] == NULL) {
+            share->isSuccessful = false;
+        }
+    }
+
+    return NULL;
+}
+
+bool threadCreateParallel(
+    ThreadFactory factory,
+    void *        context,
+    size_t        count,
+    size_t        creatorCount,
+    Thread **     threads)
+{
+    if (creatorCount > count) {
+        creatorCount = count;
+    }
+
+    if (creatorCount <= 1) {
+        ThreadCreatorShare share
+            = {factory, context, threads, count, 0, 1, true};
+        createShare(&share);
+        return share.isSuccessful;
+    }
+
+    ThreadCreatorShare *shares = calloc(creatorCount, sizeof(*shares));
+    pthread_t *         creators = calloc(creatorCount, sizeof(*creators));
+    bool                success  = shares != NULL && creators != NULL;
+
+    for (size_t i = 0; i < count; ++i) {
+        threads[i] = NULL;
+    }
+
+    // Every creator takes every `creatorCount`th index, so that the thread
+    // IDs of all the creators grow at the same pace. The calling thread
+    // takes the first share itself.
+    size_t started = 1;
+
+    for (size_t c = 0; success && c < creatorCount; ++c) {
+        ThreadCreatorShare *share = &shares[c];
+        share->factory            = factory;
+        share->context            = context;
+        share->threads            = threads;
+        share->count              = count;
+        share->first              = c;
+        share->stride             = creatorCount;
+        share->isSuccessful       = true;
+
+        if (c != 0) {
+            if (pthread_create(&creators[c], NULL, &createShare, share) != 0) {
+                success = false;
+                break;
+            }
+
+            ++started;
+        }
+    }
+
+    if (success) {
+        createShare(&shares[0]);
+    }
+
+    for (size_t c = 1; c < started; ++c) {
+        pthread_join(creators[c], NULL);
+    }
+
+    for (size_t c = 0; success && c < creatorCount; ++c) {
+        success = shares[c].isSuccessful;
+    }
+
+    free(creators);
+    free(shares);
+    return success;
+}
+
+bool threadSetStackSize(size_t byteCount)
+{
+#ifdef PTHREAD_STACK_MIN
+    if (byteCount != 0 && byteCount < (size_t) PTHREAD_STACK_MIN) {
+        return false;
+    }
+#endif
+
+    pthread_mutex_lock(&startup.mutex);
+    startup.stackSize = byteCount;
+    pthread_mutex_unlock(&startup.mutex);
+    return true;
+}
+
+void threadHoldStart(void)
+{
+    pthread_mutex_lock(&startup.mutex);
+    startup.isHolding    = true;
+    startup.waitingCount = 0;
+    pthread_mutex_unlock(&startup.mutex);
+}
+
+void threadWaitStartReady(size_t threadCount)
+{
+    pthread_mutex_lock(&startup.mutex);
+
+    while (startup.waitingCount < threadCount) {
+        pthread_cond_wait(&startup.arrived, &startup.mutex);
+    }
+
+    pthread_mutex_unlock(&startup.mutex);
+}
+
+void threadReleaseStart(void)
+{
+    pthread_mutex_lock(&startup.mutex);
+
+    if (startup.isHolding) {
+        startup.isHolding    = false;
+        startup.waitingCount = 0;
+        ++startup.generation;
+        pthread_cond_broadcast(&startup.released);
+    }
+
+    pthread_mutex_unlock(&startup.mutex);
+}
+
+void *threadContext(Thread *thread)
+{
+    return impl(thread)->context;
+}
+
 bool threadFree(Thread *thread, int *threadExitStatus)
 {
     ThreadImpl *thr = impl(thread);
@@ -141,16 +437,16 @@ bool threadFree(Thread *thread, int *threadExitStatus)
 
     if (pthread_join(thr->handle, &exitStatus) != 0) {
         pthread_mutex_destroy(&thr->mutex);
-        free(thr);
+        deallocate(thr->arena, thr);
         return false;
     }
 
     if (pthread_mutex_destroy(&thr->mutex) != 0) {
-        free(thr);
+        deallocate(thr->arena, thr);
         return false;
     }
 
-    free(thr);
+    deallocate(thr->arena, thr);
     *threadExitStatus = (int) exitStatus;
     return true;
 }
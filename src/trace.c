@@ -0,0 +1,266 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "trace.h"
+
+/*!
+ * \def TRACE_THREAD_LOCAL
+ * \brief Gives every thread a variable of its own.
+ **/
+#ifdef _WIN32
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+/*!
+ * \brief An event recorded.
+ **/
+typedef struct {
+    uint64_t ticks;    /*!< The time stamp, see `readTicks` */
+    int32_t  threadId; /*!< The thread ID given */
+    uint32_t event;    /*!< The `TraceEvent` */
+} TraceRecord;
+
+/*!
+ * \brief The events of a thread.
+ **/
+typedef struct TraceBuffer {
+    struct TraceBuffer *next;      /*!< The buffer of another thread */
+    size_t              count;     /*!< The amount of records */
+    size_t              dropped;   /*!< Events that didn't fit anymore */
+    TraceRecord         records[]; /*!< The records; `gEventsPerThread` */
+} TraceBuffer;
+
+/*!
+ * \brief Whether tracing is enabled; accessed atomically.
+ **/
+static bool gTraceEnabled = false;
+
+/*!
+ * \brief Counts the times tracing was enabled, so that threads notice that
+ *        their buffers of an earlier time are gone.
+ **/
+static uint64_t gTraceGeneration = 0;
+
+static size_t          gEventsPerThread = 0;
+static pthread_mutex_t gTraceMutex      = PTHREAD_MUTEX_INITIALIZER;
+static TraceBuffer *   gTraceBuffers    = NULL; /*!< Guarded by the mutex */
+static uint64_t        gStartTicks;
+static uint64_t        gStartNanoseconds;
+
+static TRACE_THREAD_LOCAL TraceBuffer *tBuffer;
+static TRACE_THREAD_LOCAL uint64_t     tGeneration;
+
+/*!
+ * \brief Reads the monotonic clock.
+ * \return The time in nanoseconds.
+ **/
+static uint64_t readNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/*!
+ * \brief Reads the time stamp counter, or the monotonic clock if there is
+ *        none.
+ * \return The time in ticks.
+ **/
+static uint64_t readTicks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return readNanoseconds();
+#endif
+}
+
+bool traceEnable(size_t eventsPerThread)
+{
+    if (eventsPerThread == 0) {
+        return false;
+    }
+
+    traceDisable();
+
+    pthread_mutex_lock(&gTraceMutex);
+    gEventsPerThread  = eventsPerThread;
+    gStartTicks       = readTicks();
+    gStartNanoseconds = readNanoseconds();
+    ++gTraceGeneration;
+    pthread_mutex_unlock(&gTraceMutex);
+
+    __atomic_store_n(&gTraceEnabled, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*!
+ * \brief Returns the buffer of the calling thread, allocating it if needed.
+ * \return The buffer; NULL if it could not be allocated.
+ **/
+static TraceBuffer *threadBuffer(void)
+{
+    pthread_mutex_lock(&gTraceMutex);
+
+    if (tBuffer == NULL || tGeneration != gTraceGeneration) {
+        tBuffer = malloc(
+            sizeof(TraceBuffer) + gEventsPerThread * sizeof(TraceRecord));
+
+        if (tBuffer != NULL) {
+            tBuffer->next    = gTraceBuffers;
+            tBuffer->count   = 0;
+            tBuffer->dropped = 0;
+            gTraceBuffers    = tBuffer;
+        }
+
+        tGeneration = gTraceGeneration;
+    }
+
+    pthread_mutex_unlock(&gTraceMutex);
+    return tBuffer;
+}
+
+void traceRecord(TraceEvent event, int threadId)
+{
+    if (!__atomic_load_n(&gTraceEnabled, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    // Only the first event of a thread takes the mutex.
+    TraceBuffer *buffer = tBuffer != NULL && tGeneration == gTraceGeneration
+                              ? tBuffer
+                              : threadBuffer();
+
+    if (buffer == NULL) {
+        return;
+    }
+
+    if (buffer->count == gEventsPerThread) {
+        ++buffer->dropped;
+        return;
+    }
+
+    TraceRecord *record = &buffer->records[buffer->count++];
+    record->ticks       = readTicks();
+    record->threadId    = (int32_t) threadId;
+    record->event       = (uint32_t) event;
+}
+
+/*!
+ * \brief Returns how an event shows on the timeline.
+ * \param event The event.
+ * \param name Output parameter for the name of the event.
+ * \param phase Output parameter for the Chrome trace event phase.
+ **/
+static void
+describeEvent(TraceEvent event, const char **name, const char **phase)
+{
+    static const char *const names[TRACE_EVENT_COUNT] = {
+        "write",
+        "write",
+        "read",
+        "read",
+        "wait for space",
+        "wait for space",
+        "wait for data",
+        "wait for data",
+        "broadcast",
+        "shutdown"};
+
+    *name = names[event];
+
+    switch (event) {
+    case TRACE_BROADCAST:
+    case TRACE_SHUTDOWN:
+        *phase = "i";
+        break;
+    default:
+        // Begin and end events alternate.
+        *phase = event % 2 == 0 ? "B" : "E";
+        break;
+    }
+}
+
+bool traceWriteChromeJson(const char *path)
+{
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&gTraceMutex);
+
+    // Calibrate the ticks against the clock over the whole run.
+    const uint64_t elapsedTicks = readTicks() - gStartTicks;
+    const double   microsecondsPerTick
+        = elapsedTicks == 0 ? 0.0
+                            : (double) (readNanoseconds() - gStartNanoseconds)
+                                  / 1e3 / (double) elapsedTicks;
+    size_t dropped = 0;
+    bool   isFirst = true;
+
+    fprintf(file, "{\"traceEvents\":[\n");
+
+    for (const TraceBuffer *buffer = gTraceBuffers; buffer != NULL;
+         buffer                    = buffer->next) {
+        for (size_t i = 0; i < buffer->count; ++i) {
+            const TraceRecord *record = &buffer->records[i];
+            const char *       name;
+            const char *       phase;
+
+            describeEvent((TraceEvent) record->event, &name, &phase);
+            fprintf(
+                file,
+                "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,"
+                "\"tid\":%d%s}",
+                isFirst ? "" : ",\n",
+                name,
+                phase,
+                (double) (record->ticks - gStartTicks) * microsecondsPerTick,
+                (int) record->threadId,
+                phase[0] == 'i' ? ",\"s\":\"t\"" : "");
+            isFirst = false;
+        }
+
+        dropped += buffer->dropped;
+    }
+
+    fprintf(
+        file,
+        "\n],\"displayTimeUnit\":\"ns\","
+        "\"otherData\":{\"droppedEvents\":\"%zu\"}}\n",
+        dropped);
+
+    pthread_mutex_unlock(&gTraceMutex);
+
+    const bool couldWrite = !ferror(file);
+    return fclose(file) == 0 && couldWrite;
+}
+
+void traceDisable(void)
+{
+    __atomic_store_n(&gTraceEnabled, false, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&gTraceMutex);
+
+    while (gTraceBuffers != NULL) {
+        TraceBuffer *next = gTraceBuffers->next;
+        free(gTraceBuffers);
+        gTraceBuffers = next;
+    }
+
+    pthread_mutex_unlock(&gTraceMutex);
+}
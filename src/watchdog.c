@@ -0,0 +1,593 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "arena.h"
+#include "sleep_thread.h"
+#include "watchdog.h"
+
+/*!
+ * \def WATCHDOG_LATENCY_BUCKETS
+ * \brief The amount of buckets of the latency histograms.
+ *
+ * Latencies are counted in microseconds, in four buckets per power of two,
+ * so that a bucket is at most a quarter as wide as the latencies it counts.
+ **/
+#define WATCHDOG_LATENCY_BUCKETS 128
+
+/*!
+ * \def WATCHDOG_LINE_SIZE
+ * \brief The size of the buffer an alarm is put together in.
+ **/
+#define WATCHDOG_LINE_SIZE 1024
+
+/*!
+ * \brief The slot of a thread watched.
+ *
+ * Allocated on cache lines of its own. The times and counts are atomic, as
+ * the watchdog thread reads them while the thread watched writes them.
+ **/
+typedef struct {
+    int          threadId;     /*!< The thread ID reported */
+    WatchdogRole role;         /*!< What the thread does */
+    uint64_t     lastBeat;     /*!< When the thread last made progress */
+    uint64_t     waitingSince; /*!< When the thread began blocking on the
+                                *   ring buffer; 0 if it isn't
+                                */
+    uint64_t latencies[WATCHDOG_LATENCY_BUCKETS]; /*!< Waits by length */
+} WatchdogSlot;
+
+/*!
+ * \brief What the watchdog thread remembers about a slot between checks.
+ **/
+typedef struct {
+    uint64_t latencies[WATCHDOG_LATENCY_BUCKETS]; /*!< As last seen */
+    bool     isStalled;                           /*!< Stall reported */
+    bool     isSlow;                              /*!< Latency reported */
+} WatchdogSlotState;
+
+/*!
+ * \brief Watchdog implementation type.
+ **/
+typedef struct {
+    WatchdogConfig     config;       /*!< The thresholds */
+    RingBuffer *       ringBuffer;   /*!< The ring buffer watched */
+    Arena *            arena;        /*!< Holds the slots */
+    WatchdogSlot **    slots;        /*!< One per thread joined */
+    size_t             maxThreads;   /*!< The size of `slots` */
+    size_t             slotCount;    /*!< Atomic; threads joined */
+    WatchdogSlotState *states;       /*!< Only touched by the watchdog
+                                      *   thread
+                                      */
+    uint64_t lastReadTotal;          /*!< The ring buffer's read total as
+                                      *   last seen
+                                      */
+    uint64_t lastReadMove;           /*!< When the read total last moved */
+    bool     isStuck;                /*!< Stuck ring buffer reported */
+} WatchdogImpl;
+
+static WatchdogImpl *impl(Watchdog *watchdog)
+{
+    return (WatchdogImpl *) watchdog;
+}
+
+static Watchdog *opaque(WatchdogImpl *watchdog)
+{
+    return (Watchdog *) watchdog;
+}
+
+/*!
+ * \brief Returns the monotonic time in nanoseconds; never 0.
+ **/
+static uint64_t nowNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec + 1;
+}
+
+RingBufferStatusCode watchdogCreate(
+    RingBuffer *          ringBuffer,
+    size_t                maxThreads,
+    const WatchdogConfig *config,
+    Watchdog **           watchdog)
+{
+    if (ringBuffer == NULL || maxThreads == 0 || config->stallMilliseconds <= 0
+        || config->intervalMilliseconds <= 0 || watchdog == NULL) {
+        return RB_INVALID_ARGUMENT;
+    }
+
+    WatchdogImpl *w = calloc(1, sizeof(WatchdogImpl));
+
+    if (w == NULL) {
+        return RB_NOMEM;
+    }
+
+    w->config       = *config;
+    w->ringBuffer   = ringBuffer;
+    w->maxThreads   = maxThreads;
+    w->slots        = calloc(maxThreads, sizeof(WatchdogSlot *));
+    w->states       = calloc(maxThreads, sizeof(WatchdogSlotState));
+    w->arena        = arenaCreate(
+        maxThreads * arenaFootprint(sizeof(WatchdogSlot)));
+    w->lastReadMove = nowNanoseconds();
+
+    if (w->slots == NULL || w->states == NULL || w->arena == NULL) {
+        arenaFree(w->arena);
+        free(w->states);
+        free(w->slots);
+        free(w);
+        return RB_NOMEM;
+    }
+
+    *watchdog = opaque(w);
+    return RB_OK;
+}
+
+RingBufferStatusCode watchdogFree(Watchdog *watchdog)
+{
+    WatchdogImpl *w = impl(watchdog);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (w == NULL) {
+        return RB_OK;
+    }
+
+    arenaFree(w->arena);
+    free(w->states);
+    free(w->slots);
+    free(w);
+    return RB_OK;
+}
+
+RingBufferStatusCode watchdogJoin(
+    Watchdog *   watchdog,
+    WatchdogRole role,
+    int          threadId,
+    size_t *     slot)
+{
+    WatchdogImpl *w = impl(watchdog);
+
+    // Not watched -> nothing to join (that's okay, it's no error).
+    if (w == NULL) {
+        *slot = 0;
+        return RB_OK;
+    }
+
+    const size_t index
+        = __atomic_fetch_add(&w->slotCount, 1, __ATOMIC_ACQ_REL);
+
+    if (index >= w->maxThreads) {
+        __atomic_fetch_sub(&w->slotCount, 1, __ATOMIC_ACQ_REL);
+        return RB_INVALID_ARGUMENT;
+    }
+
+    WatchdogSlot *s = arenaAllocate(w->arena, sizeof(WatchdogSlot));
+
+    s->threadId = threadId;
+    s->role     = role;
+    s->lastBeat = nowNanoseconds();
+
+    // The watchdog thread skips the slot until it is published.
+    __atomic_store_n(&w->slots[index], s, __ATOMIC_RELEASE);
+    *slot = index;
+    return RB_OK;
+}
+
+void watchdogWaiting(Watchdog *watchdog, size_t slot)
+{
+    if (watchdog == NULL) {
+        return;
+    }
+
+    WatchdogSlot *s = impl(watchdog)->slots[slot];
+    __atomic_store_n(&s->waitingSince, nowNanoseconds(), __ATOMIC_RELAXED);
+}
+
+/*!
+ * \brief Returns the latency bucket of a wait.
+ * \param nanoseconds The length of the wait.
+ * \return The index of the bucket.
+ **/
+static size_t latencyBucket(uint64_t nanoseconds)
+{
+    const uint64_t microseconds = nanoseconds / 1000u;
+
+    if (microseconds < 4) {
+        return (size_t) microseconds;
+    }
+
+    size_t exponent = 2;
+
+    while ((microseconds >> (exponent + 1)) != 0) {
+        ++exponent;
+    }
+
+    const size_t bucket
+        = 4 * (exponent - 1) + (size_t) ((microseconds >> (exponent - 2)) & 3);
+    return bucket < WATCHDOG_LATENCY_BUCKETS ? bucket
+                                             : WATCHDOG_LATENCY_BUCKETS - 1;
+}
+
+/*!
+ * \brief Returns the smallest latency a bucket counts.
+ * \param bucket The index of the bucket.
+ * \return The latency in microseconds.
+ **/
+static uint64_t bucketMicroseconds(size_t bucket)
+{
+    if (bucket < 4) {
+        return bucket;
+    }
+
+    const size_t exponent = bucket / 4 + 1;
+    return (uint64_t) (4 + bucket % 4) << (exponent - 2);
+}
+
+void watchdogBeat(Watchdog *watchdog, size_t slot)
+{
+    if (watchdog == NULL) {
+        return;
+    }
+
+    WatchdogSlot * s            = impl(watchdog)->slots[slot];
+    const uint64_t now          = nowNanoseconds();
+    const uint64_t waitingSince
+        = __atomic_load_n(&s->waitingSince, __ATOMIC_RELAXED);
+
+    if (waitingSince != 0) {
+        __atomic_fetch_add(
+            &s->latencies[latencyBucket(now - waitingSince)],
+            1,
+            __ATOMIC_RELAXED);
+        __atomic_store_n(&s->waitingSince, 0, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&s->lastBeat, now, __ATOMIC_RELAXED);
+}
+
+/*!
+ * \brief Appends to an alarm being put together.
+ * \param line The alarm; WATCHDOG_LINE_SIZE bytes.
+ * \param length The length of `line` so far; updated.
+ * \param format The format string.
+ *
+ * Text that doesn't fit anymore is dropped.
+ **/
+static void appendToLine(char *line, size_t *length, const char *format, ...)
+{
+    if (*length >= WATCHDOG_LINE_SIZE - 1) {
+        return;
+    }
+
+    va_list arguments;
+    va_start(arguments, format);
+    const int written = vsnprintf(
+        line + *length, WATCHDOG_LINE_SIZE - *length, format, arguments);
+    va_end(arguments);
+
+    if (written > 0) {
+        *length += (size_t) written;
+    }
+}
+
+/*!
+ * \brief Prints an alarm along with a snapshot of the ring buffer.
+ * \param line The alarm.
+ * \param length The length of `line`.
+ * \param stats The snapshot.
+ **/
+static void
+printAlarm(char *line, size_t length, const RingBufferStats *stats)
+{
+    appendToLine(
+        line,
+        &length,
+        " Ring: size %zu, count %zu, read %llu, written %llu, full waits "
+        "%llu, empty waits %llu.",
+        stats->size,
+        stats->count,
+        (unsigned long long) stats->readTotal,
+        (unsigned long long) stats->writtenTotal,
+        (unsigned long long) stats->fullWaits,
+        (unsigned long long) stats->emptyWaits);
+    printf("%s\n", line);
+}
+
+/*!
+ * \brief Computes the 99th percentile of the waits since the last check.
+ * \param s The slot.
+ * \param state What the watchdog remembers about the slot; updated.
+ * \param now The time of the check.
+ * \param p99 Output parameter for the lower bound of the percentile in
+ *            microseconds.
+ * \return true if there were waits; otherwise false.
+ *
+ * A wait still underway counts with its length so far, so that a producer
+ * blocked for good is reported as well.
+ **/
+static bool p99Microseconds(
+    const WatchdogSlot *s,
+    WatchdogSlotState * state,
+    uint64_t            now,
+    uint64_t *          p99)
+{
+    uint64_t counts[WATCHDOG_LATENCY_BUCKETS];
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < WATCHDOG_LATENCY_BUCKETS; ++i) {
+        const uint64_t seen
+            = __atomic_load_n(&s->latencies[i], __ATOMIC_RELAXED);
+
+        counts[i]           = seen - state->latencies[i];
+        state->latencies[i] = seen;
+        total += counts[i];
+    }
+
+    const uint64_t waitingSince
+        = __atomic_load_n(&s->waitingSince, __ATOMIC_RELAXED);
+
+    if (waitingSince != 0 && now > waitingSince) {
+        ++counts[latencyBucket(now - waitingSince)];
+        ++total;
+    }
+
+    // The smallest bucket that holds at least 99 % of the waits.
+    const uint64_t rank = total - total / 100;
+    uint64_t       sum  = 0;
+
+    for (size_t i = 0; i < WATCHDOG_LATENCY_BUCKETS && total != 0; ++i) {
+        sum += counts[i];
+
+        if (sum >= rank) {
+            *p99 = bucketMicroseconds(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * \brief Checks on the ring buffer and the threads, reporting the alarms
+ *        raised and cleared.
+ * \param w The watchdog.
+ * \param id The thread ID of the watchdog thread.
+ * \return true on success; otherwise false.
+ **/
+static bool check(WatchdogImpl *w, int id)
+{
+    RingBufferStats stats;
+
+    if (RB_FAILURE(ringBufferStats(w->ringBuffer, &stats))) {
+        return false;
+    }
+
+    const uint64_t now   = nowNanoseconds();
+    const uint64_t stall = (uint64_t) w->config.stallMilliseconds * 1000000u;
+
+    if (stats.readTotal != w->lastReadTotal) {
+        w->lastReadTotal = stats.readTotal;
+        w->lastReadMove  = now;
+    }
+
+    const bool   isReadStuck = now - w->lastReadMove >= stall;
+    const bool   isStuck     = stats.count >= stats.size && isReadStuck;
+    const size_t slotCount
+        = __atomic_load_n(&w->slotCount, __ATOMIC_ACQUIRE);
+    char   stalled[WATCHDOG_LINE_SIZE];
+    char   recovered[WATCHDOG_LINE_SIZE];
+    char   idle[WATCHDOG_LINE_SIZE];
+    char   slow[WATCHDOG_LINE_SIZE];
+    char   fast[WATCHDOG_LINE_SIZE];
+    size_t stalledLength   = 0;
+    size_t recoveredLength = 0;
+    size_t idleLength      = 0;
+    size_t slowLength      = 0;
+    size_t fastLength      = 0;
+
+    for (size_t i = 0; i < slotCount; ++i) {
+        const WatchdogSlot *s = __atomic_load_n(&w->slots[i], __ATOMIC_ACQUIRE);
+
+        // Joined, but not yet published.
+        if (s == NULL) {
+            continue;
+        }
+
+        WatchdogSlotState *state    = &w->states[i];
+        const uint64_t     lastBeat
+            = __atomic_load_n(&s->lastBeat, __ATOMIC_RELAXED);
+        const uint64_t waitingSince
+            = __atomic_load_n(&s->waitingSince, __ATOMIC_RELAXED);
+        const bool isSilent = now > lastBeat && now - lastBeat >= stall;
+
+        // Waiting on the ring buffer is fine unless a consumer waits while
+        // there are bytes nobody reads.
+        const bool isStalled
+            = waitingSince == 0
+                  ? isSilent
+                  : s->role == WATCHDOG_ROLE_CONSUMER && isSilent
+                        && stats.count != 0 && isReadStuck;
+
+        if (isStalled && !state->isStalled) {
+            appendToLine(
+                stalled,
+                &stalledLength,
+                " %d (%llu ms)",
+                s->threadId,
+                (unsigned long long) ((now - lastBeat) / 1000000u));
+        }
+        else if (!isStalled && state->isStalled) {
+            appendToLine(recovered, &recoveredLength, " %d", s->threadId);
+        }
+
+        state->isStalled = isStalled;
+
+        if (isStuck && !w->isStuck && s->role == WATCHDOG_ROLE_CONSUMER
+            && isSilent) {
+            appendToLine(idle, &idleLength, " %d", s->threadId);
+        }
+
+        if (s->role != WATCHDOG_ROLE_PRODUCER
+            || w->config.p99LimitMicroseconds == 0) {
+            continue;
+        }
+
+        uint64_t p99 = 0;
+
+        // Without writes there is nothing to tell the latency by.
+        if (!p99Microseconds(s, state, now, &p99)) {
+            continue;
+        }
+
+        const bool isSlow = p99 >= w->config.p99LimitMicroseconds;
+
+        if (isSlow && !state->isSlow) {
+            appendToLine(
+                slow,
+                &slowLength,
+                " %d (%llu us)",
+                s->threadId,
+                (unsigned long long) p99);
+        }
+        else if (!isSlow && state->isSlow) {
+            appendToLine(fast, &fastLength, " %d", s->threadId);
+        }
+
+        state->isSlow = isSlow;
+    }
+
+    char   line[WATCHDOG_LINE_SIZE];
+    size_t length;
+
+    if (stalledLength != 0) {
+        length = 0;
+        appendToLine(
+            line,
+            &length,
+            "Watchdog (tid: %d) threads stalled for over %d ms (tid, time "
+            "since progress):%s.",
+            id,
+            w->config.stallMilliseconds,
+            stalled);
+        printAlarm(line, length, &stats);
+    }
+
+    if (recoveredLength != 0) {
+        length = 0;
+        appendToLine(
+            line,
+            &length,
+            "Watchdog (tid: %d) threads making progress again:%s.",
+            id,
+            recovered);
+        printAlarm(line, length, &stats);
+    }
+
+    if (isStuck != w->isStuck) {
+        length = 0;
+
+        if (isStuck) {
+            appendToLine(
+                line,
+                &length,
+                "Watchdog (tid: %d) ring buffer full and not read for over %d "
+                "ms; consumers not making progress:%s.",
+                id,
+                w->config.stallMilliseconds,
+                idleLength == 0 ? " none" : idle);
+        }
+        else {
+            appendToLine(
+                line,
+                &length,
+                "Watchdog (tid: %d) ring buffer moving again.",
+                id);
+        }
+
+        printAlarm(line, length, &stats);
+        w->isStuck = isStuck;
+    }
+
+    if (slowLength != 0) {
+        length = 0;
+        appendToLine(
+            line,
+            &length,
+            "Watchdog (tid: %d) p99 write latency at or over %llu us (tid, "
+            "p99 at least):%s.",
+            id,
+            (unsigned long long) w->config.p99LimitMicroseconds,
+            slow);
+        printAlarm(line, length, &stats);
+    }
+
+    if (fastLength != 0) {
+        length = 0;
+        appendToLine(
+            line,
+            &length,
+            "Watchdog (tid: %d) p99 write latency back under %llu us:%s.",
+            id,
+            (unsigned long long) w->config.p99LimitMicroseconds,
+            fast);
+        printAlarm(line, length, &stats);
+    }
+
+    return true;
+}
+
+/*!
+ * \brief The thread function for the watchdog thread.
+ * \param ringBuffer Unused; the ring buffer is part of the watchdog.
+ * \param sleepTimeSeconds Unused; the interval is part of the config.
+ * \param id The thread ID.
+ * \param self A pointer to the thread itself; its context is the watchdog.
+ **/
+static int watchdogThreadFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+
+    WatchdogImpl *w = threadContext(self);
+
+    for (;;) {
+        bool shouldShutdown;
+
+        if (!threadShouldShutdown(self, &shouldShutdown)) {
+            return EXIT_FAILURE;
+        }
+
+        if (shouldShutdown) {
+            break;
+        }
+
+        sleepThreadMilliseconds(w->config.intervalMilliseconds);
+
+        if (!check(w, id)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+Thread *watchdogThreadCreate(Watchdog *watchdog, int id)
+{
+    WatchdogImpl *w = impl(watchdog);
+
+    return threadCreateWithContext(
+        &watchdogThreadFunction,
+        w->ringBuffer,
+        /* sleepTimeSeconds */ 0,
+        id,
+        w);
+}
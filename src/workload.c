@@ -0,0 +1,423 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "workload.h"
+
+/*!
+ * \def WORKLOAD_FILE_BUFFER_SIZE
+ * \brief The amount of bytes a recorder buffers before writing them out.
+ **/
+#define WORKLOAD_FILE_BUFFER_SIZE (256 * 1024)
+
+/*!
+ * \def WORKLOAD_MAX_VARINT_SIZE
+ * \brief The maximum size of a LEB128 encoded 64 bit number in bytes.
+ **/
+#define WORKLOAD_MAX_VARINT_SIZE 10
+
+/*!
+ * \brief Workload recorder implementation type.
+ **/
+typedef struct {
+    pthread_mutex_t mutex;           /*!< Protects all of the below */
+    FILE *          file;            /*!< The file recorded to */
+    size_t          messageSize;     /*!< 0 for single bytes */
+    uint64_t        lastNanoseconds; /*!< When the last message arrived */
+    uint64_t        messageCount;    /*!< The messages recorded */
+    bool            couldWrite;      /*!< false once a write failed */
+} WorkloadRecorderImpl;
+
+/*!
+ * \brief Workload replay implementation type.
+ **/
+typedef struct {
+    const byte *data;        /*!< The whole file */
+    size_t      size;        /*!< The size of `data` in bytes */
+    size_t      messageSize; /*!< 0 for single bytes */
+} WorkloadReplayImpl;
+
+static WorkloadRecorderImpl *implRecorder(WorkloadRecorder *recorder)
+{
+    return (WorkloadRecorderImpl *) recorder;
+}
+
+static WorkloadRecorder *opaqueRecorder(WorkloadRecorderImpl *recorder)
+{
+    return (WorkloadRecorder *) recorder;
+}
+
+static const WorkloadReplayImpl *implReplay(const WorkloadReplay *replay)
+{
+    return (const WorkloadReplayImpl *) replay;
+}
+
+static WorkloadReplay *opaqueReplay(WorkloadReplayImpl *replay)
+{
+    return (WorkloadReplay *) replay;
+}
+
+/*!
+ * \brief Stores a 32 bit word in little endian.
+ * \param destination Where to store the 4 bytes.
+ * \param value The word.
+ **/
+static void storeWord(byte *destination, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        destination[i] = (byte) (value >> (8 * i));
+    }
+}
+
+/*!
+ * \brief Loads a 32 bit word in little endian.
+ * \param source The 4 bytes.
+ * \return The word.
+ **/
+static uint32_t loadWord(const byte *source)
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        value |= (uint32_t) source[i] << (8 * i);
+    }
+
+    return value;
+}
+
+/*!
+ * \brief Encodes a number as LEB128.
+ * \param destination Must hold WORKLOAD_MAX_VARINT_SIZE bytes.
+ * \param value The number.
+ * \return The amount of bytes stored.
+ **/
+static size_t storeVarint(byte *destination, uint64_t value)
+{
+    size_t size = 0;
+
+    while (value >= 0x80) {
+        destination[size++] = (byte) (value | 0x80);
+        value >>= 7;
+    }
+
+    destination[size++] = (byte) value;
+    return size;
+}
+
+/*!
+ * \brief Decodes a LEB128 number.
+ * \param source The bytes.
+ * \param size The size of `source` in bytes.
+ * \param value Output parameter for the number.
+ * \return The amount of bytes taken; 0 if `source` ends before the number.
+ **/
+static size_t loadVarint(const byte *source, size_t size, uint64_t *value)
+{
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < size && i < WORKLOAD_MAX_VARINT_SIZE; ++i) {
+        result |= (uint64_t) (source[i] & 0x7F) << (7 * i);
+
+        if ((source[i] & 0x80) == 0) {
+            *value = result;
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+uint64_t workloadNanoseconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) ((double) counter.QuadPart * 1e9
+                       / (double) frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+#endif
+}
+
+void workloadSleepUntil(uint64_t deadlineNanoseconds)
+{
+#ifdef _WIN32
+    const uint64_t now = workloadNanoseconds();
+
+    if (deadlineNanoseconds > now) {
+        Sleep((DWORD) ((deadlineNanoseconds - now) / 1000000u));
+    }
+#else
+    struct timespec deadline;
+    deadline.tv_sec  = (time_t) (deadlineNanoseconds / 1000000000u);
+    deadline.tv_nsec = (long) (deadlineNanoseconds % 1000000000u);
+
+    // Sleeping until an absolute time doesn't drift when interrupted.
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)
+           == EINTR) {
+    }
+#endif
+}
+
+WorkloadRecorder *workloadRecorderCreate(const char *path, size_t messageSize)
+{
+    WorkloadRecorderImpl *r = malloc(sizeof(WorkloadRecorderImpl));
+
+    if (r == NULL) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&r->mutex, NULL) != 0) {
+        goto errorMutex;
+    }
+
+    r->file = fopen(path, "wb");
+
+    if (r->file == NULL) {
+        goto errorFile;
+    }
+
+    // Full buffering, so that a message costs a copy rather than a write.
+    setvbuf(r->file, NULL, _IOFBF, WORKLOAD_FILE_BUFFER_SIZE);
+
+    byte header[WORKLOAD_HEADER_SIZE];
+    storeWord(header, WORKLOAD_MAGIC);
+    storeWord(header + 4, WORKLOAD_VERSION);
+    storeWord(header + 8, (uint32_t) messageSize);
+
+    if (fwrite(header, sizeof(header), 1, r->file) != 1) {
+        goto errorHeader;
+    }
+
+    r->messageSize     = messageSize;
+    r->lastNanoseconds = 0;
+    r->messageCount    = 0;
+    r->couldWrite      = true;
+    return opaqueRecorder(r);
+
+errorHeader:
+    fclose(r->file);
+errorFile:
+    pthread_mutex_destroy(&r->mutex);
+errorMutex:
+    free(r);
+    return NULL;
+}
+
+bool workloadRecorderAppend(WorkloadRecorder *recorder, const byte *message)
+{
+    WorkloadRecorderImpl *r           = implRecorder(recorder);
+    const size_t          messageSize = r->messageSize == 0 ? 1
+                                                            : r->messageSize;
+
+    if (pthread_mutex_lock(&r->mutex) != 0) {
+        return false;
+    }
+
+    // Taken under the mutex, so that the messages are recorded in the
+    // order of their timestamps.
+    const uint64_t now = workloadNanoseconds();
+    byte           delta[WORKLOAD_MAX_VARINT_SIZE];
+    const size_t   deltaSize = storeVarint(
+        delta, r->messageCount == 0 ? 0 : now - r->lastNanoseconds);
+
+    if (fwrite(delta, deltaSize, 1, r->file) != 1
+        || fwrite(message, messageSize, 1, r->file) != 1) {
+        r->couldWrite = false;
+    }
+
+    r->lastNanoseconds = now;
+    ++r->messageCount;
+
+    const bool couldWrite = r->couldWrite;
+    pthread_mutex_unlock(&r->mutex);
+    return couldWrite;
+}
+
+bool workloadRecorderFree(WorkloadRecorder *recorder, uint64_t *messageCount)
+{
+    WorkloadRecorderImpl *r = implRecorder(recorder);
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (r == NULL) {
+        return true;
+    }
+
+    if (messageCount != NULL) {
+        *messageCount = r->messageCount;
+    }
+
+    bool success = r->couldWrite;
+
+    if (fclose(r->file) != 0) {
+        success = false;
+    }
+
+    pthread_mutex_destroy(&r->mutex);
+    free(r);
+    return success;
+}
+
+WorkloadReplay *workloadReplayOpen(const char *path)
+{
+    WorkloadReplayImpl *r = malloc(sizeof(WorkloadReplayImpl));
+
+    if (r == NULL) {
+        return NULL;
+    }
+
+#ifdef _WIN32
+    // No mapping here; read the whole file instead.
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        goto errorOpen;
+    }
+
+    byte * data     = NULL;
+    size_t size     = 0;
+    size_t capacity = 0;
+
+    for (;;) {
+        if (size == capacity) {
+            capacity = capacity == 0 ? WORKLOAD_FILE_BUFFER_SIZE
+                                     : capacity * 2;
+            byte *grown = realloc(data, capacity);
+
+            if (grown == NULL) {
+                free(data);
+                fclose(file);
+                goto errorOpen;
+            }
+
+            data = grown;
+        }
+
+        const size_t bytesRead = fread(data + size, 1, capacity - size, file);
+
+        if (bytesRead == 0) {
+            break;
+        }
+
+        size += bytesRead;
+    }
+
+    fclose(file);
+    r->data = data;
+    r->size = size;
+#else
+    const int fd = open(path, O_RDONLY);
+
+    if (fd == -1) {
+        goto errorOpen;
+    }
+
+    struct stat status;
+
+    if (fstat(fd, &status) != 0 || (size_t) status.st_size == 0) {
+        close(fd);
+        goto errorOpen;
+    }
+
+    void *mapping = mmap(
+        NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps the file alive.
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        goto errorOpen;
+    }
+
+    // The replay walks the file once, front to back.
+    posix_madvise(mapping, (size_t) status.st_size, POSIX_MADV_SEQUENTIAL);
+    r->data = mapping;
+    r->size = (size_t) status.st_size;
+#endif
+
+    if (r->size < WORKLOAD_HEADER_SIZE || loadWord(r->data) != WORKLOAD_MAGIC
+        || loadWord(r->data + 4) != WORKLOAD_VERSION) {
+        fprintf(stderr, "%s is no workload file.\n", path);
+        workloadReplayFree(opaqueReplay(r));
+        return NULL;
+    }
+
+    r->messageSize = loadWord(r->data + 8);
+    return opaqueReplay(r);
+
+errorOpen:
+    free(r);
+    return NULL;
+}
+
+void workloadReplayFree(WorkloadReplay *replay)
+{
+    WorkloadReplayImpl *r = (WorkloadReplayImpl *) replay;
+
+    // If the pointer is NULL -> Do nothing (that's okay, it's no error).
+    if (r == NULL) {
+        return;
+    }
+
+#ifdef _WIN32
+    free((void *) r->data);
+#else
+    munmap((void *) r->data, r->size);
+#endif
+    free(r);
+}
+
+size_t workloadReplayMessageSize(const WorkloadReplay *replay)
+{
+    return implReplay(replay)->messageSize;
+}
+
+void workloadCursorRewind(WorkloadCursor *cursor)
+{
+    cursor->position          = WORKLOAD_HEADER_SIZE;
+    cursor->offsetNanoseconds = 0;
+}
+
+bool workloadReplayNext(
+    const WorkloadReplay *replay,
+    WorkloadCursor *      cursor,
+    const byte **         message)
+{
+    const WorkloadReplayImpl *r           = implReplay(replay);
+    const size_t              messageSize = r->messageSize == 0
+                                                ? 1
+                                                : r->messageSize;
+    uint64_t                  delta;
+    const size_t              deltaSize   = loadVarint(
+        r->data + cursor->position, r->size - cursor->position, &delta);
+
+    if (deltaSize == 0
+        || r->size - cursor->position - deltaSize < messageSize) {
+        return false;
+    }
+
+    *message = r->data + cursor->position + deltaSize;
+    cursor->position += deltaSize + messageSize;
+    cursor->offsetNanoseconds += delta;
+    return true;
+}
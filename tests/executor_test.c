@@ -0,0 +1,221 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "executor.h"
+#include "thread.h"
+
+/*!
+ * \def SUBMITTER_COUNT
+ * \brief The amount of threads submitting tasks concurrently.
+ **/
+#define SUBMITTER_COUNT 4
+
+/*!
+ * \def TASKS_PER_SUBMITTER
+ * \brief The amount of tasks each submitter submits itself.
+ *
+ * Every other task submits a child task from within the executor, so that
+ * the workers' deques are exercised as well.
+ **/
+#define TASKS_PER_SUBMITTER 25000
+
+/*!
+ * \def BATCH_SIZE
+ * \brief The amount of tasks submitted at once by `executorSubmitBatch`.
+ **/
+#define BATCH_SIZE 10
+
+/*!
+ * \def TASK_COUNT
+ * \brief The amount of tasks that must run: the submitted ones and their
+ *        children.
+ **/
+#define TASK_COUNT (SUBMITTER_COUNT * TASKS_PER_SUBMITTER * 3 / 2)
+
+/*!
+ * \def WORKER_COUNT
+ * \brief The amount of worker threads of the executor.
+ **/
+#define WORKER_COUNT 4
+
+/*!
+ * \def QUEUE_CAPACITY
+ * \brief Kept small, so that the submitters block on a full queue.
+ **/
+#define QUEUE_CAPACITY 64
+
+/*!
+ * \brief The payload of the tasks.
+ **/
+typedef struct {
+    Executor *executor; /*!< To submit the child task to */
+    size_t    index;    /*!< Index in `runCounts` */
+} TestPayload;
+
+/*!
+ * \brief How often each task has run; updated atomically.
+ **/
+static uint32_t runCounts[TASK_COUNT];
+
+/*!
+ * \brief Set by tasks that fail to submit their child.
+ **/
+static bool couldSubmitChildren = true;
+
+static void childTask(void *payload)
+{
+    const TestPayload *testPayload = payload;
+    __atomic_add_fetch(&runCounts[testPayload->index], 1, __ATOMIC_RELAXED);
+}
+
+static void parentTask(void *payload)
+{
+    const TestPayload *testPayload = payload;
+    __atomic_add_fetch(&runCounts[testPayload->index], 1, __ATOMIC_RELAXED);
+
+    // Only the even tasks have a child, which takes an index after all the
+    // submitted tasks.
+    if (testPayload->index % 2 != 0) {
+        return;
+    }
+
+    const TestPayload child
+        = {testPayload->executor,
+           SUBMITTER_COUNT * TASKS_PER_SUBMITTER + testPayload->index / 2};
+
+    if (RB_FAILURE(executorSubmit(
+            testPayload->executor, &childTask, &child, sizeof(child)))) {
+        __atomic_store_n(&couldSubmitChildren, false, __ATOMIC_RELAXED);
+    }
+}
+
+/*!
+ * \brief Submits a submitter's share of the tasks, the odd submitters one
+ *        at a time, the even ones in batches.
+ **/
+static int submitterFunction(
+    RingBuffer *ringBuffer,
+    int32_t     sleepTimeSeconds,
+    int         id,
+    Thread *    self)
+{
+    (void) ringBuffer;
+    (void) sleepTimeSeconds;
+    Executor *   executor = threadContext(self);
+    const size_t first    = (size_t) id * TASKS_PER_SUBMITTER;
+
+    if (id % 2 != 0) {
+        for (size_t i = 0; i < TASKS_PER_SUBMITTER; ++i) {
+            const TestPayload payload = {executor, first + i};
+
+            if (RB_FAILURE(executorSubmit(
+                    executor, &parentTask, &payload, sizeof(payload)))) {
+                return EXIT_FAILURE;
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    ExecutorTask batch[BATCH_SIZE];
+
+    for (size_t i = 0; i < TASKS_PER_SUBMITTER; i += BATCH_SIZE) {
+        for (size_t j = 0; j < BATCH_SIZE; ++j) {
+            const TestPayload payload = {executor, first + i + j};
+
+            batch[j].function = &parentTask;
+            memcpy(batch[j].payload, &payload, sizeof(payload));
+        }
+
+        if (RB_FAILURE(executorSubmitBatch(executor, batch, BATCH_SIZE))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Submits tasks from several threads at once and checks that every
+ *        one of them has run exactly once when `executorWaitAll` returns.
+ **/
+int main(void)
+{
+    Executor *executor = NULL;
+
+    if (RB_FAILURE(executorCreate(WORKER_COUNT, QUEUE_CAPACITY, &executor))) {
+        fprintf(stderr, "Could not create the executor.\n");
+        return EXIT_FAILURE;
+    }
+
+    int     exitStatus = EXIT_SUCCESS;
+    Thread *submitters[SUBMITTER_COUNT];
+
+    for (int i = 0; i < SUBMITTER_COUNT; ++i) {
+        submitters[i] = threadCreateWithContext(
+            &submitterFunction, NULL, 0, i, executor);
+
+        if (submitters[i] == NULL) {
+            fprintf(stderr, "Could not create submitter %d.\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (int i = 0; i < SUBMITTER_COUNT; ++i) {
+        int submitterExitStatus;
+
+        if (!threadFree(submitters[i], &submitterExitStatus)
+            || submitterExitStatus != EXIT_SUCCESS) {
+            fprintf(stderr, "Submitter %d failed.\n", i);
+            exitStatus = EXIT_FAILURE;
+        }
+    }
+
+    if (RB_FAILURE(executorWaitAll(executor))) {
+        fprintf(stderr, "Could not wait for the tasks.\n");
+        exitStatus = EXIT_FAILURE;
+    }
+
+    if (!couldSubmitChildren) {
+        fprintf(stderr, "Could not submit the child tasks.\n");
+        exitStatus = EXIT_FAILURE;
+    }
+
+    size_t wrongCount = 0;
+
+    for (size_t i = 0; i < TASK_COUNT; ++i) {
+        const uint32_t runCount
+            = __atomic_load_n(&runCounts[i], __ATOMIC_RELAXED);
+
+        if (runCount != 1) {
+            if (wrongCount == 0) {
+                fprintf(stderr, "Task %zu ran %u times.\n", i, runCount);
+            }
+
+            ++wrongCount;
+        }
+    }
+
+    if (wrongCount != 0) {
+        fprintf(
+            stderr,
+            "%zu of %d tasks didn't run once.\n",
+            wrongCount,
+            TASK_COUNT);
+        exitStatus = EXIT_FAILURE;
+    }
+
+    if (RB_FAILURE(executorFree(executor))) {
+        fprintf(stderr, "Could not free the executor.\n");
+        exitStatus = EXIT_FAILURE;
+    }
+
+    if (exitStatus == EXIT_SUCCESS) {
+        printf("All %d tasks ran exactly once.\n", TASK_COUNT);
+    }
+
+    return exitStatus;
+}